@@ -0,0 +1,201 @@
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <vector>
+#include <DirectXMath.h>
+
+#include "benchmark_support.h"
+#include "common.h"
+#include "courtyard.h"
+#include "object_loader.h"
+#include "occlusion_baker.h"
+#include "task_scheduler.h"
+#include "triangle_bvh.h"
+
+// OcclusionBaker on the courtyard of the lightmap benchmark, with the gap in
+// the south wall closed. Bakes per vertex, reporting how many of the repeated
+// triangle list vertices were traced, then per texel. Packets (--packet rays
+// sharing an origin) are compared with the same rays traced one by one, both
+// for speed and for the result. A wall loaded from an OBJ file, with a
+// large panel close behind it, has to come out open on the side it faces in
+// the file.
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+    constexpr std::size_t COMPARED_POINTS = 4096;
+
+    struct Settings {
+        std::uint32_t rays = 64;
+        std::uint32_t size = 256;
+        int cells = 64;
+        unsigned workers = 0;
+        std::uint32_t packet = 8;
+    };
+
+    // The wall faces -z in the file, the panel is half a meter behind it; the loader turns both
+    // around the y axis, normals included.
+    const char* MIRRORED_WALL =
+            "v -1 0 0\nv 1 0 0\nv 1 2 0\nv -1 2 0\n"
+            "v -10 -9 0.5\nv 10 -9 0.5\nv 10 11 0.5\nv -10 11 0.5\n"
+            "vn 0 0 -1\nvn 0 0 1\n"
+            "f 1//1 4//1 3//1 2//1\n"
+            "f 5//2 6//2 7//2 8//2\n";
+
+    float get_mean(const std::vector<float>& values) {
+        double sum = 0.0;
+
+        for (float value : values) {
+            sum += value;
+        }
+
+        return values.empty() ? 0.0f : static_cast<float>(sum / static_cast<double>(values.size()));
+    }
+
+    void check_mirrored_wall(Checks& check, TaskScheduler& scheduler, std::uint32_t rays) {
+        ScratchDirectory scratch("ao_benchmark");
+        const std::filesystem::path& directory = scratch.get_path();
+
+        {
+            std::ofstream file(directory / "wall.obj", std::ios::binary);
+            file << MIRRORED_WALL;
+        }
+
+        ObjectLoader loader((directory / "wall").string(), {1.0f, 1.0f, 1.0f, 1.0f});
+        check(SUCCEEDED(loader.load()), "the mirrored wall loads");
+
+        std::vector<Vertex> vertices = loader.take_vertices();
+
+        TriangleBvh bvh;
+        bvh.build(vertices);
+
+        OcclusionBaker::Options options;
+        options.rays = rays;
+        OcclusionBaker baker(vertices, bvh, options);
+        std::vector<float> occlusion = baker.bake_vertices(scheduler);
+
+        std::vector<float> wall;
+
+        for (std::size_t i = 0; i < vertices.size(); i++) {
+            if (std::fabs(vertices[i].position.z) < 1e-4f) {
+                wall.push_back(occlusion[i]);
+            }
+        }
+
+        check(wall.size() == 6, "the mirrored wall has two triangles");
+        check(get_mean(wall) > 0.9f, "the mirrored wall is open on the side it faces");
+    }
+}
+
+int main(int argc, char** argv) {
+    Settings settings;
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--rays") == 0 && i + 1 < argc) {
+            settings.rays = static_cast<std::uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (std::strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+            settings.size = static_cast<std::uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (std::strcmp(argv[i], "--cells") == 0 && i + 1 < argc) {
+            settings.cells = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--packet") == 0 && i + 1 < argc) {
+            settings.packet = static_cast<std::uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (std::strcmp(argv[i], "--workers") == 0 && i + 1 < argc) {
+            settings.workers = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else {
+            std::printf("usage: %s [--rays N] [--size <texels>] [--cells N] [--packet N] [--workers N]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (settings.rays == 0 || settings.size == 0 || settings.cells <= 0 || settings.packet == 0 ||
+        settings.packet > TriangleBvh::MAX_PACKET_SIZE || 64 % settings.packet != 0) {
+        std::printf("--rays, --size and --cells must be positive, --packet a divisor of 64 up to %u\n", TriangleBvh::MAX_PACKET_SIZE);
+        return 1;
+    }
+
+    std::vector<Vertex> vertices = make_courtyard(settings.cells, 0.0f);
+    TriangleBvh bvh;
+    bvh.build(vertices);
+
+    TaskScheduler scheduler(TaskScheduler::Options{settings.workers});
+
+    OcclusionBaker::Options options;
+    options.rays = settings.rays;
+    OcclusionBaker baker(vertices, bvh, options);
+
+    std::printf("%zu triangles, %u rays per point, %u workers\n\n", vertices.size() / 3, settings.rays, scheduler.get_worker_count());
+
+    std::vector<float> vertex_occlusion = baker.bake_vertices(scheduler);
+    OcclusionBaker::Statistics statistics = baker.get_statistics();
+    std::printf("per vertex  %zu vertices, %zu distinct (%.1fx fewer)  %.1f ms  %.2f Mrays/s  mean %.3f\n",
+                vertices.size(),
+                statistics.points,
+                static_cast<double>(vertices.size()) / static_cast<double>(statistics.points),
+                statistics.bake_ms,
+                statistics.rays_per_second / 1e6,
+                get_mean(vertex_occlusion));
+
+    std::vector<float> texel_occlusion = baker.bake_texels(scheduler, settings.size, settings.size);
+    statistics = baker.get_statistics();
+    std::printf("per texel   %zu texels (%u x %u)  %.1f ms  %.2f Mrays/s\n",
+                statistics.points, settings.size, settings.size, statistics.bake_ms, statistics.rays_per_second / 1e6);
+
+    // Packets against single rays: random floor points, 64 cosine weighted directions each, every packet
+    // covering its own slice of azimuths like the rays of the baker.
+    std::mt19937 rng(39);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::size_t compared_rays = 0;
+    std::size_t mismatches = 0;
+    double packet_ms = 0.0;
+    double single_ms = 0.0;
+    std::uint32_t packet = settings.packet;
+
+    for (std::size_t point = 0; point < COMPARED_POINTS; point++) {
+        DirectX::XMFLOAT3 origin = {12.0f * unit(rng) - 6.0f, 1e-3f, 12.0f * unit(rng) - 6.0f};
+        std::vector<DirectX::XMFLOAT3> directions(64);
+
+        for (std::size_t i = 0; i < directions.size(); i++) {
+            float radius = std::sqrt(unit(rng));
+            float angle = 2.0f * DirectX::XM_PI * (static_cast<float>(i / packet) + unit(rng)) / static_cast<float>(directions.size() / packet);
+            directions[i] = {radius * std::cos(angle), std::sqrt(std::max(0.0f, 1.0f - radius * radius)), radius * std::sin(angle)};
+        }
+
+        for (std::size_t first = 0; first < directions.size(); first += packet) {
+            auto packet_start = Clock::now();
+            std::uint32_t mask = bvh.occluded(origin, &directions[first], packet, options.max_distance);
+            packet_ms += std::chrono::duration<double, std::milli>(Clock::now() - packet_start).count();
+
+            std::uint32_t expected = 0;
+            auto single_start = Clock::now();
+
+            for (std::uint32_t i = 0; i < packet; i++) {
+                expected |= static_cast<std::uint32_t>(bvh.occluded({origin, directions[first + i]}, options.max_distance)) << i;
+            }
+
+            single_ms += std::chrono::duration<double, std::milli>(Clock::now() - single_start).count();
+            mismatches += static_cast<std::size_t>(std::popcount(mask ^ expected));
+            compared_rays += packet;
+        }
+    }
+
+    std::printf("\npackets of %u  %.2f Mrays/s\n", packet, static_cast<double>(compared_rays) / (packet_ms * 1e3));
+    std::printf("single rays    %.2f Mrays/s\n", static_cast<double>(compared_rays) / (single_ms * 1e3));
+    std::printf("%zu / %zu rays agree, packets %.2fx faster\n", compared_rays - mismatches, compared_rays, single_ms / packet_ms);
+
+    Checks check;
+    check_mirrored_wall(check, scheduler, settings.rays);
+
+    return mismatches == 0 && check.passed() ? 0 : 1;
+}
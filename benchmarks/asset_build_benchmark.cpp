@@ -0,0 +1,495 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "asset_builder.h"
+#include "benchmark_support.h"
+#include "common.h"
+#include "mesh_codec.h"
+#include "task_scheduler.h"
+#include "texture_codec.h"
+
+// Incremental asset builds. A library of --models OBJ height fields of about
+// --size KiB sharing a material library and of --textures PNG files of
+// --texture-size texels is written to the temporary directory and built with
+// AssetBuilder: from an empty cache, again without changes, after one
+// texture was edited, after a model was saved without changes and after the
+// material library was edited. Each build has to run exactly the steps that
+// depend on what changed, a damaged texture has to fail its own steps only,
+// and a clean build into another directory has to give the same files.
+// The outputs are checked too: the BC error of a texture, the triangle counts
+// of the levels of detail and the meshlets, which have to keep to their
+// limits and cover every triangle of the mesh once.
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+    constexpr unsigned LOD_LEVELS = 3;
+    constexpr unsigned LOD_CELLS = 32;
+    constexpr std::size_t MESHLET_VERTICES = 64;
+    constexpr std::size_t MESHLET_TRIANGLES = 124;
+
+    struct Settings {
+        int models = 16;
+        int size = 256;
+        int textures = 32;
+        int texture_size = 512;
+    };
+
+    void append_big_endian(std::vector<std::uint8_t>& out, std::uint32_t value) {
+        for (int shift = 24; shift >= 0; shift -= 8) {
+            out.push_back(static_cast<std::uint8_t>(value >> shift));
+        }
+    }
+
+    std::uint32_t get_crc32(const std::uint8_t* data, std::size_t size) {
+        std::uint32_t crc = 0xFFFFFFFFu;
+
+        for (std::size_t i = 0; i < size; i++) {
+            crc ^= data[i];
+
+            for (int bit = 0; bit < 8; bit++) {
+                crc = (crc & 1) ? 0xEDB88320u ^ (crc >> 1) : crc >> 1;
+            }
+        }
+
+        return crc ^ 0xFFFFFFFFu;
+    }
+
+    void append_chunk(std::vector<std::uint8_t>& png, const char* type, const std::vector<std::uint8_t>& data) {
+        append_big_endian(png, static_cast<std::uint32_t>(data.size()));
+        std::size_t start = png.size();
+        png.insert(png.end(), type, type + 4);
+        png.insert(png.end(), data.begin(), data.end());
+        append_big_endian(png, get_crc32(png.data() + start, png.size() - start));
+    }
+
+    // RGB or RGBA, every row with the Sub filter, in stored deflate blocks (a PNG encoder is not
+    // part of the project; the decoder only has to read such files like compressed ones).
+    std::vector<std::uint8_t> encode_png(const Image& image, bool alpha) {
+        std::size_t channels = alpha ? 4 : 3;
+        std::vector<std::uint8_t> filtered;
+
+        for (std::uint32_t y = 0; y < image.height; y++) {
+            filtered.push_back(1);
+
+            for (std::uint32_t x = 0; x < image.width; x++) {
+                for (std::size_t channel = 0; channel < channels; channel++) {
+                    std::size_t index = (static_cast<std::size_t>(y) * image.width + x) * 4 + channel;
+                    std::uint8_t left = x > 0 ? image.pixels[index - 4] : 0;
+                    filtered.push_back(static_cast<std::uint8_t>(image.pixels[index] - left));
+                }
+            }
+        }
+
+        std::vector<std::uint8_t> zlib = {0x78, 0x01};
+
+        for (std::size_t position = 0; position < filtered.size();) {
+            std::size_t length = std::min<std::size_t>(filtered.size() - position, 65535);
+            zlib.push_back(position + length == filtered.size() ? 1 : 0);
+            zlib.push_back(static_cast<std::uint8_t>(length));
+            zlib.push_back(static_cast<std::uint8_t>(length >> 8));
+            zlib.push_back(static_cast<std::uint8_t>(~length));
+            zlib.push_back(static_cast<std::uint8_t>(~length >> 8));
+            zlib.insert(zlib.end(), filtered.begin() + static_cast<std::ptrdiff_t>(position),
+                        filtered.begin() + static_cast<std::ptrdiff_t>(position + length));
+            position += length;
+        }
+
+        std::uint32_t a = 1;
+        std::uint32_t b = 0;
+
+        for (std::uint8_t byte : filtered) {
+            a = (a + byte) % 65521;
+            b = (b + a) % 65521;
+        }
+
+        append_big_endian(zlib, (b << 16) | a);
+
+        std::vector<std::uint8_t> header;
+        append_big_endian(header, image.width);
+        append_big_endian(header, image.height);
+        header.insert(header.end(), {8, static_cast<std::uint8_t>(alpha ? 6 : 2), 0, 0, 0});
+
+        std::vector<std::uint8_t> png = {137, 80, 78, 71, 13, 10, 26, 10};
+        append_chunk(png, "IHDR", header);
+        append_chunk(png, "IDAT", zlib);
+        append_chunk(png, "IEND", {});
+        return png;
+    }
+
+    // Smooth gradients with some noise, like a photograph
+    Image make_texture(std::uint32_t size, bool alpha, std::uint32_t& state) {
+        Image image;
+        image.width = size;
+        image.height = size;
+        image.pixels.resize(static_cast<std::size_t>(size) * size * 4);
+        float phase = static_cast<float>(next_random(state) % 1000) / 100.0f;
+
+        for (std::uint32_t y = 0; y < size; y++) {
+            for (std::uint32_t x = 0; x < size; x++) {
+                std::uint8_t* texel = image.pixels.data() + (static_cast<std::size_t>(y) * size + x) * 4;
+                float u = static_cast<float>(x) / static_cast<float>(size) * 6.0f;
+                float v = static_cast<float>(y) / static_cast<float>(size) * 6.0f;
+                int noise = static_cast<int>(next_random(state) % 9) - 4;
+                texel[0] = static_cast<std::uint8_t>(std::clamp(static_cast<int>(128.0f + 100.0f * std::sin(u + phase)) + noise, 0, 255));
+                texel[1] = static_cast<std::uint8_t>(std::clamp(static_cast<int>(128.0f + 100.0f * std::cos(v - phase)) + noise, 0, 255));
+                texel[2] = static_cast<std::uint8_t>(std::clamp(static_cast<int>(128.0f + 60.0f * std::sin(u + v)) + noise, 0, 255));
+                texel[3] = alpha ? static_cast<std::uint8_t>(x * 255 / std::max(size - 1, 1u)) : 255;
+            }
+        }
+
+        return image;
+    }
+
+    // Height field of quads, two triangles each
+    bool write_model(const std::filesystem::path& path, std::size_t size, std::uint32_t& state) {
+        int quads_per_side = std::max(2, static_cast<int>(std::sqrt(static_cast<double>(size) / 80.0)));
+        int vertices_per_side = quads_per_side + 1;
+        std::ofstream file(path, std::ios::binary);
+        char line[128];
+
+        file << "mtllib materials.mtl\nusemtl surface\n";
+
+        for (int z = 0; z < vertices_per_side; z++) {
+            for (int x = 0; x < vertices_per_side; x++) {
+                float height = std::sin(static_cast<float>(x) * 0.2f) * std::cos(static_cast<float>(z) * 0.15f) * 4.0f +
+                               static_cast<float>(next_random(state) % 100) / 500.0f;
+                int length = std::snprintf(line, sizeof(line), "v %.4f %.4f %.4f\n", static_cast<float>(x), height, static_cast<float>(z));
+                file.write(line, length);
+            }
+        }
+
+        for (int z = 0; z < quads_per_side; z++) {
+            for (int x = 0; x < quads_per_side; x++) {
+                int corner = z * vertices_per_side + x + 1;
+                int length = std::snprintf(line, sizeof(line), "f %d %d %d\nf %d %d %d\n", corner, corner + vertices_per_side, corner + 1,
+                                           corner + 1, corner + vertices_per_side, corner + vertices_per_side + 1);
+                file.write(line, length);
+            }
+        }
+
+        return file.good();
+    }
+
+    bool write_materials(const std::filesystem::path& path, float red) {
+        std::ofstream file(path, std::ios::binary);
+        file << "newmtl surface\nKd " << red << " 0.6 0.4\n";
+        return file.good();
+    }
+
+    bool write_bytes(const std::filesystem::path& path, const std::vector<std::uint8_t>& data) {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+        return file.good();
+    }
+
+    std::vector<std::uint8_t> read_bytes(const std::filesystem::path& path) {
+        std::ifstream file(path, std::ios::binary);
+        return {std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+    }
+
+    std::uint32_t read_u32(const std::vector<std::uint8_t>& data, std::size_t offset) {
+        std::uint32_t value = 0;
+
+        if (offset + sizeof(value) <= data.size()) {
+            std::memcpy(&value, data.data() + offset, sizeof(value));
+        }
+
+        return value;
+    }
+
+    std::array<std::uint32_t, 3> get_canonical(std::uint32_t a, std::uint32_t b, std::uint32_t c) {
+        std::array<std::uint32_t, 3> triangle = {a, b, c};
+        std::rotate(triangle.begin(), std::min_element(triangle.begin(), triangle.end()), triangle.end());
+        return triangle;
+    }
+
+    // Every meshlet within the limits and every triangle of the mesh in exactly one of them.
+    bool check_meshlets(const std::vector<std::uint8_t>& file, const std::vector<std::uint32_t>& indices) {
+        constexpr std::size_t HEADER_BYTES = 5 * sizeof(std::uint32_t);
+        constexpr std::size_t MESHLET_BYTES = 4 * sizeof(std::uint32_t) + 6 * sizeof(float);
+
+        std::uint32_t meshlet_count = read_u32(file, 8);
+        std::uint32_t vertex_index_count = read_u32(file, 12);
+        std::uint32_t triangle_index_count = read_u32(file, 16);
+        std::size_t vertex_indices = HEADER_BYTES + meshlet_count * MESHLET_BYTES;
+        std::size_t triangle_indices = vertex_indices + vertex_index_count * sizeof(std::uint32_t);
+
+        if (read_u32(file, 0) != 0x4C4D3350 || file.size() != triangle_indices + triangle_index_count) {
+            return false;
+        }
+
+        std::vector<std::array<std::uint32_t, 3>> covered;
+
+        for (std::uint32_t i = 0; i < meshlet_count; i++) {
+            std::size_t meshlet = HEADER_BYTES + i * MESHLET_BYTES;
+            std::uint32_t vertex_offset = read_u32(file, meshlet);
+            std::uint32_t vertex_count = read_u32(file, meshlet + 4);
+            std::uint32_t triangle_offset = read_u32(file, meshlet + 8);
+            std::uint32_t triangle_count = read_u32(file, meshlet + 12);
+
+            if (vertex_count > MESHLET_VERTICES || triangle_count > MESHLET_TRIANGLES ||
+                vertex_offset + vertex_count > vertex_index_count || (triangle_offset + triangle_count) * 3 > triangle_index_count) {
+                return false;
+            }
+
+            for (std::uint32_t triangle = triangle_offset; triangle < triangle_offset + triangle_count; triangle++) {
+                std::uint32_t corners[3];
+
+                for (int corner = 0; corner < 3; corner++) {
+                    std::uint8_t local = file[triangle_indices + triangle * 3 + corner];
+
+                    if (local >= vertex_count) {
+                        return false;
+                    }
+
+                    corners[corner] = read_u32(file, vertex_indices + (vertex_offset + local) * sizeof(std::uint32_t));
+                }
+
+                covered.push_back(get_canonical(corners[0], corners[1], corners[2]));
+            }
+        }
+
+        std::vector<std::array<std::uint32_t, 3>> expected;
+
+        for (std::size_t i = 0; i + 2 < indices.size(); i += 3) {
+            expected.push_back(get_canonical(indices[i], indices[i + 1], indices[i + 2]));
+        }
+
+        std::sort(covered.begin(), covered.end());
+        std::sort(expected.begin(), expected.end());
+        return covered == expected;
+    }
+
+    std::size_t count_triangles(const std::filesystem::path& path) {
+        std::vector<std::uint8_t> data = read_bytes(path);
+        std::vector<Vertex> vertices;
+        std::vector<std::uint32_t> indices;
+        return SUCCEEDED(decode_mesh(data.data(), data.size(), vertices, indices)) ? indices.size() / 3 : 0;
+    }
+
+    // Root mean square difference per channel between the first level of the DDS and the image
+    double get_block_error(const std::vector<std::uint8_t>& dds, const Image& image) {
+        constexpr std::size_t HEADER_BYTES = 128;
+
+        if (dds.size() < HEADER_BYTES) {
+            return 1e9;
+        }
+
+        BlockFormat format = read_u32(dds, 84) == 0x31545844 ? BlockFormat::BC1 : BlockFormat::BC3;
+        Image decoded;
+
+        if (FAILED(decode_blocks(dds.data() + HEADER_BYTES, dds.size() - HEADER_BYTES, format, image.width, image.height, decoded))) {
+            return 1e9;
+        }
+
+        double sum = 0.0;
+
+        for (std::size_t i = 0; i < image.pixels.size(); i++) {
+            double difference = static_cast<double>(image.pixels[i]) - static_cast<double>(decoded.pixels[i]);
+            sum += difference * difference;
+        }
+
+        return std::sqrt(sum / static_cast<double>(image.pixels.size()));
+    }
+
+    struct Run {
+        const char* name;
+        HRESULT hr;
+        double ms;
+        AssetBuilder::Statistics statistics;
+    };
+}
+
+int main(int argc, char** argv) {
+    Settings settings;
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--models") == 0 && i + 1 < argc) {
+            settings.models = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+            settings.size = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--textures") == 0 && i + 1 < argc) {
+            settings.textures = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--texture-size") == 0 && i + 1 < argc) {
+            settings.texture_size = std::atoi(argv[++i]);
+        }
+        else {
+            std::printf("usage: %s [--models N] [--size <KiB>] [--textures N] [--texture-size <texels>]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    // The second texture is edited and the fourth, the first with alpha, checked
+    if (settings.models <= 0 || settings.size <= 0 || settings.textures < 4 || settings.texture_size <= 0) {
+        std::printf("--models, --size and --texture-size must be positive, --textures at least 4\n");
+        return 1;
+    }
+
+    ScratchDirectory scratch("asset_build_benchmark");
+    const std::filesystem::path& directory = scratch.get_path();
+    std::filesystem::path sources = directory / "sources";
+    std::filesystem::path output = directory / "output";
+    std::filesystem::create_directories(sources / "models");
+    std::filesystem::create_directories(sources / "textures");
+
+    Checks check;
+
+    std::uint32_t state = 1;
+    bool written = write_materials(sources / "models" / "materials.mtl", 0.8f);
+    std::vector<Image> textures;
+
+    for (int i = 0; i < settings.models; i++) {
+        char name[32];
+        std::snprintf(name, sizeof(name), "model_%03d.obj", i);
+        written = write_model(sources / "models" / name, static_cast<std::size_t>(settings.size) << 10, state) && written;
+    }
+
+    for (int i = 0; i < settings.textures; i++) {
+        char name[32];
+        std::snprintf(name, sizeof(name), "texture_%03d.png", i);
+        textures.push_back(make_texture(static_cast<std::uint32_t>(settings.texture_size), i % 4 == 3, state));
+        written = write_bytes(sources / "textures" / name, encode_png(textures.back(), i % 4 == 3)) && written;
+    }
+
+    check(written, "the library is written");
+
+    TaskScheduler& scheduler = TaskScheduler::get_default();
+    AssetBuilder::Options options;
+    options.lod_levels = LOD_LEVELS;
+    options.lod_cells = LOD_CELLS;
+    options.meshlet_vertices = MESHLET_VERTICES;
+    options.meshlet_triangles = MESHLET_TRIANGLES;
+
+    std::vector<Run> runs;
+    auto build = [&](const char* name, const std::filesystem::path& output_directory) {
+        AssetBuilder builder(sources, output_directory, options);
+        auto start = Clock::now();
+        HRESULT hr = builder.build(scheduler);
+        runs.push_back({name, hr, get_ms(start), builder.get_statistics()});
+        return runs.back();
+    };
+
+    const std::uint64_t model_steps = 2 + LOD_LEVELS;
+    const std::uint64_t steps = settings.models * model_steps + settings.textures * 2;
+    const std::uint64_t outputs = settings.models * model_steps + settings.textures;
+    const std::uint64_t sources_count = settings.models + settings.textures + 1;
+
+    Run cold = build("cold", output);
+    check(SUCCEEDED(cold.hr), "the library builds");
+    check(cold.statistics.sources == sources_count && cold.statistics.steps == steps, "every source gives its steps");
+    check(cold.statistics.built_steps == steps && cold.statistics.written_outputs == outputs, "a cold build runs every step");
+
+    Run unchanged = build("unchanged", output);
+    check(SUCCEEDED(unchanged.hr), "the build without changes succeeds");
+    check(unchanged.statistics.hashed_sources == 0, "unchanged sources are not read again");
+    check(unchanged.statistics.built_steps == 0 && unchanged.statistics.cached_steps == steps &&
+          unchanged.statistics.written_outputs == 0, "without changes nothing is built or written");
+
+    std::filesystem::path edited = output / "textures" / "texture_001.dds";
+    std::vector<std::uint8_t> before_edit = read_bytes(edited);
+    textures[1] = make_texture(static_cast<std::uint32_t>(settings.texture_size), false, state);
+    check(write_bytes(sources / "textures" / "texture_001.png", encode_png(textures[1], false)), "the texture is edited");
+
+    Run texture = build("texture", output);
+    check(SUCCEEDED(texture.hr), "the build after a texture edit succeeds");
+    check(texture.statistics.hashed_sources == 1 && texture.statistics.built_steps == 2 &&
+          texture.statistics.written_outputs == 1, "a texture edit runs the steps of that texture only");
+    check(read_bytes(edited) != before_edit, "the edited texture is written again");
+
+    std::filesystem::path saved = sources / "models" / "model_000.obj";
+    check(write_bytes(saved, read_bytes(saved)), "the model is saved");
+
+    Run touched = build("saved", output);
+    check(touched.statistics.hashed_sources == 1 && touched.statistics.built_steps == 0 &&
+          touched.statistics.written_outputs == 0, "a model saved without changes is hashed again but not built");
+
+    check(write_materials(sources / "models" / "materials.mtl", 0.5f), "the materials are edited");
+
+    Run materials = build("materials", output);
+    check(SUCCEEDED(materials.hr), "the build after a material edit succeeds");
+    check(materials.statistics.built_steps == settings.models * model_steps &&
+          materials.statistics.written_outputs == settings.models * model_steps, "a material edit rebuilds the models only");
+
+    check(write_bytes(sources / "textures" / "damaged.png", {137, 80, 78, 71, 13, 10, 26, 10, 0, 0}), "the damaged texture is written");
+
+    Run damaged = build("damaged", output);
+    check(FAILED(damaged.hr), "a damaged texture fails the build");
+    check(damaged.statistics.failed_steps == 2 && damaged.statistics.built_steps == 0 &&
+          damaged.statistics.cached_steps == steps, "a damaged texture fails its own steps only");
+    std::filesystem::remove(sources / "textures" / "damaged.png");
+
+    Run clean = build("clean", directory / "clean");
+    check(SUCCEEDED(clean.hr) && clean.statistics.built_steps == steps, "a clean build runs every step");
+
+    bool identical = true;
+
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(directory / "clean")) {
+        std::filesystem::path relative = entry.path().lexically_relative(directory / "clean");
+
+        if (entry.is_regular_file() && *relative.begin() != ".cache") {
+            identical = identical && read_bytes(entry.path()) == read_bytes(output / relative);
+        }
+    }
+
+    check(identical, "a clean build gives the same files");
+
+    for (int i : {0, 3}) {
+        char name[32];
+        std::snprintf(name, sizeof(name), "texture_%03d.dds", i);
+        std::vector<std::uint8_t> dds = read_bytes(output / "textures" / name);
+        check(read_u32(dds, 28) == static_cast<std::uint32_t>(std::log2(settings.texture_size)) + 1, "the DDS has the full mip chain");
+        check(read_u32(dds, 84) == (i == 3 ? 0x35545844u : 0x31545844u), "opaque textures are BC1 and others BC3");
+        check(get_block_error(dds, textures[static_cast<std::size_t>(i)]) < 12.0, "the BC error is small");
+    }
+
+    std::vector<std::uint8_t> mesh = read_bytes(output / "models" / "model_000.mesh");
+    std::vector<Vertex> vertices;
+    std::vector<std::uint32_t> indices;
+    check(SUCCEEDED(decode_mesh(mesh.data(), mesh.size(), vertices, indices)), "the mesh decodes");
+    check(check_meshlets(read_bytes(output / "models" / "model_000.meshlets"), indices), "the meshlets cover the mesh within their limits");
+
+    std::vector<std::size_t> triangles = {indices.size() / 3};
+
+    for (unsigned level = 1; level <= LOD_LEVELS; level++) {
+        triangles.push_back(count_triangles(output / "models" / ("model_000.lod" + std::to_string(level) + ".mesh")));
+        check(triangles.back() > 0 && triangles.back() < triangles[level - 1], "every level of detail has fewer triangles");
+    }
+
+    std::printf("%d models of %d KiB, %d textures of %dx%d, %llu steps, %u workers\n", settings.models, settings.size,
+                settings.textures, settings.texture_size, settings.texture_size, static_cast<unsigned long long>(steps),
+                scheduler.get_worker_count());
+    std::printf("%10s %10s %8s %8s %8s %8s %8s\n", "build", "ms", "hashed", "built", "cached", "failed", "written");
+
+    for (const Run& run : runs) {
+        std::printf("%10s %10.2f %8llu %8llu %8llu %8llu %8llu\n", run.name, run.ms,
+                    static_cast<unsigned long long>(run.statistics.hashed_sources),
+                    static_cast<unsigned long long>(run.statistics.built_steps),
+                    static_cast<unsigned long long>(run.statistics.cached_steps),
+                    static_cast<unsigned long long>(run.statistics.failed_steps),
+                    static_cast<unsigned long long>(run.statistics.written_outputs));
+    }
+
+    std::printf("triangles of model_000 and its levels of detail:");
+
+    for (std::size_t count : triangles) {
+        std::printf(" %zu", count);
+    }
+
+    std::printf("\n");
+    return check.passed() ? 0 : 1;
+}
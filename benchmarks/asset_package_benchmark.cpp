@@ -0,0 +1,288 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "asset_package.h"
+#include "benchmark_support.h"
+
+// Loose files against an asset package. --files files of about --size KiB
+// are written to the temporary directory, alternating between OBJ-like text
+// and random bytes standing in for already compressed textures, and packed
+// with compression. Reported are the size of the package, the time to open
+// and read every file loose (ifstream, like the loaders) and from the package
+// (one open and mapping, get() of every entry), and the time to look up a
+// name. On Linux the files are also read cold, after dropping them from the
+// page cache with posix_fadvise. Every entry has to match its file, stored
+// blobs have to be 64 KiB apart and missing names and damaged packages have
+// to be reported.
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+    constexpr int LOOKUPS = 1000000;
+
+    struct Settings {
+        int files = 500;
+        int size = 64;
+    };
+
+    std::vector<std::uint8_t> make_file(int index, std::size_t size, std::uint32_t& state) {
+        std::vector<std::uint8_t> data;
+        data.reserve(size + 64);
+
+        if (index % 2 == 1) {
+            while (data.size() < size) {
+                data.push_back(static_cast<std::uint8_t>(next_random(state)));
+            }
+
+            return data;
+        }
+
+        char line[64];
+
+        while (data.size() < size) {
+            int length = std::snprintf(line, sizeof(line), "v %f %f %f\n",
+                                       static_cast<float>(next_random(state) % 20000) / 100.0f - 100.0f,
+                                       static_cast<float>(next_random(state) % 20000) / 100.0f - 100.0f,
+                                       static_cast<float>(next_random(state) % 20000) / 100.0f - 100.0f);
+            data.insert(data.end(), line, line + length);
+        }
+
+        return data;
+    }
+
+    std::string get_name(const std::filesystem::path& directory, int index) {
+        char name[32];
+        std::snprintf(name, sizeof(name), index % 2 == 0 ? "mesh_%04d.obj" : "texture_%04d.png", index);
+        return (directory / name).generic_string();
+    }
+
+    std::uint64_t get_checksum(const std::uint8_t* data, std::size_t size) {
+        std::uint64_t checksum = 0;
+
+        for (std::size_t i = 0; i < size; i++) {
+            checksum = checksum * 31 + data[i];
+        }
+
+        return checksum;
+    }
+
+    std::uint64_t read_loose(const std::vector<std::string>& names) {
+        std::uint64_t checksum = 0;
+
+        for (const auto& name : names) {
+            std::ifstream file(name, std::ios::binary | std::ios::ate);
+            std::vector<std::uint8_t> data(static_cast<std::size_t>(file.tellg()));
+            file.seekg(0);
+            file.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(data.size()));
+            checksum += get_checksum(data.data(), data.size());
+        }
+
+        return checksum;
+    }
+
+    std::uint64_t read_package(const std::filesystem::path& path, const std::vector<std::string>& names) {
+        AssetPackage package;
+        std::vector<std::uint8_t> storage;
+        std::uint64_t checksum = 0;
+
+        if (FAILED(package.open(path))) {
+            return 0;
+        }
+
+        for (const auto& name : names) {
+            std::span<const std::uint8_t> data;
+
+            if (SUCCEEDED(package.get(name, data, storage))) {
+                checksum += get_checksum(data.data(), data.size());
+            }
+        }
+
+        return checksum;
+    }
+
+    // Copy of the package with byte position overwritten, or cut at position when truncate is set.
+    bool write_damaged(const std::filesystem::path& path, const std::filesystem::path& damaged, std::size_t position, bool truncate) {
+        std::ifstream in(path, std::ios::binary);
+        std::vector<char> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+        if (truncate) {
+            data.resize(std::min(position, data.size()));
+        }
+        else if (position < data.size()) {
+            data[position] ^= 0x5A;
+        }
+
+        std::ofstream out(damaged, std::ios::binary | std::ios::trunc);
+        out.write(data.data(), static_cast<std::streamsize>(data.size()));
+        return out.good();
+    }
+}
+
+int main(int argc, char** argv) {
+    Settings settings;
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--files") == 0 && i + 1 < argc) {
+            settings.files = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+            settings.size = std::atoi(argv[++i]);
+        }
+        else {
+            std::printf("usage: %s [--files N] [--size <KiB>]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (settings.files <= 0 || settings.size <= 0) {
+        std::printf("--files and --size must be positive\n");
+        return 1;
+    }
+
+    ScratchDirectory scratch("asset_package_benchmark");
+    const std::filesystem::path& directory = scratch.get_path();
+    std::filesystem::path assets = directory / "assets";
+    std::filesystem::path package_path = directory / "scene.pak";
+    std::filesystem::create_directories(assets);
+
+    std::vector<std::string> names;
+    std::vector<std::vector<std::uint8_t>> contents;
+    std::uint32_t state = 1;
+    std::size_t loose_bytes = 0;
+
+    for (int i = 0; i < settings.files; i++) {
+        names.push_back(get_name(assets, i));
+        contents.push_back(make_file(i, static_cast<std::size_t>(settings.size) << 10, state));
+        loose_bytes += contents.back().size();
+
+        std::ofstream file(names.back(), std::ios::binary);
+        file.write(reinterpret_cast<const char*>(contents.back().data()), static_cast<std::streamsize>(contents.back().size()));
+    }
+
+    auto start = Clock::now();
+    AssetPackageWriter writer;
+    HRESULT hr = writer.add_directory(assets, AssetCompression::LZ);
+
+    if (SUCCEEDED(hr)) {
+        hr = writer.save(package_path);
+    }
+
+    double pack_ms = get_ms(start);
+    Checks check;
+
+    check(SUCCEEDED(hr), "the package is written");
+
+    std::size_t package_bytes = SUCCEEDED(hr) ? static_cast<std::size_t>(std::filesystem::file_size(package_path)) : 0;
+    std::printf("%d files, %.1f MiB loose, package %.1f MiB, packed in %.1f ms\n",
+                settings.files, static_cast<double>(loose_bytes) / (1 << 20), static_cast<double>(package_bytes) / (1 << 20), pack_ms);
+
+    // Contents, compression and layout of the entries.
+    AssetPackage package;
+    check(SUCCEEDED(package.open(package_path)), "the package opens");
+    check(package.get_number_of_entries() == names.size(), "every file has an entry");
+
+    std::size_t stored_bytes = 0;
+    std::size_t compressed = 0;
+    const std::uint8_t* first_blob = nullptr;
+    bool contents_match = true;
+    bool aligned = true;
+    std::vector<std::uint8_t> storage;
+
+    for (std::size_t i = 0; i < names.size(); i++) {
+        std::span<const std::uint8_t> data;
+        bool found = SUCCEEDED(package.get(names[i], data, storage));
+        contents_match = contents_match && found && std::equal(data.begin(), data.end(), contents[i].begin(), contents[i].end());
+
+        if (found && data.data() != storage.data()) {
+            first_blob = first_blob == nullptr ? data.data() : first_blob;
+            aligned = aligned && (data.data() - first_blob) % static_cast<std::ptrdiff_t>(AssetPackageWriter::BLOB_ALIGNMENT) == 0;
+            stored_bytes += data.size();
+        }
+    }
+
+    for (std::size_t i = 0; i < package.get_number_of_entries(); i++) {
+        compressed += package.get_compression(i) == AssetCompression::LZ ? 1 : 0;
+    }
+
+    check(contents_match, "every entry matches its file");
+    check(aligned, "stored entries are 64 KiB aligned");
+    check(compressed == names.size() / 2, "text is compressed and random bytes are stored");
+
+    std::string backslashes = names[0];
+    std::replace(backslashes.begin(), backslashes.end(), '/', '\\');
+    std::span<const std::uint8_t> data;
+    check(package.contains(backslashes), "names with '\\' are found");
+    check(package.get(names[0] + ".missing", data, storage) == E_INVALIDARG && data.empty(), "a missing name is reported");
+
+    // Lookups of existing names, in an order the table does not follow.
+    start = Clock::now();
+    std::size_t hits = 0;
+
+    for (int i = 0; i < LOOKUPS; i++) {
+        hits += package.contains(names[(static_cast<std::size_t>(i) * 7919) % names.size()]) ? 1 : 0;
+    }
+
+    double lookup_ns = get_ms(start) * 1e6 / LOOKUPS;
+    check(hits == LOOKUPS, "every lookup hits");
+    package.close();
+
+    std::filesystem::path damaged = directory / "damaged.pak";
+    check(write_damaged(package_path, damaged, 20, false) && FAILED(package.open(damaged)), "a damaged table of contents is rejected");
+    check(write_damaged(package_path, damaged, package_bytes - 1, true) && FAILED(package.open(damaged)), "a truncated package is rejected");
+
+    std::uint64_t expected = 0;
+
+    for (const auto& content : contents) {
+        expected += get_checksum(content.data(), content.size());
+    }
+
+    // Warm reads come from the page cache, which holds the files as they were just written.
+    start = Clock::now();
+    std::uint64_t loose_checksum = read_loose(names);
+    double loose_ms = get_ms(start);
+
+    start = Clock::now();
+    std::uint64_t package_checksum = read_package(package_path, names);
+    double package_ms = get_ms(start);
+
+    check(loose_checksum == expected && package_checksum == expected, "warm reads give the files");
+
+    bool can_evict = true;
+
+    for (const auto& name : names) {
+        can_evict = evict(name) && can_evict;
+    }
+
+    double cold_loose_ms = 0.0;
+    double cold_package_ms = 0.0;
+
+    if (can_evict && evict(package_path.string())) {
+        start = Clock::now();
+        loose_checksum = read_loose(names);
+        cold_loose_ms = get_ms(start);
+
+        start = Clock::now();
+        package_checksum = read_package(package_path, names);
+        cold_package_ms = get_ms(start);
+
+        check(loose_checksum == expected && package_checksum == expected, "cold reads give the files");
+    }
+
+    std::printf("%zu of %zu entries compressed, %.1f MiB stored uncompressed\n",
+                compressed, names.size(), static_cast<double>(stored_bytes) / (1 << 20));
+    std::printf("%10s %12s %12s %12s\n", "", "warm ms", "cold ms", "per file us");
+    std::printf("%10s %12.2f %12.2f %12.1f\n", "loose", loose_ms, cold_loose_ms, loose_ms * 1e3 / settings.files);
+    std::printf("%10s %12.2f %12.2f %12.1f\n", "package", package_ms, cold_package_ms, package_ms * 1e3 / settings.files);
+    std::printf("lookup %.0f ns%s\n", lookup_ns, can_evict ? "" : ", cold reads not available");
+
+    return check.passed() ? 0 : 1;
+}
@@ -0,0 +1,212 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "async_file_reader.h"
+#include "async_task.h"
+#include "benchmark_support.h"
+#include "common.h"
+#include "object_loader.h"
+#include "task_scheduler.h"
+
+// Many small models loaded with coroutines. --models OBJ files of about
+// --size KiB are written to the temporary directory and loaded warm and cold
+// (dropped from the page cache with posix_fadvise, Linux only): one after
+// another with ObjectLoader::load, and all at once with load_async, which
+// suspends on the AsyncFileReader and parses on the TaskScheduler, awaited
+// together with when_all from a single sync_wait. Reported are the times,
+// the reads the reader had in flight at most and the threads it took. Every
+// model has to load with the same vertices both ways and a missing one has
+// to fail.
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+    const DirectX::XMFLOAT4 COLOR = {0.8f, 0.7f, 0.6f, 1.0f};
+
+    struct Settings {
+        int models = 300;
+        int size = 64;
+    };
+
+    struct Result {
+        double ms = 0.0;
+        std::size_t loaded = 0;
+        std::vector<std::uint64_t> checksums;
+        std::uint64_t max_in_flight = 0;
+    };
+
+    // A strip of triangles with smoothing on, so the loader generates normals.
+    bool write_strip(const std::string& uri, std::size_t size, std::uint32_t& state) {
+        std::ofstream file(uri + ".obj", std::ios::binary);
+        std::size_t written = 0;
+        std::size_t vertices = 0;
+        char line[128];
+
+        file << "s 1\n";
+
+        while (written < size) {
+            int length = std::snprintf(line, sizeof(line), "v %.4f %.4f %.4f\n",
+                                       static_cast<float>(vertices / 2), get_random(state, 0.5f), static_cast<float>(vertices % 2));
+            file.write(line, length);
+            written += static_cast<std::size_t>(length);
+            vertices++;
+
+            if (vertices >= 3) {
+                length = std::snprintf(line, sizeof(line), "f -3 -2 -1\n");
+                file.write(line, length);
+                written += static_cast<std::size_t>(length);
+            }
+        }
+
+        return file.good();
+    }
+
+    std::uint64_t get_checksum(const std::vector<Vertex>& vertices) {
+        std::uint64_t checksum = vertices.size();
+        auto data = reinterpret_cast<const std::uint8_t*>(vertices.data());
+
+        for (std::size_t i = 0; i < vertices.size() * sizeof(Vertex); i++) {
+            checksum = checksum * 31 + data[i];
+        }
+
+        return checksum;
+    }
+
+    Result load_serial(const std::vector<std::string>& uris) {
+        Result result;
+        auto start = Clock::now();
+
+        for (const auto& uri : uris) {
+            ObjectLoader loader(uri, COLOR);
+            bool loaded = SUCCEEDED(loader.load());
+            result.loaded += loaded ? 1 : 0;
+            result.checksums.push_back(loaded ? get_checksum(loader.get_vertices()) : 0);
+        }
+
+        result.ms = get_ms(start);
+        return result;
+    }
+
+    Result load_coroutines(const std::vector<std::string>& uris, TaskScheduler& scheduler) {
+        Result result;
+        auto start = Clock::now();
+        AsyncFileReader reader;
+        std::vector<std::unique_ptr<ObjectLoader>> loaders;
+        std::vector<Task<HRESULT>> loads;
+
+        for (const auto& uri : uris) {
+            loaders.push_back(std::make_unique<ObjectLoader>(uri, COLOR));
+            loads.push_back(loaders.back()->load_async(reader, scheduler));
+        }
+
+        std::vector<HRESULT> results = sync_wait(when_all(std::move(loads)), scheduler);
+
+        for (std::size_t i = 0; i < uris.size(); i++) {
+            bool loaded = SUCCEEDED(results[i]);
+            result.loaded += loaded ? 1 : 0;
+            result.checksums.push_back(loaded ? get_checksum(loaders[i]->get_vertices()) : 0);
+        }
+
+        result.ms = get_ms(start);
+        result.max_in_flight = reader.get_statistics().max_in_flight;
+        return result;
+    }
+}
+
+int main(int argc, char** argv) {
+    Settings settings;
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--models") == 0 && i + 1 < argc) {
+            settings.models = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+            settings.size = std::atoi(argv[++i]);
+        }
+        else {
+            std::printf("usage: %s [--models N] [--size <KiB>]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (settings.models <= 0 || settings.size <= 0) {
+        std::printf("--models and --size must be positive\n");
+        return 1;
+    }
+
+    ScratchDirectory scratch("async_load_benchmark");
+    const std::filesystem::path& directory = scratch.get_path();
+
+    Checks check;
+
+    std::vector<std::string> uris;
+    std::uint32_t state = 1;
+    bool written = true;
+
+    for (int i = 0; i < settings.models; i++) {
+        char name[32];
+        std::snprintf(name, sizeof(name), "model_%04d", i);
+        uris.push_back((directory / name).string());
+        written = write_strip(uris.back(), static_cast<std::size_t>(settings.size) << 10, state) && written;
+    }
+
+    check(written, "the models are written");
+
+    TaskScheduler& scheduler = TaskScheduler::get_default();
+
+    {
+        AsyncFileReader reader;
+        ObjectLoader missing((directory / "missing").string(), COLOR);
+        check(FAILED(sync_wait(missing.load_async(reader, scheduler), scheduler)), "a missing model fails");
+    }
+
+    Result serial_warm = load_serial(uris);
+    Result async_warm = load_coroutines(uris, scheduler);
+
+    bool can_evict = true;
+
+    for (const auto& uri : uris) {
+        can_evict = evict(uri + ".obj") && can_evict;
+    }
+
+    Result serial_cold;
+    Result async_cold;
+
+    if (can_evict) {
+        serial_cold = load_serial(uris);
+
+        for (const auto& uri : uris) {
+            evict(uri + ".obj");
+        }
+
+        async_cold = load_coroutines(uris, scheduler);
+    }
+
+    check(serial_warm.loaded == uris.size() && async_warm.loaded == uris.size(), "every model loads");
+    check(async_warm.checksums == serial_warm.checksums, "coroutine loads give the same vertices");
+    check(!can_evict || async_cold.checksums == serial_warm.checksums, "cold coroutine loads give the same vertices");
+
+    bool has_io_uring = AsyncFileReader().get_backend() == AsyncFileReader::Backend::IO_URING;
+    std::printf("%d models of %d KiB, threads: %u of the scheduler and %u of the reader (%s)\n",
+                settings.models, settings.size, scheduler.get_worker_count(),
+                has_io_uring ? 1u : AsyncFileReader::Options().pool_threads, has_io_uring ? "io_uring" : "thread pool");
+    std::printf("%12s %12s %12s %12s\n", "", "warm ms", "cold ms", "max reads");
+    std::printf("%12s %12.2f %12.2f %12d\n", "serial", serial_warm.ms, serial_cold.ms, 1);
+    std::printf("%12s %12.2f %12.2f %12llu\n", "coroutines", async_warm.ms, async_cold.ms,
+                static_cast<unsigned long long>(std::max(async_warm.max_in_flight, async_cold.max_in_flight)));
+
+    if (!can_evict) {
+        std::printf("cold loads not available\n");
+    }
+
+    return check.passed() ? 0 : 1;
+}
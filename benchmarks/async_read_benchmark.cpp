@@ -0,0 +1,268 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "async_file_reader.h"
+#include "benchmark_support.h"
+#include "task_scheduler.h"
+
+// Loading a scene's worth of small assets. --files files of 1/4 to 4 times
+// --size KiB, alternating between OBJ-like text and random bytes standing in
+// for textures, are written to the temporary directory and read back warm
+// (from the page cache) and cold (dropped from it with posix_fadvise, Linux
+// only): one after another with ifstream, like the loaders, and with
+// AsyncFileReader on a thread pool, on io_uring with a single read in flight
+// and on io_uring with the default queue depth. The reader's callbacks hand
+// every file to a TaskScheduler job that checksums it, standing in for the
+// decode. Every file has to arrive intact, a missing one has to be reported
+// and io_uring reads have to be submitted in batches.
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+    struct Settings {
+        int files = 1000;
+        int size = 64;
+    };
+
+    struct Result {
+        double ms = 0.0;
+        bool intact = false;
+        AsyncFileReader::Statistics statistics;
+    };
+
+    std::vector<std::uint8_t> make_file(int index, std::size_t size, std::uint32_t& state) {
+        std::vector<std::uint8_t> data;
+        data.reserve(size + 64);
+
+        if (index % 2 == 1) {
+            while (data.size() < size) {
+                data.push_back(static_cast<std::uint8_t>(next_random(state)));
+            }
+
+            return data;
+        }
+
+        char line[64];
+
+        while (data.size() < size) {
+            int length = std::snprintf(line, sizeof(line), "v %f %f %f\n",
+                                       static_cast<float>(next_random(state) % 20000) / 100.0f - 100.0f,
+                                       static_cast<float>(next_random(state) % 20000) / 100.0f - 100.0f,
+                                       static_cast<float>(next_random(state) % 20000) / 100.0f - 100.0f);
+            data.insert(data.end(), line, line + length);
+        }
+
+        return data;
+    }
+
+    std::string get_name(const std::filesystem::path& directory, int index) {
+        char name[32];
+        std::snprintf(name, sizeof(name), index % 2 == 0 ? "mesh_%04d.obj" : "texture_%04d.png", index);
+        return (directory / name).generic_string();
+    }
+
+    bool evict_all(const std::vector<std::string>& names) {
+        bool evicted = true;
+
+        for (const auto& name : names) {
+            evicted = evict(name) && evicted;
+        }
+
+        return evicted;
+    }
+
+    std::uint64_t get_checksum(const std::uint8_t* data, std::size_t size) {
+        std::uint64_t checksum = 0;
+
+        for (std::size_t i = 0; i < size; i++) {
+            checksum = checksum * 31 + data[i];
+        }
+
+        return checksum;
+    }
+
+    Result read_serial(const std::vector<std::string>& names, const std::vector<std::uint64_t>& expected) {
+        Result result;
+        result.intact = true;
+        auto start = Clock::now();
+
+        for (std::size_t i = 0; i < names.size(); i++) {
+            std::ifstream file(names[i], std::ios::binary | std::ios::ate);
+            std::vector<std::uint8_t> data(static_cast<std::size_t>(file.tellg()));
+            file.seekg(0);
+            file.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(data.size()));
+            result.intact = result.intact && get_checksum(data.data(), data.size()) == expected[i];
+        }
+
+        result.ms = get_ms(start);
+        return result;
+    }
+
+    Result read_async(const std::vector<std::string>& names, const std::vector<std::uint64_t>& expected,
+                      AsyncFileReader::Options options) {
+        TaskScheduler& scheduler = TaskScheduler::get_default();
+        TaskCounter counter;
+        std::vector<std::uint64_t> checksums(names.size(), 0);
+        Result result;
+
+        auto start = Clock::now();
+
+        {
+            AsyncFileReader reader(options);
+
+            for (std::size_t i = 0; i < names.size(); i++) {
+                reader.read(names[i], [&scheduler, &counter, &checksums, i](HRESULT hr, AsyncFileReader::FileData data) {
+                    if (FAILED(hr)) {
+                        return;
+                    }
+
+                    auto file = std::make_shared<AsyncFileReader::FileData>(std::move(data));
+                    scheduler.spawn(counter, [file, &checksums, i] {
+                        checksums[i] = get_checksum(file->get().data(), file->get().size());
+                    });
+                });
+            }
+
+            reader.wait();
+            scheduler.wait(counter);
+            result.statistics = reader.get_statistics();
+        }
+
+        result.ms = get_ms(start);
+        result.intact = checksums == expected;
+        return result;
+    }
+}
+
+int main(int argc, char** argv) {
+    Settings settings;
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--files") == 0 && i + 1 < argc) {
+            settings.files = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+            settings.size = std::atoi(argv[++i]);
+        }
+        else {
+            std::printf("usage: %s [--files N] [--size <KiB>]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (settings.files <= 0 || settings.size <= 0) {
+        std::printf("--files and --size must be positive\n");
+        return 1;
+    }
+
+    ScratchDirectory scratch("async_read_benchmark");
+    const std::filesystem::path& directory = scratch.get_path();
+
+    std::vector<std::string> names;
+    std::vector<std::uint64_t> expected;
+    std::uint32_t state = 1;
+    std::size_t total_bytes = 0;
+
+    for (int i = 0; i < settings.files; i++) {
+        std::size_t size = (static_cast<std::size_t>(settings.size) << 10) * (1 + next_random(state) % 16) / 4;
+        std::vector<std::uint8_t> content = make_file(i, size, state);
+        names.push_back(get_name(directory, i));
+        expected.push_back(get_checksum(content.data(), content.size()));
+        total_bytes += content.size();
+
+        std::ofstream file(names.back(), std::ios::binary);
+        file.write(reinterpret_cast<const char*>(content.data()), static_cast<std::streamsize>(content.size()));
+    }
+
+    Checks check;
+
+    AsyncFileReader::Options pool_options;
+    pool_options.use_io_uring = false;
+    AsyncFileReader::Options single_options;
+    single_options.queue_depth = 1;
+    AsyncFileReader::Options ring_options;
+
+    bool has_io_uring = AsyncFileReader(ring_options).get_backend() == AsyncFileReader::Backend::IO_URING;
+
+    // A missing file is reported, with either backend.
+    for (const auto& options : {pool_options, ring_options}) {
+        AsyncFileReader reader(options);
+        HRESULT missing = S_OK;
+        reader.read(directory / "missing.obj", [&missing](HRESULT hr, AsyncFileReader::FileData) {
+            missing = hr;
+        });
+        reader.wait();
+        check(missing == E_FAIL && reader.get_statistics().failed_reads == 1, "a missing file is reported");
+    }
+
+    const char* methods[] = {"serial", "pool", "uring qd1", "uring"};
+    const AsyncFileReader::Options* method_options[] = {nullptr, &pool_options, &single_options, &ring_options};
+    Result warm[4];
+    Result cold[4];
+    bool can_evict = true;
+
+    for (int method = 0; method < 4; method++) {
+        if (method >= 2 && !has_io_uring) {
+            continue;
+        }
+
+        auto run = [&] {
+            return method == 0 ? read_serial(names, expected) : read_async(names, expected, *method_options[method]);
+        };
+
+        warm[method] = run();
+        check(warm[method].intact, "warm reads give the files");
+
+        can_evict = can_evict && evict_all(names);
+
+        if (can_evict) {
+            cold[method] = run();
+            check(cold[method].intact, "cold reads give the files");
+        }
+    }
+
+    if (has_io_uring) {
+        const auto& statistics = warm[3].statistics;
+        check(statistics.submit_calls < statistics.reads, "io_uring reads are submitted in batches");
+        check(statistics.max_in_flight > 1, "io_uring keeps several reads in flight");
+    }
+
+    std::printf("%d files, %.1f MiB, io_uring %s\n", settings.files, static_cast<double>(total_bytes) / (1 << 20),
+                has_io_uring ? "available" : "not available");
+    std::printf("%10s %12s %12s %12s %14s %12s\n", "", "warm ms", "cold ms", "cold MiB/s", "ops per submit", "max queue");
+
+    for (int method = 0; method < 4; method++) {
+        if (method >= 2 && !has_io_uring) {
+            continue;
+        }
+
+        const auto& statistics = warm[method].statistics;
+        double ops_per_submit = statistics.submit_calls > 0
+                ? static_cast<double>(statistics.submitted_operations) / static_cast<double>(statistics.submit_calls) : 0.0;
+        double cold_rate = cold[method].ms > 0.0 ? static_cast<double>(total_bytes) / (1 << 20) / (cold[method].ms / 1000.0) : 0.0;
+        std::printf("%10s %12.2f %12.2f %12.1f %14.1f %12llu\n", methods[method], warm[method].ms, cold[method].ms, cold_rate,
+                    ops_per_submit, static_cast<unsigned long long>(statistics.max_in_flight));
+    }
+
+    if (has_io_uring) {
+        const auto& statistics = warm[3].statistics;
+        std::printf("io_uring: %llu of %llu reads to buffers, %llu of them registered\n",
+                    static_cast<unsigned long long>(statistics.buffered_reads), static_cast<unsigned long long>(statistics.reads),
+                    static_cast<unsigned long long>(statistics.fixed_reads));
+    }
+
+    if (!can_evict) {
+        std::printf("cold reads not available\n");
+    }
+
+    return check.passed() ? 0 : 1;
+}
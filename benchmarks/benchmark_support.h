@@ -0,0 +1,182 @@
+#ifndef PROJECT3D_BENCHMARK_SUPPORT_H
+#define PROJECT3D_BENCHMARK_SUPPORT_H
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <system_error>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// Milliseconds between two readings of the clock the benchmarks time with.
+inline double get_ms(std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end) {
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+inline double get_ms(std::chrono::steady_clock::time_point start) {
+    return get_ms(start, std::chrono::steady_clock::now());
+}
+
+// The correctness checks run next to the measurements: check(condition,
+// description) prints the description of a failed one, and a benchmark exits
+// with 1 when any of them failed.
+class Checks {
+public:
+    Checks() = default;
+
+    // Printed before the descriptions, e.g. the scene being checked.
+    explicit Checks(const char* context) : context(context) {}
+
+    void operator()(bool condition, const char* description) {
+        if (condition) {
+            return;
+        }
+
+        if (context != nullptr) {
+            std::printf("FAILED: %s: %s\n", context, description);
+        }
+        else {
+            std::printf("FAILED: %s\n", description);
+        }
+
+        failures++;
+    }
+
+    int get_failures() const {
+        return failures;
+    }
+
+    bool passed() const {
+        return failures == 0;
+    }
+
+private:
+    const char* context = nullptr;
+    int failures = 0;
+};
+
+// A directory of the temporary directory for the files a benchmark writes,
+// emptied when created and removed with everything in it when destroyed.
+class ScratchDirectory {
+public:
+    explicit ScratchDirectory(const char* name) : path(std::filesystem::temp_directory_path() / name) {
+        std::filesystem::remove_all(path);
+        std::filesystem::create_directories(path);
+    }
+
+    ~ScratchDirectory() {
+        std::error_code error;
+        std::filesystem::remove_all(path, error);
+    }
+
+    ScratchDirectory(const ScratchDirectory&) = delete;
+    ScratchDirectory& operator=(const ScratchDirectory&) = delete;
+
+    const std::filesystem::path& get_path() const {
+        return path;
+    }
+
+private:
+    std::filesystem::path path;
+};
+
+// Drops the file from the page cache, so the next read goes to the disk. False where that is not possible.
+inline bool evict(const std::string& path) {
+#ifdef _WIN32
+    return false;
+#else
+    int file = open(path.c_str(), O_RDONLY);
+
+    if (file < 0) {
+        return false;
+    }
+
+    bool evicted = fdatasync(file) == 0 && posix_fadvise(file, 0, 0, POSIX_FADV_DONTNEED) == 0;
+    close(file);
+    return evicted;
+#endif
+}
+
+// The generator of the benchmark inputs, so every run writes the same files:
+// a linear congruential step returning the top 24 bits of the state.
+inline std::uint32_t next_random(std::uint32_t& state) {
+    state = state * 1664525u + 1013904223u;
+    return state >> 8;
+}
+
+// Uniform in [-range, range).
+inline float get_random(std::uint32_t& state, float range) {
+    return (static_cast<float>(next_random(state)) / 16777216.0f * 2.0f - 1.0f) * range;
+}
+
+// How write_model gives the faces their normals.
+enum class ModelNormals {
+    // One normal at the top of the file, referenced by every face.
+    Shared,
+    // One normal per object, left out of the faces of every other object so the loader generates them.
+    EveryOtherObject
+};
+
+// An OBJ file of about size bytes next to uri, plus its material library:
+// objects of 1000 random vertices and 998 triangles, alternating between two
+// materials.
+inline bool write_model(const std::filesystem::path& uri, std::size_t size, ModelNormals normals) {
+    std::ofstream mtl_file(uri.string() + ".mtl", std::ios::binary);
+    mtl_file << "newmtl red\nKd 0.8 0.1 0.1\nnewmtl green\nKd 0.1 0.8 0.1\n";
+
+    std::ofstream obj_file(uri.string() + ".obj", std::ios::binary);
+    obj_file << "mtllib " << uri.filename().string() << ".mtl\n";
+
+    if (normals == ModelNormals::Shared) {
+        obj_file << "vn 0.0000 1.0000 0.0000\n";
+    }
+
+    std::uint32_t state = 1;
+    std::size_t written = 0;
+    std::string block;
+    char line[128];
+
+    for (int object = 0; written < size && obj_file.good(); object++) {
+        block.clear();
+        std::snprintf(line, sizeof(line), "o Object.%03d\nusemtl %s\n", object, object % 2 == 0 ? "red" : "green");
+        block += line;
+
+        for (int i = 0; i < 1000; i++) {
+            std::snprintf(line, sizeof(line), "v %f %f %f\n", get_random(state, 100.0f), get_random(state, 100.0f), get_random(state, 100.0f));
+            block += line;
+        }
+
+        if (normals == ModelNormals::EveryOtherObject) {
+            block += "vn 0.0000 1.0000 0.0000\n";
+        }
+
+        for (int i = 0; i < 998; i++) {
+            int first = -1000 + i;
+
+            if (normals == ModelNormals::Shared) {
+                std::snprintf(line, sizeof(line), "f %d//1 %d//1 %d//1\n", first, first + 1, first + 2);
+            }
+            else if (object % 2 == 0) {
+                std::snprintf(line, sizeof(line), "f %d//-1 %d//-1 %d//-1\n", first, first + 1, first + 2);
+            }
+            else {
+                std::snprintf(line, sizeof(line), "f %d %d %d\n", first, first + 1, first + 2);
+            }
+
+            block += line;
+        }
+
+        obj_file << block;
+        written += block.size();
+    }
+
+    return obj_file.good() && mtl_file.good();
+}
+
+#endif //PROJECT3D_BENCHMARK_SUPPORT_H
@@ -0,0 +1,258 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <DirectXMath.h>
+
+#include "bounds.h"
+#include "character_controller.h"
+#include "rolling_statistics.h"
+#include "triangle_bvh.h"
+
+// CharacterController against a TriangleBvh of about a million triangles:
+// rolling terrain plus a flat test yard with stairs, a ledge that is too high
+// to step on and a wall. The yard scenarios check the behaviour (climbing,
+// blocking, sliding, falling), the long walk over the terrain measures the
+// cost of an update at the 120 Hz simulation rate.
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+    constexpr float TIMESTEP = 1.0f / 120.0f;
+    constexpr float YARD_SIZE = 40.0f;
+
+    struct Settings {
+        float terrain_size = 350.0f;
+        float cell_size = 0.5f;
+        float walk_seconds = 60.0f;
+    };
+
+    float terrain_height(float x, float z) {
+        if (x <= 0.0f) {
+            return 0.0f;
+        }
+
+        // Hills fade in, so the yard border stays flat.
+        float fade = std::min(x / 20.0f, 1.0f);
+        return fade * (1.5f * std::sin(x * 0.06f) * std::cos(z * 0.05f) + 0.5f * std::sin(x * 0.17f + z * 0.11f));
+    }
+
+    void add_quad(std::vector<BvhTriangle>& triangles, DirectX::XMFLOAT3 a, DirectX::XMFLOAT3 b, DirectX::XMFLOAT3 c, DirectX::XMFLOAT3 d) {
+        triangles.push_back({a, b, c});
+        triangles.push_back({a, c, d});
+    }
+
+    void add_box(std::vector<BvhTriangle>& triangles, DirectX::XMFLOAT3 min, DirectX::XMFLOAT3 max) {
+        DirectX::XMFLOAT3 p[8];
+
+        for (int i = 0; i < 8; i++) {
+            p[i] = {(i & 1) ? max.x : min.x, (i & 2) ? max.y : min.y, (i & 4) ? max.z : min.z};
+        }
+
+        add_quad(triangles, p[0], p[1], p[3], p[2]);
+        add_quad(triangles, p[4], p[6], p[7], p[5]);
+        add_quad(triangles, p[0], p[4], p[5], p[1]);
+        add_quad(triangles, p[2], p[3], p[7], p[6]);
+        add_quad(triangles, p[0], p[2], p[6], p[4]);
+        add_quad(triangles, p[1], p[5], p[7], p[3]);
+    }
+
+    void add_grid(std::vector<BvhTriangle>& triangles, float x0, float z0, float size, float cell_size) {
+        int cells = static_cast<int>(size / cell_size);
+
+        for (int i = 0; i < cells; i++) {
+            for (int j = 0; j < cells; j++) {
+                float xa = x0 + static_cast<float>(i) * cell_size;
+                float xb = xa + cell_size;
+                float za = z0 + static_cast<float>(j) * cell_size;
+                float zb = za + cell_size;
+
+                add_quad(triangles,
+                         {xa, terrain_height(xa, za), za},
+                         {xa, terrain_height(xa, zb), zb},
+                         {xb, terrain_height(xb, zb), zb},
+                         {xb, terrain_height(xb, za), za});
+            }
+        }
+    }
+
+    std::vector<BvhTriangle> make_scene(const Settings& settings) {
+        std::vector<BvhTriangle> triangles;
+
+        add_grid(triangles, -YARD_SIZE, 0.0f, YARD_SIZE, settings.cell_size);
+        add_grid(triangles, 0.0f, 0.0f, settings.terrain_size, settings.cell_size);
+
+        // Eight 25 cm steps up to a 2 m platform
+        for (int step = 0; step < 8; step++) {
+            float x = -30.0f + static_cast<float>(step) * 0.35f;
+            add_box(triangles, {x, 0.0f, 4.0f}, {x + 0.35f, 0.25f * static_cast<float>(step + 1), 8.0f});
+        }
+
+        add_box(triangles, {-27.2f, 0.0f, 4.0f}, {-20.0f, 2.0f, 8.0f});
+
+        // 60 cm ledge, above the step height
+        add_box(triangles, {-30.0f, 0.0f, 14.0f}, {-28.0f, 0.6f, 18.0f});
+
+        // Wall along z
+        add_box(triangles, {-10.0f, 0.0f, 20.0f}, {-9.8f, 3.0f, 40.0f});
+
+        return triangles;
+    }
+
+    struct Scenario {
+        const char* name;
+        DirectX::XMFLOAT3 start;
+        DirectX::XMFLOAT3 velocity;
+        float seconds;
+    };
+
+    CharacterController run(const TriangleBvh& bvh, const Scenario& scenario) {
+        CharacterController controller(bvh, scenario.start);
+
+        for (float time = 0.0f; time < scenario.seconds; time += TIMESTEP) {
+            controller.update(scenario.velocity, false, TIMESTEP);
+        }
+
+        return controller;
+    }
+
+    bool check(const char* name, bool passed, DirectX::XMFLOAT3 position) {
+        std::printf("%-34s %s  (end at %.2f %.2f %.2f)\n", name, passed ? "ok  " : "FAIL", position.x, position.y, position.z);
+        return passed;
+    }
+}
+
+int main(int argc, char** argv) {
+    Settings settings;
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--terrain-size") == 0 && i + 1 < argc) {
+            settings.terrain_size = std::strtof(argv[++i], nullptr);
+        }
+        else if (std::strcmp(argv[i], "--cell-size") == 0 && i + 1 < argc) {
+            settings.cell_size = std::strtof(argv[++i], nullptr);
+        }
+        else if (std::strcmp(argv[i], "--walk") == 0 && i + 1 < argc) {
+            settings.walk_seconds = std::strtof(argv[++i], nullptr);
+        }
+        else {
+            std::printf("usage: %s [--terrain-size <m>] [--cell-size <m>] [--walk <s>]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (settings.terrain_size < 40.0f || settings.cell_size <= 0.0f) {
+        std::printf("--terrain-size must be at least 40 and --cell-size positive\n");
+        return 1;
+    }
+
+    std::vector<BvhTriangle> triangles = make_scene(settings);
+    std::size_t triangle_count = triangles.size();
+    std::vector<Aabb> triangle_bounds;
+
+    for (const auto& triangle : triangles) {
+        Aabb bounds;
+        bounds.merge(triangle.a);
+        bounds.merge(triangle.b);
+        bounds.merge(triangle.c);
+        triangle_bounds.push_back(bounds);
+    }
+
+    TriangleBvh bvh;
+    auto build_start = Clock::now();
+    bvh.build(std::move(triangles));
+    double build_ms = std::chrono::duration<double, std::milli>(Clock::now() - build_start).count();
+
+    std::printf("%zu triangles, %zu nodes, built in %.1f ms\n\n", triangle_count, bvh.get_number_of_nodes(), build_ms);
+
+    bool passed = true;
+    float radius = CharacterController::Options().radius;
+
+    CharacterController stairs = run(bvh, {"stairs", {-33.0f, 0.0f, 6.0f}, {3.0f, 0.0f, 0.0f}, 3.5f});
+    passed &= check("climbs 25 cm stairs", std::fabs(stairs.get_position().y - 2.0f) < 0.05f && stairs.get_position().x > -25.0f, stairs.get_position());
+
+    CharacterController ledge = run(bvh, {"ledge", {-33.0f, 0.0f, 16.0f}, {3.0f, 0.0f, 0.0f}, 3.0f});
+    passed &= check("stopped by a 60 cm ledge", ledge.get_position().y < 0.05f && ledge.get_position().x < -30.0f - radius + 0.01f, ledge.get_position());
+
+    CharacterController wall = run(bvh, {"wall", {-14.0f, 0.0f, 22.0f}, {2.0f, 0.0f, 2.0f}, 4.0f});
+    passed &= check("slides along a wall", wall.get_position().x < -10.0f - radius + 0.01f && wall.get_position().z > 28.0f, wall.get_position());
+
+    CharacterController fall = run(bvh, {"fall", {-5.0f, 5.0f, 10.0f}, {0.0f, 0.0f, 0.0f}, 2.0f});
+    passed &= check("falls and lands", fall.is_grounded() && std::fabs(fall.get_position().y) < 0.01f, fall.get_position());
+
+    // Long walk over the hills: a zig-zag across the terrain at walking speed.
+    float start_x = 10.0f;
+    float start_z = 10.0f;
+    CharacterController walker(bvh, {start_x, terrain_height(start_x, start_z) + 0.5f, start_z});
+    RollingStatistics update_statistics(static_cast<std::size_t>(settings.walk_seconds / TIMESTEP) + 1);
+    std::size_t candidates = 0;
+    std::size_t updates = 0;
+    float worst_error = 0.0f;
+    float limit = settings.terrain_size - 10.0f;
+    float direction_x = 1.0f;
+
+    for (float time = 0.0f; time < settings.walk_seconds; time += TIMESTEP) {
+        DirectX::XMFLOAT3 position = walker.get_position();
+
+        if (position.x > limit) {
+            direction_x = -1.0f;
+        }
+        else if (position.x < 10.0f) {
+            direction_x = 1.0f;
+        }
+
+        float heading = 0.3f * std::sin(time * 0.2f);
+        DirectX::XMFLOAT3 velocity = {6.0f * direction_x * std::cos(heading), 0.0f, 6.0f * std::sin(heading)};
+
+        auto start = Clock::now();
+        walker.update(velocity, false, TIMESTEP);
+        update_statistics.add(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+
+        candidates += walker.get_number_of_candidates();
+        updates++;
+
+        position = walker.get_position();
+
+        if (walker.is_grounded() && time > 1.0f) {
+            worst_error = std::max(worst_error, std::fabs(position.y - terrain_height(position.x, position.z)));
+        }
+    }
+
+    passed &= check("walks over the terrain", worst_error < 0.05f, walker.get_position());
+
+    std::printf("\nupdate at 120 Hz  mean %.2f us  p50 %.2f  p99 %.2f  max %.2f  (%.1f candidate triangles, ground error %.3f m)\n",
+                update_statistics.mean(),
+                update_statistics.percentile(50.0),
+                update_statistics.percentile(99.0),
+                update_statistics.max(),
+                static_cast<double>(candidates) / static_cast<double>(std::max<std::size_t>(updates, 1)),
+                worst_error);
+
+    // The same gather without the hierarchy, for scale.
+    DirectX::XMFLOAT3 position = walker.get_position();
+    Aabb region = {{position.x - 0.5f, position.y - 0.5f, position.z - 0.5f}, {position.x + 0.5f, position.y + 2.3f, position.z + 0.5f}};
+    std::vector<std::uint32_t> result;
+
+    auto start = Clock::now();
+    std::size_t visited = bvh.query(region, result);
+    double bvh_us = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+
+    start = Clock::now();
+    std::size_t linear_found = 0;
+
+    for (const Aabb& bounds : triangle_bounds) {
+        linear_found += bounds.intersects(region) ? 1 : 0;
+    }
+
+    double linear_us = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+
+    std::printf("candidate gather  bvh %.2f us (%zu nodes)  linear scan %.0f us  (%zu / %zu triangles)\n",
+                bvh_us, visited, linear_us, result.size(), linear_found);
+
+    passed &= result.size() == linear_found;
+
+    return passed ? 0 : 1;
+}
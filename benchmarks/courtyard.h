@@ -0,0 +1,79 @@
+#ifndef PROJECT3D_COURTYARD_H
+#define PROJECT3D_COURTYARD_H
+
+#include <vector>
+#include <DirectXMath.h>
+
+#include "common.h"
+
+namespace courtyard_detail {
+    constexpr int ATLAS_TILES = 4;
+    constexpr float TILE_PADDING = 0.01f;
+
+    // Quad origin + s * u + t * v, split into cells x cells pairs of triangles, mapped onto one atlas tile.
+    inline void add_quad(std::vector<Vertex>& vertices, int tile, int cells, DirectX::XMFLOAT3 origin,
+                         DirectX::XMFLOAT3 u, DirectX::XMFLOAT3 v, DirectX::XMFLOAT3 normal) {
+        float tile_size = 1.0f / ATLAS_TILES;
+        float tile_u = static_cast<float>(tile % ATLAS_TILES) * tile_size + TILE_PADDING;
+        float tile_v = static_cast<float>(tile / ATLAS_TILES) * tile_size + TILE_PADDING;
+        float tile_extent = tile_size - 2.0f * TILE_PADDING;
+
+        auto vertex = [&](int i, int j) {
+            float s = static_cast<float>(i) / static_cast<float>(cells);
+            float t = static_cast<float>(j) / static_cast<float>(cells);
+
+            return Vertex{
+                    {origin.x + s * u.x + t * v.x, origin.y + s * u.y + t * v.y, origin.z + s * u.z + t * v.z},
+                    normal,
+                    {1.0f, 1.0f, 1.0f, 1.0f},
+                    {tile_u + s * tile_extent, tile_v + t * tile_extent}
+            };
+        };
+
+        for (int i = 0; i < cells; i++) {
+            for (int j = 0; j < cells; j++) {
+                vertices.push_back(vertex(i, j));
+                vertices.push_back(vertex(i + 1, j));
+                vertices.push_back(vertex(i + 1, j + 1));
+                vertices.push_back(vertex(i, j));
+                vertices.push_back(vertex(i + 1, j + 1));
+                vertices.push_back(vertex(i, j + 1));
+            }
+        }
+    }
+}
+
+// The scene of the baker benchmarks: a 12 x 12 m floor inside 4 m walls with
+// a 3 x 3 x 2 m block in the middle, every face in its own tile of the uv
+// atlas. The south wall has a gap of gap meters in the middle (none at 0).
+inline std::vector<Vertex> make_courtyard(int cells, float gap) {
+    using courtyard_detail::add_quad;
+    std::vector<Vertex> vertices;
+    int tile = 0;
+
+    // Floor and walls, normals pointing inside
+    add_quad(vertices, tile++, cells, {-6.0f, 0.0f, -6.0f}, {12.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 12.0f}, {0.0f, 1.0f, 0.0f});
+    add_quad(vertices, tile++, cells, {-6.0f, 0.0f, -6.0f}, {0.0f, 0.0f, 12.0f}, {0.0f, 4.0f, 0.0f}, {1.0f, 0.0f, 0.0f});
+    add_quad(vertices, tile++, cells, {6.0f, 0.0f, -6.0f}, {0.0f, 0.0f, 12.0f}, {0.0f, 4.0f, 0.0f}, {-1.0f, 0.0f, 0.0f});
+    add_quad(vertices, tile++, cells, {-6.0f, 0.0f, 6.0f}, {12.0f, 0.0f, 0.0f}, {0.0f, 4.0f, 0.0f}, {0.0f, 0.0f, -1.0f});
+
+    if (gap > 0.0f) {
+        float side = 6.0f - gap * 0.5f;
+        add_quad(vertices, tile++, cells, {-6.0f, 0.0f, -6.0f}, {side, 0.0f, 0.0f}, {0.0f, 4.0f, 0.0f}, {0.0f, 0.0f, 1.0f});
+        add_quad(vertices, tile++, cells, {gap * 0.5f, 0.0f, -6.0f}, {side, 0.0f, 0.0f}, {0.0f, 4.0f, 0.0f}, {0.0f, 0.0f, 1.0f});
+    }
+    else {
+        add_quad(vertices, tile++, cells, {-6.0f, 0.0f, -6.0f}, {12.0f, 0.0f, 0.0f}, {0.0f, 4.0f, 0.0f}, {0.0f, 0.0f, 1.0f});
+    }
+
+    // Block in the middle, normals pointing out
+    add_quad(vertices, tile++, cells, {-1.5f, 2.0f, -1.5f}, {3.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 3.0f}, {0.0f, 1.0f, 0.0f});
+    add_quad(vertices, tile++, cells, {-1.5f, 0.0f, -1.5f}, {0.0f, 0.0f, 3.0f}, {0.0f, 2.0f, 0.0f}, {-1.0f, 0.0f, 0.0f});
+    add_quad(vertices, tile++, cells, {1.5f, 0.0f, -1.5f}, {0.0f, 0.0f, 3.0f}, {0.0f, 2.0f, 0.0f}, {1.0f, 0.0f, 0.0f});
+    add_quad(vertices, tile++, cells, {-1.5f, 0.0f, -1.5f}, {3.0f, 0.0f, 0.0f}, {0.0f, 2.0f, 0.0f}, {0.0f, 0.0f, -1.0f});
+    add_quad(vertices, tile++, cells, {-1.5f, 0.0f, 1.5f}, {3.0f, 0.0f, 0.0f}, {0.0f, 2.0f, 0.0f}, {0.0f, 0.0f, 1.0f});
+
+    return vertices;
+}
+
+#endif //PROJECT3D_COURTYARD_H
@@ -0,0 +1,146 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "benchmark_support.h"
+#include "descriptor_allocator.h"
+
+// Slots of the shader-visible descriptor heap the way App hands them out:
+// --operations random allocations (mostly single texture slots, sometimes
+// ranges of up to 8) and releases of earlier ones, on a heap of --capacity
+// slots. Every allocation is compared with a map of the slots in use, so
+// ranges never overlap or leave the heap, and the allocator has to report
+// a full heap, count its slots right and merge everything back into one
+// free range once all of them are released. Reported is the time per
+// operation and the number of free ranges left by the churn.
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+    constexpr std::uint32_t MAX_RANGE = 8;
+
+    struct Settings {
+        int operations = 1000000;
+        int capacity = 4096;
+    };
+
+    struct Allocation {
+        std::uint32_t index;
+        std::uint32_t count;
+    };
+}
+
+int main(int argc, char** argv) {
+    Settings settings;
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--operations") == 0 && i + 1 < argc) {
+            settings.operations = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--capacity") == 0 && i + 1 < argc) {
+            settings.capacity = std::atoi(argv[++i]);
+        }
+        else {
+            std::printf("usage: %s [--operations N] [--capacity N]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (settings.operations <= 0 || settings.capacity <= 0) {
+        std::printf("--operations and --capacity must be positive\n");
+        return 1;
+    }
+
+    Checks check;
+
+    std::uint32_t capacity = static_cast<std::uint32_t>(settings.capacity);
+    DescriptorAllocator allocator(capacity);
+    std::vector<bool> used(capacity, false);
+    std::vector<Allocation> allocations;
+    std::uint32_t state = 1;
+    std::uint32_t used_slots = 0;
+    std::size_t full = 0;
+    bool in_heap = true;
+    bool disjoint = true;
+    bool counted = true;
+
+    auto start = Clock::now();
+
+    for (int i = 0; i < settings.operations; i++) {
+        // Allocations get rarer as the heap fills up, so it runs full now and then.
+        bool allocate = allocations.empty() || next_random(state) % capacity >= used_slots / 2;
+
+        if (allocate) {
+            std::uint32_t count = next_random(state) % 8 == 0 ? 1 + next_random(state) % MAX_RANGE : 1;
+            std::uint32_t index = allocator.allocate(count);
+
+            if (index == DescriptorAllocator::INVALID_INDEX) {
+                full++;
+                continue;
+            }
+
+            in_heap = in_heap && index + count <= capacity;
+
+            for (std::uint32_t slot = index; in_heap && slot < index + count; slot++) {
+                disjoint = disjoint && !used[slot];
+                used[slot] = true;
+            }
+
+            allocations.push_back({index, count});
+            used_slots += count;
+        }
+        else {
+            std::size_t position = next_random(state) % allocations.size();
+            Allocation allocation = allocations[position];
+            allocations[position] = allocations.back();
+            allocations.pop_back();
+
+            allocator.free(allocation.index, allocation.count);
+
+            for (std::uint32_t slot = allocation.index; slot < allocation.index + allocation.count; slot++) {
+                used[slot] = false;
+            }
+
+            used_slots -= allocation.count;
+        }
+
+        counted = counted && allocator.get_allocated_count() == used_slots;
+    }
+
+    double operation_ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / settings.operations;
+    std::size_t churn_ranges = allocator.get_number_of_free_ranges();
+
+    check(in_heap, "allocated ranges lie inside the heap");
+    check(disjoint, "allocated ranges do not overlap");
+    check(counted, "the allocated count follows allocations and releases");
+
+    for (const Allocation& allocation : allocations) {
+        allocator.free(allocation.index, allocation.count);
+    }
+
+    check(allocator.get_allocated_count() == 0, "releasing everything leaves no slot allocated");
+    check(allocator.get_number_of_free_ranges() == 1, "released ranges merge into one");
+
+    // A full heap, then the slot App frees when replacing a texture.
+    std::uint32_t first = allocator.allocate(capacity);
+    check(first == 0, "the whole heap is one range");
+    check(allocator.allocate() == DescriptorAllocator::INVALID_INDEX, "a full heap is reported");
+    check(allocator.allocate(0) == DescriptorAllocator::INVALID_INDEX, "empty ranges are not handed out");
+
+    allocator.free(capacity / 2);
+    check(allocator.allocate() == capacity / 2, "a released slot is reused");
+
+    allocator.free(DescriptorAllocator::INVALID_INDEX);
+    check(allocator.get_allocated_count() == capacity, "releasing INVALID_INDEX does nothing");
+
+    allocator.reset();
+    check(allocator.get_allocated_count() == 0 && allocator.get_number_of_free_ranges() == 1, "reset frees the heap");
+
+    std::printf("%d operations on %u slots, %.1f ns per operation\n", settings.operations, capacity, operation_ns);
+    std::printf("heap full %zu times, %zu free ranges after the churn\n", full, churn_ranges);
+
+    return check.passed() ? 0 : 1;
+}
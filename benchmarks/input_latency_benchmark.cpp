@@ -0,0 +1,223 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "mouse_input.h"
+#include "profiler.h"
+#include "rolling_statistics.h"
+
+// Headless input latency harness: a producer thread plays the role of a
+// high-rate mouse, the main thread runs a frame loop with simulated work and
+// applies input right before "matrix construction". It compares the old
+// App behaviour (one queued delta per frame, everything past two dropped)
+// with MouseInput, reporting the input -> apply latency and how much of the
+// generated motion actually reached the camera.
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+    struct Settings {
+        double mouse_rate = 1000.0;
+        double frame_rate = 60.0;
+        double frame_work_ms = 4.0;
+        double duration = 5.0;
+    };
+
+    struct Result {
+        RollingStatistics latency{1 << 16};
+        long long generated_motion = 0;
+        long long applied_motion = 0;
+        std::uint64_t generated_events = 0;
+    };
+
+    void busy_wait(Clock::time_point until) {
+        while (Clock::now() < until) {
+        }
+    }
+
+    // Moves the mouse by one unit along x every 1 / mouse_rate seconds.
+    template<class Add>
+    std::uint64_t produce(const Settings& settings, std::atomic<bool>& running, Add add) {
+        auto period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / settings.mouse_rate));
+        auto next = Clock::now();
+        std::uint64_t events = 0;
+
+        while (running.load(std::memory_order_relaxed)) {
+            next += period;
+            busy_wait(next);
+            add(1, 0, Profiler::now());
+            events++;
+        }
+
+        return events;
+    }
+
+    template<class Frame>
+    void run_frames(const Settings& settings, Frame frame) {
+        auto period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / settings.frame_rate));
+        auto work = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(settings.frame_work_ms));
+        auto start = Clock::now();
+        auto next = start;
+
+        while (std::chrono::duration<double>(Clock::now() - start).count() < settings.duration) {
+            // Simulation and command recording happen before the input is applied.
+            busy_wait(Clock::now() + work);
+            frame();
+
+            next += period;
+            std::this_thread::sleep_until(next);
+        }
+    }
+
+    void run_queue(const Settings& settings, Result& result) {
+        std::mutex mutex;
+        std::queue<std::pair<std::pair<long, long>, std::uint64_t>> queue;
+        std::atomic<bool> running{true};
+        Profiler& profiler = Profiler::get();
+
+        std::thread producer([&] {
+            result.generated_events = produce(settings, running, [&](long x, long y, std::uint64_t timestamp) {
+                std::lock_guard<std::mutex> lock(mutex);
+                queue.push({{x, y}, timestamp});
+            });
+        });
+
+        run_frames(settings, [&] {
+            std::lock_guard<std::mutex> lock(mutex);
+
+            if (!queue.empty()) {
+                auto event = queue.front();
+                queue.pop();
+
+                result.applied_motion += event.first.first;
+                result.latency.add(profiler.ticks_to_milliseconds(Profiler::now() - event.second));
+            }
+
+            while (queue.size() > 2) {
+                queue.pop();
+            }
+        });
+
+        running.store(false);
+        producer.join();
+        result.generated_motion = static_cast<long long>(result.generated_events);
+    }
+
+    void run_accumulator(const Settings& settings, Result& result) {
+        MouseInput input;
+        std::atomic<bool> running{true};
+        Profiler& profiler = Profiler::get();
+
+        std::thread producer([&] {
+            result.generated_events = produce(settings, running, [&](std::int32_t x, std::int32_t y, std::uint64_t timestamp) {
+                input.add(x, y, timestamp);
+            });
+        });
+
+        run_frames(settings, [&] {
+            MouseInput::Sample sample = input.consume();
+
+            if (!sample.empty()) {
+                result.applied_motion += sample.delta_x;
+                result.latency.add(profiler.ticks_to_milliseconds(Profiler::now() - sample.first_timestamp));
+            }
+        });
+
+        running.store(false);
+        producer.join();
+
+        // Motion that arrived after the last frame.
+        result.applied_motion += input.consume().delta_x;
+        result.generated_motion = static_cast<long long>(result.generated_events);
+    }
+
+    void print(const char* name, const Result& result) {
+        double applied = result.generated_motion > 0
+                ? 100.0 * static_cast<double>(result.applied_motion) / static_cast<double>(result.generated_motion)
+                : 0.0;
+
+        std::printf("%-12s %8llu events  motion applied %6.2f%%  oldest input -> apply p50 %7.3f  p99 %7.3f  max %7.3f ms\n",
+                    name,
+                    static_cast<unsigned long long>(result.generated_events),
+                    applied,
+                    result.latency.percentile(50.0),
+                    result.latency.percentile(99.0),
+                    result.latency.max());
+    }
+
+    void add_throughput() {
+        constexpr std::uint64_t EVENT_COUNT = 10'000'000;
+        MouseInput input;
+        std::int64_t total = 0;
+
+        auto start = Clock::now();
+
+        for (std::uint64_t i = 0; i < EVENT_COUNT; i++) {
+            input.add(1, -1, i + 1);
+
+            if ((i & 1023) == 0) {
+                total += input.consume().delta_x;
+            }
+        }
+
+        total += input.consume().delta_x;
+        double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+
+        std::printf("MouseInput::add %.2f ns/event (sum %lld of %llu)\n",
+                    ns / static_cast<double>(EVENT_COUNT),
+                    static_cast<long long>(total),
+                    static_cast<unsigned long long>(EVENT_COUNT));
+    }
+}
+
+int main(int argc, char** argv) {
+    Settings settings;
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--mouse-rate") == 0 && i + 1 < argc) {
+            settings.mouse_rate = std::strtod(argv[++i], nullptr);
+        }
+        else if (std::strcmp(argv[i], "--frame-rate") == 0 && i + 1 < argc) {
+            settings.frame_rate = std::strtod(argv[++i], nullptr);
+        }
+        else if (std::strcmp(argv[i], "--frame-work") == 0 && i + 1 < argc) {
+            settings.frame_work_ms = std::strtod(argv[++i], nullptr);
+        }
+        else if (std::strcmp(argv[i], "--duration") == 0 && i + 1 < argc) {
+            settings.duration = std::strtod(argv[++i], nullptr);
+        }
+        else {
+            std::printf("usage: %s [--mouse-rate <Hz>] [--frame-rate <Hz>] [--frame-work <ms>] [--duration <s>]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (settings.mouse_rate <= 0.0 || settings.frame_rate <= 0.0 || settings.duration <= 0.0) {
+        std::printf("rates and duration must be positive\n");
+        return 1;
+    }
+
+    std::printf("mouse %.0f Hz, frames %.0f Hz, %.1f ms of work per frame, %.1f s\n\n",
+                settings.mouse_rate, settings.frame_rate, settings.frame_work_ms, settings.duration);
+
+    Result queue_result;
+    run_queue(settings, queue_result);
+    print("queue", queue_result);
+
+    Result accumulator_result;
+    run_accumulator(settings, accumulator_result);
+    print("accumulator", accumulator_result);
+
+    std::printf("\n");
+    add_throughput();
+
+    return 0;
+}
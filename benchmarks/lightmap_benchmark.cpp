@@ -0,0 +1,182 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+#include <DirectXMath.h>
+
+#include "benchmark_support.h"
+#include "common.h"
+#include "courtyard.h"
+#include "lightmap_baker.h"
+#include "object_loader.h"
+#include "task_scheduler.h"
+#include "triangle_bvh.h"
+
+// LightmapBaker on a courtyard: a 12 x 12 m room without a roof, one wall
+// with a door-sized gap, and a block in the middle, every face in its own
+// tile of the uv atlas. Passes are run until most texels have converged (or
+// --passes runs out), reporting the time, ray throughput and noise after
+// every pass. A wall loaded from an OBJ file with its own normals has to
+// come out lit from the side it faces in the file.
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+    struct Settings {
+        std::uint32_t size = 256;
+        std::uint32_t passes = 64;
+        std::uint32_t bounces = 2;
+        int cells = 32;
+        unsigned workers = 0;
+        double target_converged = 0.9;
+    };
+
+    // Faces -z in the file; the loader turns it around the y axis, normals included.
+    const char* MIRRORED_WALL =
+            "v -1 0 0\nv 1 0 0\nv 1 2 0\nv -1 2 0\n"
+            "vt 0.1 0.1\nvt 0.9 0.1\nvt 0.9 0.9\nvt 0.1 0.9\n"
+            "vn 0 0 -1\n"
+            "f 1/1/1 4/4/1 3/3/1 2/2/1\n";
+
+    void check_mirrored_wall(Checks& check, TaskScheduler& scheduler) {
+        ScratchDirectory scratch("lightmap_benchmark");
+        const std::filesystem::path& directory = scratch.get_path();
+
+        {
+            std::ofstream file(directory / "wall.obj", std::ios::binary);
+            file << MIRRORED_WALL;
+        }
+
+        ObjectLoader loader((directory / "wall").string(), {1.0f, 1.0f, 1.0f, 1.0f});
+        check(SUCCEEDED(loader.load()), "the mirrored wall loads");
+
+        std::vector<Vertex> vertices = loader.take_vertices();
+
+        if (vertices.size() != 6) {
+            check(false, "the mirrored wall has two triangles");
+            return;
+        }
+
+        bool front = true;
+
+        for (std::size_t i = 0; i < vertices.size(); i++) {
+            const Vertex* corners = &vertices[i - i % 3];
+            DirectX::XMVECTOR p0 = DirectX::XMLoadFloat3(&corners[0].position);
+            DirectX::XMVECTOR face = DirectX::XMVector3Cross(DirectX::XMVectorSubtract(DirectX::XMLoadFloat3(&corners[1].position), p0),
+                                                             DirectX::XMVectorSubtract(DirectX::XMLoadFloat3(&corners[2].position), p0));
+            front = front && DirectX::XMVectorGetX(DirectX::XMVector3Dot(face, DirectX::XMLoadFloat3(&vertices[i].normal))) > 0.0f;
+        }
+
+        check(front, "file normals stay on the front of their faces");
+
+        // Only the sun, which the wall faces after the turn
+        LightmapBaker::Options options;
+        options.width = 64;
+        options.height = 64;
+        options.max_bounces = 0;
+        options.sun_direction = {0.0f, 0.0f, 1.0f};
+        options.sky_color = {0.0f, 0.0f, 0.0f};
+
+        TriangleBvh bvh;
+        bvh.build(vertices);
+        LightmapBaker baker(vertices, bvh, options);
+        baker.refine(scheduler);
+
+        std::vector<std::uint8_t> bitmap;
+        baker.get_bitmap(bitmap);
+
+        std::size_t center = (static_cast<std::size_t>(options.height / 2) * options.width + options.width / 2) * 4;
+        check(bitmap.size() > center && bitmap[center] > 128, "the mirrored wall is lit by the sun it faces");
+    }
+}
+
+int main(int argc, char** argv) {
+    Settings settings;
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+            settings.size = static_cast<std::uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (std::strcmp(argv[i], "--passes") == 0 && i + 1 < argc) {
+            settings.passes = static_cast<std::uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (std::strcmp(argv[i], "--bounces") == 0 && i + 1 < argc) {
+            settings.bounces = static_cast<std::uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (std::strcmp(argv[i], "--cells") == 0 && i + 1 < argc) {
+            settings.cells = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--workers") == 0 && i + 1 < argc) {
+            settings.workers = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else {
+            std::printf("usage: %s [--size <texels>] [--passes N] [--bounces N] [--cells N] [--workers N]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (settings.size == 0 || settings.passes == 0 || settings.cells <= 0) {
+        std::printf("--size, --passes and --cells must be positive\n");
+        return 1;
+    }
+
+    std::vector<Vertex> vertices = make_courtyard(settings.cells, 2.0f);
+    TriangleBvh bvh;
+    bvh.build(vertices);
+
+    TaskScheduler scheduler(TaskScheduler::Options{settings.workers});
+
+    LightmapBaker::Options options;
+    options.width = settings.size;
+    options.height = settings.size;
+    options.max_bounces = settings.bounces;
+
+    auto setup_start = Clock::now();
+    LightmapBaker baker(vertices, bvh, options);
+    double setup_ms = std::chrono::duration<double, std::milli>(Clock::now() - setup_start).count();
+
+    std::printf("%zu triangles, %zu texels (%u x %u), rasterized in %.1f ms, %u workers\n\n",
+                vertices.size() / 3, baker.get_statistics().texels, settings.size, settings.size, setup_ms, scheduler.get_worker_count());
+    std::printf("%6s %10s %12s %12s %10s\n", "pass", "pass ms", "Mrays/s", "rel. error", "converged");
+
+    double total_ms = 0.0;
+
+    for (std::uint32_t pass = 0; pass < settings.passes; pass++) {
+        const LightmapBaker::Statistics& statistics = baker.refine(scheduler);
+        total_ms += statistics.pass_ms;
+
+        bool last = statistics.converged >= settings.target_converged || pass + 1 == settings.passes;
+
+        // Powers of two and the last pass
+        if ((statistics.samples & (statistics.samples - 1)) == 0 || last) {
+            std::printf("%6u %10.1f %12.2f %12.4f %9.1f%%\n",
+                        statistics.samples,
+                        statistics.pass_ms,
+                        statistics.rays_per_second / 1e6,
+                        statistics.relative_error,
+                        100.0 * statistics.converged);
+        }
+
+        if (last) {
+            break;
+        }
+    }
+
+    std::vector<std::uint8_t> bitmap;
+    baker.get_bitmap(bitmap);
+
+    std::printf("\n%.0f ms in total, %u samples per texel, %.1f%% of texels below %.0f%% error\n",
+                total_ms,
+                baker.get_statistics().samples,
+                100.0 * baker.get_statistics().converged,
+                100.0 * options.target_error);
+
+    Checks check;
+    check_mirrored_wall(check, scheduler);
+
+    return check.passed() && bitmap.size() == static_cast<std::size_t>(settings.size) * settings.size * 4 ? 0 : 1;
+}
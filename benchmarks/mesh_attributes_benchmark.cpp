@@ -0,0 +1,255 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+#include <DirectXMath.h>
+
+#include "benchmark_support.h"
+#include "common.h"
+#include "mesh_attributes.h"
+#include "object_loader.h"
+#include "task_scheduler.h"
+
+// Normal and tangent generation. First an OBJ file mixing every face format
+// (v, v/vt, v//vn, v/vt/vn, negative indices, quads and a pentagon, smoothing
+// on and off) is loaded and its normals and tangents are checked, and a file
+// with an index out of range has to fail. Then a wavy terrain of --cells x
+// --cells quads without normals is generated with one worker and with all of
+// them, reporting triangles per second and the angle between the smoothed
+// normals and the analytic ones.
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+    constexpr float TERRAIN_SIZE = 100.0f;
+    constexpr float WAVE_HEIGHT = 2.0f;
+    constexpr float WAVE_NUMBER = 0.2f;
+
+    struct Settings {
+        int cells = 512;
+        unsigned workers = 0;
+    };
+
+    const char* MIXED_FACES =
+            "o flat_cube\n"
+            "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\nv 0 0 1\nv 1 0 1\nv 1 1 1\nv 0 1 1\n"
+            "s off\n"
+            "f 1 4 3 2\nf 5 6 7 8\nf 1 2 6 5\nf 4 8 7 3\nf 1 5 8 4\nf 2 3 7 6 \n"
+            "o smooth_cube\n"
+            "v 3 0 0\nv 4 0 0\nv 4 1 0\nv 3 1 0\nv 3 0 1\nv 4 0 1\nv 4 1 1\nv 3 1 1\n"
+            "vt 0 0\nvt 1 0\nvt 1 1\nvt 0 1\n"
+            "s 1\n"
+            "f -8/1 -5/2 -6/3 -7/4\r\nf -4/1 -3/2 -2/3 -1/4\nf -8/1 -7/2 -3/3 -4/4\n"
+            "f -5/1 -1/2 -2/3 -6/4\nf -8/1 -4/2 -1/3 -5/4\nf -7/1 -6/2 -2/3 -3/4\n"
+            "o pentagon\n"
+            "v 0 3 0\nv 1 3 0\nv 1.3 4 0\nv 0.5 4.6 0\nv -0.3 4 0\n"
+            "vn 0 0 1\n"
+            "f 17//1 18//1 19//1 20//1 21//1\n"
+            "f 17/1/1 18/2/1 19/3/1\n";
+
+    const char* INDEX_OUT_OF_RANGE =
+            "v 0 0 0\nv 1 0 0\nv 1 1 0\n"
+            "f 1 2 4\n";
+
+    float get_length(const DirectX::XMFLOAT3& v) {
+        return std::sqrt(v.x * v.x + v.y * v.y + v.z * v.z);
+    }
+
+    bool write_file(const std::filesystem::path& path, const char* contents) {
+        std::ofstream file(path, std::ios::binary);
+        file << contents;
+        return file.good();
+    }
+
+    void check_mixed_faces(Checks& check) {
+        ScratchDirectory scratch("mesh_attributes_benchmark");
+        const std::filesystem::path& directory = scratch.get_path();
+
+        write_file(directory / "mixed.obj", MIXED_FACES);
+        write_file(directory / "broken.obj", INDEX_OUT_OF_RANGE);
+
+        ObjectLoader mixed((directory / "mixed").string(), {1.0f, 1.0f, 1.0f, 1.0f});
+        mixed.set_generate_tangents(true);
+        check(SUCCEEDED(mixed.load()), "the file mixing face formats loads");
+
+        std::vector<Vertex> vertices = mixed.get_vertices();
+        const std::vector<DirectX::XMFLOAT4>& tangents = mixed.get_tangents();
+        check(vertices.size() == 36 + 36 + 9 + 3, "quads, the pentagon and the triangle are split into 28 triangles");
+        check(tangents.size() == vertices.size(), "every vertex has a tangent");
+
+        if (vertices.size() != 84 || tangents.size() != vertices.size()) {
+            return;
+        }
+
+        bool flat = true;
+        bool smooth = true;
+        bool kept = true;
+        bool tangent_frames = true;
+
+        for (std::size_t i = 0; i < vertices.size(); i++) {
+            const DirectX::XMFLOAT3& n = vertices[i].normal;
+            float largest = std::max({std::fabs(n.x), std::fabs(n.y), std::fabs(n.z)});
+            float smallest = std::min({std::fabs(n.x), std::fabs(n.y), std::fabs(n.z)});
+
+            if (i < 36) {
+                flat = flat && std::fabs(largest - 1.0f) < 1e-5f && std::fabs(get_length(n) - 1.0f) < 1e-5f;
+            }
+            else if (i < 72) {
+                // Corners of a smoothed cube point along its diagonals.
+                smooth = smooth && std::fabs(smallest - 1.0f / std::sqrt(3.0f)) < 1e-4f && std::fabs(largest - smallest) < 1e-4f;
+
+                const DirectX::XMFLOAT4& t = tangents[i];
+                float dot = t.x * n.x + t.y * n.y + t.z * n.z;
+                tangent_frames = tangent_frames && std::fabs(get_length({t.x, t.y, t.z}) - 1.0f) < 1e-4f &&
+                                 std::fabs(dot) < 1e-4f && std::fabs(std::fabs(t.w) - 1.0f) < 1e-6f;
+            }
+            else {
+                // Turned around the y axis like the positions
+                kept = kept && std::fabs(n.z + 1.0f) < 1e-6f;
+            }
+        }
+
+        check(flat, "s off gives axis aligned face normals");
+        check(smooth, "s 1 gives diagonal corner normals");
+        check(kept, "normals from the file are kept");
+        check(tangent_frames, "tangents are unit length, orthogonal to the normal and w is +-1");
+
+        ObjectLoader plain((directory / "mixed").string(), {1.0f, 1.0f, 1.0f, 1.0f});
+        check(SUCCEEDED(plain.load()) && plain.get_tangents().empty() && plain.get_number_of_vertices() == vertices.size(),
+              "tangents are only generated on request");
+
+        ObjectLoader broken((directory / "broken").string(), {1.0f, 1.0f, 1.0f, 1.0f});
+        check(FAILED(broken.load()), "an index out of range fails the load");
+    }
+
+    struct Terrain {
+        std::vector<Vertex> vertices;
+        std::vector<std::uint32_t> position_indices;
+        std::vector<std::uint32_t> smoothing_groups;
+    };
+
+    float get_height(float x, float z) {
+        return WAVE_HEIGHT * std::sin(WAVE_NUMBER * x) * std::cos(WAVE_NUMBER * z);
+    }
+
+    Terrain make_terrain(int cells) {
+        Terrain terrain;
+        float cell = TERRAIN_SIZE / static_cast<float>(cells);
+
+        auto add = [&](int i, int j) {
+            float x = static_cast<float>(i) * cell;
+            float z = static_cast<float>(j) * cell;
+            terrain.vertices.push_back({
+                    {x, get_height(x, z), z},
+                    {0.0f, 0.0f, 0.0f},
+                    {1.0f, 1.0f, 1.0f, 1.0f},
+                    {x / TERRAIN_SIZE, -z / TERRAIN_SIZE}
+            });
+            terrain.position_indices.push_back(static_cast<std::uint32_t>(i * (cells + 1) + j));
+        };
+
+        for (int i = 0; i < cells; i++) {
+            for (int j = 0; j < cells; j++) {
+                add(i, j);
+                add(i, j + 1);
+                add(i + 1, j + 1);
+                add(i, j);
+                add(i + 1, j + 1);
+                add(i + 1, j);
+                terrain.smoothing_groups.push_back(1);
+                terrain.smoothing_groups.push_back(1);
+            }
+        }
+
+        return terrain;
+    }
+
+    // Mean angle in degrees between the generated normals and the gradient of the height field.
+    double get_mean_normal_error(const std::vector<Vertex>& vertices) {
+        double sum = 0.0;
+
+        for (const Vertex& vertex : vertices) {
+            float x = vertex.position.x;
+            float z = vertex.position.z;
+            DirectX::XMFLOAT3 expected = {
+                    -WAVE_HEIGHT * WAVE_NUMBER * std::cos(WAVE_NUMBER * x) * std::cos(WAVE_NUMBER * z),
+                    1.0f,
+                    WAVE_HEIGHT * WAVE_NUMBER * std::sin(WAVE_NUMBER * x) * std::sin(WAVE_NUMBER * z)
+            };
+            float dot = (expected.x * vertex.normal.x + expected.y * vertex.normal.y + expected.z * vertex.normal.z) / get_length(expected);
+            sum += std::acos(std::clamp(dot, -1.0f, 1.0f)) * 180.0 / DirectX::XM_PI;
+        }
+
+        return vertices.empty() ? 0.0 : sum / static_cast<double>(vertices.size());
+    }
+
+    void run(const Terrain& terrain, TaskScheduler& scheduler, double& normals_ms, double& tangents_ms, double& error) {
+        std::vector<Vertex> vertices = terrain.vertices;
+
+        auto normals_start = Clock::now();
+        generate_normals(vertices, terrain.position_indices, terrain.smoothing_groups, scheduler);
+        normals_ms = std::chrono::duration<double, std::milli>(Clock::now() - normals_start).count();
+
+        auto tangents_start = Clock::now();
+        std::vector<DirectX::XMFLOAT4> tangents = generate_tangents(vertices, terrain.position_indices, scheduler);
+        tangents_ms = std::chrono::duration<double, std::milli>(Clock::now() - tangents_start).count();
+
+        error = get_mean_normal_error(vertices);
+    }
+}
+
+int main(int argc, char** argv) {
+    Settings settings;
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--cells") == 0 && i + 1 < argc) {
+            settings.cells = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--workers") == 0 && i + 1 < argc) {
+            settings.workers = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else {
+            std::printf("usage: %s [--cells N] [--workers N]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (settings.cells <= 0) {
+        std::printf("--cells must be positive\n");
+        return 1;
+    }
+
+    Checks check;
+    check_mixed_faces(check);
+    std::printf("face formats: %s\n\n", check.passed() ? "ok" : "FAILED");
+
+    Terrain terrain = make_terrain(settings.cells);
+    double triangles = static_cast<double>(terrain.vertices.size() / 3);
+    std::printf("%.0f triangles, %zu vertices\n", triangles, terrain.vertices.size());
+    std::printf("%8s %12s %14s %12s %14s %12s\n", "workers", "normals ms", "Mtriangles/s", "tangents ms", "Mtriangles/s", "error deg");
+
+    TaskScheduler single(TaskScheduler::Options{1});
+    TaskScheduler all(TaskScheduler::Options{settings.workers});
+
+    for (TaskScheduler* scheduler : {&single, &all}) {
+        double normals_ms = 0.0;
+        double tangents_ms = 0.0;
+        double error = 0.0;
+        run(terrain, *scheduler, normals_ms, tangents_ms, error);
+
+        std::printf("%8u %12.1f %14.2f %12.1f %14.2f %12.3f\n",
+                    scheduler->get_worker_count(),
+                    normals_ms,
+                    triangles / (normals_ms * 1e3),
+                    tangents_ms,
+                    triangles / (tangents_ms * 1e3),
+                    error);
+    }
+
+    return check.passed() ? 0 : 1;
+}
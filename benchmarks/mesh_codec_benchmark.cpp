@@ -0,0 +1,316 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <DirectXMath.h>
+
+#include "benchmark_support.h"
+#include "common.h"
+#include "mesh_chunk.h"
+#include "mesh_codec.h"
+#include "object_loader.h"
+
+// Mesh compression. A scan-like terrain of --cells x --cells quads (smooth
+// normals, uvs, baked vertex colors, a triangle list as ObjectLoader gives
+// it) and optionally a model are encoded with the default options. Reported
+// are the sizes (index bits per triangle, vertex bytes per vertex), encoding
+// time and decoding throughput in bytes of Vertex data produced per second,
+// indexed and expanded to a triangle list. Every decoded triangle has to
+// match the original up to rotation within the quantization error, a
+// truncated stream has to fail and a compressed MeshChunk has to load back.
+// Times are the best of --repeats runs on a single core.
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+    constexpr double TARGET_BYTES_PER_SECOND = 1e9;
+    constexpr float TERRAIN_SIZE = 200.0f;
+    constexpr float WAVE_HEIGHT = 4.0f;
+    constexpr float WAVE_NUMBER = 0.15f;
+
+    // Quantization error allowed on top of the half step, for float rounding
+    constexpr float TOLERANCE = 1.001f;
+    constexpr float MAX_NORMAL_ERROR_DEGREES = 0.5f;
+
+    struct Settings {
+        std::string model_uri;
+        int cells = 1024;
+        int repeats = 5;
+    };
+
+    struct Errors {
+        float position = 0.0f;
+        float normal_degrees = 0.0f;
+        float texture_coordinates = 0.0f;
+        float color = 0.0f;
+    };
+
+    float get_height(float x, float z) {
+        return WAVE_HEIGHT * std::sin(WAVE_NUMBER * x) * std::cos(WAVE_NUMBER * z);
+    }
+
+    DirectX::XMFLOAT3 get_normal(float x, float z) {
+        using namespace DirectX;
+
+        XMFLOAT3 normal;
+        XMVECTOR gradient = XMVectorSet(-WAVE_HEIGHT * WAVE_NUMBER * std::cos(WAVE_NUMBER * x) * std::cos(WAVE_NUMBER * z), 1.0f,
+                                        WAVE_HEIGHT * WAVE_NUMBER * std::sin(WAVE_NUMBER * x) * std::sin(WAVE_NUMBER * z), 0.0f);
+        XMStoreFloat3(&normal, XMVector3Normalize(gradient));
+        return normal;
+    }
+
+    std::vector<Vertex> make_terrain(int cells) {
+        std::vector<Vertex> vertices;
+        vertices.reserve(static_cast<std::size_t>(cells) * cells * 6);
+        float cell = TERRAIN_SIZE / static_cast<float>(cells);
+
+        auto add = [&](int i, int j) {
+            float x = static_cast<float>(i) * cell;
+            float z = static_cast<float>(j) * cell;
+            float occlusion = 0.6f + 0.4f * (get_height(x, z) / WAVE_HEIGHT * 0.5f + 0.5f);
+            vertices.push_back({
+                    {x, get_height(x, z), z},
+                    get_normal(x, z),
+                    {occlusion, occlusion, occlusion, 1.0f},
+                    {x / TERRAIN_SIZE, -z / TERRAIN_SIZE}
+            });
+        };
+
+        for (int i = 0; i < cells; i++) {
+            for (int j = 0; j < cells; j++) {
+                add(i, j);
+                add(i, j + 1);
+                add(i + 1, j + 1);
+                add(i, j);
+                add(i + 1, j + 1);
+                add(i + 1, j);
+            }
+        }
+
+        return vertices;
+    }
+
+    template <typename Function>
+    double get_best_seconds(int repeats, Function&& function) {
+        double best = 0.0;
+
+        for (int i = 0; i < repeats; i++) {
+            auto start = Clock::now();
+            function();
+            double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+            best = i == 0 ? seconds : std::min(best, seconds);
+        }
+
+        return best;
+    }
+
+    float get_distance(const DirectX::XMFLOAT3& a, const DirectX::XMFLOAT3& b) {
+        return std::sqrt((a.x - b.x) * (a.x - b.x) + (a.y - b.y) * (a.y - b.y) + (a.z - b.z) * (a.z - b.z));
+    }
+
+    float get_angle_degrees(const DirectX::XMFLOAT3& a, const DirectX::XMFLOAT3& b) {
+        float dot = (a.x * b.x + a.y * b.y + a.z * b.z) / std::max(get_distance(a, {0.0f, 0.0f, 0.0f}) * get_distance(b, {0.0f, 0.0f, 0.0f}), 1e-20f);
+        return std::acos(std::clamp(dot, -1.0f, 1.0f)) * 180.0f / DirectX::XM_PI;
+    }
+
+    // Largest errors over the triangles, each matched at the rotation closest in position.
+    Errors get_errors(const std::vector<Vertex>& original, const std::vector<Vertex>& decoded) {
+        Errors errors;
+
+        for (std::size_t t = 0; t + 2 < original.size(); t += 3) {
+            int best_rotation = 0;
+            float best_distance = INFINITY;
+
+            for (int r = 0; r < 3; r++) {
+                float distance = 0.0f;
+
+                for (int k = 0; k < 3; k++) {
+                    distance = std::max(distance, get_distance(original[t + (k + r) % 3].position, decoded[t + k].position));
+                }
+
+                if (distance < best_distance) {
+                    best_distance = distance;
+                    best_rotation = r;
+                }
+            }
+
+            for (int k = 0; k < 3; k++) {
+                const Vertex& a = original[t + (k + best_rotation) % 3];
+                const Vertex& b = decoded[t + k];
+                const float* a_position = &a.position.x;
+                const float* b_position = &b.position.x;
+                const float* a_color = &a.color.x;
+                const float* b_color = &b.color.x;
+
+                for (int c = 0; c < 3; c++) {
+                    errors.position = std::max(errors.position, std::abs(a_position[c] - b_position[c]));
+                }
+
+                for (int c = 0; c < 4; c++) {
+                    errors.color = std::max(errors.color, std::abs(std::clamp(a_color[c], 0.0f, 1.0f) - b_color[c]));
+                }
+
+                errors.normal_degrees = std::max(errors.normal_degrees, get_angle_degrees(a.normal, b.normal));
+                errors.texture_coordinates = std::max({errors.texture_coordinates,
+                                                       std::abs(a.texture_coordinates.x - b.texture_coordinates.x),
+                                                       std::abs(a.texture_coordinates.y - b.texture_coordinates.y)});
+            }
+        }
+
+        return errors;
+    }
+
+    // Half a quantization step of the largest extent of the given components.
+    float get_half_step(const std::vector<Vertex>& vertices, int offset, int components, int bits) {
+        float half_step = 0.0f;
+
+        for (int c = 0; c < components; c++) {
+            auto compare = [&](const Vertex& a, const Vertex& b) {
+                return reinterpret_cast<const float*>(&a)[offset + c] < reinterpret_cast<const float*>(&b)[offset + c];
+            };
+            auto [min, max] = std::minmax_element(vertices.begin(), vertices.end(), compare);
+            float extent = reinterpret_cast<const float*>(&*max)[offset + c] - reinterpret_cast<const float*>(&*min)[offset + c];
+            half_step = std::max(half_step, 0.5f * extent / static_cast<float>((1 << bits) - 1));
+        }
+
+        return half_step;
+    }
+
+    // Returns the number of failed checks.
+    int run(const char* name, const std::vector<Vertex>& vertices, int repeats) {
+        Checks check(name);
+
+        MeshEncodeOptions options;
+        std::vector<std::uint8_t> encoded;
+        HRESULT hr = S_OK;
+        double encode_seconds = get_best_seconds(repeats, [&] { hr = encode_mesh(vertices, encoded, options); });
+        check(SUCCEEDED(hr), "encoding succeeds");
+
+        std::vector<Vertex> indexed_vertices;
+        std::vector<std::uint32_t> indices;
+        double indexed_seconds = get_best_seconds(repeats, [&] { hr = decode_mesh(encoded.data(), encoded.size(), indexed_vertices, indices); });
+        check(SUCCEEDED(hr), "indexed decoding succeeds");
+
+        std::vector<Vertex> decoded;
+        double list_seconds = get_best_seconds(repeats, [&] { hr = decode_mesh(encoded.data(), encoded.size(), decoded); });
+        check(SUCCEEDED(hr) && decoded.size() == vertices.size(), "triangle list decoding succeeds");
+
+        std::vector<std::uint8_t> encoded_indices;
+        std::vector<std::uint32_t> decoded_indices;
+        encode_index_buffer(indices, encoded_indices);
+        double index_seconds = get_best_seconds(repeats, [&] {
+            hr = decode_index_buffer(encoded_indices.data(), encoded_indices.size(), indices.size(), decoded_indices);
+        });
+        check(SUCCEEDED(hr) && decoded_indices == indices, "the index stage round trips");
+
+        std::vector<Vertex> truncated;
+        check(FAILED(decode_mesh(encoded.data(), encoded.size() - 1, truncated)), "a truncated stream fails");
+
+        double raw_bytes = static_cast<double>(vertices.size() * sizeof(Vertex));
+        double indexed_bytes = static_cast<double>(indexed_vertices.size() * sizeof(Vertex) + indices.size() * sizeof(std::uint32_t));
+        double index_bits = static_cast<double>(encoded_indices.size() * 8) / static_cast<double>(indices.size() / 3);
+        double vertex_bytes = static_cast<double>(encoded.size() - encoded_indices.size()) / static_cast<double>(std::max<std::size_t>(indexed_vertices.size(), 1));
+
+        std::printf("\n%s: %zu triangles, %zu unique vertices\n", name, vertices.size() / 3, indexed_vertices.size());
+        std::printf("  size: raw %.1f MiB, indexed %.1f MiB, encoded %.2f MiB (%.1fx raw, %.1fx indexed)\n",
+                    raw_bytes / (1 << 20), indexed_bytes / (1 << 20), static_cast<double>(encoded.size()) / (1 << 20),
+                    raw_bytes / static_cast<double>(encoded.size()), indexed_bytes / static_cast<double>(encoded.size()));
+        std::printf("  indices %.2f bits per triangle, vertices %.2f bytes per vertex\n", index_bits, vertex_bytes);
+        std::printf("  encode %.1f ms, decode indexed %.2f GB/s, triangle list %.2f GB/s, indices alone %.0f M triangles/s\n",
+                    encode_seconds * 1e3, indexed_bytes / indexed_seconds * 1e-9, raw_bytes / list_seconds * 1e-9,
+                    static_cast<double>(indices.size() / 3) / index_seconds * 1e-6);
+
+        if (indexed_bytes / indexed_seconds < TARGET_BYTES_PER_SECOND) {
+            std::printf("  indexed decoding is below the target of %.1f GB/s\n", TARGET_BYTES_PER_SECOND * 1e-9);
+        }
+
+        if (decoded.size() == vertices.size()) {
+            Errors errors = get_errors(vertices, decoded);
+            float position_step = get_half_step(vertices, 0, 3, options.position_bits);
+            float texture_coordinate_step = get_half_step(vertices, 10, 2, options.texture_coordinate_bits);
+
+            std::printf("  max error: position %.2e (half step %.2e), normal %.3f deg, uv %.2e (half step %.2e), color %.4f\n",
+                        errors.position, position_step, errors.normal_degrees, errors.texture_coordinates, texture_coordinate_step, errors.color);
+
+            check(errors.position <= position_step * TOLERANCE + 1e-6f, "positions within half a quantization step");
+            check(errors.texture_coordinates <= texture_coordinate_step * TOLERANCE + 1e-6f, "uvs within half a quantization step");
+            check(errors.normal_degrees <= MAX_NORMAL_ERROR_DEGREES, "normals within half a degree");
+            check(errors.color <= 0.5f / 255.0f * TOLERANCE, "colors within half a step");
+        }
+
+        return check.get_failures();
+    }
+
+    // Returns the number of failed checks.
+    int check_chunk(const std::vector<Vertex>& vertices) {
+        ScratchDirectory scratch("mesh_codec_benchmark");
+        std::filesystem::path path = scratch.get_path() / "terrain.chunk";
+        MeshChunk chunk;
+        chunk.vertices = vertices;
+
+        for (const auto& vertex : vertices) {
+            chunk.bounds.merge(vertex.position);
+        }
+
+        std::vector<Vertex> decoded;
+        std::vector<std::uint8_t> encoded;
+        encode_mesh(vertices, encoded);
+        decode_mesh(encoded.data(), encoded.size(), decoded);
+
+        MeshChunk loaded;
+        Checks check;
+        check(SUCCEEDED(chunk.save_compressed(path)) && SUCCEEDED(loaded.load(path)) &&
+              loaded.vertices.size() == decoded.size() &&
+              std::memcmp(loaded.vertices.data(), decoded.data(), decoded.size() * sizeof(Vertex)) == 0,
+              "a compressed chunk loads back");
+
+        return check.get_failures();
+    }
+}
+
+int main(int argc, char** argv) {
+    Settings settings;
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--cells") == 0 && i + 1 < argc) {
+            settings.cells = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--repeats") == 0 && i + 1 < argc) {
+            settings.repeats = std::atoi(argv[++i]);
+        }
+        else if (argv[i][0] != '-' && settings.model_uri.empty()) {
+            settings.model_uri = argv[i];
+        }
+        else {
+            std::printf("usage: %s [<model uri without .obj>] [--cells N] [--repeats N]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (settings.cells <= 0 || settings.repeats <= 0) {
+        std::printf("--cells and --repeats must be positive\n");
+        return 1;
+    }
+
+    std::vector<Vertex> terrain = make_terrain(settings.cells);
+    int failures = run("terrain", terrain, settings.repeats);
+    failures += check_chunk(make_terrain(16));
+
+    if (!settings.model_uri.empty()) {
+        ObjectLoader object_loader(settings.model_uri, {1.0f, 1.0f, 1.0f, 1.0f});
+
+        if (FAILED(object_loader.load())) {
+            std::printf("could not load model %s\n", settings.model_uri.c_str());
+            return 1;
+        }
+
+        failures += run(settings.model_uri.c_str(), object_loader.take_vertices(), settings.repeats);
+    }
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,349 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+#include <DirectXMath.h>
+
+#include "benchmark_support.h"
+#include "common.h"
+#include "mesh_chunk.h"
+#include "mesh_cooker.h"
+#include "object_loader.h"
+#include "process_memory.h"
+#include "world_streamer.h"
+
+// Out-of-core cooking. A scan-like terrain OBJ of about --size MiB (vertices,
+// uvs and normals first, then quads using the same index for all three, like
+// photogrammetry exports) with small smoothed boxes of another material,
+// whose uvs have indices of their own, is cooked into chunks of --chunk units
+// with a memory budget of --budget MiB, raw and compressed. Reported are the
+// throughput in MiB of OBJ and triangles per second, the sorted runs, the
+// temporary and output sizes and the peak resident memory above what the
+// process held before. The peak has to stay within the budget and a file
+// larger than the budget has to be sorted in runs. For files of up to 256 MiB
+// the raw chunks are compared with MeshChunk::split of what ObjectLoader
+// loads: every chunk has to hold the same triangles, and the compressed
+// chunks are listed from their headers and streamed in by WorldStreamer like
+// App does with --world: every one has to arrive with the bounds and the
+// size its header gave.
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+    constexpr float TERRAIN_SIZE = 256.0f;
+    constexpr int BOXES = 64;
+    constexpr int REFERENCE_LIMIT_MIB = 256;
+
+    // Allocator and thread stacks on top of the budget
+    constexpr std::size_t RESIDENT_SLACK = std::size_t{16} << 20;
+    constexpr float NORMAL_TOLERANCE = 1e-4f;
+    constexpr double STREAMING_TIMEOUT_SECONDS = 30.0;
+
+    struct Settings {
+        int size = 128;
+        int budget = 64;
+        float chunk = 32.0f;
+    };
+
+    struct Run {
+        HRESULT hr = E_FAIL;
+        MeshCooker::Statistics statistics;
+        std::size_t before = 0;
+        std::size_t peak = 0;
+    };
+
+    float get_height(float x, float z) {
+        return 3.0f * std::sin(0.11f * x) * std::cos(0.07f * z) + 0.5f * std::sin(0.9f * x + 0.4f * z);
+    }
+
+    // About 155 bytes of text per grid point.
+    bool write_model(const std::filesystem::path& uri, std::size_t size) {
+        std::FILE* file = std::fopen((uri.string() + ".obj").c_str(), "w");
+        std::FILE* library = std::fopen((uri.string() + ".mtl").c_str(), "w");
+        bool written = file != nullptr && library != nullptr;
+
+        if (library != nullptr) {
+            std::fprintf(library, "newmtl ground\nKd 0.5 0.6 0.7\n\nnewmtl rock\nKd 0.8 0.3 0.2\n");
+            written = std::fclose(library) == 0 && written;
+        }
+
+        if (file == nullptr) {
+            return false;
+        }
+
+        int points = static_cast<int>(std::sqrt(static_cast<double>(size) / 155.0));
+        points = std::max(points, 2);
+        float step = TERRAIN_SIZE / static_cast<float>(points - 1);
+        std::fprintf(file, "mtllib model.mtl\no Terrain\n");
+
+        for (int i = 0; i < points; i++) {
+            for (int j = 0; j < points; j++) {
+                float x = static_cast<float>(j) * step;
+                float z = static_cast<float>(i) * step;
+                float dx = (get_height(x + 0.01f, z) - get_height(x - 0.01f, z)) / 0.02f;
+                float dz = (get_height(x, z + 0.01f) - get_height(x, z - 0.01f)) / 0.02f;
+                float length = std::sqrt(dx * dx + 1.0f + dz * dz);
+
+                std::fprintf(file, "v %.4f %.4f %.4f\nvt %.5f %.5f\nvn %.4f %.4f %.4f\n",
+                             x, get_height(x, z), z, x / TERRAIN_SIZE, z / TERRAIN_SIZE, -dx / length, 1.0f / length, -dz / length);
+            }
+        }
+
+        std::fprintf(file, "usemtl ground\ns off\n");
+
+        for (int i = 0; i + 1 < points; i++) {
+            for (int j = 0; j + 1 < points; j++) {
+                int a = i * points + j + 1;
+                int b = a + points;
+                std::fprintf(file, "f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d\n", a, a, a, b, b, b, b + 1, b + 1, b + 1, a + 1, a + 1, a + 1);
+            }
+        }
+
+        // Boxes within the cells (away from their borders) without normals, smoothed.
+        std::fprintf(file, "o Rocks\nusemtl rock\ns 1\n");
+
+        for (int box = 0; box < BOXES; box++) {
+            float x = (static_cast<float>(box % 8) + 0.5f) * TERRAIN_SIZE / 8.0f;
+            float z = (static_cast<float>(box / 8) + 0.5f) * TERRAIN_SIZE / 8.0f;
+            float y = get_height(x, z);
+
+            for (int corner = 0; corner < 8; corner++) {
+                std::fprintf(file, "v %.4f %.4f %.4f\n", x + (corner & 1 ? 1.0f : -1.0f), y + (corner & 2 ? 2.0f : 0.0f), z + (corner & 4 ? 1.0f : -1.0f));
+            }
+
+            // Uvs of their own indices, which have to be sorted for separately.
+            for (const char* face : {"-8 -7 -5 -6", "-4 -2 -1 -3", "-8 -4 -3 -7", "-6 -5 -1 -2", "-8 -6 -2 -4", "-7 -3 -1 -5"}) {
+                int position[4];
+                std::sscanf(face, "%d %d %d %d", &position[0], &position[1], &position[2], &position[3]);
+                std::fprintf(file, "f %d/1 %d/2 %d/%d %d/%d\n", position[0], position[1], position[2], points + 1, position[3], points + 2);
+            }
+        }
+
+        return std::fclose(file) == 0 && written;
+    }
+
+    Run cook(const std::string& uri, const std::filesystem::path& output, const Settings& settings, bool compress) {
+        MeshCooker::Options options;
+        options.memory_budget = static_cast<std::size_t>(settings.budget) << 20;
+        options.chunk_size = settings.chunk;
+        options.compress = compress;
+
+        Run run;
+        std::filesystem::remove_all(output);
+        reset_peak_resident_bytes();
+        run.before = get_resident_bytes();
+
+        MeshCooker cooker(uri, {1.0f, 1.0f, 1.0f, 1.0f}, options);
+        run.hr = cooker.cook(output);
+        run.peak = get_peak_resident_bytes();
+        run.statistics = cooker.get_statistics();
+
+        return run;
+    }
+
+    // Triangles of a chunk in a fixed order, so chunks can be compared regardless of the order of their triangles.
+    std::vector<std::vector<Vertex>> get_triangles(const std::vector<Vertex>& vertices) {
+        std::vector<std::vector<Vertex>> triangles;
+
+        for (std::size_t i = 0; i + 2 < vertices.size(); i += 3) {
+            triangles.emplace_back(vertices.begin() + static_cast<std::ptrdiff_t>(i), vertices.begin() + static_cast<std::ptrdiff_t>(i + 3));
+        }
+
+        std::sort(triangles.begin(), triangles.end(), [](const std::vector<Vertex>& a, const std::vector<Vertex>& b) {
+            for (int k = 0; k < 3; k++) {
+                const DirectX::XMFLOAT3& p = a[k].position;
+                const DirectX::XMFLOAT3& q = b[k].position;
+
+                if (p.x != q.x || p.y != q.y || p.z != q.z) {
+                    return p.x != q.x ? p.x < q.x : p.y != q.y ? p.y < q.y : p.z < q.z;
+                }
+            }
+
+            return false;
+        });
+
+        return triangles;
+    }
+
+    bool is_same_vertex(const Vertex& a, const Vertex& b) {
+        return std::memcmp(&a.position, &b.position, sizeof(a.position)) == 0 &&
+               std::memcmp(&a.color, &b.color, sizeof(a.color)) == 0 &&
+               std::memcmp(&a.texture_coordinates, &b.texture_coordinates, sizeof(a.texture_coordinates)) == 0 &&
+               std::fabs(a.normal.x - b.normal.x) <= NORMAL_TOLERANCE &&
+               std::fabs(a.normal.y - b.normal.y) <= NORMAL_TOLERANCE &&
+               std::fabs(a.normal.z - b.normal.z) <= NORMAL_TOLERANCE;
+    }
+
+    // Every cooked chunk against the chunks split from the loaded model.
+    bool matches_reference(const std::string& uri, const std::filesystem::path& output, const Settings& settings, std::size_t& chunks) {
+        ObjectLoader loader(uri, {1.0f, 1.0f, 1.0f, 1.0f});
+
+        if (FAILED(loader.load())) {
+            return false;
+        }
+
+        std::vector<MeshChunk> reference = MeshChunk::split(loader.take_vertices(), settings.chunk);
+        chunks = reference.size();
+
+        for (std::size_t i = 0; i < reference.size(); i++) {
+            MeshChunk cooked;
+
+            if (FAILED(cooked.load(MeshCooker::get_chunk_path(output, i))) || cooked.vertices.size() != reference[i].vertices.size()) {
+                return false;
+            }
+
+            auto cooked_triangles = get_triangles(cooked.vertices);
+            auto reference_triangles = get_triangles(reference[i].vertices);
+
+            for (std::size_t t = 0; t < cooked_triangles.size(); t++) {
+                for (int k = 0; k < 3; k++) {
+                    if (!is_same_vertex(cooked_triangles[t][k], reference_triangles[t][k])) {
+                        return false;
+                    }
+                }
+            }
+        }
+
+        return true;
+    }
+
+    bool is_same_box(const Aabb& a, const Aabb& b) {
+        return a.min.x == b.min.x && a.min.y == b.min.y && a.min.z == b.min.z &&
+               a.max.x == b.max.x && a.max.y == b.max.y && a.max.z == b.max.z;
+    }
+
+    // Every chunk within range of the camera in the middle of the terrain, so all of them have to become resident.
+    bool streams(const std::filesystem::path& output, std::uint64_t expected_chunks, std::uint64_t expected_triangles) {
+        std::vector<WorldStreamer::Chunk> chunks;
+        Aabb world;
+
+        for (std::size_t i = 0; std::filesystem::exists(MeshCooker::get_chunk_path(output, i)); i++) {
+            WorldStreamer::Chunk chunk = {};
+
+            if (FAILED(MeshChunk::read_header(MeshCooker::get_chunk_path(output, i), chunk.bounds, chunk.size_bytes))) {
+                return false;
+            }
+
+            chunks.push_back(chunk);
+            world.merge(chunk.bounds);
+        }
+
+        std::vector<MeshChunk> loaded(chunks.size());
+        std::uint64_t triangles = 0;
+        bool as_listed = true;
+
+        ThreadedChunkLoader loader([&](ChunkId chunk) {
+            return loaded[chunk].load(MeshCooker::get_chunk_path(output, chunk));
+        });
+
+        WorldStreamer::Callbacks callbacks;
+        callbacks.upload = [&](ChunkId chunk) {
+            triangles += loaded[chunk].vertices.size() / 3;
+            as_listed = as_listed && is_same_box(loaded[chunk].bounds, chunks[chunk].bounds) &&
+                        loaded[chunk].get_size_bytes() == chunks[chunk].size_bytes;
+            return S_OK;
+        };
+
+        WorldStreamer::Options options;
+        options.load_radius = 2.0f * TERRAIN_SIZE;
+        options.unload_radius = 2.0f * TERRAIN_SIZE;
+        options.memory_budget = SIZE_MAX;
+        options.upload_budget = SIZE_MAX;
+
+        WorldStreamer streamer(chunks, loader, callbacks, options);
+        DirectX::XMFLOAT3 center = {(world.min.x + world.max.x) / 2.0f, world.max.y, (world.min.z + world.max.z) / 2.0f};
+        auto start = Clock::now();
+
+        while (streamer.get_statistics().resident_chunks < chunks.size() &&
+               std::chrono::duration<double>(Clock::now() - start).count() < STREAMING_TIMEOUT_SECONDS) {
+            streamer.update(center, 0.0f);
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        return chunks.size() == expected_chunks && streamer.get_statistics().resident_chunks == chunks.size() &&
+               streamer.get_statistics().failed_loads == 0 && triangles == expected_triangles && as_listed;
+    }
+
+    double get_mib(std::uint64_t bytes) {
+        return static_cast<double>(bytes) / (1 << 20);
+    }
+}
+
+int main(int argc, char** argv) {
+    Settings settings;
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+            settings.size = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--budget") == 0 && i + 1 < argc) {
+            settings.budget = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--chunk") == 0 && i + 1 < argc) {
+            settings.chunk = static_cast<float>(std::atof(argv[++i]));
+        }
+        else {
+            std::printf("usage: %s [--size <MiB>] [--budget <MiB>] [--chunk <units>]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (settings.size <= 0 || settings.budget <= 0 || !(settings.chunk > 0.0f)) {
+        std::printf("--size, --budget and --chunk must be positive\n");
+        return 1;
+    }
+
+    ScratchDirectory scratch("mesh_cooker_benchmark");
+    const std::filesystem::path& directory = scratch.get_path();
+    std::filesystem::path uri = directory / "model";
+
+    if (!write_model(uri, static_cast<std::size_t>(settings.size) << 20)) {
+        std::printf("could not write %s\n", uri.string().c_str());
+        return 1;
+    }
+
+    bool can_reset = reset_peak_resident_bytes();
+    Run raw = cook(uri.string(), directory / "raw", settings, false);
+    Run compressed = cook(uri.string(), directory / "compressed", settings, true);
+
+    Checks check;
+
+    const MeshCooker::Statistics& statistics = raw.statistics;
+    std::printf("%.1f MiB OBJ, %llu triangles, %llu chunks (largest %llu triangles), budget %d MiB%s\n",
+                get_mib(statistics.input_bytes), static_cast<unsigned long long>(statistics.triangles),
+                static_cast<unsigned long long>(statistics.chunks), static_cast<unsigned long long>(statistics.max_chunk_triangles),
+                settings.budget, can_reset ? "" : ", peak not resettable");
+    std::printf("%11s %8s %8s %10s %10s %6s %10s %10s %10s\n",
+                "", "parse s", "total s", "MiB/s", "Mtri/s", "runs", "temp MiB", "out MiB", "peak MiB");
+
+    for (const auto& [run, name] : {std::pair<const Run&, const char*>{raw, "raw"}, {compressed, "compressed"}}) {
+        const MeshCooker::Statistics& s = run.statistics;
+        double peak = get_mib(run.peak > run.before ? run.peak - run.before : 0);
+
+        std::printf("%11s %8.2f %8.2f %10.1f %10.2f %6llu %10.1f %10.1f %10.1f\n",
+                    name, s.parse_seconds, s.seconds, get_mib(s.input_bytes) / s.seconds, static_cast<double>(s.triangles) / s.seconds / 1e6,
+                    static_cast<unsigned long long>(s.sorted_runs), get_mib(s.temporary_bytes), get_mib(s.output_bytes), peak);
+
+        check(SUCCEEDED(run.hr), "the model is cooked");
+        check(s.chunks > 0 && s.triangles == statistics.triangles, "both cooks give the same triangles");
+        check(!can_reset || run.peak <= run.before + (static_cast<std::size_t>(settings.budget) << 20) + RESIDENT_SLACK,
+              "the peak resident memory stays within the budget");
+        check(s.input_bytes <= static_cast<std::uint64_t>(settings.budget) << 20 || s.sorted_runs > 0, "a file larger than the budget is sorted in runs");
+    }
+
+    if (settings.size <= REFERENCE_LIMIT_MIB) {
+        std::size_t chunks = 0;
+        check(matches_reference(uri.string(), directory / "raw", settings, chunks) && chunks == statistics.chunks,
+              "the chunks match MeshChunk::split of the loaded model");
+        check(streams(directory / "compressed", compressed.statistics.chunks, compressed.statistics.triangles),
+              "the compressed chunks stream in as their headers list them");
+    }
+
+    return check.passed() ? 0 : 1;
+}
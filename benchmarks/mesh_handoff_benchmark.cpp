@@ -0,0 +1,158 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "benchmark_support.h"
+#include "common.h"
+#include "object_loader.h"
+#include "process_memory.h"
+
+// Memory of handing a loaded mesh to upload memory. An OBJ file of --size MiB
+// is written to the temporary directory and loaded three times, each time
+// ending with the vertices in a separate buffer standing in for a mapped
+// upload heap:
+//  - copy: get_vertices() kept as the CPU copy and copied into the buffer
+//    (what the app did before),
+//  - take: take_vertices() copied into the buffer and released,
+//  - sink: load() writes the sorted vertices straight into the buffer.
+// For each the resident memory before the load, its peak during the load and
+// what stays resident afterwards are reported, relative to the size of the
+// vertex data. The three buffers have to hold the same vertices. Resetting
+// the peak needs Linux; elsewhere only the first row is exact.
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+    struct Settings {
+        int size = 512;
+    };
+
+    enum class Handoff { COPY, TAKE, SINK };
+
+    struct Result {
+        std::size_t before = 0;
+        std::size_t peak = 0;
+        std::size_t after = 0;
+        double ms = 0.0;
+        std::size_t vertices = 0;
+        std::size_t checksum = 0;
+        bool loaded = false;
+    };
+
+    std::size_t get_checksum(const Vertex* vertices, std::size_t count) {
+        return std::hash<std::string_view>()(std::string_view(reinterpret_cast<const char*>(vertices), count * sizeof(Vertex)));
+    }
+
+    Result run(const std::string& uri, Handoff handoff) {
+        Result result;
+        std::unique_ptr<Vertex[]> upload;
+        std::vector<Vertex> cpu_copy;
+
+        reset_peak_resident_bytes();
+        result.before = get_resident_bytes();
+        auto start = Clock::now();
+
+        {
+            ObjectLoader loader(uri, {1.0f, 1.0f, 1.0f, 1.0f});
+
+            if (handoff == Handoff::SINK) {
+                loader.set_vertex_sink([&](std::size_t count) {
+                    upload = std::make_unique_for_overwrite<Vertex[]>(count);
+                    return upload.get();
+                });
+            }
+
+            result.loaded = SUCCEEDED(loader.load());
+            result.vertices = loader.get_number_of_vertices();
+
+            if (result.loaded && handoff != Handoff::SINK) {
+                cpu_copy = handoff == Handoff::COPY ? loader.get_vertices() : loader.take_vertices();
+                upload = std::make_unique_for_overwrite<Vertex[]>(cpu_copy.size());
+                std::memcpy(upload.get(), cpu_copy.data(), cpu_copy.size() * sizeof(Vertex));
+
+                if (handoff == Handoff::TAKE) {
+                    std::vector<Vertex>().swap(cpu_copy);
+                }
+            }
+        }
+
+        result.ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        result.peak = get_peak_resident_bytes();
+        result.after = get_resident_bytes();
+        result.checksum = result.loaded ? get_checksum(upload.get(), result.vertices) : 0;
+
+        return result;
+    }
+}
+
+int main(int argc, char** argv) {
+    Settings settings;
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+            settings.size = std::atoi(argv[++i]);
+        }
+        else {
+            std::printf("usage: %s [--size <MiB>]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (settings.size <= 0) {
+        std::printf("--size must be positive\n");
+        return 1;
+    }
+
+    ScratchDirectory scratch("mesh_handoff_benchmark");
+    std::filesystem::path uri = scratch.get_path() / "model";
+
+    if (!write_model(uri, static_cast<std::size_t>(settings.size) << 20, ModelNormals::Shared)) {
+        std::printf("could not write %s\n", uri.string().c_str());
+        return 1;
+    }
+
+    bool can_reset = reset_peak_resident_bytes();
+
+    // The sink goes first, so without resetting the peak the row that should be the lowest is exact.
+    const std::pair<Handoff, const char*> handoffs[] = {{Handoff::SINK, "sink"}, {Handoff::TAKE, "take"}, {Handoff::COPY, "copy"}};
+    Result results[3];
+
+    for (int i = 0; i < 3; i++) {
+        results[i] = run(uri.string(), handoffs[i].first);
+    }
+
+    double vertex_bytes = static_cast<double>(results[0].vertices * sizeof(Vertex));
+    Checks check;
+
+    std::printf("%zu vertices, %.1f MiB of vertex data%s\n",
+                results[0].vertices, vertex_bytes / (1 << 20), can_reset ? "" : ", peak not resettable");
+    std::printf("%8s %10s %12s %12s %10s %12s %10s\n", "handoff", "load ms", "before MiB", "peak MiB", "peak x", "after MiB", "after x");
+
+    for (int i = 0; i < 3; i++) {
+        const Result& result = results[i];
+        double peak = static_cast<double>(result.peak) - static_cast<double>(result.before);
+        double after = static_cast<double>(result.after) - static_cast<double>(result.before);
+
+        std::printf("%8s %10.1f %12.1f %12.1f %10.2f %12.1f %10.2f\n",
+                    handoffs[i].second,
+                    result.ms,
+                    static_cast<double>(result.before) / (1 << 20),
+                    static_cast<double>(result.peak) / (1 << 20),
+                    peak / vertex_bytes,
+                    static_cast<double>(result.after) / (1 << 20),
+                    after / vertex_bytes);
+
+        char description[64];
+        std::snprintf(description, sizeof(description), "%s gives the same vertices", handoffs[i].second);
+        check(result.loaded && result.vertices == results[0].vertices && result.checksum == results[0].checksum, description);
+    }
+
+    return check.passed() ? 0 : 1;
+}
@@ -0,0 +1,280 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "benchmark_support.h"
+#include "obj_scanner.h"
+
+// OBJ parsing throughput. A file looking like a Blender export (%f numbers,
+// v/vt/vn/f records, quads, o, usemtl and s lines) of --size MiB is generated
+// in memory. For every kernel the CPU supports the structural index is built
+// and compared with the scalar one, then the whole file is walked with
+// ObjScanner, reading every number and face corner, and the record counts
+// are checked. Finally parse_float is compared with strtof on every number of
+// the file and on a list of harder cases, where both have to give the same
+// bits. Times are the best of --repeats runs on a single core.
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+    constexpr double TARGET_BYTES_PER_SECOND = 1e9;
+
+    struct Settings {
+        int size = 64;
+        int repeats = 5;
+    };
+
+    struct Counts {
+        std::size_t positions = 0;
+        std::size_t texture_coordinates = 0;
+        std::size_t normals = 0;
+        std::size_t faces = 0;
+        std::size_t corners = 0;
+
+        bool operator==(const Counts&) const = default;
+    };
+
+    const char* HARD_NUMBERS[] = {
+            "0.000000", "-0.000000", "1.000000", "-1.000000", "0.5", ".5", "5.", "+2.25",
+            "16777216.000000", "16777217.000000", "0.1", "0.2", "0.3", "123456.789012", "-98765.432109",
+            "0.000001", "0.0000001234567", "1.0000000596046448", "1.000000059604644775", "1.000000059604644775390625",
+            "3.4028235e38", "1e-3", "-2.5E+2", "1e-45", "inf", "-inf", "999999999999999999.9", "0.00000000000000000001"
+    };
+
+    // Objects of 1000 quads with their own vertices, like separate meshes of one export.
+    std::string make_obj(std::size_t size, Counts& counts) {
+        std::string text;
+        text.reserve(size + 4096);
+        std::uint32_t state = 1;
+        char line[128];
+
+        text += "# Blender v3.4.1 OBJ File: ''\n# www.blender.org\nmtllib scene.mtl\n";
+
+        for (int object = 0; text.size() < size; object++) {
+            std::snprintf(line, sizeof(line), "o Object.%03d\n", object);
+            text += line;
+
+            for (int i = 0; i < 1000; i++) {
+                std::snprintf(line, sizeof(line), "v %f %f %f\n", get_random(state, 100.0f), get_random(state, 100.0f), get_random(state, 100.0f));
+                text += line;
+            }
+
+            for (int i = 0; i < 1000; i++) {
+                std::snprintf(line, sizeof(line), "vt %f %f\n", get_random(state, 1.0f) * 0.5f + 0.5f, get_random(state, 1.0f) * 0.5f + 0.5f);
+                text += line;
+            }
+
+            for (int i = 0; i < 1000; i++) {
+                std::snprintf(line, sizeof(line), "vn %.4f %.4f %.4f\n", get_random(state, 1.0f), get_random(state, 1.0f), get_random(state, 1.0f));
+                text += line;
+            }
+
+            std::snprintf(line, sizeof(line), "usemtl Material.%03d\ns %s\n", object % 8, object % 2 == 0 ? "off" : "1");
+            text += line;
+
+            for (int i = 0; i < 1000; i++) {
+                int first = static_cast<int>(counts.positions) + 1 + static_cast<int>(next_random(state) % 997);
+                int uv = static_cast<int>(counts.texture_coordinates) + 1 + i;
+                int normal = static_cast<int>(counts.normals) + 1 + static_cast<int>(next_random(state) % 1000);
+                std::snprintf(line, sizeof(line), "f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d\n",
+                              first, uv, normal, first + 1, uv, normal, first + 2, uv, normal, first + 3, uv, normal);
+                text += line;
+            }
+
+            counts.positions += 1000;
+            counts.texture_coordinates += 1000;
+            counts.normals += 1000;
+            counts.faces += 1000;
+            counts.corners += 4000;
+        }
+
+        return text;
+    }
+
+    // The second stage without building a mesh: every number and corner is read, their sum keeps the work alive.
+    Counts walk(const std::string& text, ScanKernel kernel, double& sum, bool& valid) {
+        Counts counts;
+        ObjScanner scanner(text, kernel);
+        ObjFaceCorner corner;
+        float value = 0.0f;
+        sum = 0.0;
+        valid = true;
+
+        while (scanner.next_line()) {
+            std::string_view keyword = scanner.get_keyword();
+            std::size_t* count = keyword == "v" ? &counts.positions : keyword == "vt" ? &counts.texture_coordinates :
+                                 keyword == "vn" ? &counts.normals : nullptr;
+
+            if (count != nullptr) {
+                (*count)++;
+
+                while (!scanner.at_line_end()) {
+                    valid = scanner.read_float(value) && valid;
+                    sum += value;
+                }
+            }
+            else if (keyword == "f") {
+                counts.faces++;
+
+                while (!scanner.at_line_end()) {
+                    valid = scanner.read_face_corner(corner) && valid;
+                    sum += static_cast<double>(corner.position + corner.texture_coordinates + corner.normal);
+                    counts.corners++;
+                }
+            }
+        }
+
+        return counts;
+    }
+
+    bool same_index(const StructuralIndex& a, const StructuralIndex& b) {
+        return a.newlines == b.newlines && a.whitespace == b.whitespace && a.slashes == b.slashes;
+    }
+
+    template <typename Function>
+    double get_best_seconds(int repeats, Function&& function) {
+        double best = 0.0;
+
+        for (int i = 0; i < repeats; i++) {
+            auto start = Clock::now();
+            function();
+            double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+            best = i == 0 ? seconds : std::min(best, seconds);
+        }
+
+        return best;
+    }
+
+    bool same_bits(float a, float b) {
+        return std::memcmp(&a, &b, sizeof(float)) == 0;
+    }
+
+    // Start of every number of the v, vt and vn lines.
+    std::vector<std::size_t> get_number_offsets(const std::string& text) {
+        std::vector<std::size_t> offsets;
+        std::size_t line_begin = 0;
+
+        while (line_begin < text.size()) {
+            std::size_t line_end = std::min(text.find('\n', line_begin), text.size());
+
+            if (text[line_begin] == 'v') {
+                for (std::size_t i = line_begin; i < line_end; i++) {
+                    if (text[i] == ' ') {
+                        offsets.push_back(i + 1);
+                    }
+                }
+            }
+
+            line_begin = line_end + 1;
+        }
+
+        return offsets;
+    }
+}
+
+int main(int argc, char** argv) {
+    Settings settings;
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+            settings.size = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--repeats") == 0 && i + 1 < argc) {
+            settings.repeats = std::atoi(argv[++i]);
+        }
+        else {
+            std::printf("usage: %s [--size <MiB>] [--repeats N]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (settings.size <= 0 || settings.repeats <= 0) {
+        std::printf("--size and --repeats must be positive\n");
+        return 1;
+    }
+
+    Counts expected;
+    std::string text = make_obj(static_cast<std::size_t>(settings.size) << 20, expected);
+    double bytes = static_cast<double>(text.size());
+    int failures = 0;
+
+    std::printf("%.1f MiB, %zu positions, %zu faces, best kernel %s\n",
+                bytes / (1 << 20), expected.positions, expected.faces, get_scan_kernel_name(get_best_scan_kernel()));
+    std::printf("%8s %14s %14s %8s\n", "kernel", "index GB/s", "parse GB/s", "result");
+
+    StructuralIndex reference;
+    build_structural_index(text, reference, ScanKernel::SCALAR);
+
+    for (ScanKernel kernel : {ScanKernel::SCALAR, ScanKernel::SSE2, ScanKernel::AVX2}) {
+        if (!is_scan_kernel_supported(kernel)) {
+            std::printf("%8s %14s %14s %8s\n", get_scan_kernel_name(kernel), "-", "-", "-");
+            continue;
+        }
+
+        StructuralIndex index;
+        double index_seconds = get_best_seconds(settings.repeats, [&] { build_structural_index(text, index, kernel); });
+
+        Counts counts;
+        double sum = 0.0;
+        bool valid = true;
+        double parse_seconds = get_best_seconds(settings.repeats, [&] { counts = walk(text, kernel, sum, valid); });
+
+        bool ok = same_index(index, reference) && counts == expected && valid;
+        failures += ok ? 0 : 1;
+
+        std::printf("%8s %14.2f %14.2f %8s\n",
+                    get_scan_kernel_name(kernel), bytes / index_seconds * 1e-9, bytes / parse_seconds * 1e-9, ok ? "ok" : "FAILED");
+
+        if (kernel == get_best_scan_kernel() && bytes / parse_seconds < TARGET_BYTES_PER_SECOND) {
+            std::printf("         below the target of %.1f GB/s\n", TARGET_BYTES_PER_SECOND * 1e-9);
+        }
+    }
+
+    std::vector<std::size_t> offsets = get_number_offsets(text);
+    std::vector<float> fast(offsets.size());
+    std::vector<float> reference_values(offsets.size());
+
+    double fast_seconds = get_best_seconds(settings.repeats, [&] {
+        for (std::size_t i = 0; i < offsets.size(); i++) {
+            parse_float(text.c_str() + offsets[i], fast[i]);
+        }
+    });
+
+    double strtof_seconds = get_best_seconds(settings.repeats, [&] {
+        for (std::size_t i = 0; i < offsets.size(); i++) {
+            reference_values[i] = std::strtof(text.c_str() + offsets[i], nullptr);
+        }
+    });
+
+    std::size_t mismatches = 0;
+
+    for (std::size_t i = 0; i < offsets.size(); i++) {
+        mismatches += same_bits(fast[i], reference_values[i]) ? 0 : 1;
+    }
+
+    for (const char* number : HARD_NUMBERS) {
+        float value = 0.0f;
+        const char* end = parse_float(number, value);
+
+        if (end == nullptr || *end != '\0' || !same_bits(value, std::strtof(number, nullptr))) {
+            std::printf("FAILED: %s\n", number);
+            mismatches++;
+        }
+    }
+
+    failures += mismatches == 0 ? 0 : 1;
+
+    std::printf("\n%zu numbers: parse_float %.1f M/s, strtof %.1f M/s, %zu mismatches\n",
+                offsets.size(),
+                static_cast<double>(offsets.size()) / fast_seconds * 1e-6,
+                static_cast<double>(offsets.size()) / strtof_seconds * 1e-6,
+                mismatches);
+
+    return failures == 0 ? 0 : 1;
+}
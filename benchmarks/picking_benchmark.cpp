@@ -0,0 +1,232 @@
+#include <algorithm>
+#include <chrono>
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+#include <DirectXMath.h>
+
+#include "bounds.h"
+#include "camera.h"
+#include "rolling_statistics.h"
+#include "triangle_bvh.h"
+
+// Ray picking on a scanned room: floor, ceiling and four walls tessellated
+// into about two million slightly noisy triangles, one object per surface.
+// Hover rays through random screen points of cameras walking around the
+// room are timed, some of them are checked against a brute force loop over
+// every triangle, and the distance between two opposite walls is measured
+// the way a user would.
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+    constexpr float ROOM_SIZE = 20.0f;
+    constexpr float ROOM_HEIGHT = 3.0f;
+    constexpr float SCAN_NOISE = 0.005f;
+    constexpr float ASPECT_RATIO = 16.0f / 9.0f;
+    constexpr std::size_t CHECKED_RAYS = 64;
+
+    struct Settings {
+        std::size_t triangles = 2000000;
+        std::size_t rays = 20000;
+    };
+
+    struct Scene {
+        std::vector<BvhTriangle> triangles;
+        std::vector<std::uint32_t> objects;
+    };
+
+    // Grid of cells over the rectangle origin + s * u + t * v, s and t in [0, 1], displaced along the normal.
+    void add_surface(Scene& scene, std::mt19937& rng, std::uint32_t object, DirectX::XMFLOAT3 origin,
+                     DirectX::XMFLOAT3 u, DirectX::XMFLOAT3 v, int cells_u, int cells_v) {
+        std::uniform_real_distribution<float> noise(-SCAN_NOISE, SCAN_NOISE);
+        DirectX::XMFLOAT3 normal = {};
+        DirectX::XMStoreFloat3(&normal, DirectX::XMVector3Normalize(
+                DirectX::XMVector3Cross(DirectX::XMLoadFloat3(&u), DirectX::XMLoadFloat3(&v))));
+
+        std::vector<DirectX::XMFLOAT3> points;
+        points.reserve(static_cast<std::size_t>(cells_u + 1) * static_cast<std::size_t>(cells_v + 1));
+
+        for (int i = 0; i <= cells_u; i++) {
+            for (int j = 0; j <= cells_v; j++) {
+                float s = static_cast<float>(i) / static_cast<float>(cells_u);
+                float t = static_cast<float>(j) / static_cast<float>(cells_v);
+                float offset = noise(rng);
+
+                points.push_back({
+                        origin.x + s * u.x + t * v.x + offset * normal.x,
+                        origin.y + s * u.y + t * v.y + offset * normal.y,
+                        origin.z + s * u.z + t * v.z + offset * normal.z
+                });
+            }
+        }
+
+        auto point = [&](int i, int j) {
+            return points[static_cast<std::size_t>(i) * static_cast<std::size_t>(cells_v + 1) + static_cast<std::size_t>(j)];
+        };
+
+        for (int i = 0; i < cells_u; i++) {
+            for (int j = 0; j < cells_v; j++) {
+                scene.triangles.push_back({point(i, j), point(i + 1, j), point(i + 1, j + 1)});
+                scene.triangles.push_back({point(i, j), point(i + 1, j + 1), point(i, j + 1)});
+                scene.objects.push_back(object);
+                scene.objects.push_back(object);
+            }
+        }
+    }
+
+    Scene make_room(std::size_t triangle_count) {
+        // Cells of the same size on every surface
+        float area = 2.0f * ROOM_SIZE * ROOM_SIZE + 4.0f * ROOM_SIZE * ROOM_HEIGHT;
+        float cell = std::sqrt(2.0f * area / static_cast<float>(triangle_count));
+        int cells_long = std::max(1, static_cast<int>(ROOM_SIZE / cell));
+        int cells_short = std::max(1, static_cast<int>(ROOM_HEIGHT / cell));
+        float half = ROOM_SIZE * 0.5f;
+
+        Scene scene;
+        std::mt19937 rng(37);
+
+        add_surface(scene, rng, 0, {-half, 0.0f, -half}, {0.0f, 0.0f, ROOM_SIZE}, {ROOM_SIZE, 0.0f, 0.0f}, cells_long, cells_long);
+        add_surface(scene, rng, 1, {-half, ROOM_HEIGHT, -half}, {ROOM_SIZE, 0.0f, 0.0f}, {0.0f, 0.0f, ROOM_SIZE}, cells_long, cells_long);
+        add_surface(scene, rng, 2, {-half, 0.0f, -half}, {0.0f, ROOM_HEIGHT, 0.0f}, {0.0f, 0.0f, ROOM_SIZE}, cells_short, cells_long);
+        add_surface(scene, rng, 3, {half, 0.0f, -half}, {0.0f, 0.0f, ROOM_SIZE}, {0.0f, ROOM_HEIGHT, 0.0f}, cells_long, cells_short);
+        add_surface(scene, rng, 4, {-half, 0.0f, -half}, {ROOM_SIZE, 0.0f, 0.0f}, {0.0f, ROOM_HEIGHT, 0.0f}, cells_long, cells_short);
+        add_surface(scene, rng, 5, {-half, 0.0f, half}, {0.0f, ROOM_HEIGHT, 0.0f}, {ROOM_SIZE, 0.0f, 0.0f}, cells_short, cells_long);
+
+        return scene;
+    }
+
+    // Reference: Moller-Trumbore against every triangle, written with DirectXMath vectors.
+    bool brute_force(const std::vector<BvhTriangle>& triangles, const Ray& ray, float& closest) {
+        using namespace DirectX;
+
+        XMVECTOR origin = XMLoadFloat3(&ray.origin);
+        XMVECTOR direction = XMLoadFloat3(&ray.direction);
+        closest = FLT_MAX;
+
+        for (const BvhTriangle& triangle : triangles) {
+            XMVECTOR a = XMLoadFloat3(&triangle.a);
+            XMVECTOR edge1 = XMVectorSubtract(XMLoadFloat3(&triangle.b), a);
+            XMVECTOR edge2 = XMVectorSubtract(XMLoadFloat3(&triangle.c), a);
+            XMVECTOR p = XMVector3Cross(direction, edge2);
+            float determinant = XMVectorGetX(XMVector3Dot(edge1, p));
+
+            if (std::fabs(determinant) < 1e-12f) {
+                continue;
+            }
+
+            XMVECTOR t = XMVectorSubtract(origin, a);
+            XMVECTOR q = XMVector3Cross(t, edge1);
+            float u = XMVectorGetX(XMVector3Dot(t, p)) / determinant;
+            float v = XMVectorGetX(XMVector3Dot(direction, q)) / determinant;
+            float distance = XMVectorGetX(XMVector3Dot(edge2, q)) / determinant;
+
+            if (u >= 0.0f && v >= 0.0f && u + v <= 1.0f && distance >= 0.0f) {
+                closest = std::min(closest, distance);
+            }
+        }
+
+        return closest != FLT_MAX;
+    }
+}
+
+int main(int argc, char** argv) {
+    Settings settings;
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--triangles") == 0 && i + 1 < argc) {
+            settings.triangles = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (std::strcmp(argv[i], "--rays") == 0 && i + 1 < argc) {
+            settings.rays = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else {
+            std::printf("usage: %s [--triangles N] [--rays N]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (settings.triangles < 12 || settings.rays == 0) {
+        std::printf("--triangles must be at least 12 and --rays positive\n");
+        return 1;
+    }
+
+    Scene scene = make_room(settings.triangles);
+    std::vector<BvhTriangle> reference = scene.triangles;
+    std::size_t triangle_count = scene.triangles.size();
+
+    TriangleBvh bvh;
+    auto build_start = Clock::now();
+    bvh.build(std::move(scene.triangles), std::move(scene.objects));
+    double build_ms = std::chrono::duration<double, std::milli>(Clock::now() - build_start).count();
+
+    std::printf("%zu triangles, %zu nodes, built in %.1f ms\n", triangle_count, bvh.get_number_of_nodes(), build_ms);
+
+    // Hover rays: a camera walking around the room at eye height, looking around.
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    RollingStatistics ray_statistics(settings.rays);
+    std::size_t hits = 0;
+    std::size_t mismatches = 0;
+    std::size_t checked = 0;
+    double brute_force_us = 0.0;
+    Camera camera;
+
+    for (std::size_t i = 0; i < settings.rays; i++) {
+        float time = static_cast<float>(i) / static_cast<float>(settings.rays);
+        float angle = time * 2.0f * DirectX::XM_PI;
+        camera.set_pose({{6.0f * std::cos(angle), 1.7f, 6.0f * std::sin(angle)}, angle * 3.0f, 0.4f * unit(rng)});
+
+        Ray ray = camera.get_ray(ASPECT_RATIO, unit(rng), unit(rng));
+        RayHit hit = {};
+
+        auto start = Clock::now();
+        bool found = bvh.intersect(ray, hit);
+        ray_statistics.add(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+
+        hits += found ? 1 : 0;
+
+        if (i % (settings.rays / std::min(settings.rays, CHECKED_RAYS)) == 0) {
+            float expected = 0.0f;
+            auto brute_start = Clock::now();
+            bool expected_found = brute_force(reference, ray, expected);
+            brute_force_us += std::chrono::duration<double, std::micro>(Clock::now() - brute_start).count();
+            checked++;
+
+            if (expected_found != found || (found && std::fabs(expected - hit.distance) > 1e-4f)) {
+                mismatches++;
+            }
+        }
+    }
+
+    std::printf("hover ray  mean %.2f us  p50 %.2f  p99 %.2f  max %.2f  (%zu / %zu hit)\n",
+                ray_statistics.mean(),
+                ray_statistics.percentile(50.0),
+                ray_statistics.percentile(99.0),
+                ray_statistics.max(),
+                hits,
+                settings.rays);
+    std::printf("brute force  %.0f us per ray, %zu / %zu rays agree\n",
+                brute_force_us / static_cast<double>(std::max<std::size_t>(checked, 1)), checked - mismatches, checked);
+
+    // Measurement: click on one wall, then on the opposite one.
+    RayHit first = {};
+    RayHit second = {};
+    bool measured = bvh.intersect({{0.0f, 1.5f, 0.0f}, {-1.0f, 0.0f, 0.0f}}, first) &&
+                    bvh.intersect({{0.0f, 1.5f, 0.0f}, {1.0f, 0.0f, 0.0f}}, second);
+
+    if (measured) {
+        float distance = std::sqrt((second.position.x - first.position.x) * (second.position.x - first.position.x) +
+                                   (second.position.y - first.position.y) * (second.position.y - first.position.y) +
+                                   (second.position.z - first.position.z) * (second.position.z - first.position.z));
+        std::printf("wall to wall  object %u -> %u  %.3f m (room is %.1f m, scan noise %.0f mm)\n",
+                    first.object, second.object, distance, ROOM_SIZE, SCAN_NOISE * 1000.0f);
+        measured = first.object == 2 && second.object == 3 && std::fabs(distance - ROOM_SIZE) < 2.0f * SCAN_NOISE + 1e-3f;
+    }
+
+    return mismatches == 0 && measured ? 0 : 1;
+}
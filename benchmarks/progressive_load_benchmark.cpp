@@ -0,0 +1,145 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "benchmark_support.h"
+#include "common.h"
+#include "object_loader.h"
+#include "progressive_mesh_loader.h"
+
+// Progressive mesh loading. An OBJ file of --size MiB (objects alternating
+// between faces with and without normals, two materials) is written to the
+// temporary directory and loaded once with ObjectLoader::load, then with
+// ProgressiveMeshLoader polled every 16 ms like the renderer does. Reported
+// are the time to the first batch, when 25 / 50 / 75 / 100% of the triangles
+// had arrived compared with the blocking load, and how long destroying a
+// loader in the middle of the file takes. The preview has to add up to the
+// final vertex count and the first batch has to arrive within 100 ms. The
+// file is read from the page cache, as it was just written.
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+    constexpr double FIRST_BATCH_TARGET_MS = 100.0;
+    constexpr auto FRAME_TIME = std::chrono::milliseconds(16);
+
+    struct Settings {
+        int size = 256;
+        int batch = 16384;
+    };
+
+    struct Arrival {
+        double ms;
+        std::size_t vertices;
+    };
+
+    // Time at which the given share of the vertices had been collected.
+    double get_arrival_ms(const std::vector<Arrival>& arrivals, std::size_t total, double share) {
+        for (const auto& arrival : arrivals) {
+            if (static_cast<double>(arrival.vertices) >= share * static_cast<double>(total)) {
+                return arrival.ms;
+            }
+        }
+
+        return 0.0;
+    }
+}
+
+int main(int argc, char** argv) {
+    Settings settings;
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+            settings.size = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--batch") == 0 && i + 1 < argc) {
+            settings.batch = std::atoi(argv[++i]);
+        }
+        else {
+            std::printf("usage: %s [--size <MiB>] [--batch <triangles>]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (settings.size <= 0 || settings.batch <= 0) {
+        std::printf("--size and --batch must be positive\n");
+        return 1;
+    }
+
+    ScratchDirectory scratch("progressive_load_benchmark");
+    std::filesystem::path uri = scratch.get_path() / "model";
+
+    if (!write_model(uri, static_cast<std::size_t>(settings.size) << 20, ModelNormals::EveryOtherObject)) {
+        std::printf("could not write %s\n", uri.string().c_str());
+        return 1;
+    }
+
+    constexpr DirectX::XMFLOAT4 color = { 1.0f, 1.0f, 1.0f, 1.0f };
+
+    auto start = Clock::now();
+    ObjectLoader blocking(uri.string(), color);
+    HRESULT hr = blocking.load();
+    double blocking_ms = get_ms(start);
+    std::size_t total = blocking.get_number_of_vertices();
+
+    std::printf("%.1f MiB, %zu triangles, batches of %d triangles\n",
+                static_cast<double>(std::filesystem::file_size(uri.string() + ".obj")) / (1 << 20), total / 3, settings.batch);
+
+    std::vector<Arrival> arrivals;
+    std::vector<Vertex> preview;
+    ProgressiveMeshLoader::Options options;
+    options.triangles_per_batch = static_cast<std::size_t>(settings.batch);
+
+    start = Clock::now();
+    ProgressiveMeshLoader progressive(uri.string(), color, options);
+    bool finished = false;
+
+    // Like the renderer: whatever arrived is collected once per frame, the final mesh replaces it at the end.
+    while (!finished) {
+        std::this_thread::sleep_for(FRAME_TIME);
+        finished = progressive.is_finished();
+
+        if (progressive.collect(preview) > 0) {
+            arrivals.push_back({get_ms(start), preview.size()});
+        }
+    }
+
+    double progressive_ms = get_ms(start);
+    double first_batch_ms = progressive.get_first_batch_ms();
+    HRESULT progressive_hr = progressive.get_result();
+    std::size_t final_vertices = progressive.get_loader().get_number_of_vertices();
+
+    std::printf("%28s %10s\n", "", "ms");
+    std::printf("%28s %10.1f\n", "blocking load", blocking_ms);
+    std::printf("%28s %10.1f\n", "first batch", first_batch_ms);
+    std::printf("%28s %10.1f\n", "first frame with geometry", arrivals.empty() ? 0.0 : arrivals.front().ms);
+
+    for (double share : {0.25, 0.5, 0.75, 1.0}) {
+        char label[32];
+        std::snprintf(label, sizeof(label), "%.0f%% of the triangles", share * 100.0);
+        std::printf("%28s %10.1f\n", label, get_arrival_ms(arrivals, total, share));
+    }
+
+    std::printf("%28s %10.1f\n", "progressive load", progressive_ms);
+
+    // Destroying a loader stops it at the next batch.
+    auto cancelled = std::make_unique<ProgressiveMeshLoader>(uri.string(), color, options);
+    std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(blocking_ms / 4.0));
+    start = Clock::now();
+    cancelled.reset();
+    std::printf("%28s %10.1f\n", "cancel", get_ms(start));
+
+    Checks check;
+    check(SUCCEEDED(hr) && SUCCEEDED(progressive_hr), "both loads succeed");
+    check(preview.size() == total && final_vertices == total, "the preview adds up to the loaded mesh");
+    check(first_batch_ms >= 0.0 && first_batch_ms <= FIRST_BATCH_TARGET_MS, "the first batch arrives within 100 ms");
+
+    return check.passed() ? 0 : 1;
+}
@@ -0,0 +1,162 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <DirectXMath.h>
+
+#include "bounds.h"
+#include "camera.h"
+#include "camera_path.h"
+#include "draw_batch.h"
+#include "frame_timing_log.h"
+#include "object_loader.h"
+#include "simulation_clock.h"
+#include "spatial_index.h"
+#include "triangle_bvh.h"
+
+// Headless replay of a camera path through the CPU side of a frame: loading
+// the model once, then fixed-timestep simulation steps, pose interpolation and
+// view/projection setup with a fixed frame time, the submesh culling against
+// the SpatialIndex with the draw list built from the visible submeshes and the
+// pick under the screen center against the TriangleBvh, the same way App does
+// it every frame (in --benchmark mode without the pick, which is timed on its
+// own here).
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+    constexpr float ASPECT_RATIO = 16.0f / 9.0f;
+
+    double elapsed_ms(Clock::time_point start, Clock::time_point end) {
+        return std::chrono::duration<double, std::milli>(end - start).count();
+    }
+
+    struct FrameConstants {
+        DirectX::XMFLOAT4X4 mat_world_view_proj;
+        DirectX::XMFLOAT4X4 mat_world_view;
+    };
+}
+
+int main(int argc, char** argv) {
+    std::string model_uri;
+    std::string path_uri;
+    std::string csv_uri;
+    float timestep = 1.0f / 60.0f;
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--path") == 0 && i + 1 < argc) {
+            path_uri = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--csv") == 0 && i + 1 < argc) {
+            csv_uri = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--timestep") == 0 && i + 1 < argc) {
+            timestep = std::strtof(argv[++i], nullptr);
+        }
+        else if (model_uri.empty() && argv[i][0] != '-') {
+            model_uri = argv[i];
+        }
+        else {
+            model_uri.clear();
+            break;
+        }
+    }
+
+    if (model_uri.empty() || timestep <= 0.0f) {
+        std::printf("usage: %s <model uri without .obj> [--path <camera path>] [--timestep <s>] [--csv <file>]\n", argv[0]);
+        return 1;
+    }
+
+    CameraPath path = CameraPath::make_default_tour();
+
+    if (!path_uri.empty() && FAILED(path.load(path_uri))) {
+        std::printf("could not load camera path %s\n", path_uri.c_str());
+        return 1;
+    }
+
+    auto load_start = Clock::now();
+    ObjectLoader object_loader(model_uri, {1.0f, 1.0f, 1.0f, 1.0f});
+
+    if (FAILED(object_loader.load())) {
+        std::printf("could not load model %s\n", model_uri.c_str());
+        return 1;
+    }
+
+    auto vertices = object_loader.take_vertices();
+    double load_ms = elapsed_ms(load_start, Clock::now());
+
+    // App::CreateDrawBatches and the collision BVH of App::PrepareModel
+    SpatialIndex submesh_index(object_loader.get_bounds());
+    std::vector<DrawBatch> submesh_draws;
+    create_submesh_draws(object_loader, object_loader.get_texture_uris(), submesh_draws, submesh_index);
+    std::vector<std::uint32_t> triangle_submeshes(vertices.size() / 3, TriangleBvh::NO_OBJECT);
+
+    for (std::size_t i = 0; i < submesh_draws.size(); i++) {
+        const DrawBatch& draw = submesh_draws[i];
+        std::fill_n(triangle_submeshes.begin() + draw.first_vertex / 3, draw.number_of_vertices / 3, static_cast<std::uint32_t>(i));
+    }
+
+    TriangleBvh collision_bvh;
+    collision_bvh.build(vertices, std::move(triangle_submeshes));
+
+    std::printf("model: %zu vertices in %zu submeshes, loaded in %.2f ms\n", vertices.size(), submesh_draws.size(), load_ms);
+    std::printf("camera path: %zu keyframes, %.2f s, timestep %.4f s\n\n",
+                path.get_number_of_keyframes(), path.get_duration(), timestep);
+
+    FrameTimingLog log({"frame_ms", "update_ms", "cull_ms", "pick_ms", "visible_submeshes", "draw_batches", "simulation_steps"});
+    Camera camera;
+    CameraPose previous_pose = camera.get_pose();
+    SimulationClock clock;
+    FrameConstants constants = {};
+    std::vector<SpatialIndex::ObjectId> visible_submeshes;
+    std::vector<bool> submesh_visible(submesh_draws.size(), true);
+    std::vector<DrawBatch> draw_batches;
+    std::size_t hits = 0;
+
+    while (clock.get_simulation_time() <= path.get_duration()) {
+        auto update_start = Clock::now();
+        std::size_t steps = 0;
+
+        clock.advance(timestep);
+
+        while (clock.step()) {
+            previous_pose = camera.get_pose();
+            camera.set_pose(path.sample(static_cast<float>(clock.get_simulation_time())));
+            steps++;
+        }
+
+        Camera view_camera = camera;
+        view_camera.set_pose(Camera::interpolate(previous_pose, camera.get_pose(), clock.get_interpolation_alpha()));
+
+        DirectX::XMMATRIX view = view_camera.get_projection_matrix();
+        DirectX::XMStoreFloat4x4(&constants.mat_world_view, DirectX::XMMatrixTranspose(view));
+        DirectX::XMMATRIX view_projection = DirectX::XMMatrixMultiply(view, view_camera.get_perspective_matrix(ASPECT_RATIO));
+        DirectX::XMStoreFloat4x4(&constants.mat_world_view_proj, DirectX::XMMatrixTranspose(view_projection));
+
+        auto cull_start = Clock::now();
+        cull_submeshes(submesh_index, submesh_draws, view_projection, visible_submeshes, submesh_visible, draw_batches);
+
+        auto pick_start = Clock::now();
+        RayHit hit;
+        hits += collision_bvh.intersect(view_camera.get_ray(ASPECT_RATIO, 0.0f, 0.0f), hit) ? 1 : 0;
+        auto frame_end = Clock::now();
+
+        log.add_frame({elapsed_ms(update_start, frame_end), elapsed_ms(update_start, cull_start), elapsed_ms(cull_start, pick_start),
+                       elapsed_ms(pick_start, frame_end), static_cast<double>(visible_submeshes.size()),
+                       static_cast<double>(draw_batches.size()), static_cast<double>(steps)});
+    }
+
+    std::printf("%s", log.get_summary().c_str());
+    std::printf("picks that hit the model: %zu of %zu\n", hits, log.get_number_of_frames());
+
+    if (!csv_uri.empty() && FAILED(log.write_csv(csv_uri))) {
+        std::printf("could not write %s\n", csv_uri.c_str());
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,178 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "task_scheduler.h"
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+    double elapsed_ns(Clock::time_point start, Clock::time_point end) {
+        return std::chrono::duration<double, std::nano>(end - start).count();
+    }
+
+    void empty_task_overhead(TaskScheduler& scheduler) {
+        constexpr std::size_t TASK_COUNT = 1'000'000;
+        constexpr std::size_t BATCH_SIZE = 1'000;
+
+        auto start = Clock::now();
+
+        for (std::size_t batch = 0; batch < TASK_COUNT / BATCH_SIZE; batch++) {
+            TaskCounter counter;
+
+            for (std::size_t i = 0; i < BATCH_SIZE; i++) {
+                scheduler.spawn(counter, [] {});
+            }
+
+            scheduler.wait(counter);
+        }
+
+        double ns = elapsed_ns(start, Clock::now());
+        std::printf("empty task:        %8.1f ns/task  %8.2f Mtasks/s\n",
+                    ns / TASK_COUNT, TASK_COUNT / ns * 1e3);
+    }
+
+    void wake_up_latency(TaskScheduler& scheduler) {
+        constexpr int SAMPLE_COUNT = 2'000;
+
+        if (scheduler.get_worker_count() < 2) {
+            std::printf("wake-up latency:   skipped, needs at least 2 workers\n");
+            return;
+        }
+
+        std::vector<double> samples;
+
+        for (int i = 0; i < SAMPLE_COUNT; i++) {
+            // Give the workers time to go to sleep so the wake-up path is measured.
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+
+            std::atomic<std::int64_t> started{0};
+            TaskCounter counter;
+            auto spawned = Clock::now();
+
+            scheduler.spawn(counter, [&started] {
+                started.store(Clock::now().time_since_epoch().count(), std::memory_order_release);
+            });
+
+            // Spin instead of wait() - the spawning thread must not run the task itself.
+            while (!counter.done()) {
+                std::this_thread::yield();
+            }
+
+            Clock::time_point start_time{Clock::duration(started.load(std::memory_order_acquire))};
+            samples.push_back(elapsed_ns(spawned, start_time));
+        }
+
+        std::sort(samples.begin(), samples.end());
+        std::printf("wake-up latency:   p50 %8.0f ns  p99 %8.0f ns  max %8.0f ns\n",
+                    samples[samples.size() / 2],
+                    samples[samples.size() * 99 / 100],
+                    samples.back());
+    }
+
+    std::size_t fork_join(TaskScheduler& scheduler, int depth) {
+        if (depth == 0) {
+            return 1;
+        }
+
+        std::size_t left = 0;
+        std::size_t right = 0;
+        TaskCounter counter;
+
+        scheduler.spawn(counter, [&scheduler, &left, depth] { left = fork_join(scheduler, depth - 1); });
+        right = fork_join(scheduler, depth - 1);
+        scheduler.wait(counter);
+
+        return left + right + 1;
+    }
+
+    void fork_join_depth(TaskScheduler& scheduler) {
+        for (int depth = 8; depth <= 20; depth += 4) {
+            auto start = Clock::now();
+            std::size_t tasks = fork_join(scheduler, depth);
+            double ns = elapsed_ns(start, Clock::now());
+
+            std::printf("fork-join depth %2d: %8zu tasks  %10.3f ms  %8.1f ns/task\n",
+                        depth, tasks, ns * 1e-6, ns / tasks);
+        }
+    }
+
+    void parallel_for_scaling(unsigned max_workers, bool pin_threads) {
+        constexpr std::size_t ELEMENT_COUNT = 1 << 24;
+
+        std::vector<float> data(ELEMENT_COUNT);
+        double single_worker_ns = 0.0;
+
+        for (std::size_t i = 0; i < ELEMENT_COUNT; i++) {
+            data[i] = static_cast<float>(i) * 0.001f;
+        }
+
+        std::vector<unsigned> worker_counts;
+
+        for (unsigned workers = 1; workers < max_workers; workers *= 2) {
+            worker_counts.push_back(workers);
+        }
+
+        worker_counts.push_back(max_workers);
+
+        for (unsigned workers : worker_counts) {
+            TaskScheduler scheduler({.worker_count = workers, .pin_threads = pin_threads});
+            auto start = Clock::now();
+
+            scheduler.parallel_for(0, ELEMENT_COUNT, [&data](std::size_t begin, std::size_t end) {
+                for (std::size_t i = begin; i < end; i++) {
+                    data[i] = std::sqrt(data[i] * data[i] + 1.0f) * std::sin(data[i]);
+                }
+            });
+
+            double ns = elapsed_ns(start, Clock::now());
+
+            if (workers == 1) {
+                single_worker_ns = ns;
+            }
+
+            std::printf("parallel_for %2u workers: %10.3f ms  speedup %5.2fx\n",
+                        workers, ns * 1e-6, single_worker_ns / ns);
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    TaskScheduler::Options options;
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--pin") == 0) {
+            options.pin_threads = true;
+        }
+        else if (std::strcmp(argv[i], "--workers") == 0 && i + 1 < argc) {
+            options.worker_count = static_cast<unsigned>(std::atoi(argv[++i]));
+        }
+        else {
+            std::printf("usage: %s [--workers N] [--pin]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    unsigned max_workers;
+
+    {
+        TaskScheduler scheduler(options);
+        max_workers = scheduler.get_worker_count();
+        std::printf("%u workers%s\n\n", max_workers, options.pin_threads ? ", pinned" : "");
+
+        empty_task_overhead(scheduler);
+        wake_up_latency(scheduler);
+        fork_join_depth(scheduler);
+    }
+
+    std::printf("\n");
+    parallel_for_scaling(max_workers, options.pin_threads);
+
+    return 0;
+}
@@ -0,0 +1,277 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+#include <DirectXMath.h>
+
+#include "bounds.h"
+#include "camera.h"
+#include "camera_path.h"
+#include "spatial_index.h"
+#include "task_scheduler.h"
+
+// SpatialIndex on a campus-sized scene (50k objects by default): building it,
+// frustum culling along an orbit around the scene, moving objects every frame,
+// batched range queries and insert / remove churn, each checked against a
+// linear scan over all bounds.
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+    constexpr int FRAME_COUNT = 200;
+    constexpr float WORLD_SIZE = 400.0f;
+    constexpr float ASPECT_RATIO = 9.0f / 16.0f;
+    constexpr std::size_t RANGE_QUERY_COUNT = 256;
+
+    double elapsed_ms(Clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    // Mostly small props (benches, lamps, trees), some buildings and a few large
+    // ground patches, clustered around random block centers.
+    Aabb random_object(std::mt19937& rng, const std::vector<DirectX::XMFLOAT2>& blocks) {
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+        std::normal_distribution<float> offset(0.0f, 15.0f);
+
+        const DirectX::XMFLOAT2& block = blocks[rng() % blocks.size()];
+        float roll = unit(rng);
+        float size = roll < 0.9f ? 0.2f + unit(rng) : (roll < 0.99f ? 5.0f + 10.0f * unit(rng) : 20.0f + 30.0f * unit(rng));
+        float height = roll < 0.99f ? size * (1.0f + unit(rng)) : 0.5f;
+
+        DirectX::XMFLOAT3 center = {
+                std::clamp(block.x + offset(rng), -WORLD_SIZE * 0.5f, WORLD_SIZE * 0.5f),
+                height * 0.5f,
+                std::clamp(block.y + offset(rng), -WORLD_SIZE * 0.5f, WORLD_SIZE * 0.5f)
+        };
+
+        return Aabb::from_center_extents(center, {size * 0.5f, height * 0.5f, size * 0.5f});
+    }
+
+    template<class Shape>
+    std::size_t linear_query(const std::vector<Aabb>& bounds, const Shape& shape) {
+        std::size_t count = 0;
+
+        for (const Aabb& box : bounds) {
+            count += shape.intersects(box) ? 1 : 0;
+        }
+
+        return count;
+    }
+
+    Frustum camera_frustum(const CameraPath& path, int frame) {
+        Camera camera;
+        camera.set_pose(path.sample(path.get_duration() * static_cast<float>(frame) / FRAME_COUNT));
+        return camera.get_frustum(ASPECT_RATIO);
+    }
+}
+
+int main(int argc, char** argv) {
+    std::size_t object_count = 50'000;
+    TaskScheduler::Options options;
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--objects") == 0 && i + 1 < argc) {
+            object_count = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (std::strcmp(argv[i], "--workers") == 0 && i + 1 < argc) {
+            options.worker_count = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else {
+            std::printf("usage: %s [--objects N] [--workers N]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (object_count == 0) {
+        std::printf("--objects must be positive\n");
+        return 1;
+    }
+
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> position(-WORLD_SIZE * 0.5f, WORLD_SIZE * 0.5f);
+    TaskScheduler scheduler(options);
+    bool mismatch = false;
+
+    std::vector<DirectX::XMFLOAT2> blocks(64);
+
+    for (auto& block : blocks) {
+        block = { position(rng), position(rng) };
+    }
+
+    std::vector<Aabb> bounds(object_count);
+
+    for (auto& box : bounds) {
+        box = random_object(rng, blocks);
+    }
+
+    Aabb world = Aabb::from_center_extents({0.0f, 0.0f, 0.0f}, {WORLD_SIZE * 0.5f, WORLD_SIZE * 0.5f, WORLD_SIZE * 0.5f});
+    SpatialIndex index(world);
+    std::vector<SpatialIndex::ObjectId> ids(object_count);
+
+    auto build_start = Clock::now();
+
+    for (std::size_t i = 0; i < object_count; i++) {
+        ids[i] = index.insert(bounds[i], static_cast<std::uint32_t>(i));
+    }
+
+    double build_ms = elapsed_ms(build_start);
+
+    std::printf("%zu objects, %zu nodes, built in %.2f ms (%.0f ns/object), %u workers\n\n",
+                index.size(), index.get_number_of_nodes(), build_ms, build_ms * 1e6 / static_cast<double>(object_count),
+                scheduler.get_worker_count());
+
+    // Frustum culling along an orbit at eye height, the far plane cuts off most of the campus.
+    CameraPath orbit = CameraPath::make_orbit({0.0f, 2.0f, 0.0f}, WORLD_SIZE * 0.3f, 20.0f, 32);
+    std::vector<SpatialIndex::ObjectId> visible;
+    double octree_ms = 0.0;
+    double linear_ms = 0.0;
+    std::size_t visible_total = 0;
+    std::size_t visited_total = 0;
+
+    for (int frame = 0; frame < FRAME_COUNT; frame++) {
+        Frustum frustum = camera_frustum(orbit, frame);
+
+        auto start = Clock::now();
+        visible.clear();
+        visited_total += index.query_frustum(frustum, visible);
+        octree_ms += elapsed_ms(start);
+
+        start = Clock::now();
+        std::size_t expected = linear_query(bounds, frustum);
+        linear_ms += elapsed_ms(start);
+
+        visible_total += visible.size();
+        mismatch |= visible.size() != expected;
+    }
+
+    std::printf("%-28s octree %8.3f ms/frame  linear %8.3f ms/frame  %8.0f visible  %6.0f nodes visited\n",
+                "frustum culling",
+                octree_ms / FRAME_COUNT,
+                linear_ms / FRAME_COUNT,
+                static_cast<double>(visible_total) / FRAME_COUNT,
+                static_cast<double>(visited_total) / FRAME_COUNT);
+
+    // 1% of the objects wander around every frame, then the same culling.
+    std::normal_distribution<float> step(0.0f, 0.5f);
+    double move_ms = 0.0;
+    double moved_cull_ms = 0.0;
+    std::size_t moved_count = std::max<std::size_t>(1, object_count / 100);
+
+    for (int frame = 0; frame < FRAME_COUNT; frame++) {
+        auto start = Clock::now();
+
+        for (std::size_t i = 0; i < moved_count; i++) {
+            std::size_t object = rng() % object_count;
+            DirectX::XMFLOAT3 center = bounds[object].get_center();
+            center.x += step(rng);
+            center.z += step(rng);
+            bounds[object] = Aabb::from_center_extents(center, bounds[object].get_extents());
+            index.move(ids[object], bounds[object]);
+        }
+
+        move_ms += elapsed_ms(start);
+
+        Frustum frustum = camera_frustum(orbit, frame);
+        start = Clock::now();
+        visible.clear();
+        index.query_frustum(frustum, visible);
+        moved_cull_ms += elapsed_ms(start);
+
+        mismatch |= visible.size() != linear_query(bounds, frustum);
+    }
+
+    std::printf("%-28s move   %8.3f ms/frame  cull   %8.3f ms/frame  %8zu moved/frame  %6zu nodes\n",
+                "1% of objects moving",
+                move_ms / FRAME_COUNT,
+                moved_cull_ms / FRAME_COUNT,
+                moved_count,
+                index.get_number_of_nodes());
+
+    // Many small range queries at once, e.g. trigger volumes or AI perception.
+    std::vector<Aabb> ranges(RANGE_QUERY_COUNT);
+
+    for (auto& range : ranges) {
+        range = Aabb::from_center_extents({position(rng), 5.0f, position(rng)}, {10.0f, 10.0f, 10.0f});
+    }
+
+    std::vector<std::vector<SpatialIndex::ObjectId>> results;
+    std::vector<SpatialIndex::ObjectId> single;
+
+    auto start = Clock::now();
+    std::size_t single_visited = 0;
+    std::size_t single_found = 0;
+
+    for (const Aabb& range : ranges) {
+        single.clear();
+        single_visited += index.query_range(range, single);
+        single_found += single.size();
+    }
+
+    double single_ms = elapsed_ms(start);
+
+    start = Clock::now();
+    std::size_t batch_visited = index.query_ranges(ranges, results);
+    double batch_ms = elapsed_ms(start);
+
+    start = Clock::now();
+    index.query_ranges(ranges, results, &scheduler);
+    double parallel_ms = elapsed_ms(start);
+
+    start = Clock::now();
+    std::size_t linear_found = 0;
+
+    for (const Aabb& range : ranges) {
+        linear_found += linear_query(bounds, range);
+    }
+
+    double range_linear_ms = elapsed_ms(start);
+    std::size_t batch_found = 0;
+
+    for (const auto& result : results) {
+        batch_found += result.size();
+    }
+
+    mismatch |= single_found != linear_found || batch_found != linear_found;
+
+    std::printf("%-28s one by one %6.3f ms (%zu nodes)  batched %6.3f ms (%zu nodes)  parallel %6.3f ms  linear %8.3f ms  %zu found\n",
+                "256 range queries",
+                single_ms, single_visited,
+                batch_ms, batch_visited,
+                parallel_ms,
+                range_linear_ms,
+                batch_found);
+
+    // Objects despawning and spawning elsewhere, releases and recreates branches.
+    std::size_t churn_count = object_count / 10;
+    start = Clock::now();
+
+    for (std::size_t i = 0; i < churn_count; i++) {
+        std::size_t object = rng() % object_count;
+        index.remove(ids[object]);
+        bounds[object] = random_object(rng, blocks);
+        ids[object] = index.insert(bounds[object], static_cast<std::uint32_t>(object));
+    }
+
+    double churn_ms = elapsed_ms(start);
+
+    visible.clear();
+    index.query_range(world, visible);
+    mismatch |= visible.size() != linear_query(bounds, world);
+
+    for (std::size_t i = 0; i < object_count; i++) {
+        mismatch |= index.get_user_data(ids[i]) != i;
+    }
+
+    std::printf("%-28s %8.3f ms (%.0f ns/object)  %zu nodes\n",
+                "remove + insert 10%",
+                churn_ms,
+                churn_ms * 1e6 / static_cast<double>(std::max<std::size_t>(1, churn_count)),
+                index.get_number_of_nodes());
+
+    std::printf("\nresults %s the linear scan\n", mismatch ? "DIFFER FROM" : "match");
+
+    return mismatch ? 1 : 0;
+}
@@ -0,0 +1,394 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <DirectXMath.h>
+
+#include "benchmark_support.h"
+#include "camera_path.h"
+#include "mesh_chunk.h"
+#include "world_streamer.h"
+
+// Headless simulation of WorldStreamer on a campus far larger than the memory
+// budget (4096 chunks of about 2 MiB by default). The camera flies along a
+// random path with some back-and-forth, loads go to a simulated disk (read
+// and decompression) with fixed latency and bandwidth, and every frame records
+// the budget accounting, uploads and the chunks near the camera that are not
+// resident yet (pop-in).
+// The same path is simulated with prefetch / hysteresis / upload throttling
+// switched off to show what each of them buys, and once with a budget of a
+// quarter and a wide unload radius, so that the chunks kept around the camera
+// outgrow the budget and have to be evicted by it. Finally the path is
+// replayed for a few seconds in real time with ThreadedChunkLoader and real
+// allocations. No run may go over its budget, and a chunk file with a
+// damaged vertex count has to fail to load instead of taking the loader down.
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+    constexpr float FRAME_TIME = 1.0f / 60.0f;
+    constexpr float CHUNK_SIZE = 32.0f;
+    constexpr float EYE_HEIGHT = 1.8f;
+
+    // Chunks this close to the camera have to be resident to be drawn without pop-in.
+    constexpr float VISIBLE_RADIUS = 80.0f;
+
+    constexpr double MIB = 1024.0 * 1024.0;
+    constexpr int DISK_QUEUE_DEPTH = 4;
+
+    struct Settings {
+        std::size_t grid_size = 64;
+        double memory_budget_mib = 256.0;
+        double disk_bandwidth_mib = 40.0;
+        double disk_latency_ms = 5.0;
+        float speed = 30.0f;
+        double threaded_seconds = 5.0;
+    };
+
+    // Requests go to the first free of DISK_QUEUE_DEPTH queues, each request
+    // takes latency + size / bandwidth and the bandwidth is split between the queues.
+    class SimulatedChunkLoader : public ChunkLoader {
+    public:
+        SimulatedChunkLoader(const std::vector<WorldStreamer::Chunk>& chunks, const Settings& settings)
+                : chunks(chunks), settings(settings) {}
+
+        void request(ChunkId chunk) override {
+            double& queue_free_at = *std::min_element(std::begin(disk_free_at), std::end(disk_free_at));
+            double start = std::max(time, queue_free_at);
+            queue_free_at = start + settings.disk_latency_ms / 1000.0 +
+                            static_cast<double>(chunks[chunk].size_bytes) * DISK_QUEUE_DEPTH / (settings.disk_bandwidth_mib * MIB);
+            in_flight.emplace_back(queue_free_at, chunk);
+        }
+
+        void collect(std::vector<std::pair<ChunkId, HRESULT>>& completed) override {
+            auto done = std::stable_partition(in_flight.begin(), in_flight.end(), [this](const auto& load) {
+                return load.first > time;
+            });
+
+            for (auto it = done; it != in_flight.end(); ++it) {
+                completed.emplace_back(it->second, S_OK);
+            }
+
+            in_flight.erase(done, in_flight.end());
+        }
+
+        void advance(double delta_time) {
+            time += delta_time;
+        }
+
+    private:
+        const std::vector<WorldStreamer::Chunk>& chunks;
+        const Settings& settings;
+        double time = 0.0;
+        double disk_free_at[DISK_QUEUE_DEPTH] = {};
+        std::vector<std::pair<double, ChunkId>> in_flight;
+    };
+
+    // Buildings make the chunks near block centers heavier than the lawns between them.
+    std::vector<WorldStreamer::Chunk> make_campus(const Settings& settings, std::mt19937& rng) {
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+        std::vector<WorldStreamer::Chunk> chunks;
+
+        for (std::size_t row = 0; row < settings.grid_size; row++) {
+            for (std::size_t column = 0; column < settings.grid_size; column++) {
+                float x = static_cast<float>(column) * CHUNK_SIZE;
+                float z = static_cast<float>(row) * CHUNK_SIZE;
+                bool block = (row / 4 + column / 4) % 3 != 0;
+                float size_mib = block ? 1.5f + 3.5f * unit(rng) : 0.25f + 0.5f * unit(rng);
+
+                chunks.push_back({
+                        Aabb{{x, 0.0f, z}, {x + CHUNK_SIZE, block ? 30.0f : 2.0f, z + CHUNK_SIZE}},
+                        static_cast<std::size_t>(size_mib * MIB)
+                });
+            }
+        }
+
+        return chunks;
+    }
+
+    // Random waypoints, every few of them the camera turns back for a short
+    // stretch and returns, which is where streaming without hysteresis thrashes.
+    CameraPath make_walk(const Settings& settings, std::mt19937& rng) {
+        float world_size = static_cast<float>(settings.grid_size) * CHUNK_SIZE;
+        std::uniform_real_distribution<float> coordinate(0.1f * world_size, 0.9f * world_size);
+        CameraPath path;
+        DirectX::XMFLOAT3 position = {world_size * 0.5f, EYE_HEIGHT, world_size * 0.5f};
+        float time = 0.0f;
+
+        auto walk_to = [&](DirectX::XMFLOAT3 target) {
+            float dx = target.x - position.x;
+            float dz = target.z - position.z;
+            float distance = std::sqrt(dx * dx + dz * dz);
+
+            time += std::max(distance / settings.speed, FRAME_TIME);
+            position = target;
+            path.add_keyframe({time, {position, std::atan2(dx, dz), 0.0f}});
+        };
+
+        path.add_keyframe({0.0f, {position, 0.0f, 0.0f}});
+
+        for (int waypoint = 0; waypoint < 12; waypoint++) {
+            DirectX::XMFLOAT3 previous = position;
+            walk_to({coordinate(rng), EYE_HEIGHT, coordinate(rng)});
+
+            if (waypoint % 3 == 2) {
+                DirectX::XMFLOAT3 turn = position;
+
+                for (int i = 0; i < 4; i++) {
+                    walk_to({turn.x + (previous.x - turn.x) * 0.1f, EYE_HEIGHT, turn.z + (previous.z - turn.z) * 0.1f});
+                    walk_to(turn);
+                }
+            }
+        }
+
+        return path;
+    }
+
+    struct RunResult {
+        std::size_t frames = 0;
+        std::size_t frames_with_pop_in = 0;
+        std::size_t missing_chunk_frames = 0;
+        double update_us_total = 0.0;
+        double update_us_max = 0.0;
+        WorldStreamer::Statistics statistics;
+    };
+
+    void count_missing(const WorldStreamer& streamer, DirectX::XMFLOAT3 position, RunResult& result) {
+        std::size_t missing = 0;
+
+        for (ChunkId chunk = 0; chunk < streamer.get_number_of_chunks(); chunk++) {
+            const Aabb& bounds = streamer.get_chunk(chunk).bounds;
+            float dx = std::max({bounds.min.x - position.x, 0.0f, position.x - bounds.max.x});
+            float dz = std::max({bounds.min.z - position.z, 0.0f, position.z - bounds.max.z});
+
+            if (dx * dx + dz * dz <= VISIBLE_RADIUS * VISIBLE_RADIUS &&
+                streamer.get_state(chunk) != WorldStreamer::ChunkState::RESIDENT) {
+                missing++;
+            }
+        }
+
+        result.missing_chunk_frames += missing;
+        result.frames_with_pop_in += missing > 0 ? 1 : 0;
+    }
+
+    RunResult simulate(const std::vector<WorldStreamer::Chunk>& chunks, const CameraPath& path,
+                       const Settings& settings, WorldStreamer::Options options) {
+        SimulatedChunkLoader loader(chunks, settings);
+        WorldStreamer streamer(chunks, loader, {}, options);
+        RunResult result;
+
+        for (float time = 0.0f; time <= path.get_duration(); time += FRAME_TIME) {
+            DirectX::XMFLOAT3 position = path.sample(time).position;
+            loader.advance(FRAME_TIME);
+
+            auto start = Clock::now();
+            streamer.update(position, FRAME_TIME);
+            double us = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+
+            result.update_us_total += us;
+            result.update_us_max = std::max(result.update_us_max, us);
+            result.frames++;
+
+            // Skip the initial load, everything is missing until the first chunks arrive.
+            if (time > 2.0f) {
+                count_missing(streamer, position, result);
+            }
+        }
+
+        result.statistics = streamer.get_statistics();
+        return result;
+    }
+
+    void print_result(const char* name, const RunResult& result, const Settings& settings) {
+        const auto& statistics = result.statistics;
+
+        std::printf("%-26s peak %7.1f / %5.0f MiB  loads %6zu  reloads %5zu  evictions %6zu (budget %5zu)  "
+                    "max upload %6.1f MiB/frame  pop-in frames %5zu (%6zu chunks)  update %5.1f us avg %7.1f max\n",
+                    name,
+                    static_cast<double>(statistics.peak_used_bytes) / MIB,
+                    settings.memory_budget_mib,
+                    statistics.loads,
+                    statistics.reloads,
+                    statistics.evictions,
+                    statistics.budget_evictions,
+                    static_cast<double>(statistics.max_uploaded_bytes) / MIB,
+                    result.frames_with_pop_in,
+                    result.missing_chunk_frames,
+                    result.update_us_total / static_cast<double>(std::max<std::size_t>(result.frames, 1)),
+                    result.update_us_max);
+    }
+
+    void check_damaged_chunk(Checks& check) {
+        ScratchDirectory scratch("streaming_benchmark");
+        std::filesystem::path path = scratch.get_path() / "chunk.bin";
+        MeshChunk chunk;
+        chunk.vertices.resize(3);
+        check(SUCCEEDED(chunk.save(path)), "a chunk is written");
+
+        // The vertex count follows the magic and the version.
+        {
+            std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+            std::uint64_t number_of_vertices = std::uint64_t{1} << 60;
+            file.seekp(8);
+            file.write(reinterpret_cast<const char*>(&number_of_vertices), sizeof(number_of_vertices));
+        }
+
+        MeshChunk loaded;
+        check(FAILED(loaded.load(path)) && loaded.vertices.empty(), "a chunk claiming more vertices than the file holds fails to load");
+
+        check(SUCCEEDED(chunk.save(path)), "the chunk is written again");
+        std::filesystem::resize_file(path, std::filesystem::file_size(path) - sizeof(Vertex));
+        check(FAILED(loaded.load(path)) && loaded.vertices.empty(), "a truncated chunk fails to load");
+    }
+
+    // Real background loads for a few seconds, every chunk gets an actual
+    // allocation that is filled on the IO thread and freed on eviction.
+    RunResult run_threaded(const std::vector<WorldStreamer::Chunk>& chunks, const CameraPath& path,
+                           const Settings& settings, WorldStreamer::Options options) {
+        std::vector<std::vector<unsigned char>> data(chunks.size());
+
+        ThreadedChunkLoader loader([&](ChunkId chunk) {
+            data[chunk].assign(chunks[chunk].size_bytes, static_cast<unsigned char>(chunk));
+            return S_OK;
+        });
+
+        WorldStreamer::Callbacks callbacks;
+        callbacks.evict = [&](ChunkId chunk) {
+            std::vector<unsigned char>().swap(data[chunk]);
+        };
+
+        RunResult result;
+        auto next_frame = Clock::now();
+
+        {
+            WorldStreamer streamer(chunks, loader, callbacks, options);
+
+            for (float time = 0.0f; time <= std::min<float>(path.get_duration(), static_cast<float>(settings.threaded_seconds)); time += FRAME_TIME) {
+                DirectX::XMFLOAT3 position = path.sample(time).position;
+
+                auto start = Clock::now();
+                streamer.update(position, FRAME_TIME);
+                double us = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+
+                result.update_us_total += us;
+                result.update_us_max = std::max(result.update_us_max, us);
+                result.frames++;
+
+                if (time > 2.0f) {
+                    count_missing(streamer, position, result);
+                }
+
+                next_frame += std::chrono::microseconds(16'667);
+                std::this_thread::sleep_until(next_frame);
+            }
+
+            result.statistics = streamer.get_statistics();
+        }
+
+        return result;
+    }
+}
+
+int main(int argc, char** argv) {
+    Settings settings;
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--grid") == 0 && i + 1 < argc) {
+            settings.grid_size = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (std::strcmp(argv[i], "--budget") == 0 && i + 1 < argc) {
+            settings.memory_budget_mib = std::strtod(argv[++i], nullptr);
+        }
+        else if (std::strcmp(argv[i], "--disk-bandwidth") == 0 && i + 1 < argc) {
+            settings.disk_bandwidth_mib = std::strtod(argv[++i], nullptr);
+        }
+        else if (std::strcmp(argv[i], "--disk-latency") == 0 && i + 1 < argc) {
+            settings.disk_latency_ms = std::strtod(argv[++i], nullptr);
+        }
+        else if (std::strcmp(argv[i], "--speed") == 0 && i + 1 < argc) {
+            settings.speed = std::strtof(argv[++i], nullptr);
+        }
+        else if (std::strcmp(argv[i], "--threaded-seconds") == 0 && i + 1 < argc) {
+            settings.threaded_seconds = std::strtod(argv[++i], nullptr);
+        }
+        else {
+            std::printf("usage: %s [--grid N] [--budget <MiB>] [--disk-bandwidth <MiB/s>] [--disk-latency <ms>] [--speed <m/s>] [--threaded-seconds <s>]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (settings.grid_size == 0 || settings.memory_budget_mib <= 0.0 || settings.disk_bandwidth_mib <= 0.0 || settings.speed <= 0.0f) {
+        std::printf("--grid, --budget, --disk-bandwidth and --speed must be positive\n");
+        return 1;
+    }
+
+    std::mt19937 rng(1234);
+    std::vector<WorldStreamer::Chunk> chunks = make_campus(settings, rng);
+    CameraPath path = make_walk(settings, rng);
+
+    std::size_t total_bytes = 0;
+
+    for (const auto& chunk : chunks) {
+        total_bytes += chunk.size_bytes;
+    }
+
+    std::printf("%zu chunks, %.0f MiB in total, budget %.0f MiB, disk %.0f MiB/s + %.1f ms, walk of %.0f s\n\n",
+                chunks.size(),
+                static_cast<double>(total_bytes) / MIB,
+                settings.memory_budget_mib,
+                settings.disk_bandwidth_mib,
+                settings.disk_latency_ms,
+                path.get_duration());
+
+    WorldStreamer::Options options;
+    options.memory_budget = static_cast<std::size_t>(settings.memory_budget_mib * MIB);
+
+    WorldStreamer::Options no_prefetch = options;
+    no_prefetch.prefetch_time = 0.0f;
+
+    WorldStreamer::Options no_hysteresis = options;
+    no_hysteresis.unload_radius = options.load_radius;
+
+    WorldStreamer::Options neither = no_hysteresis;
+    neither.prefetch_time = 0.0f;
+
+    WorldStreamer::Options no_throttle = options;
+    no_throttle.upload_budget = SIZE_MAX;
+
+    print_result("prefetch + hysteresis", simulate(chunks, path, settings, options), settings);
+    print_result("no prefetch", simulate(chunks, path, settings, no_prefetch), settings);
+    print_result("no hysteresis", simulate(chunks, path, settings, no_hysteresis), settings);
+    print_result("neither", simulate(chunks, path, settings, neither), settings);
+    print_result("no upload throttling", simulate(chunks, path, settings, no_throttle), settings);
+
+    Settings tight_settings = settings;
+    tight_settings.memory_budget_mib = settings.memory_budget_mib / 4.0;
+    WorldStreamer::Options tight = options;
+    tight.memory_budget = static_cast<std::size_t>(tight_settings.memory_budget_mib * MIB);
+    tight.unload_radius = 4.0f * options.load_radius;
+
+    RunResult tight_result = simulate(chunks, path, tight_settings, tight);
+    print_result("working set over budget", tight_result, tight_settings);
+
+    Checks check;
+    check_damaged_chunk(check);
+    check(tight_result.statistics.budget_evictions > 0, "a working set over the budget is evicted by it");
+    check(tight_result.statistics.peak_used_bytes <= tight.memory_budget, "the quarter budget is kept");
+
+    if (settings.threaded_seconds > 0.0) {
+        RunResult threaded = run_threaded(chunks, path, settings, options);
+        std::printf("\n");
+        print_result("threaded, real time", threaded, settings);
+        check(threaded.statistics.peak_used_bytes <= options.memory_budget, "the budget is kept with real loads");
+    }
+
+    return check.passed() ? 0 : 1;
+}
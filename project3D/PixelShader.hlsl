@@ -4,9 +4,13 @@ struct ps_input_t {
     float2 tex : TEXCOORD;
 };
 
-Texture2D texture_ps;
-SamplerState sampler_ps;
+cbuffer ps_material_t : register(b1) {
+    uint texture_index;
+};
+
+Texture2D textures[] : register(t0);
+SamplerState sampler_ps : register(s0);
 
 float4 main(ps_input_t input) : SV_TARGET {
-    return input.color * texture_ps.Sample(sampler_ps, input.tex);
+    return input.color * textures[texture_index].Sample(sampler_ps, input.tex);
 }
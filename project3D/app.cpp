@@ -1,10 +1,13 @@
 #include "app.h"
 
+#include <algorithm>
 #include <cstdlib>
 #include <malloc.h>
 #include <memory.h>
 #include <cwchar>
 #include <cmath>
+#include <filesystem>
+#include <fstream>
 #include <windowsx.h>
 #include <numbers>
 #include <string>
@@ -13,15 +16,20 @@
 
 #include "pixel_shader.h"
 #include "vertex_shader.h"
+#include "asset_builder.h"
+#include "mesh_cooker.h"
 #include "object_loader.h"
+#include "profiler.h"
+#include "task_scheduler.h"
 
 
-App::App(std::wstring name) :
+App::App(std::wstring name, AppOptions options) :
         hwnd(nullptr),
         width(0.0f),
         height(0.0f),
         aspect_ratio(0.0f),
         title(std::move(name)),
+        options(std::move(options)),
         use_warp_device(false),
         frame_index(0),
         rtv_descriptor_size(0),
@@ -58,8 +66,17 @@ void App::RunMessageLoop() {
                 DispatchMessage(&msg);
             }
         } else {
-            OnUpdate();
-            OnRender();
+            {
+                PROFILE_ZONE("Frame", &frame_statistics);
+                OnUpdate();
+                OnRender();
+            }
+
+            ReportFrameStatistics();
+
+            if (options.benchmark) {
+                BenchmarkFrame();
+            }
         }
     } while (msg.message != WM_QUIT);
 }
@@ -67,6 +84,8 @@ void App::RunMessageLoop() {
 HRESULT App::Initialize(HINSTANCE instance, INT cmd_show) {
     HRESULT hr = S_OK;
 
+    Profiler::get().set_thread_name("Main");
+
     // Register the window class.
     WNDCLASSEX wcex = {sizeof(WNDCLASSEX)};
     wcex.style = CS_HREDRAW | CS_VREDRAW;
@@ -190,33 +209,23 @@ LRESULT CALLBACK App::WindowProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lPar
                     break;
 
                 case WM_INPUT: {
-                    std::vector<char> raw_input_buffer;
-                    UINT size;
-
-                    if (GetRawInputData(
-                            reinterpret_cast<HRAWINPUT>(lParam),
-                            RID_INPUT,
-                            nullptr,
-                            &size,
-                            sizeof(RAWINPUTHEADER)) == -1) {
-                        break;
-                    }
-
-                    raw_input_buffer.resize(size);
+                    // Mouse packets always fit into RAWINPUT, so no per-message allocation is needed.
+                    RAWINPUT raw_input;
+                    UINT size = sizeof(raw_input);
 
                     if (GetRawInputData(
                             reinterpret_cast<HRAWINPUT>(lParam),
                             RID_INPUT,
-                            raw_input_buffer.data(),
+                            &raw_input,
                             &size,
-                            sizeof(RAWINPUTHEADER)) != size) {
+                            sizeof(RAWINPUTHEADER)) == static_cast<UINT>(-1)) {
                         break;
                     }
 
-                    auto& raw_input = reinterpret_cast<const RAWINPUT&>(*raw_input_buffer.data());
                     if (raw_input.header.dwType == RIM_TYPEMOUSE &&
+                        (raw_input.data.mouse.usFlags & MOUSE_MOVE_ABSOLUTE) == 0 &&
                         (raw_input.data.mouse.lLastX != 0 || raw_input.data.mouse.lLastY != 0)) {
-                        app->mouse_position_queue.emplace(raw_input.data.mouse.lLastX, raw_input.data.mouse.lLastY);
+                        app->mouse_input.add(raw_input.data.mouse.lLastX, raw_input.data.mouse.lLastY);
                     }
                 }
                     result = 0;
@@ -337,6 +346,10 @@ HRESULT App::LoadPipeline() {
         hr = device->CreateCommandQueue(&queue_desc, IID_PPV_ARGS(&command_queue));
     }
 
+    if (SUCCEEDED(hr)) {
+        hr = gpu_profiler.initialize(device.Get(), command_queue.Get(), MAX_GPU_ZONES);
+    }
+
     Microsoft::WRL::ComPtr<IDXGISwapChain1> loc_swap_chain;
 
     if (SUCCEEDED(hr)) {
@@ -383,7 +396,7 @@ HRESULT App::LoadPipeline() {
 
     if (SUCCEEDED(hr)) {
         D3D12_DESCRIPTOR_HEAP_DESC cbv_heap_desc = {};
-        cbv_heap_desc.NumDescriptors = 2;
+        cbv_heap_desc.NumDescriptors = DESCRIPTOR_HEAP_SIZE;
         cbv_heap_desc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
         cbv_heap_desc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
         cbv_heap_desc.NodeMask = 0;
@@ -446,12 +459,13 @@ HRESULT App::LoadAssets() {
                     .RegisterSpace = 0,
                     .OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND
             },
+            // Every texture of the heap, indexed in the pixel shader by the material constant
             {
                     .RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV,
-                    .NumDescriptors = 1,
+                    .NumDescriptors = UINT_MAX,
                     .BaseShaderRegister = 0,
                     .RegisterSpace = 0,
-                    .OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND
+                    .OffsetInDescriptorsFromTableStart = 0
             }
     };
 
@@ -466,6 +480,11 @@ HRESULT App::LoadAssets() {
                     .DescriptorTable = { 1, &descriptor_ranges[1] },
                     .ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL
             },
+            {
+                    .ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS,
+                    .Constants = { .ShaderRegister = 1, .RegisterSpace = 0, .Num32BitValues = 1 },
+                    .ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL
+            },
     };
 
     D3D12_STATIC_SAMPLER_DESC texture_sampler_desc = {};
@@ -560,53 +579,6 @@ HRESULT App::LoadAssets() {
         hr = command_list->Close();
     }
 
-    ObjectLoader object_loader(MODEL_URI, color);
-
-    if (SUCCEEDED(hr)) {
-        hr = object_loader.load();
-    }
-
-    UINT vertex_buffer_size = 0;
-
-    if (SUCCEEDED(hr)) {
-        object = object_loader.get_vertices();
-        number_of_vertices = object_loader.get_number_of_vertices();
-        vertex_buffer_size = object.size() * sizeof(Vertex);
-
-        hr = LoadBitmapFromFile(object_loader.get_texture_uri().c_str(), bitmap_width, bitmap_height, &bitmap);
-    }
-
-    if (SUCCEEDED(hr)) {
-        const auto heap_properties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-        const auto resource_desc = CD3DX12_RESOURCE_DESC::Buffer(vertex_buffer_size);
-
-        hr = device->CreateCommittedResource(
-                &heap_properties,
-                D3D12_HEAP_FLAG_NONE,
-                &resource_desc,
-                D3D12_RESOURCE_STATE_GENERIC_READ,
-                nullptr,
-                IID_PPV_ARGS(&vertex_buffer)
-        );
-    }
-
-    UINT8* vertex_data_begin;
-
-    if (SUCCEEDED(hr)) {
-        CD3DX12_RANGE read_range(0, 0);
-        hr = vertex_buffer->Map(0, &read_range, reinterpret_cast<void**>(&vertex_data_begin));
-    }
-
-    if (SUCCEEDED(hr)) {
-        Vertex* object_ptr = &object[0];
-        memcpy(vertex_data_begin, object_ptr, number_of_vertices * sizeof(Vertex));
-        vertex_buffer->Unmap(0, nullptr);
-
-        vertex_buffer_view.BufferLocation = vertex_buffer->GetGPUVirtualAddress();
-        vertex_buffer_view.StrideInBytes = sizeof(Vertex);
-        vertex_buffer_view.SizeInBytes = vertex_buffer_size;
-    }
-
     if (SUCCEEDED(hr)) {
         D3D12_HEAP_PROPERTIES heap_properties = {};
         heap_properties.Type = D3D12_HEAP_TYPE_UPLOAD;
@@ -637,11 +609,19 @@ HRESULT App::LoadAssets() {
         );
     }
 
+    if (SUCCEEDED(hr)) {
+        constant_buffer_descriptor = descriptor_allocator.allocate();
+
+        if (constant_buffer_descriptor == DescriptorAllocator::INVALID_INDEX) {
+            hr = E_OUTOFMEMORY;
+        }
+    }
+
     if (SUCCEEDED(hr)) {
         D3D12_CONSTANT_BUFFER_VIEW_DESC constant_buffer_view_desc = {};
         constant_buffer_view_desc.BufferLocation = constant_buffer->GetGPUVirtualAddress();
         constant_buffer_view_desc.SizeInBytes = sizeof(ConstantBuffer);
-        device->CreateConstantBufferView(&constant_buffer_view_desc, cbv_heap->GetCPUDescriptorHandleForHeapStart());
+        device->CreateConstantBufferView(&constant_buffer_view_desc, GetCpuDescriptorHandle(constant_buffer_descriptor));
 
         CD3DX12_RANGE read_range(0, 0);
         hr = constant_buffer->Map(0, &read_range, reinterpret_cast<void**>(&constant_buffer_data_begin));
@@ -699,113 +679,20 @@ HRESULT App::LoadAssets() {
         );
     }
 
-    if (SUCCEEDED(hr)) {
-        D3D12_HEAP_PROPERTIES heap_properties = {};
-        heap_properties.Type = D3D12_HEAP_TYPE_DEFAULT;
-        heap_properties.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
-        heap_properties.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
-        heap_properties.CreationNodeMask = 1;
-        heap_properties.VisibleNodeMask = 1;
-
-        D3D12_RESOURCE_DESC resource_desc = {};
-        resource_desc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
-        resource_desc.Alignment = 0;
-        resource_desc.Width = bitmap_width;
-        resource_desc.Height = bitmap_height;
-        resource_desc.DepthOrArraySize = 1;
-        resource_desc.MipLevels = 1;
-        resource_desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-        resource_desc.SampleDesc = { .Count = 1, .Quality = 0 };
-        resource_desc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
-        resource_desc.Flags = D3D12_RESOURCE_FLAG_NONE;
-
-        hr = device->CreateCommittedResource(
-                &heap_properties,
-                D3D12_HEAP_FLAG_NONE,
-                &resource_desc,
-                D3D12_RESOURCE_STATE_COPY_DEST,
-                nullptr,
-                IID_PPV_ARGS(&texture)
-        );
-    }
-
-    Microsoft::WRL::ComPtr<ID3D12Resource> tex_upload_buffer;
-    UINT64 tex_upload_buffer_size = 0;
-
-    if (SUCCEEDED(hr)) {
-        tex_upload_buffer_size = GetRequiredIntermediateSize(texture.Get(), 0, 1);
-    }
-
-    D3D12_RESOURCE_DESC texture_resource_desc = {};
-    texture_resource_desc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
-    texture_resource_desc.Alignment = 0;
-    texture_resource_desc.Width = tex_upload_buffer_size;
-    texture_resource_desc.Height = 1;
-    texture_resource_desc.DepthOrArraySize = 1;
-    texture_resource_desc.MipLevels = 1;
-    texture_resource_desc.Format = DXGI_FORMAT_UNKNOWN;
-    texture_resource_desc.SampleDesc = { .Count = 1, .Quality = 0 };
-    texture_resource_desc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
-    texture_resource_desc.Flags = D3D12_RESOURCE_FLAG_NONE;
-
-    if (SUCCEEDED(hr)) {
-        D3D12_HEAP_PROPERTIES heap_properties = {};
-        heap_properties.Type = D3D12_HEAP_TYPE_UPLOAD;
-        heap_properties.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
-        heap_properties.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
-        heap_properties.CreationNodeMask = 1;
-        heap_properties.VisibleNodeMask = 1;
-
-        hr = device->CreateCommittedResource(
-                &heap_properties,
-                D3D12_HEAP_FLAG_NONE,
-                &texture_resource_desc,
-                D3D12_RESOURCE_STATE_GENERIC_READ,
-                nullptr,
-                IID_PPV_ARGS(&tex_upload_buffer)
-        );
-    }
+    // Upload buffers have to stay alive until the copies recorded below have finished.
+    std::vector<Microsoft::WRL::ComPtr<ID3D12Resource>> texture_upload_buffers;
 
     if (SUCCEEDED(hr)) {
         hr = command_list->Reset(command_allocator.Get(), pipeline_state.Get());
     }
 
+    // Texture 0 is white and used by untextured materials.
     if (SUCCEEDED(hr)) {
-        D3D12_SUBRESOURCE_DATA texture_data = {};
-        texture_data.RowPitch = bitmap_width * BITMAP_PIXEL_SIZE;
-        texture_data.SlicePitch = bitmap_width * bitmap_height * BITMAP_PIXEL_SIZE;
-        texture_data.pData = bitmap;
-
-        D3D12_RESOURCE_BARRIER tex_upload_resource_barrier = {};
-        tex_upload_resource_barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
-        tex_upload_resource_barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
-        tex_upload_resource_barrier.Transition = {
-                .pResource = texture.Get(),
-                .Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES,
-                .StateBefore = D3D12_RESOURCE_STATE_COPY_DEST,
-                .StateAfter = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE
-        };
-
-        UpdateSubresources(command_list.Get(), texture.Get(), tex_upload_buffer.Get(), 0, 0, 1, &texture_data);
-        command_list->ResourceBarrier(1, &tex_upload_resource_barrier);
+        const BYTE white[BITMAP_PIXEL_SIZE] = { 0xff, 0xff, 0xff, 0xff };
+        hr = CreateTexture(white, 1, 1, texture_upload_buffers);
     }
 
     if (SUCCEEDED(hr)) {
-        D3D12_SHADER_RESOURCE_VIEW_DESC shader_resource_view_desc = {};
-        shader_resource_view_desc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
-        shader_resource_view_desc.Format = texture_resource_desc.Format;
-        shader_resource_view_desc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-        shader_resource_view_desc.Texture2D = {
-                .MostDetailedMip = 0,
-                .MipLevels = 1,
-                .PlaneSlice = 0,
-                .ResourceMinLODClamp = 0.f
-        };
-
-        D3D12_CPU_DESCRIPTOR_HANDLE cpu_descriptor_handle = cbv_heap->GetCPUDescriptorHandleForHeapStart();
-        cpu_descriptor_handle.ptr += device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
-        device->CreateShaderResourceView(texture.Get(), &shader_resource_view_desc, cpu_descriptor_handle);
-
         hr = command_list->Close();
     }
 
@@ -816,6 +703,10 @@ HRESULT App::LoadAssets() {
         hr = device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&fence));
     }
 
+    if (SUCCEEDED(hr)) {
+        hr = device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&upload_fence));
+    }
+
     if (SUCCEEDED(hr)) {
         fence_value = 1;
         fence_event = CreateEvent(nullptr, FALSE, FALSE, nullptr);
@@ -826,167 +717,1240 @@ HRESULT App::LoadAssets() {
         WaitForPreviousFrame();
     }
 
-    return hr;
-}
-
-
-HRESULT App::PopulateCommandList() {
-    HRESULT hr = S_OK;
+    if (SUCCEEDED(hr) && !options.package_path.empty()) {
+        hr = package.open(options.package_path);
+    }
 
-    hr = command_allocator->Reset();
+    const AssetPackage* model_package = package.is_open() ? &package : nullptr;
 
-    if (SUCCEEDED(hr)) {
-        hr = command_list->Reset(command_allocator.Get(), pipeline_state.Get());
+    if (SUCCEEDED(hr) && model_package == nullptr) {
+        file_reader = std::make_unique<AsyncFileReader>();
     }
 
-    if (SUCCEEDED(hr)) {
-        command_list->SetGraphicsRootSignature(root_signature.Get());
-        ID3D12DescriptorHeap* heaps[] = { cbv_heap.Get() };
-        command_list->SetDescriptorHeaps(_countof(heaps), heaps);
+    if (SUCCEEDED(hr) && options.hot_reload && !options.benchmark && model_package == nullptr && options.world_path.empty()) {
+        asset_watcher = std::make_unique<FileWatcher>(std::filesystem::path(MODEL_URI).parent_path());
+    }
 
-        D3D12_GPU_DESCRIPTOR_HANDLE gpu_descriptor_handle = cbv_heap->GetGPUDescriptorHandleForHeapStart();
-        command_list->SetGraphicsRootDescriptorTable(0, gpu_descriptor_handle);
-        gpu_descriptor_handle.ptr += device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
-        command_list->SetGraphicsRootDescriptorTable(1, gpu_descriptor_handle);
-        command_list->RSSetViewports(1, &viewport);
-        command_list->RSSetScissorRects(1, &scissor_rect);
+    // The model is drawn as it is parsed and replaced by the sorted one in UpdateProgressiveLoad.
+    if (SUCCEEDED(hr) && !options.world_path.empty()) {
+        hr = LoadWorld();
+    }
+    else if (SUCCEEDED(hr) && options.progressive && !options.benchmark) {
+        ProgressiveMeshLoader::Options loader_options;
+        loader_options.package = model_package;
+        progressive_loader = std::make_unique<ProgressiveMeshLoader>(MODEL_URI, color, loader_options);
+    }
+    else if (SUCCEEDED(hr)) {
+        ObjectLoader object_loader(MODEL_URI, color);
+        object_loader.set_package(model_package);
+        hr = object_loader.load();
 
-        auto transition1 = CD3DX12_RESOURCE_BARRIER::Transition(render_targets[frame_index].Get(), D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET);
-        command_list->ResourceBarrier(1, &transition1);
-        CD3DX12_CPU_DESCRIPTOR_HANDLE rtv_handle(rtv_heap->GetCPUDescriptorHandleForHeapStart(), frame_index, rtv_descriptor_size);
-        CD3DX12_CPU_DESCRIPTOR_HANDLE dsv_handle(dsv_heap->GetCPUDescriptorHandleForHeapStart());
-        command_list->OMSetRenderTargets(1, &rtv_handle, FALSE, &dsv_handle);
+        if (SUCCEEDED(hr)) {
+            hr = LoadModel(object_loader);
+        }
+    }
 
-        const float color_arr[] = {background_color.x, background_color.y, background_color.z, background_color.w};
-        command_list->ClearRenderTargetView(rtv_handle, color_arr, 0, nullptr);
-        command_list->ClearDepthStencilView(dsv_heap->GetCPUDescriptorHandleForHeapStart(), D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr);
-        command_list->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-        command_list->IASetVertexBuffers(0, 1, &vertex_buffer_view);
-        command_list->DrawInstanced(number_of_vertices, 1, 0, 0);
+    return hr;
+}
 
-        auto transition2 = CD3DX12_RESOURCE_BARRIER::Transition(render_targets[frame_index].Get(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT);
-        command_list->ResourceBarrier(1, &transition2);
+// Builds the model and swaps it in at once, for loads the frames wait for anyway.
+HRESULT App::LoadModel(ObjectLoader& object_loader) {
+    PreparedModel model;
+    HRESULT hr = PrepareModel(object_loader, model, loaded_texture_uris);
 
-        hr = command_list->Close();
+    if (SUCCEEDED(hr)) {
+        hr = SwapInModel(model);
     }
 
     return hr;
 }
 
-HRESULT App::WaitForPreviousFrame() {
+// Everything that depends on the model: vertex buffer, draws, collision, bakes and textures
+// (unless kept_texture_uris are the ones of the model and nothing baked changes them). Leaves
+// the model on screen alone, so a hot reload runs it on the loader thread.
+HRESULT App::PrepareModel(ObjectLoader& object_loader, PreparedModel& model, const std::vector<std::wstring>& kept_texture_uris) {
     HRESULT hr = S_OK;
 
-    const UINT64 fence_value_copy = fence_value;
-    hr = command_queue->Signal(fence.Get(), fence_value_copy);
+    // CPU copy of the model, only kept while building and baking from it
+    std::vector<Vertex> vertices = object_loader.take_vertices();
+    UINT vertex_buffer_size = static_cast<UINT>(vertices.size() * sizeof(Vertex));
 
-    if (SUCCEEDED(hr)) {
-        fence_value++;
+    model.number_of_vertices = object_loader.get_number_of_vertices();
+    model.texture_uris = object_loader.get_texture_uris();
+    CreateDrawBatches(object_loader, model);
 
-        if (fence->GetCompletedValue() < fence_value_copy) {
-            hr = fence->SetEventOnCompletion(fence_value_copy, fence_event);
-            WaitForSingleObject(fence_event, INFINITE);
+    {
+        // The model node keeps the identity transform, so model space triangles are world space ones.
+        std::vector<std::uint32_t> triangle_submeshes(vertices.size() / 3, TriangleBvh::NO_OBJECT);
+
+        for (std::size_t i = 0; i < model.submesh_draws.size(); i++) {
+            const DrawBatch& draw = model.submesh_draws[i];
+            std::fill_n(triangle_submeshes.begin() + draw.first_vertex / 3, draw.number_of_vertices / 3, static_cast<std::uint32_t>(i));
         }
 
-        frame_index = swap_chain->GetCurrentBackBufferIndex();
+        model.collision_bvh.build(vertices, std::move(triangle_submeshes));
     }
 
-    return hr;
-}
+    // Occlusion either goes into the vertex colors uploaded below or multiplies every texture.
+    if (options.ao_rays > 0) {
+        BakeOcclusion(vertices, model.collision_bvh, model.texture_occlusion);
+    }
 
-HRESULT App::OnInit() {
-    HRESULT hr = LoadPipeline();
+    if (SUCCEEDED(hr)) {
+        const auto heap_properties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
+        const auto resource_desc = CD3DX12_RESOURCE_DESC::Buffer(vertex_buffer_size);
+
+        hr = device->CreateCommittedResource(
+                &heap_properties,
+                D3D12_HEAP_FLAG_NONE,
+                &resource_desc,
+                D3D12_RESOURCE_STATE_GENERIC_READ,
+                nullptr,
+                IID_PPV_ARGS(&model.vertex_buffer)
+        );
+    }
+
+    UINT8* vertex_data_begin;
 
     if (SUCCEEDED(hr)) {
-        hr = LoadAssets();
+        CD3DX12_RANGE read_range(0, 0);
+        hr = model.vertex_buffer->Map(0, &read_range, reinterpret_cast<void**>(&vertex_data_begin));
     }
 
-    return hr;
-}
+    if (SUCCEEDED(hr)) {
+        memcpy(vertex_data_begin, vertices.data(), model.number_of_vertices * sizeof(Vertex));
+        model.vertex_buffer->Unmap(0, nullptr);
 
-HRESULT App::OnUpdate() {
-    ProcessMove();
-    if (mouse_pressed) camera.reset();
-    DirectX::XMMATRIX wvp_matrix = camera.get_projection_matrix();
-    DirectX::XMStoreFloat4x4(&constant_buffer_data.mat_world_view, XMMatrixTranspose(wvp_matrix));
+        model.vertex_buffer_view.BufferLocation = model.vertex_buffer->GetGPUVirtualAddress();
+        model.vertex_buffer_view.StrideInBytes = sizeof(Vertex);
+        model.vertex_buffer_view.SizeInBytes = vertex_buffer_size;
+    }
 
-    wvp_matrix = XMMatrixMultiply(
-            wvp_matrix,
-            DirectX::XMMatrixPerspectiveFovLH(
-                    45.0f, aspect_ratio, 1.0f, 100.0f
-            )
-    );
+    // A reloaded model keeps its textures, unless they depend on the geometry (baked lightmap or occlusion).
+    model.keep_textures = model.texture_uris == kept_texture_uris && options.bake_passes == 0 && model.texture_occlusion.empty();
 
-    wvp_matrix = XMMatrixTranspose(wvp_matrix);
-    DirectX::XMStoreFloat4x4(&constant_buffer_data.mat_world_view_proj, wvp_matrix);
+    // A lightmap baked here replaces the one shipped with the model (every texture of the model is its lightmap).
+    std::vector<DecodedBitmap> bitmaps;
 
-    memcpy(constant_buffer_data_begin, &constant_buffer_data, sizeof(constant_buffer_data));
+    if (SUCCEEDED(hr) && !model.keep_textures && options.bake_passes > 0) {
+        DecodedBitmap baked = {};
+        BakeLightmap(vertices, model.collision_bvh, baked.bits, baked.width, baked.height);
+        OcclusionBaker::apply_to_bitmap(baked.bits.data(), baked.width, baked.height, model.texture_occlusion, AO_TEXTURE_SIZE, AO_TEXTURE_SIZE);
+        bitmaps.assign(model.texture_uris.size(), baked);
+    }
+    else if (SUCCEEDED(hr) && !model.keep_textures) {
+        // The texture files are read and decoded all at once, overlapping the reads with the decoding.
+        std::vector<Task<DecodedBitmap>> decodes;
 
-    return S_OK;
-}
+        for (const std::wstring& uri : model.texture_uris) {
+            decodes.push_back(DecodeBitmapAsync(uri));
+        }
 
-HRESULT App::OnRender() {
-    HRESULT hr = S_OK;
+        bitmaps = sync_wait(when_all(std::move(decodes)), TaskScheduler::get_default());
 
-    hr = PopulateCommandList();
+        for (DecodedBitmap& bitmap : bitmaps) {
+            if (SUCCEEDED(bitmap.hr)) {
+                OcclusionBaker::apply_to_bitmap(bitmap.bits.data(), bitmap.width, bitmap.height, model.texture_occlusion, AO_TEXTURE_SIZE, AO_TEXTURE_SIZE);
+            }
+        }
+    }
 
-    if (SUCCEEDED(hr)) {
-        ID3D12CommandList* command_lists[] = { command_list.Get() };
-        command_queue->ExecuteCommandLists(_countof(command_lists), command_lists);
+    // Each texture is uploaded with a command list of its own, next to the frames.
+    std::vector<Task<HRESULT>> uploads;
+    model.textures.resize(bitmaps.size());
 
-        hr = swap_chain->Present(1, 0);
-        WaitForPreviousFrame();
+    for (std::size_t i = 0; SUCCEEDED(hr) && i < bitmaps.size(); i++) {
+        hr = bitmaps[i].hr;
+
+        if (SUCCEEDED(hr)) {
+            uploads.push_back(UploadTextureAsync(std::move(bitmaps[i]), model.textures[i]));
+        }
     }
 
-    return hr;
-}
+    if (SUCCEEDED(hr) && !uploads.empty()) {
+        for (HRESULT upload_hr : sync_wait(when_all(std::move(uploads)), TaskScheduler::get_default())) {
+            hr = SUCCEEDED(hr) ? upload_hr : hr;
+        }
+    }
 
-HRESULT App::OnDestroy() {
-    HRESULT hr = WaitForPreviousFrame();
+    // The vertex buffer and the collision hierarchy hold everything drawing and picking need.
+    std::vector<Vertex>().swap(vertices);
 
     if (SUCCEEDED(hr)) {
-        CloseHandle(fence_event);
+        WCHAR text[128];
+        swprintf_s(text, L"Model loaded: %zu vertices, resident %.1f MiB, peak %.1f MiB\n",
+                   model.number_of_vertices,
+                   static_cast<double>(get_resident_bytes()) / (1 << 20),
+                   static_cast<double>(get_peak_resident_bytes()) / (1 << 20));
+        OutputDebugStringW(text);
     }
 
     return hr;
 }
 
-HRESULT App::LoadBitmapFromFile(PCWSTR uri, UINT &width, UINT &height, BYTE **bits) {
-    IWICBitmapDecoder *decoder = nullptr;
-    IWICBitmapFrameDecode *source = nullptr;
-    IWICFormatConverter *converter = nullptr;
+// Puts a prepared model in place of the one on screen, moving only buffers and pointers.
+// Nothing may be in flight.
+HRESULT App::SwapInModel(PreparedModel& model) {
+    if (!model.keep_textures) {
+        ReleaseModelTextures();
 
-    HRESULT hr = wic_factory->CreateDecoderFromFilename(
-            uri,
-            nullptr,
-            GENERIC_READ,
-            WICDecodeMetadataCacheOnLoad,
-            &decoder
-    );
+        for (Microsoft::WRL::ComPtr<ID3D12Resource>& texture : model.textures) {
+            UINT descriptor = descriptor_allocator.allocate();
 
-    if (SUCCEEDED(hr)) {
-        hr = decoder->GetFrame(0, &source);
-    }
+            if (descriptor == DescriptorAllocator::INVALID_INDEX) {
+                return E_OUTOFMEMORY;
+            }
 
-    if (SUCCEEDED(hr)) {
-        hr = wic_factory->CreateFormatConverter(&converter);
+            CreateTextureView(texture.Get(), descriptor);
+            textures.push_back(std::move(texture));
+            texture_descriptors.push_back(descriptor);
+        }
+
+        loaded_texture_uris = std::move(model.texture_uris);
     }
 
-    if (SUCCEEDED(hr)) {
-        hr = converter->Initialize(
-                source,
-                GUID_WICPixelFormat32bppRGBA,
-                WICBitmapDitherTypeNone,
-                nullptr,
-                0.f,
-                WICBitmapPaletteTypeMedianCut
-        );
+    vertex_buffer = std::move(model.vertex_buffer);
+    vertex_buffer_view = model.vertex_buffer_view;
+    number_of_vertices = model.number_of_vertices;
+    submesh_draws = std::move(model.submesh_draws);
+    submesh_index = std::move(model.submesh_index);
+    submesh_visible.assign(submesh_draws.size(), true);
+    texture_occlusion = std::move(model.texture_occlusion);
+
+    // Feet below the camera, like when walking starts, so walking on goes on from the same height.
+    collision_bvh = std::move(model.collision_bvh);
+    DirectX::XMFLOAT3 eye = camera.get_pose().position;
+    walker = std::make_unique<CharacterController>(collision_bvh, DirectX::XMFLOAT3{eye.x, eye.y - EYE_HEIGHT, eye.z});
+
+    return S_OK;
+}
+
+// --world: the chunks are listed from their headers, WorldStreamer loads them from the first frame on.
+HRESULT App::LoadWorld() {
+    std::vector<WorldStreamer::Chunk> chunks;
+
+    for (std::size_t i = 0; std::filesystem::exists(MeshCooker::get_chunk_path(options.world_path, i)); i++) {
+        WorldStreamer::Chunk chunk = {};
+        std::filesystem::path path = MeshCooker::get_chunk_path(options.world_path, i);
+        HRESULT hr = MeshChunk::read_header(path, chunk.bounds, chunk.size_bytes);
+
+        if (FAILED(hr)) {
+            return hr;
+        }
+
+        chunks.push_back(chunk);
+        world_chunks.emplace_back().path = path;
     }
 
-    if (SUCCEEDED(hr)) {
-        hr = converter->GetSize(&width, &height);
+    if (chunks.empty()) {
+        return E_INVALIDARG;
     }
 
-    if (SUCCEEDED(hr)) {
+    // world_chunks is not resized from here on, the loader threads write into its entries.
+    chunk_loader = std::make_unique<ThreadedChunkLoader>([this](ChunkId chunk) {
+        WorldChunk& world_chunk = world_chunks[chunk];
+        return world_chunk.mesh.load(world_chunk.path);
+    });
+
+    WorldStreamer::Callbacks callbacks;
+    callbacks.upload = [this](ChunkId chunk) { return UploadChunk(chunk); };
+    callbacks.evict = [this](ChunkId chunk) { EvictChunk(chunk); };
+    world_streamer = std::make_unique<WorldStreamer>(std::move(chunks), *chunk_loader, std::move(callbacks));
+
+    WCHAR text[512];
+    swprintf_s(text, L"World %s: %zu chunks\n", options.world_path.c_str(), world_chunks.size());
+    OutputDebugStringW(text);
+
+    return S_OK;
+}
+
+// Called from WorldStreamer::update, while nothing is in flight (see UpdateProgressiveLoad).
+HRESULT App::UploadChunk(ChunkId chunk) {
+    WorldChunk& world_chunk = world_chunks[chunk];
+    UINT buffer_size = static_cast<UINT>(world_chunk.mesh.get_size_bytes());
+    HRESULT hr = buffer_size > 0 ? S_OK : E_INVALIDARG;
+
+    if (SUCCEEDED(hr)) {
+        const auto heap_properties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
+        const auto resource_desc = CD3DX12_RESOURCE_DESC::Buffer(buffer_size);
+
+        hr = device->CreateCommittedResource(
+                &heap_properties,
+                D3D12_HEAP_FLAG_NONE,
+                &resource_desc,
+                D3D12_RESOURCE_STATE_GENERIC_READ,
+                nullptr,
+                IID_PPV_ARGS(&world_chunk.vertex_buffer)
+        );
+    }
+
+    UINT8* vertex_data_begin = nullptr;
+
+    if (SUCCEEDED(hr)) {
+        CD3DX12_RANGE read_range(0, 0);
+        hr = world_chunk.vertex_buffer->Map(0, &read_range, reinterpret_cast<void**>(&vertex_data_begin));
+    }
+
+    if (SUCCEEDED(hr)) {
+        memcpy(vertex_data_begin, world_chunk.mesh.vertices.data(), buffer_size);
+        world_chunk.vertex_buffer->Unmap(0, nullptr);
+
+        world_chunk.vertex_buffer_view.BufferLocation = world_chunk.vertex_buffer->GetGPUVirtualAddress();
+        world_chunk.vertex_buffer_view.StrideInBytes = sizeof(Vertex);
+        world_chunk.vertex_buffer_view.SizeInBytes = buffer_size;
+    }
+    else {
+        world_chunk.vertex_buffer.Reset();
+    }
+
+    // The vertex buffer is all drawing needs.
+    std::vector<Vertex>().swap(world_chunk.mesh.vertices);
+
+    return hr;
+}
+
+void App::EvictChunk(ChunkId chunk) {
+    WorldChunk& world_chunk = world_chunks[chunk];
+    world_chunk.vertex_buffer.Reset();
+    world_chunk.vertex_buffer_view = {};
+    std::vector<Vertex>().swap(world_chunk.mesh.vertices);
+}
+
+HRESULT App::CreateTexture(
+        const BYTE* bits,
+        UINT bitmap_width,
+        UINT bitmap_height,
+        std::vector<Microsoft::WRL::ComPtr<ID3D12Resource>>& upload_buffers) {
+    Microsoft::WRL::ComPtr<ID3D12Resource> texture;
+    Microsoft::WRL::ComPtr<ID3D12Resource> upload_buffer;
+    UINT descriptor = descriptor_allocator.allocate();
+
+    if (descriptor == DescriptorAllocator::INVALID_INDEX) {
+        return E_OUTOFMEMORY;
+    }
+
+    HRESULT hr = RecordTextureUpload(command_list.Get(), bits, bitmap_width, bitmap_height, texture, upload_buffer);
+
+    if (SUCCEEDED(hr)) {
+        CreateTextureView(texture.Get(), descriptor);
+
+        textures.push_back(texture);
+        texture_descriptors.push_back(descriptor);
+        upload_buffers.push_back(upload_buffer);
+    }
+    else {
+        descriptor_allocator.free(descriptor);
+    }
+
+    return hr;
+}
+
+// Creates the texture and records the copy of the bitmap into it on list; upload_buffer
+// has to stay alive until the copy has finished.
+HRESULT App::RecordTextureUpload(
+        ID3D12GraphicsCommandList* list,
+        const BYTE* bits,
+        UINT bitmap_width,
+        UINT bitmap_height,
+        Microsoft::WRL::ComPtr<ID3D12Resource>& texture,
+        Microsoft::WRL::ComPtr<ID3D12Resource>& upload_buffer) {
+    D3D12_HEAP_PROPERTIES heap_properties = {};
+    heap_properties.Type = D3D12_HEAP_TYPE_DEFAULT;
+    heap_properties.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+    heap_properties.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+    heap_properties.CreationNodeMask = 1;
+    heap_properties.VisibleNodeMask = 1;
+
+    D3D12_RESOURCE_DESC resource_desc = {};
+    resource_desc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+    resource_desc.Alignment = 0;
+    resource_desc.Width = bitmap_width;
+    resource_desc.Height = bitmap_height;
+    resource_desc.DepthOrArraySize = 1;
+    resource_desc.MipLevels = 1;
+    resource_desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+    resource_desc.SampleDesc = { .Count = 1, .Quality = 0 };
+    resource_desc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+    resource_desc.Flags = D3D12_RESOURCE_FLAG_NONE;
+
+    HRESULT hr = device->CreateCommittedResource(
+            &heap_properties,
+            D3D12_HEAP_FLAG_NONE,
+            &resource_desc,
+            D3D12_RESOURCE_STATE_COPY_DEST,
+            nullptr,
+            IID_PPV_ARGS(&texture)
+    );
+
+    if (SUCCEEDED(hr)) {
+        const auto upload_heap_properties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
+        const auto upload_resource_desc = CD3DX12_RESOURCE_DESC::Buffer(GetRequiredIntermediateSize(texture.Get(), 0, 1));
+
+        hr = device->CreateCommittedResource(
+                &upload_heap_properties,
+                D3D12_HEAP_FLAG_NONE,
+                &upload_resource_desc,
+                D3D12_RESOURCE_STATE_GENERIC_READ,
+                nullptr,
+                IID_PPV_ARGS(&upload_buffer)
+        );
+    }
+
+    if (SUCCEEDED(hr)) {
+        D3D12_SUBRESOURCE_DATA texture_data = {};
+        texture_data.RowPitch = bitmap_width * BITMAP_PIXEL_SIZE;
+        texture_data.SlicePitch = bitmap_width * bitmap_height * BITMAP_PIXEL_SIZE;
+        texture_data.pData = bits;
+
+        auto transition = CD3DX12_RESOURCE_BARRIER::Transition(texture.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+
+        UpdateSubresources(list, texture.Get(), upload_buffer.Get(), 0, 0, 1, &texture_data);
+        list->ResourceBarrier(1, &transition);
+    }
+
+    return hr;
+}
+
+void App::CreateTextureView(ID3D12Resource* texture, UINT descriptor) {
+    D3D12_SHADER_RESOURCE_VIEW_DESC shader_resource_view_desc = {};
+    shader_resource_view_desc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+    shader_resource_view_desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+    shader_resource_view_desc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+    shader_resource_view_desc.Texture2D = {
+            .MostDetailedMip = 0,
+            .MipLevels = 1,
+            .PlaneSlice = 0,
+            .ResourceMinLODClamp = 0.f
+    };
+
+    device->CreateShaderResourceView(texture, &shader_resource_view_desc, GetCpuDescriptorHandle(descriptor));
+}
+
+// Uploads with a command list of its own, so frames go on while the copy runs, and
+// suspends until the GPU has finished it.
+Task<HRESULT> App::UploadTextureAsync(DecodedBitmap bitmap, Microsoft::WRL::ComPtr<ID3D12Resource>& texture) {
+    Microsoft::WRL::ComPtr<ID3D12CommandAllocator> allocator;
+    Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> list;
+    Microsoft::WRL::ComPtr<ID3D12Resource> upload_buffer;
+
+    HRESULT hr = device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&allocator));
+
+    if (SUCCEEDED(hr)) {
+        hr = device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, allocator.Get(), nullptr, IID_PPV_ARGS(&list));
+    }
+
+    if (SUCCEEDED(hr)) {
+        hr = RecordTextureUpload(list.Get(), bitmap.bits.data(), bitmap.width, bitmap.height, texture, upload_buffer);
+    }
+
+    if (SUCCEEDED(hr)) {
+        hr = list->Close();
+    }
+
+    UINT64 value = 0;
+
+    if (SUCCEEDED(hr)) {
+        ID3D12CommandList* command_lists[] = { list.Get() };
+        command_queue->ExecuteCommandLists(_countof(command_lists), command_lists);
+
+        std::lock_guard lock(upload_fence_mutex);
+        value = ++upload_fence_value;
+        hr = command_queue->Signal(upload_fence.Get(), value);
+    }
+
+    if (SUCCEEDED(hr)) {
+        hr = co_await FenceAwaiter(upload_fence.Get(), value, TaskScheduler::get_default());
+    }
+
+    co_return hr;
+}
+
+App::FenceAwaiter::FenceAwaiter(ID3D12Fence* fence, UINT64 value, TaskScheduler& scheduler)
+        : fence(fence), value(value), scheduler(scheduler) {}
+
+bool App::FenceAwaiter::await_ready() const {
+    return fence->GetCompletedValue() >= value;
+}
+
+// The event is waited for by the thread pool of the system, the coroutine itself continues on the scheduler.
+void App::FenceAwaiter::await_suspend(std::coroutine_handle<> handle) {
+    auto wait = new Wait{scheduler, handle};
+    wait->event = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+    HRESULT status = wait->event != nullptr ? fence->SetEventOnCompletion(value, wait->event) : HRESULT_FROM_WIN32(GetLastError());
+
+    // Once the wait is registered OnCompleted can resume the coroutine, freeing this awaiter, before the call
+    // returns; from here on only the wait is touched
+    if (SUCCEEDED(status) && RegisterWaitForSingleObject(&wait->wait_handle, wait->event, OnCompleted, wait, INFINITE, WT_EXECUTEONLYONCE)) {
+        Release(wait);
+        return;
+    }
+
+    hr = SUCCEEDED(status) ? HRESULT_FROM_WIN32(GetLastError()) : status;
+
+    if (wait->event != nullptr) {
+        CloseHandle(wait->event);
+    }
+
+    delete wait;
+    scheduler.spawn([handle] { handle.resume(); });
+}
+
+HRESULT App::FenceAwaiter::await_resume() {
+    return hr;
+}
+
+void CALLBACK App::FenceAwaiter::OnCompleted(PVOID context, [[maybe_unused]] BOOLEAN timed_out) {
+    auto wait = static_cast<Wait*>(context);
+    std::coroutine_handle<> handle = wait->handle;
+    wait->scheduler.spawn([handle] { handle.resume(); });
+    Release(wait);
+}
+
+// The wait handle is only known once RegisterWaitForSingleObject has returned, which may be after OnCompleted
+// ran, so the last of the two unregisters it. UnregisterWaitEx does not block, as it may run in the callback.
+void App::FenceAwaiter::Release(Wait* wait) {
+    if (--wait->users > 0) {
+        return;
+    }
+
+    UnregisterWaitEx(wait->wait_handle, nullptr);
+    CloseHandle(wait->event);
+    delete wait;
+}
+
+void App::CreateDrawBatches(const ObjectLoader& object_loader, PreparedModel& model) {
+    model.submesh_index = std::make_unique<SpatialIndex>(object_loader.get_bounds());
+    create_submesh_draws(object_loader, model.texture_uris, model.submesh_draws, *model.submesh_index);
+}
+
+// Appends the triangles parsed since the last frame to the preview vertex buffer, which
+// grows by doubling. Nothing is in flight at this point (OnRender waits for every frame),
+// so a replaced buffer can be released right away.
+HRESULT App::UpdateProgressiveLoad() {
+    HRESULT hr = S_OK;
+
+    preview_batch.clear();
+    progressive_loader->collect(preview_batch);
+
+    std::size_t needed = preview_vertices + preview_batch.size();
+
+    if (needed > preview_capacity) {
+        std::size_t capacity = std::max(needed, std::max<std::size_t>(2 * preview_capacity, MIN_PREVIEW_VERTICES));
+        Microsoft::WRL::ComPtr<ID3D12Resource> buffer;
+        UINT8* buffer_data_begin = nullptr;
+
+        const auto heap_properties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
+        const auto resource_desc = CD3DX12_RESOURCE_DESC::Buffer(capacity * sizeof(Vertex));
+
+        hr = device->CreateCommittedResource(
+                &heap_properties,
+                D3D12_HEAP_FLAG_NONE,
+                &resource_desc,
+                D3D12_RESOURCE_STATE_GENERIC_READ,
+                nullptr,
+                IID_PPV_ARGS(&buffer)
+        );
+
+        if (SUCCEEDED(hr)) {
+            CD3DX12_RANGE read_range(0, 0);
+            hr = buffer->Map(0, &read_range, reinterpret_cast<void**>(&buffer_data_begin));
+        }
+
+        if (SUCCEEDED(hr)) {
+            if (preview_vertices > 0) {
+                memcpy(buffer_data_begin, preview_data_begin, preview_vertices * sizeof(Vertex));
+            }
+
+            vertex_buffer = buffer;
+            preview_data_begin = buffer_data_begin;
+            preview_capacity = capacity;
+
+            vertex_buffer_view.BufferLocation = vertex_buffer->GetGPUVirtualAddress();
+            vertex_buffer_view.StrideInBytes = sizeof(Vertex);
+            vertex_buffer_view.SizeInBytes = static_cast<UINT>(capacity * sizeof(Vertex));
+        }
+    }
+
+    if (SUCCEEDED(hr) && !preview_batch.empty()) {
+        if (preview_vertices == 0) {
+            WCHAR text[128];
+            swprintf_s(text, L"Progressive load: first geometry after %.1f ms\n", progressive_loader->get_first_batch_ms());
+            OutputDebugStringW(text);
+        }
+
+        memcpy(preview_data_begin + preview_vertices * sizeof(Vertex), preview_batch.data(), preview_batch.size() * sizeof(Vertex));
+        preview_vertices = needed;
+    }
+
+    if (SUCCEEDED(hr) && progressive_loader->is_finished()) {
+        hr = progressive_loader->get_result();
+
+        if (SUCCEEDED(hr)) {
+            hr = LoadModel(progressive_loader->get_loader());
+        }
+
+        WCHAR text[128];
+        swprintf_s(text, L"Progressive load: %zu vertices, 0x%08lx\n", preview_vertices, static_cast<unsigned long>(hr));
+        OutputDebugStringW(text);
+
+        progressive_loader.reset();
+        std::vector<Vertex>().swap(preview_batch);
+        preview_data_begin = nullptr;
+        preview_capacity = 0;
+        preview_vertices = 0;
+    }
+
+    return hr;
+}
+
+// Starts reloading the files saved since the last frame and swaps in what has finished loading.
+// Like UpdateProgressiveLoad this runs while nothing is in flight. A file that fails to load
+// (e.g. saved half way) only leaves the model as it was.
+HRESULT App::UpdateHotReload() {
+    HRESULT hr = S_OK;
+
+    std::filesystem::path model_file = std::filesystem::path(MODEL_URI).filename().concat(".obj");
+
+    for (const FileWatcher::Change& change : asset_watcher->poll()) {
+        // Material libraries are not tracked per model, any of them counts.
+        if (change.path.filename() == model_file || change.path.extension() == ".mtl") {
+            // A save during a reload starts it again, still counted from the first save.
+            if (!reload_loader) {
+                reload_saved_time = change.first_time;
+            }
+
+            // Resetting the loader waits for a model it is still building.
+            reload_loader.reset();
+            reload_model = std::make_unique<PreparedModel>();
+
+            ProgressiveMeshLoader::Options loader_options;
+            loader_options.preview = false;
+            loader_options.finish = [this, model = reload_model.get(), kept_texture_uris = loaded_texture_uris](ObjectLoader& object_loader) {
+                return PrepareModel(object_loader, *model, kept_texture_uris);
+            };
+            reload_loader = std::make_unique<ProgressiveMeshLoader>(MODEL_URI, color, loader_options);
+            continue;
+        }
+
+        for (std::size_t i = 0; i < loaded_texture_uris.size(); i++) {
+            if (std::filesystem::path(loaded_texture_uris[i]).lexically_normal() == change.path.lexically_normal() && options.bake_passes == 0) {
+                texture_reloads.push_back(std::make_unique<TextureReload>());
+                TextureReload& reload = *texture_reloads.back();
+                reload.texture_index = i + 1;
+                reload.saved_time = change.first_time;
+
+                start(ReloadTextureAsync(reload, loaded_texture_uris[i], texture_occlusion), [&reload](HRESULT reload_hr) {
+                    reload.hr = reload_hr;
+                    reload.finished.store(true, std::memory_order_release);
+                });
+            }
+        }
+    }
+
+    if (reload_loader && reload_loader->is_finished()) {
+        HRESULT load_hr = reload_loader->get_result();
+
+        if (SUCCEEDED(load_hr)) {
+            hr = SwapInModel(*reload_model);
+        }
+
+        WCHAR text[128];
+        swprintf_s(text, L"Hot reload: model 0x%08lx, visible %.0f ms after the save\n",
+                   static_cast<unsigned long>(FAILED(load_hr) ? load_hr : hr),
+                   std::chrono::duration<double, std::milli>(FileWatcher::Clock::now() - reload_saved_time).count());
+        OutputDebugStringW(text);
+
+        reload_loader.reset();
+        reload_model.reset();
+    }
+
+    for (auto it = texture_reloads.begin(); SUCCEEDED(hr) && it != texture_reloads.end();) {
+        TextureReload& reload = **it;
+
+        if (!reload.finished.load(std::memory_order_acquire)) {
+            ++it;
+            continue;
+        }
+
+        // The model may have been reloaded with other textures in the meantime.
+        if (SUCCEEDED(reload.hr) && reload.texture_index < textures.size()) {
+            hr = ReplaceTexture(reload.texture_index, reload.texture.Get());
+        }
+
+        WCHAR text[128];
+        swprintf_s(text, L"Hot reload: texture %zu 0x%08lx, visible %.0f ms after the save\n",
+                   reload.texture_index, static_cast<unsigned long>(FAILED(reload.hr) ? reload.hr : hr),
+                   std::chrono::duration<double, std::milli>(FileWatcher::Clock::now() - reload.saved_time).count());
+        OutputDebugStringW(text);
+
+        it = texture_reloads.erase(it);
+    }
+
+    return hr;
+}
+
+// Runs on a worker thread, with a WIC factory of its own (the one of the app belongs to the main thread).
+// Decodes contents when given, otherwise reads the file.
+App::DecodedBitmap App::DecodeBitmap(const std::wstring& uri, std::span<const std::uint8_t> contents) {
+    DecodedBitmap bitmap = {};
+    HRESULT com_hr = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+    Microsoft::WRL::ComPtr<IWICImagingFactory> factory;
+    BYTE* bits = nullptr;
+
+    bitmap.hr = CoCreateInstance(CLSID_WICImagingFactory, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&factory));
+
+    if (SUCCEEDED(bitmap.hr)) {
+        bitmap.hr = contents.empty() ? LoadBitmapFromFile(factory.Get(), uri.c_str(), bitmap.width, bitmap.height, &bits)
+                                     : LoadBitmapFromMemory(factory.Get(), contents, bitmap.width, bitmap.height, &bits);
+    }
+
+    if (SUCCEEDED(bitmap.hr)) {
+        bitmap.bits.assign(bits, bits + static_cast<std::size_t>(BITMAP_PIXEL_SIZE) * bitmap.width * bitmap.height);
+    }
+
+    delete[] bits;
+    factory.Reset();
+
+    if (SUCCEEDED(com_hr)) {
+        CoUninitialize();
+    }
+
+    return bitmap;
+}
+
+// Suspends while the file is read and decodes it as a task of the scheduler. Packed
+// textures are in memory already and only decoded.
+Task<App::DecodedBitmap> App::DecodeBitmapAsync(std::wstring uri) {
+    TaskScheduler& scheduler = TaskScheduler::get_default();
+
+    if (!file_reader) {
+        co_await schedule_on(scheduler);
+        co_return DecodeBitmap(uri);
+    }
+
+    AsyncFileReader::ReadResult file = co_await file_reader->read(uri, scheduler);
+
+    if (FAILED(file.hr)) {
+        DecodedBitmap bitmap = {};
+        bitmap.hr = file.hr;
+        co_return bitmap;
+    }
+
+    co_return DecodeBitmap(uri, file.data.get());
+}
+
+// A saved texture, read, decoded and uploaded without stalling the frames; occlusion is the
+// one of the model at the time of the save. UpdateHotReload swaps the texture in once finished.
+Task<HRESULT> App::ReloadTextureAsync(TextureReload& reload, std::wstring uri, std::vector<float> occlusion) {
+    DecodedBitmap bitmap = co_await DecodeBitmapAsync(std::move(uri));
+
+    if (FAILED(bitmap.hr)) {
+        co_return bitmap.hr;
+    }
+
+    OcclusionBaker::apply_to_bitmap(bitmap.bits.data(), bitmap.width, bitmap.height, occlusion, AO_TEXTURE_SIZE, AO_TEXTURE_SIZE);
+    co_return co_await UploadTextureAsync(std::move(bitmap), reload.texture);
+}
+
+// Everything but the white texture 0. The GPU has to be idle.
+void App::ReleaseModelTextures() {
+    for (std::size_t i = 1; i < texture_descriptors.size(); i++) {
+        descriptor_allocator.free(texture_descriptors[i]);
+    }
+
+    textures.resize(std::min<std::size_t>(textures.size(), 1));
+    texture_descriptors.resize(std::min<std::size_t>(texture_descriptors.size(), 1));
+    loaded_texture_uris.clear();
+}
+
+// Moves the uploaded texture, with a new descriptor, into the place of the texture at index,
+// so the draws pick it up. Nothing may be in flight.
+HRESULT App::ReplaceTexture(std::size_t index, ID3D12Resource* texture) {
+    UINT descriptor = descriptor_allocator.allocate();
+
+    if (descriptor == DescriptorAllocator::INVALID_INDEX) {
+        return E_OUTOFMEMORY;
+    }
+
+    CreateTextureView(texture, descriptor);
+    descriptor_allocator.free(texture_descriptors[index]);
+    textures[index] = texture;
+    texture_descriptors[index] = descriptor;
+
+    return S_OK;
+}
+
+void App::CullSubmeshes(const DirectX::XMMATRIX& world_view_proj) {
+    PROFILE_ZONE("CullSubmeshes", &cull_statistics);
+    cull_submeshes(*submesh_index, submesh_draws, world_view_proj, visible_submeshes, submesh_visible, draw_batches);
+}
+
+// Resident chunks in the view frustum, each drawn from its own vertex buffer.
+void App::CullChunks(const DirectX::XMMATRIX& world_view_proj) {
+    PROFILE_ZONE("CullChunks", &cull_statistics);
+
+    Frustum frustum = Frustum::from_matrix(world_view_proj);
+    visible_chunks.clear();
+
+    for (ChunkId chunk : world_streamer->get_loaded_chunks()) {
+        if (world_streamer->get_state(chunk) == WorldStreamer::ChunkState::RESIDENT &&
+            frustum.intersects(world_streamer->get_chunk(chunk).bounds)) {
+            visible_chunks.push_back(chunk);
+        }
+    }
+}
+
+void App::BakeLightmap(const std::vector<Vertex>& vertices, const TriangleBvh& bvh,
+                       std::vector<std::uint8_t>& bitmap, UINT& bitmap_width, UINT& bitmap_height) {
+    PROFILE_ZONE("BakeLightmap");
+
+    LightmapBaker baker(vertices, bvh);
+
+    for (unsigned pass = 0; pass < options.bake_passes; pass++) {
+        const LightmapBaker::Statistics& statistics = baker.refine(TaskScheduler::get_default());
+
+        WCHAR report[256];
+        swprintf_s(
+                report,
+                L"lightmap pass %u: %.1f ms, %.2f Mrays/s, relative error %.4f, %.1f%% converged\n",
+                statistics.samples,
+                statistics.pass_ms,
+                statistics.rays_per_second / 1e6,
+                statistics.relative_error,
+                100.0 * statistics.converged
+        );
+        OutputDebugStringW(report);
+    }
+
+    baker.get_bitmap(bitmap);
+    bitmap_width = baker.get_width();
+    bitmap_height = baker.get_height();
+}
+
+void App::BakeOcclusion(std::vector<Vertex>& vertices, const TriangleBvh& bvh, std::vector<float>& texture_occlusion) {
+    PROFILE_ZONE("BakeOcclusion");
+
+    OcclusionBaker::Options baker_options;
+    baker_options.rays = options.ao_rays;
+    OcclusionBaker baker(vertices, bvh, baker_options);
+
+    if (options.ao_texture) {
+        texture_occlusion = baker.bake_texels(TaskScheduler::get_default(), AO_TEXTURE_SIZE, AO_TEXTURE_SIZE);
+    }
+    else {
+        OcclusionBaker::apply_to_vertices(vertices, baker.bake_vertices(TaskScheduler::get_default()));
+    }
+
+    const OcclusionBaker::Statistics& statistics = baker.get_statistics();
+
+    WCHAR report[256];
+    swprintf_s(
+            report,
+            L"ambient occlusion: %zu %ls, %.1f ms, %.2f Mrays/s\n",
+            statistics.points,
+            options.ao_texture ? L"texels" : L"distinct vertices",
+            statistics.bake_ms,
+            statistics.rays_per_second / 1e6
+    );
+    OutputDebugStringW(report);
+}
+
+D3D12_CPU_DESCRIPTOR_HANDLE App::GetCpuDescriptorHandle(UINT descriptor) {
+    return CD3DX12_CPU_DESCRIPTOR_HANDLE(
+            cbv_heap->GetCPUDescriptorHandleForHeapStart(),
+            static_cast<INT>(descriptor),
+            device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV)
+    );
+}
+
+D3D12_GPU_DESCRIPTOR_HANDLE App::GetGpuDescriptorHandle(UINT descriptor) {
+    return CD3DX12_GPU_DESCRIPTOR_HANDLE(
+            cbv_heap->GetGPUDescriptorHandleForHeapStart(),
+            static_cast<INT>(descriptor),
+            device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV)
+    );
+}
+
+void App::PickAtScreenCenter(const Camera& view_camera) {
+    {
+        PROFILE_ZONE("Pick", &pick_statistics);
+        hover_valid = collision_bvh.intersect(view_camera.get_ray(aspect_ratio, 0.0f, 0.0f), hover_hit);
+    }
+
+    // The title only changes with the hovered submesh, not with every hit position.
+    UINT submesh = hover_valid ? hover_hit.object : TriangleBvh::NO_OBJECT;
+
+    if (submesh != shown_submesh) {
+        shown_submesh = submesh;
+
+        WCHAR text[256] = L"";
+
+        if (hover_valid) {
+            swprintf_s(text, L" | submesh %u, %.2f m", submesh, hover_hit.distance);
+        }
+
+        SetWindowTextW(hwnd, (title + text).c_str());
+    }
+}
+
+// First call marks the point under the screen center, the second one reports the distance to it.
+void App::Measure() {
+    if (!hover_valid) {
+        return;
+    }
+
+    if (!measure_started) {
+        measure_start = hover_hit.position;
+        measure_started = true;
+        return;
+    }
+
+    measure_started = false;
+
+    float distance = DirectX::XMVectorGetX(DirectX::XMVector3Length(DirectX::XMVectorSubtract(
+            DirectX::XMLoadFloat3(&hover_hit.position),
+            DirectX::XMLoadFloat3(&measure_start)
+    )));
+
+    WCHAR report[128];
+    swprintf_s(report, L"measured %.3f m", distance);
+    SetWindowTextW(hwnd, (title + L" | " + report).c_str());
+    OutputDebugStringW((std::wstring(report) + L"\n").c_str());
+}
+
+HRESULT App::PopulateCommandList() {
+    PROFILE_ZONE("PopulateCommandList", &record_statistics);
+    HRESULT hr = S_OK;
+
+    hr = command_allocator->Reset();
+
+    if (SUCCEEDED(hr)) {
+        hr = command_list->Reset(command_allocator.Get(), pipeline_state.Get());
+    }
+
+    if (SUCCEEDED(hr)) {
+        gpu_profiler.begin_zone(command_list.Get(), "Frame");
+
+        command_list->SetGraphicsRootSignature(root_signature.Get());
+        ID3D12DescriptorHeap* heaps[] = { cbv_heap.Get() };
+        command_list->SetDescriptorHeaps(_countof(heaps), heaps);
+
+        command_list->SetGraphicsRootDescriptorTable(0, GetGpuDescriptorHandle(constant_buffer_descriptor));
+        command_list->SetGraphicsRootDescriptorTable(1, cbv_heap->GetGPUDescriptorHandleForHeapStart());
+        command_list->RSSetViewports(1, &viewport);
+        command_list->RSSetScissorRects(1, &scissor_rect);
+
+        auto transition1 = CD3DX12_RESOURCE_BARRIER::Transition(render_targets[frame_index].Get(), D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET);
+        command_list->ResourceBarrier(1, &transition1);
+        CD3DX12_CPU_DESCRIPTOR_HANDLE rtv_handle(rtv_heap->GetCPUDescriptorHandleForHeapStart(), frame_index, rtv_descriptor_size);
+        CD3DX12_CPU_DESCRIPTOR_HANDLE dsv_handle(dsv_heap->GetCPUDescriptorHandleForHeapStart());
+        command_list->OMSetRenderTargets(1, &rtv_handle, FALSE, &dsv_handle);
+
+        const float color_arr[] = {background_color.x, background_color.y, background_color.z, background_color.w};
+        command_list->ClearRenderTargetView(rtv_handle, color_arr, 0, nullptr);
+        command_list->ClearDepthStencilView(dsv_heap->GetCPUDescriptorHandleForHeapStart(), D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr);
+        command_list->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+        command_list->IASetVertexBuffers(0, 1, &vertex_buffer_view);
+
+        UINT bound_texture = UINT_MAX;
+
+        // Switching textures only changes the index the pixel shader reads from the bindless table.
+        for (const auto& batch : draw_batches) {
+            if (batch.texture_index != bound_texture) {
+                command_list->SetGraphicsRoot32BitConstant(2, texture_descriptors[batch.texture_index], 0);
+                bound_texture = batch.texture_index;
+            }
+
+            command_list->DrawInstanced(batch.number_of_vertices, 1, batch.first_vertex, 0);
+        }
+
+        // Chunks carry their colors in the vertices, they use the white texture.
+        if (!visible_chunks.empty()) {
+            command_list->SetGraphicsRoot32BitConstant(2, texture_descriptors[0], 0);
+        }
+
+        for (ChunkId chunk : visible_chunks) {
+            const D3D12_VERTEX_BUFFER_VIEW& view = world_chunks[chunk].vertex_buffer_view;
+            command_list->IASetVertexBuffers(0, 1, &view);
+            command_list->DrawInstanced(view.SizeInBytes / view.StrideInBytes, 1, 0, 0);
+        }
+
+        auto transition2 = CD3DX12_RESOURCE_BARRIER::Transition(render_targets[frame_index].Get(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT);
+        command_list->ResourceBarrier(1, &transition2);
+
+        gpu_profiler.end_zone(command_list.Get());
+        gpu_profiler.resolve(command_list.Get());
+
+        hr = command_list->Close();
+    }
+
+    return hr;
+}
+
+HRESULT App::WaitForPreviousFrame() {
+    PROFILE_ZONE("WaitForPreviousFrame", &fence_wait_statistics);
+    HRESULT hr = S_OK;
+
+    const UINT64 fence_value_copy = fence_value;
+    hr = command_queue->Signal(fence.Get(), fence_value_copy);
+
+    if (SUCCEEDED(hr)) {
+        fence_value++;
+
+        if (fence->GetCompletedValue() < fence_value_copy) {
+            hr = fence->SetEventOnCompletion(fence_value_copy, fence_event);
+            WaitForSingleObject(fence_event, INFINITE);
+        }
+
+        frame_index = swap_chain->GetCurrentBackBufferIndex();
+    }
+
+    return hr;
+}
+
+HRESULT App::OnInit() {
+    HRESULT hr = LoadPipeline();
+
+    if (SUCCEEDED(hr)) {
+        hr = LoadAssets();
+    }
+
+    if (SUCCEEDED(hr)) {
+        hr = LoadCameraPaths();
+    }
+
+    if (SUCCEEDED(hr)) {
+        model_node = scene.create_node();
+        previous_camera_pose = camera.get_pose();
+        simulation_clock.reset();
+    }
+
+    return hr;
+}
+
+HRESULT App::OnUpdate() {
+    PROFILE_ZONE("OnUpdate", &update_statistics);
+    HRESULT hr = S_OK;
+
+    if (progressive_loader) {
+        hr = UpdateProgressiveLoad();
+    }
+
+    if (SUCCEEDED(hr) && asset_watcher && !progressive_loader) {
+        hr = UpdateHotReload();
+    }
+
+    // Benchmark frames advance the simulation by a fixed amount of time, so replays are deterministic.
+    if (options.benchmark) {
+        simulation_clock.advance(BENCHMARK_TIMESTEP);
+    } else {
+        simulation_clock.advance();
+    }
+
+    while (simulation_clock.step()) {
+        previous_camera_pose = camera.get_pose();
+
+        if (options.benchmark) {
+            camera.set_pose(benchmark_path.sample(static_cast<float>(simulation_clock.get_simulation_time())));
+        } else {
+            ProcessMove(static_cast<float>(simulation_clock.get_timestep()));
+        }
+    }
+
+    if (!options.benchmark) {
+        ProcessMouse();
+
+        if (mouse_pressed) {
+            camera.reset();
+            SetWalkMode(walk_mode);
+            previous_camera_pose = camera.get_pose();
+        }
+    }
+
+    Camera view_camera = camera;
+    view_camera.set_pose(Camera::interpolate(
+            previous_camera_pose,
+            camera.get_pose(),
+            simulation_clock.get_interpolation_alpha()
+    ));
+
+    scene.update(&TaskScheduler::get_default());
+
+    DirectX::XMMATRIX wvp_matrix = XMMatrixMultiply(scene.get_world_matrix(model_node), view_camera.get_projection_matrix());
+    DirectX::XMStoreFloat4x4(&constant_buffer_data.mat_world_view, XMMatrixTranspose(wvp_matrix));
+
+    wvp_matrix = XMMatrixMultiply(wvp_matrix, view_camera.get_perspective_matrix(aspect_ratio));
+
+    // Until the model is loaded the preview is drawn whole, with the white texture.
+    if (submesh_index) {
+        CullSubmeshes(wvp_matrix);
+    }
+    else {
+        draw_batches.clear();
+
+        if (preview_vertices > 0) {
+            draw_batches.push_back({0, static_cast<UINT>(preview_vertices), 0});
+        }
+    }
+
+    // Chunks are streamed around the rendered camera, the simulation time drives the prefetching.
+    if (world_streamer) {
+        world_streamer->update(view_camera.get_pose().position, static_cast<float>(simulation_clock.get_simulation_time() - streamed_time));
+        streamed_time = simulation_clock.get_simulation_time();
+        CullChunks(wvp_matrix);
+    }
+
+    if (!options.benchmark) {
+        PickAtScreenCenter(view_camera);
+    }
+
+    wvp_matrix = XMMatrixTranspose(wvp_matrix);
+    DirectX::XMStoreFloat4x4(&constant_buffer_data.mat_world_view_proj, wvp_matrix);
+
+    memcpy(constant_buffer_data_begin, &constant_buffer_data, sizeof(constant_buffer_data));
+
+    return hr;
+}
+
+HRESULT App::OnRender() {
+    PROFILE_ZONE("OnRender");
+    HRESULT hr = S_OK;
+
+    hr = PopulateCommandList();
+
+    if (SUCCEEDED(hr)) {
+        {
+            PROFILE_ZONE("ExecuteCommandLists");
+            ID3D12CommandList* command_lists[] = { command_list.Get() };
+            command_queue->ExecuteCommandLists(_countof(command_lists), command_lists);
+        }
+
+        {
+            PROFILE_ZONE("Present", &present_statistics);
+            // Benchmark frames are not capped by vsync.
+            hr = swap_chain->Present(options.benchmark ? 0 : 1, 0);
+        }
+
+        RecordInputLatency();
+
+        WaitForPreviousFrame();
+        gpu_profiler.collect();
+    }
+
+    return hr;
+}
+
+HRESULT App::OnDestroy() {
+    // A reloaded model being built and texture reloads still running use the device and the queue.
+    reload_loader.reset();
+
+    TaskScheduler::get_default().wait_until([this] {
+        return std::all_of(texture_reloads.begin(), texture_reloads.end(), [](const auto& reload) {
+            return reload->finished.load(std::memory_order_acquire);
+        });
+    });
+
+    HRESULT hr = WaitForPreviousFrame();
+
+    if (SUCCEEDED(hr)) {
+        CloseHandle(fence_event);
+    }
+
+    if (!options.trace_path.empty()) {
+        Profiler::get().export_chrome_trace(options.trace_path);
+    }
+
+    if (!options.record_path.empty()) {
+        recorded_path.save(options.record_path);
+    }
+
+    if (!options.latency_output.empty()) {
+        WriteTimingLog(latency_log, options.latency_output);
+    }
+
+    return hr;
+}
+
+// With --package the file is decoded straight from the mapping of the package.
+HRESULT App::LoadBitmapFromFile(IWICImagingFactory* factory, PCWSTR uri, UINT &width, UINT &height, BYTE **bits) {
+    if (package.is_open()) {
+        std::span<const std::uint8_t> packed;
+        std::vector<std::uint8_t> packed_storage;
+        HRESULT hr = package.get(std::filesystem::path(uri).string(), packed, packed_storage);
+
+        return SUCCEEDED(hr) ? LoadBitmapFromMemory(factory, packed, width, height, bits) : hr;
+    }
+
+    IWICBitmapDecoder *decoder = nullptr;
+
+    HRESULT hr = factory->CreateDecoderFromFilename(
+            uri,
+            nullptr,
+            GENERIC_READ,
+            WICDecodeMetadataCacheOnLoad,
+            &decoder
+    );
+
+    if (SUCCEEDED(hr)) {
+        hr = DecodeBitmapFrame(factory, decoder, width, height, bits);
+    }
+
+    SafeRelease(&decoder);
+
+    return hr;
+}
+
+HRESULT App::LoadBitmapFromMemory(IWICImagingFactory* factory, std::span<const std::uint8_t> contents, UINT &width, UINT &height, BYTE **bits) {
+    IWICStream *stream = nullptr;
+    IWICBitmapDecoder *decoder = nullptr;
+
+    HRESULT hr = factory->CreateStream(&stream);
+
+    if (SUCCEEDED(hr)) {
+        hr = stream->InitializeFromMemory(const_cast<BYTE*>(contents.data()), static_cast<DWORD>(contents.size()));
+    }
+
+    if (SUCCEEDED(hr)) {
+        hr = factory->CreateDecoderFromStream(stream, nullptr, WICDecodeMetadataCacheOnLoad, &decoder);
+    }
+
+    if (SUCCEEDED(hr)) {
+        hr = DecodeBitmapFrame(factory, decoder, width, height, bits);
+    }
+
+    SafeRelease(&decoder);
+    SafeRelease(&stream);
+
+    return hr;
+}
+
+// The first frame of the image as 32 bit RGBA.
+HRESULT App::DecodeBitmapFrame(IWICImagingFactory* factory, IWICBitmapDecoder* decoder, UINT &width, UINT &height, BYTE **bits) {
+    IWICBitmapFrameDecode *source = nullptr;
+    IWICFormatConverter *converter = nullptr;
+
+    HRESULT hr = decoder->GetFrame(0, &source);
+
+    if (SUCCEEDED(hr)) {
+        hr = factory->CreateFormatConverter(&converter);
+    }
+
+    if (SUCCEEDED(hr)) {
+        hr = converter->Initialize(
+                source,
+                GUID_WICPixelFormat32bppRGBA,
+                WICBitmapDitherTypeNone,
+                nullptr,
+                0.f,
+                WICBitmapPaletteTypeMedianCut
+        );
+    }
+
+    if (SUCCEEDED(hr)) {
+        hr = converter->GetSize(&width, &height);
+    }
+
+    if (SUCCEEDED(hr)) {
         *bits = new BYTE[4 * width * height];
         hr = converter->CopyPixels(
                 nullptr,
@@ -996,13 +1960,174 @@ HRESULT App::LoadBitmapFromFile(PCWSTR uri, UINT &width, UINT &height, BYTE **bi
         );
     }
 
-    SafeRelease(&decoder);
     SafeRelease(&source);
     SafeRelease(&converter);
 
     return hr;
 }
 
+HRESULT App::WriteAssetPackage(const std::wstring& path) {
+    std::filesystem::path directory = std::filesystem::path(MODEL_URI).parent_path();
+    AssetPackageWriter writer;
+    HRESULT hr = writer.add_directory(directory, AssetCompression::LZ);
+
+    if (SUCCEEDED(hr)) {
+        hr = writer.save(path);
+    }
+
+    WCHAR text[512];
+    swprintf_s(text, L"Asset package %s from %s: %s\n",
+               path.c_str(), directory.wstring().c_str(), SUCCEEDED(hr) ? L"written" : L"failed");
+    OutputDebugStringW(text);
+
+    return hr;
+}
+
+HRESULT App::CookModel(const std::wstring& directory, unsigned budget_mib) {
+    MeshCooker::Options cook_options;
+    cook_options.memory_budget = static_cast<std::size_t>(std::max(budget_mib, 1u)) << 20;
+
+    reset_peak_resident_bytes();
+    MeshCooker cooker(MODEL_URI, color, cook_options);
+    HRESULT hr = cooker.cook(directory);
+    const MeshCooker::Statistics& statistics = cooker.get_statistics();
+
+    WCHAR text[512];
+    swprintf_s(text, L"Cooked %s into %s: %s, %llu triangles in %llu chunks, %.1f MiB/s, %.1f s, peak resident %.1f MiB\n",
+               std::filesystem::path(MODEL_URI).wstring().c_str(), directory.c_str(), SUCCEEDED(hr) ? L"done" : L"failed",
+               static_cast<unsigned long long>(statistics.triangles), static_cast<unsigned long long>(statistics.chunks),
+               static_cast<double>(statistics.input_bytes) / (1 << 20) / std::max(statistics.seconds, 1e-9), statistics.seconds,
+               static_cast<double>(get_peak_resident_bytes()) / (1 << 20));
+    OutputDebugStringW(text);
+
+    return hr;
+}
+
+HRESULT App::BuildAssets(const std::wstring& directory) {
+    std::filesystem::path sources = std::filesystem::path(MODEL_URI).parent_path();
+    AssetBuilder::Options build_options;
+    build_options.color = color;
+
+    AssetBuilder builder(sources, directory, build_options);
+    HRESULT hr = builder.build(TaskScheduler::get_default());
+    const AssetBuilder::Statistics& statistics = builder.get_statistics();
+
+    WCHAR text[512];
+    swprintf_s(text, L"Built assets of %s into %s: %s, %llu steps (%llu built, %llu cached, %llu failed), %llu of %llu sources hashed, %llu outputs written, %.2f s\n",
+               sources.wstring().c_str(), directory.c_str(), SUCCEEDED(hr) ? L"done" : L"failed",
+               static_cast<unsigned long long>(statistics.steps), static_cast<unsigned long long>(statistics.built_steps),
+               static_cast<unsigned long long>(statistics.cached_steps), static_cast<unsigned long long>(statistics.failed_steps),
+               static_cast<unsigned long long>(statistics.hashed_sources), static_cast<unsigned long long>(statistics.sources),
+               static_cast<unsigned long long>(statistics.written_outputs), statistics.seconds);
+    OutputDebugStringW(text);
+
+    return hr;
+}
+
+void App::ReportFrameStatistics() {
+    if (++frames_since_report < FRAME_STATISTICS_INTERVAL) {
+        return;
+    }
+
+    frames_since_report = 0;
+
+    WCHAR report[512];
+    swprintf_s(
+            report,
+            L"frame p50 %.2f p95 %.2f p99 %.2f ms | cull p95 %.3f (%zu/%zu visible) | pick p95 %.3f | record p95 %.2f | present p95 %.2f | fence wait p95 %.2f | gpu p95 %.2f | input to present p50 %.2f p95 %.2f\n",
+            frame_statistics.percentile(50.0),
+            frame_statistics.percentile(95.0),
+            frame_statistics.percentile(99.0),
+            cull_statistics.percentile(95.0),
+            visible_submeshes.size(),
+            submesh_draws.size(),
+            pick_statistics.percentile(95.0),
+            record_statistics.percentile(95.0),
+            present_statistics.percentile(95.0),
+            fence_wait_statistics.percentile(95.0),
+            gpu_profiler.get_frame_statistics().percentile(95.0),
+            input_latency_statistics.percentile(50.0),
+            input_latency_statistics.percentile(95.0)
+    );
+    OutputDebugStringW(report);
+
+    if (world_streamer) {
+        const WorldStreamer::Statistics& statistics = world_streamer->get_statistics();
+
+        swprintf_s(
+                report,
+                L"world: %zu/%zu chunks resident (%zu visible), %.1f MiB, %zu loads (%zu failed, %zu reloads), %zu evictions\n",
+                statistics.resident_chunks,
+                world_streamer->get_number_of_chunks(),
+                visible_chunks.size(),
+                static_cast<double>(statistics.used_bytes) / (1 << 20),
+                statistics.loads,
+                statistics.failed_loads,
+                statistics.reloads,
+                statistics.evictions
+        );
+        OutputDebugStringW(report);
+    }
+}
+
+HRESULT App::LoadCameraPaths() {
+    HRESULT hr = S_OK;
+
+    if (options.benchmark) {
+        if (options.benchmark_path.empty()) {
+            benchmark_path = CameraPath::make_default_tour();
+        } else {
+            hr = benchmark_path.load(options.benchmark_path);
+        }
+    }
+
+    return hr;
+}
+
+void App::BenchmarkFrame() {
+    if (benchmark_finished) {
+        return;
+    }
+
+    benchmark_log.add_frame({
+            frame_statistics.last(),
+            update_statistics.last(),
+            cull_statistics.last(),
+            record_statistics.last(),
+            present_statistics.last(),
+            fence_wait_statistics.last(),
+            gpu_profiler.get_frame_statistics().last(),
+            static_cast<double>(visible_submeshes.size()),
+            static_cast<double>(draw_batches.size() + visible_chunks.size())
+    });
+
+    if (simulation_clock.get_simulation_time() > benchmark_path.get_duration()) {
+        benchmark_finished = true;
+        FinishBenchmark();
+        PostQuitMessage(0);
+    }
+}
+
+HRESULT App::FinishBenchmark() {
+    return WriteTimingLog(benchmark_log, options.benchmark_output);
+}
+
+HRESULT App::WriteTimingLog(const FrameTimingLog& log, std::filesystem::path output_path) {
+    std::string summary = log.get_summary();
+
+    HRESULT hr = log.write_csv(output_path);
+
+    if (SUCCEEDED(hr)) {
+        std::ofstream summary_file(output_path.replace_extension(".summary.txt"));
+        summary_file << summary;
+        hr = summary_file.fail() ? E_FAIL : S_OK;
+    }
+
+    OutputDebugStringA(summary.c_str());
+
+    return hr;
+}
+
 void App::OnKeyDown(UINT8 key) {
     switch (key) {
         case 'W': {
@@ -1029,6 +2154,14 @@ void App::OnKeyDown(UINT8 key) {
             keyboard.shift = true;
             break;
         }
+        case 'F': {
+            SetWalkMode(!walk_mode);
+            break;
+        }
+        case 'M': {
+            Measure();
+            break;
+        }
         case VK_ESCAPE:
         case 'Q': {
             post_quit = true;
@@ -1068,7 +2201,7 @@ void App::OnKeyUp(UINT8 key) {
     }
 }
 
-void App::ProcessMove() {
+void App::ProcessMove(float delta_time) {
     DirectX::XMFLOAT3 move = { 0.0f, 0.0f, 0.0f };
 
     if (keyboard.w) {
@@ -1090,17 +2223,66 @@ void App::ProcessMove() {
         move.y -= 1.0f;
     }
 
-    camera.move(move);
+    if (walk_mode) {
+        walker->update(camera.get_walk_velocity(move), keyboard.space, delta_time);
+
+        CameraPose pose = camera.get_pose();
+        DirectX::XMFLOAT3 feet = walker->get_position();
+        pose.position = {feet.x, feet.y + EYE_HEIGHT, feet.z};
+        camera.set_pose(pose);
+    } else {
+        camera.move(move, delta_time);
+    }
+
+    if (!options.record_path.empty()) {
+        float time = static_cast<float>(simulation_clock.get_simulation_time());
+        recorded_path.add_keyframe({time, camera.get_pose()});
+    }
+}
+
+// Walking starts with the feet below the current camera position, the capsule falls from there.
+void App::SetWalkMode(bool enabled) {
+    walk_mode = enabled && walker != nullptr;
+
+    if (walk_mode) {
+        DirectX::XMFLOAT3 eye = camera.get_pose().position;
+        walker->set_position({eye.x, eye.y - EYE_HEIGHT, eye.z});
+    }
+}
+
+// Mouse look is applied once per rendered frame, right before the matrices are built, and not interpolated,
+// so it does not lag behind the simulation. All deltas since the previous frame are applied at once.
+void App::ProcessMouse() {
+    MouseInput::Sample sample = mouse_input.consume();
+
+    if (sample.empty()) {
+        return;
+    }
+
+    camera.rotate(static_cast<float>(sample.delta_x), static_cast<float>(sample.delta_y));
 
-    if (!mouse_position_queue.empty()) {
-        auto mouse_delta = mouse_position_queue.front();
-        mouse_position_queue.pop();
+    CameraPose rotated_pose = camera.get_pose();
+    previous_camera_pose.yaw = rotated_pose.yaw;
+    previous_camera_pose.pitch = rotated_pose.pitch;
 
-        camera.rotate(mouse_delta.first, mouse_delta.second);
+    pending_input_events = sample.event_count;
+    pending_input_timestamp = sample.first_timestamp;
+    input_to_update_ms = Profiler::get().ticks_to_milliseconds(Profiler::now() - sample.first_timestamp);
+}
+
+// Called after Present returns, closes the input -> present measurement of the frame.
+void App::RecordInputLatency() {
+    if (pending_input_events == 0) {
+        return;
     }
 
-    while (mouse_position_queue.size() > 2) {
-        mouse_position_queue.pop();
+    double input_to_present_ms = Profiler::get().ticks_to_milliseconds(Profiler::now() - pending_input_timestamp);
+    input_latency_statistics.add(input_to_present_ms);
+
+    if (!options.latency_output.empty()) {
+        latency_log.add_frame({static_cast<double>(pending_input_events), input_to_update_ms, input_to_present_ms});
     }
+
+    pending_input_events = 0;
 }
 
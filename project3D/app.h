@@ -7,15 +7,45 @@
 #include <dxgi1_6.h>
 #include <D3Dcompiler.h>
 #include <DirectXMath.h>
+#include <atomic>
+#include <coroutine>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <span>
 #include <string>
+#include <vector>
 #include <wrl.h>
 #include <shellapi.h>
 #include <wincodec.h>
-#include <queue>
 
 #include "d3dx12.h"
+#include "asset_package.h"
+#include "async_file_reader.h"
+#include "async_task.h"
 #include "common.h"
 #include "camera.h"
+#include "camera_path.h"
+#include "object_loader.h"
+#include "descriptor_allocator.h"
+#include "draw_batch.h"
+#include "file_watcher.h"
+#include "scene_graph.h"
+#include "spatial_index.h"
+#include "triangle_bvh.h"
+#include "character_controller.h"
+#include "lightmap_baker.h"
+#include "mesh_chunk.h"
+#include "occlusion_baker.h"
+#include "progressive_mesh_loader.h"
+#include "process_memory.h"
+#include "simulation_clock.h"
+#include "mouse_input.h"
+#include "frame_timing_log.h"
+#include "app_options.h"
+#include "gpu_profiler.h"
+#include "rolling_statistics.h"
+#include "world_streamer.h"
 
 template<class Interface>
 inline void SafeRelease(
@@ -28,7 +58,7 @@ inline void SafeRelease(
 
 class App {
 public:
-    explicit App(std::wstring name);
+    explicit App(std::wstring name, AppOptions options = {});
 
     ~App();
 
@@ -36,10 +66,22 @@ public:
 
     HRESULT Initialize(HINSTANCE instance, INT cmd_show);
 
+    // --pack: every file of the model directory into an asset package, without a window.
+    static HRESULT WriteAssetPackage(const std::wstring& path);
+    static HRESULT CookModel(const std::wstring& directory, unsigned budget_mib);
+    static HRESULT BuildAssets(const std::wstring& directory);
+
 private:
     static const UINT FRAME_COUNT = 2;
     static const UINT BITMAP_PIXEL_SIZE = 4;
-    std::string MODEL_URI = "assets\\model1";
+    static const UINT FRAME_STATISTICS_INTERVAL = 120;
+    static const UINT MAX_GPU_ZONES = 16;
+    static const UINT DESCRIPTOR_HEAP_SIZE = 4096;
+    static const UINT AO_TEXTURE_SIZE = 1024;
+    static const UINT MIN_PREVIEW_VERTICES = 3 * 65536;
+    static constexpr float BENCHMARK_TIMESTEP = 1.0f / 60.0f;
+    static constexpr float EYE_HEIGHT = 1.7f;
+    static constexpr const char* MODEL_URI = "assets\\model1";
 
     struct ConstantBuffer {
         DirectX::XMFLOAT4X4 mat_world_view_proj;
@@ -63,6 +105,7 @@ private:
     FLOAT aspect_ratio;
     bool use_warp_device;
     std::wstring title;
+    AppOptions options;
 
     // Pipeline objects
     CD3DX12_VIEWPORT viewport;
@@ -74,6 +117,7 @@ private:
     Microsoft::WRL::ComPtr<ID3D12CommandQueue> command_queue;
     Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> rtv_heap;
     Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> cbv_heap;
+    DescriptorAllocator descriptor_allocator{DESCRIPTOR_HEAP_SIZE};
     Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> dsv_heap;
     Microsoft::WRL::ComPtr<ID3D12PipelineState> pipeline_state;
     Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> command_list;
@@ -87,8 +131,126 @@ private:
     Microsoft::WRL::ComPtr<ID3D12Resource> constant_buffer;
     ConstantBuffer constant_buffer_data{};
     UINT8* constant_buffer_data_begin;
+    UINT constant_buffer_descriptor = DescriptorAllocator::INVALID_INDEX;
     Microsoft::WRL::ComPtr<ID3D12Resource> depth_buffer;
-    Microsoft::WRL::ComPtr<ID3D12Resource> texture;
+    std::vector<Microsoft::WRL::ComPtr<ID3D12Resource>> textures;
+    std::vector<UINT> texture_descriptors;
+    std::vector<DrawBatch> draw_batches;
+
+    // Per-submesh draws and their model space bounds, culled every frame into draw_batches
+    std::vector<DrawBatch> submesh_draws;
+    std::unique_ptr<SpatialIndex> submesh_index;
+    std::vector<SpatialIndex::ObjectId> visible_submeshes;
+    std::vector<bool> submesh_visible;
+
+    // --package: model and textures are read from it instead of loose files; the loaders point into it
+    AssetPackage package;
+
+    // Model being parsed in the background, its triangles so far are drawn from vertex_buffer
+    std::unique_ptr<ProgressiveMeshLoader> progressive_loader;
+    std::vector<Vertex> preview_batch;
+    UINT8* preview_data_begin = nullptr;
+    std::size_t preview_vertices = 0;
+    std::size_t preview_capacity = 0;
+
+    // Loose texture files are read through it while being decoded (see DecodeBitmapAsync), none with --package
+    std::unique_ptr<AsyncFileReader> file_reader;
+
+    // Uploads running next to the frames (see UploadTextureAsync) signal this fence on the command queue;
+    // the mutex keeps the values in the order they are signalled in, whichever thread uploads
+    Microsoft::WRL::ComPtr<ID3D12Fence> upload_fence;
+    std::mutex upload_fence_mutex;
+    UINT64 upload_fence_value = 0;
+
+    // co_await FenceAwaiter(...) suspends the coroutine until the fence reaches value
+    // and continues it as a task of the scheduler.
+    class FenceAwaiter {
+    public:
+        FenceAwaiter(ID3D12Fence* fence, UINT64 value, TaskScheduler& scheduler);
+
+        bool await_ready() const;
+        void await_suspend(std::coroutine_handle<> handle);
+        HRESULT await_resume();
+
+    private:
+        // Outlives the awaiter: shared by await_suspend and OnCompleted, freed by whichever is done with it last
+        struct Wait {
+            TaskScheduler& scheduler;
+            std::coroutine_handle<> handle;
+            HANDLE event = nullptr;
+            HANDLE wait_handle = nullptr;
+            std::atomic<int> users{2};
+        };
+
+        ID3D12Fence* fence;
+        UINT64 value;
+        TaskScheduler& scheduler;
+        HRESULT hr = S_OK;
+
+        static void CALLBACK OnCompleted(PVOID context, BOOLEAN timed_out);
+        static void Release(Wait* wait);
+    };
+
+    // Hot reload of the loose model files: a changed OBJ / MTL is parsed and built again (PrepareModel) on
+    // the loader thread behind the model on screen, a changed texture read, decoded and uploaded by a
+    // coroutine (ReloadTextureAsync), and either is swapped in at the start of a frame
+    struct DecodedBitmap {
+        HRESULT hr;
+        UINT width;
+        UINT height;
+        std::vector<BYTE> bits;
+    };
+
+    struct TextureReload {
+        std::size_t texture_index;
+        FileWatcher::Clock::time_point saved_time;
+        Microsoft::WRL::ComPtr<ID3D12Resource> texture;
+        HRESULT hr = S_OK;
+        std::atomic<bool> finished{false};
+    };
+
+    // What PrepareModel builds from a parsed model, ready to be swapped in by SwapInModel
+    struct PreparedModel {
+        std::size_t number_of_vertices = 0;
+        Microsoft::WRL::ComPtr<ID3D12Resource> vertex_buffer;
+        D3D12_VERTEX_BUFFER_VIEW vertex_buffer_view{};
+        std::vector<DrawBatch> submesh_draws;
+        std::unique_ptr<SpatialIndex> submesh_index;
+        TriangleBvh collision_bvh;
+        std::vector<float> texture_occlusion;
+        std::vector<std::wstring> texture_uris;
+
+        // Uploaded textures of texture_uris, none when the ones on screen are kept
+        std::vector<Microsoft::WRL::ComPtr<ID3D12Resource>> textures;
+        bool keep_textures = false;
+    };
+
+    std::unique_ptr<FileWatcher> asset_watcher;
+
+    // Filled on the loader thread, so it has to outlive reload_loader
+    std::unique_ptr<PreparedModel> reload_model;
+    std::unique_ptr<ProgressiveMeshLoader> reload_loader;
+    FileWatcher::Clock::time_point reload_saved_time;
+    std::vector<std::unique_ptr<TextureReload>> texture_reloads;
+
+    // --world: chunks cooked by --cook, streamed in around the camera instead of the model. The loader
+    // threads read mesh, WorldStreamer::update uploads it into vertex_buffer on the main thread.
+    struct WorldChunk {
+        std::filesystem::path path;
+        MeshChunk mesh;
+        Microsoft::WRL::ComPtr<ID3D12Resource> vertex_buffer;
+        D3D12_VERTEX_BUFFER_VIEW vertex_buffer_view{};
+    };
+
+    std::vector<WorldChunk> world_chunks;
+    std::unique_ptr<ThreadedChunkLoader> chunk_loader;
+    std::unique_ptr<WorldStreamer> world_streamer;
+    std::vector<ChunkId> visible_chunks;
+    double streamed_time = 0.0;
+
+    // Files of textures[1..], and the occlusion they were multiplied by (--ao-texture)
+    std::vector<std::wstring> loaded_texture_uris;
+    std::vector<float> texture_occlusion;
 
     // Synchronization objects
     UINT frame_index;
@@ -96,6 +258,17 @@ private:
     Microsoft::WRL::ComPtr<ID3D12Fence> fence;
     UINT64 fence_value{};
 
+    // Frame timings (ms)
+    GpuProfiler gpu_profiler;
+    RollingStatistics frame_statistics;
+    RollingStatistics update_statistics;
+    RollingStatistics record_statistics;
+    RollingStatistics present_statistics;
+    RollingStatistics fence_wait_statistics;
+    RollingStatistics cull_statistics;
+    RollingStatistics pick_statistics;
+    UINT frames_since_report = 0;
+
     static LRESULT CALLBACK WindowProc(
             HWND hwnd,
             UINT msg,
@@ -111,31 +284,105 @@ private:
 
     HRESULT LoadPipeline();
     HRESULT LoadAssets();
+    HRESULT LoadModel(ObjectLoader& object_loader);
+    HRESULT PrepareModel(ObjectLoader& object_loader, PreparedModel& model, const std::vector<std::wstring>& kept_texture_uris);
+    HRESULT SwapInModel(PreparedModel& model);
+    HRESULT LoadWorld();
+    HRESULT UploadChunk(ChunkId chunk);
+    void EvictChunk(ChunkId chunk);
+    HRESULT UpdateProgressiveLoad();
+    HRESULT CreateTexture(
+            const BYTE* bits,
+            UINT bitmap_width,
+            UINT bitmap_height,
+            std::vector<Microsoft::WRL::ComPtr<ID3D12Resource>>& upload_buffers
+    );
+    HRESULT RecordTextureUpload(
+            ID3D12GraphicsCommandList* list,
+            const BYTE* bits,
+            UINT bitmap_width,
+            UINT bitmap_height,
+            Microsoft::WRL::ComPtr<ID3D12Resource>& texture,
+            Microsoft::WRL::ComPtr<ID3D12Resource>& upload_buffer
+    );
+    void CreateTextureView(ID3D12Resource* texture, UINT descriptor);
+    Task<HRESULT> UploadTextureAsync(DecodedBitmap bitmap, Microsoft::WRL::ComPtr<ID3D12Resource>& texture);
+    void BakeLightmap(const std::vector<Vertex>& vertices, const TriangleBvh& bvh,
+                      std::vector<std::uint8_t>& bitmap, UINT& bitmap_width, UINT& bitmap_height);
+    void BakeOcclusion(std::vector<Vertex>& vertices, const TriangleBvh& bvh, std::vector<float>& texture_occlusion);
+    D3D12_CPU_DESCRIPTOR_HANDLE GetCpuDescriptorHandle(UINT descriptor);
+    D3D12_GPU_DESCRIPTOR_HANDLE GetGpuDescriptorHandle(UINT descriptor);
+    void CreateDrawBatches(const ObjectLoader& object_loader, PreparedModel& model);
+    void CullSubmeshes(const DirectX::XMMATRIX& world_view_proj);
+    void CullChunks(const DirectX::XMMATRIX& world_view_proj);
+    void PickAtScreenCenter(const Camera& view_camera);
+    void Measure();
     HRESULT PopulateCommandList();
     HRESULT WaitForPreviousFrame();
     HRESULT OnInit();
     HRESULT OnUpdate();
     HRESULT OnRender();
     HRESULT OnDestroy();
-    HRESULT LoadBitmapFromFile(PCWSTR uri, UINT &width, UINT &height, BYTE **bits);
+    HRESULT LoadBitmapFromFile(IWICImagingFactory* factory, PCWSTR uri, UINT &width, UINT &height, BYTE **bits);
+    HRESULT LoadBitmapFromMemory(IWICImagingFactory* factory, std::span<const std::uint8_t> contents, UINT &width, UINT &height, BYTE **bits);
+    HRESULT DecodeBitmapFrame(IWICImagingFactory* factory, IWICBitmapDecoder* decoder, UINT &width, UINT &height, BYTE **bits);
+    DecodedBitmap DecodeBitmap(const std::wstring& uri, std::span<const std::uint8_t> contents = {});
+    Task<DecodedBitmap> DecodeBitmapAsync(std::wstring uri);
+    Task<HRESULT> ReloadTextureAsync(TextureReload& reload, std::wstring uri, std::vector<float> occlusion);
+    void ReleaseModelTextures();
+    HRESULT ReplaceTexture(std::size_t index, ID3D12Resource* texture);
+    HRESULT UpdateHotReload();
+    void ReportFrameStatistics();
+    HRESULT LoadCameraPaths();
+    void BenchmarkFrame();
+    HRESULT FinishBenchmark();
+    HRESULT WriteTimingLog(const FrameTimingLog& log, std::filesystem::path output_path);
 
     void OnKeyDown(UINT8 key);
     void OnKeyUp(UINT8 key);
-    void ProcessMove();
+    void ProcessMove(float delta_time);
+    void SetWalkMode(bool enabled);
+    void ProcessMouse();
+    void RecordInputLatency();
 
-    std::queue<std::pair<LONG, LONG>> mouse_position_queue;
+    MouseInput mouse_input;
+
+    // Input latency (ms) of frames that applied mouse input, from the oldest event to Present returning
+    RollingStatistics input_latency_statistics;
+    FrameTimingLog latency_log{{"input_events", "input_to_update_ms", "input_to_present_ms"}};
+    UINT pending_input_events = 0;
+    std::uint64_t pending_input_timestamp = 0;
+    double input_to_update_ms = 0.0;
     bool mouse_pressed = false;
     Keyboard keyboard;
     bool post_quit = false;
 
     Camera camera;
 
-    std::vector<Vertex> object;
-    std::size_t number_of_vertices{};
+    // Walk mode: the camera follows a capsule colliding with the model, at eye height above its feet
+    TriangleBvh collision_bvh;
+    std::unique_ptr<CharacterController> walker;
+    bool walk_mode = false;
 
-    UINT bitmap_width = 0;
-    UINT bitmap_height = 0;
-    BYTE* bitmap = nullptr;
+    // Surface under the screen center, picked every frame against the same hierarchy (object = submesh)
+    RayHit hover_hit{};
+    bool hover_valid = false;
+    UINT shown_submesh = TriangleBvh::NO_OBJECT;
+    DirectX::XMFLOAT3 measure_start{};
+    bool measure_started = false;
+
+    SceneGraph scene;
+    SceneGraph::NodeId model_node = SceneGraph::INVALID_NODE;
+    SimulationClock simulation_clock;
+    CameraPose previous_camera_pose{};
+
+    // Camera path replay / recording
+    CameraPath benchmark_path;
+    bool benchmark_finished = false;
+    FrameTimingLog benchmark_log{{"frame_ms", "update_ms", "cull_ms", "record_ms", "present_ms", "fence_wait_ms", "gpu_ms", "visible_submeshes", "draw_calls"}};
+    CameraPath recorded_path;
+
+    std::size_t number_of_vertices{};
 
     static constexpr DirectX::XMFLOAT4 background_color = { 0.15f, 0.56f, 0.96f, 1.0f };
     static constexpr DirectX::XMFLOAT4 color = { 1.0f, 1.0f, 1.0f, 1.0f };
@@ -0,0 +1,82 @@
+#include "app_options.h"
+
+#include <windows.h>
+#include <shellapi.h>
+#include <cwchar>
+
+AppOptions ParseAppOptions(const wchar_t* cmd_line) {
+    AppOptions options;
+
+    // CommandLineToArgvW returns the executable path for an empty string.
+    if (cmd_line == nullptr || *cmd_line == L'\0') {
+        return options;
+    }
+
+    int argc = 0;
+    LPWSTR* argv = CommandLineToArgvW(cmd_line, &argc);
+
+    if (argv == nullptr) {
+        return options;
+    }
+
+    for (int i = 0; i < argc; i++) {
+        std::wstring arg = argv[i];
+
+        if (arg == L"--trace" && i + 1 < argc) {
+            options.trace_path = argv[++i];
+        }
+        else if (arg == L"--record" && i + 1 < argc) {
+            options.record_path = argv[++i];
+        }
+        else if (arg == L"--benchmark") {
+            options.benchmark = true;
+
+            if (i + 1 < argc && argv[i + 1][0] != L'-') {
+                options.benchmark_path = argv[++i];
+            }
+        }
+        else if (arg == L"--benchmark-output" && i + 1 < argc) {
+            options.benchmark_output = argv[++i];
+        }
+        else if (arg == L"--latency-output" && i + 1 < argc) {
+            options.latency_output = argv[++i];
+        }
+        else if (arg == L"--bake" && i + 1 < argc) {
+            options.bake_passes = static_cast<unsigned>(std::wcstoul(argv[++i], nullptr, 10));
+        }
+        else if (arg == L"--ao" && i + 1 < argc) {
+            options.ao_rays = static_cast<unsigned>(std::wcstoul(argv[++i], nullptr, 10));
+        }
+        else if (arg == L"--ao-texture") {
+            options.ao_texture = true;
+        }
+        else if (arg == L"--no-progressive") {
+            options.progressive = false;
+        }
+        else if (arg == L"--no-hot-reload") {
+            options.hot_reload = false;
+        }
+        else if (arg == L"--package" && i + 1 < argc) {
+            options.package_path = argv[++i];
+        }
+        else if (arg == L"--pack" && i + 1 < argc) {
+            options.pack_path = argv[++i];
+        }
+        else if (arg == L"--cook" && i + 1 < argc) {
+            options.cook_path = argv[++i];
+        }
+        else if (arg == L"--cook-budget" && i + 1 < argc) {
+            options.cook_budget = static_cast<unsigned>(std::wcstoul(argv[++i], nullptr, 10));
+        }
+        else if (arg == L"--world" && i + 1 < argc) {
+            options.world_path = argv[++i];
+        }
+        else if (arg == L"--build-assets" && i + 1 < argc) {
+            options.build_path = argv[++i];
+        }
+    }
+
+    LocalFree(argv);
+
+    return options;
+}
@@ -0,0 +1,63 @@
+#ifndef PROJECT3D_APP_OPTIONS_H
+#define PROJECT3D_APP_OPTIONS_H
+
+#include <string>
+
+struct AppOptions {
+    // --trace <file>: Chrome trace of the whole run written on exit
+    std::wstring trace_path;
+
+    // --record <file>: camera path of the session saved on exit
+    std::wstring record_path;
+
+    // --benchmark [<file>]: replay a recorded camera path (or the built-in tour)
+    // with a fixed timestep and no input, then quit
+    bool benchmark = false;
+    std::wstring benchmark_path;
+
+    // --benchmark-output <file>: per-frame timings, the summary goes next to it
+    std::wstring benchmark_output = L"benchmark.csv";
+
+    // --latency-output <file>: input -> present latency of every frame that applied mouse input
+    std::wstring latency_output;
+
+    // --bake <passes>: textures of the model replaced by a lightmap baked at startup, passes paths per texel
+    unsigned bake_passes = 0;
+
+    // --ao <rays>: ambient occlusion baked at startup into the vertex colors, rays per distinct vertex
+    unsigned ao_rays = 0;
+
+    // --ao-texture: ambient occlusion baked into the textures of the model instead of the vertex colors
+    bool ao_texture = false;
+
+    // --no-progressive: the model is shown only once fully loaded, instead of as it is parsed
+    // (benchmarks always load it up front)
+    bool progressive = true;
+
+    // --no-hot-reload: changes of the model files are not picked up while running
+    // (never with --package or --benchmark)
+    bool hot_reload = true;
+
+    // --package <file>: model and textures read from an asset package instead of loose files
+    std::wstring package_path;
+
+    // --pack <file>: writes the model directory into an asset package and quits
+    std::wstring pack_path;
+
+    // --cook <directory>: cooks the model into compressed chunks without loading it whole and quits
+    std::wstring cook_path;
+
+    // --cook-budget <MiB>: memory the cooking may use
+    unsigned cook_budget = 2048;
+
+    // --world <directory>: chunks written by --cook streamed in around the camera instead of loading the model
+    std::wstring world_path;
+
+    // --build-assets <directory>: builds meshes, levels of detail, meshlets and compressed
+    // textures of the model directory, only what changed since the last build, and quits
+    std::wstring build_path;
+};
+
+AppOptions ParseAppOptions(const wchar_t* cmd_line);
+
+#endif //PROJECT3D_APP_OPTIONS_H
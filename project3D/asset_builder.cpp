@@ -0,0 +1,677 @@
+#include "asset_builder.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "common.h"
+#include "meshlet_builder.h"
+#include "mesh_simplifier.h"
+#include "object_loader.h"
+#include "task_scheduler.h"
+#include "texture_codec.h"
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+    // Part of every key; changing what a step produces has to bump it, so old results are not reused
+    constexpr int STEP_VERSION = 1;
+
+    constexpr std::uint32_t MESHLETS_MAGIC = 0x4C4D3350; // "P3ML"
+    constexpr std::uint32_t MESHLETS_VERSION = 1;
+
+    constexpr const char* MANIFEST_NAME = "manifest.txt";
+
+    constexpr std::uint64_t FNV_OFFSET = 0xCBF29CE484222325ull;
+    constexpr std::uint64_t FNV_PRIME = 0x100000001B3ull;
+
+    // FNV-1a over 8 byte words, the tail byte by byte, with a final mix. Fast enough that
+    // changed sources are hashed without notice; not meant to resist deliberate collisions.
+    std::uint64_t hash_bytes(const std::uint8_t* data, std::size_t size) {
+        std::uint64_t hash = FNV_OFFSET ^ size;
+        std::size_t i = 0;
+
+        for (; i + 8 <= size; i += 8) {
+            std::uint64_t word;
+            std::memcpy(&word, data + i, sizeof(word));
+            hash = (hash ^ word) * FNV_PRIME;
+        }
+
+        for (; i < size; i++) {
+            hash = (hash ^ data[i]) * FNV_PRIME;
+        }
+
+        hash ^= hash >> 33;
+        hash *= 0xFF51AFD7ED558CCDull;
+        hash ^= hash >> 33;
+        hash *= 0xC4CEB9FE1A85EC53ull;
+        return hash ^ (hash >> 33);
+    }
+
+    std::string to_hex(std::uint64_t value) {
+        char text[17];
+        std::snprintf(text, sizeof(text), "%016llx", static_cast<unsigned long long>(value));
+        return text;
+    }
+
+    bool read_file(const std::filesystem::path& path, std::vector<std::uint8_t>& data) {
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+
+        if (!file.is_open()) {
+            return false;
+        }
+
+        data.resize(static_cast<std::size_t>(file.tellg()));
+        file.seekg(0);
+        file.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(data.size()));
+        return file.good() || data.empty();
+    }
+
+    // Through a temporary file renamed over the path, so readers (and a build that was
+    // interrupted) never see half of it.
+    bool write_file(const std::filesystem::path& path, const std::vector<std::uint8_t>& data) {
+        static std::atomic<std::uint64_t> temporary_files{0};
+
+        std::filesystem::path temporary = path;
+        temporary += ".tmp" + std::to_string(temporary_files.fetch_add(1, std::memory_order_relaxed));
+
+        std::error_code error;
+        std::filesystem::create_directories(path.parent_path(), error);
+
+        {
+            std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+            file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+
+            if (!file.good()) {
+                file.close();
+                std::filesystem::remove(temporary, error);
+                return false;
+            }
+        }
+
+        std::filesystem::rename(temporary, path, error);
+
+        if (error) {
+            std::filesystem::remove(temporary, error);
+            return false;
+        }
+
+        return true;
+    }
+
+    bool is_inside(const std::filesystem::path& path, const std::filesystem::path& directory) {
+        std::filesystem::path relative = path.lexically_relative(directory);
+        return !relative.empty() && *relative.begin() != "..";
+    }
+
+    template <typename T>
+    void append(std::vector<std::uint8_t>& out, const T& value) {
+        auto bytes = reinterpret_cast<const std::uint8_t*>(&value);
+        out.insert(out.end(), bytes, bytes + sizeof(T));
+    }
+
+    template <typename T>
+    void append(std::vector<std::uint8_t>& out, const std::vector<T>& values) {
+        auto bytes = reinterpret_cast<const std::uint8_t*>(values.data());
+        out.insert(out.end(), bytes, bytes + values.size() * sizeof(T));
+    }
+
+    struct SourceRecord {
+        std::uint64_t size = 0;
+        std::int64_t time = 0;
+        std::uint64_t hash = 0;
+    };
+
+    // Hashes of the sources and keys of the outputs of the last build, by path relative to
+    // the source / output directory. One line each: "s <hash> <size> <time> <path>" or
+    // "o <key> <path>".
+    struct Manifest {
+        std::unordered_map<std::string, SourceRecord> sources;
+        std::unordered_map<std::string, std::uint64_t> outputs;
+
+        void load(const std::filesystem::path& path) {
+            std::ifstream file(path);
+            std::string line;
+
+            while (std::getline(file, line)) {
+                std::istringstream stream(line);
+                std::string tag;
+                std::string name;
+                stream >> tag;
+
+                if (tag == "s") {
+                    SourceRecord record;
+                    stream >> std::hex >> record.hash >> std::dec >> record.size >> record.time;
+                    stream.get();
+
+                    if (stream && std::getline(stream, name)) {
+                        sources[name] = record;
+                    }
+                }
+                else if (tag == "o") {
+                    std::uint64_t key = 0;
+                    stream >> std::hex >> key;
+                    stream.get();
+
+                    if (stream && std::getline(stream, name)) {
+                        outputs[name] = key;
+                    }
+                }
+            }
+        }
+
+        bool save(const std::filesystem::path& path) const {
+            std::string text;
+
+            for (const auto& [name, record] : sources) {
+                text += "s " + to_hex(record.hash) + " " + std::to_string(record.size) + " " + std::to_string(record.time) + " " + name + "\n";
+            }
+
+            for (const auto& [name, key] : outputs) {
+                text += "o " + to_hex(key) + " " + name + "\n";
+            }
+
+            return write_file(path, std::vector<std::uint8_t>(text.begin(), text.end()));
+        }
+    };
+
+    struct BuildStep {
+        // Source files have no run, their key is the hash of their contents
+        std::filesystem::path source;
+        std::string source_name;
+
+        std::string name;
+        std::string parameters;
+        std::vector<BuildStep*> inputs;
+
+        // Gives the result for the inputs, whose contents read_input returns
+        std::function<HRESULT(const BuildStep& step, std::vector<std::uint8_t>& result)> run;
+
+        // Relative to the output directory, empty for intermediate results
+        std::string output_name;
+
+        std::uint64_t key = 0;
+        HRESULT hr = S_OK;
+    };
+
+    struct BuildState {
+        std::filesystem::path cache_directory;
+        std::filesystem::path output_directory;
+
+        std::mutex mutex;
+        Manifest old_manifest;
+        Manifest manifest;
+
+        std::atomic<std::uint64_t> hashed_sources{0};
+        std::atomic<std::uint64_t> built_steps{0};
+        std::atomic<std::uint64_t> cached_steps{0};
+        std::atomic<std::uint64_t> failed_steps{0};
+        std::atomic<std::uint64_t> written_outputs{0};
+
+        std::filesystem::path get_cache_path(std::uint64_t key) const {
+            return cache_directory / to_hex(key);
+        }
+    };
+
+    HRESULT read_input(const BuildState& state, const BuildStep& input, std::vector<std::uint8_t>& data) {
+        const std::filesystem::path& path = input.run ? state.get_cache_path(input.key) : input.source;
+        return read_file(path, data) ? S_OK : E_FAIL;
+    }
+
+    void hash_source(BuildState& state, BuildStep& step) {
+        std::error_code error;
+        std::uint64_t size = std::filesystem::file_size(step.source, error);
+        std::int64_t time = error ? 0 : static_cast<std::int64_t>(std::filesystem::last_write_time(step.source, error).time_since_epoch().count());
+
+        if (error) {
+            step.hr = E_FAIL;
+            return;
+        }
+
+        {
+            std::lock_guard lock(state.mutex);
+            auto it = state.old_manifest.sources.find(step.source_name);
+
+            if (it != state.old_manifest.sources.end() && it->second.size == size && it->second.time == time) {
+                step.key = it->second.hash;
+                state.manifest.sources[step.source_name] = it->second;
+                return;
+            }
+        }
+
+        std::vector<std::uint8_t> data;
+
+        if (!read_file(step.source, data)) {
+            step.hr = E_FAIL;
+            return;
+        }
+
+        step.key = hash_bytes(data.data(), data.size());
+        state.hashed_sources.fetch_add(1, std::memory_order_relaxed);
+
+        std::lock_guard lock(state.mutex);
+        state.manifest.sources[step.source_name] = {size, time, step.key};
+    }
+
+    bool write_output(BuildState& state, const BuildStep& step) {
+        std::filesystem::path path = state.output_directory / std::filesystem::path(step.output_name);
+        bool up_to_date;
+
+        {
+            std::lock_guard lock(state.mutex);
+            auto it = state.old_manifest.outputs.find(step.output_name);
+            up_to_date = it != state.old_manifest.outputs.end() && it->second == step.key;
+        }
+
+        std::error_code error;
+        bool exists = std::filesystem::exists(path, error);
+
+        if (error) {
+            return false;
+        }
+
+        if (!up_to_date || !exists) {
+            std::vector<std::uint8_t> data;
+
+            if (!read_file(state.get_cache_path(step.key), data) || !write_file(path, data)) {
+                return false;
+            }
+
+            state.written_outputs.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        std::lock_guard lock(state.mutex);
+        state.manifest.outputs[step.output_name] = step.key;
+        return true;
+    }
+
+    void run_step(BuildState& state, BuildStep& step) {
+        if (!step.run) {
+            hash_source(state, step);
+            return;
+        }
+
+        std::string description = step.name + "\n" + std::to_string(STEP_VERSION) + "\n" + step.parameters + "\n";
+
+        for (const BuildStep* input : step.inputs) {
+            if (FAILED(input->hr)) {
+                step.hr = E_ABORT;
+                state.failed_steps.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+
+            description += to_hex(input->key) + "\n";
+        }
+
+        step.key = hash_bytes(reinterpret_cast<const std::uint8_t*>(description.data()), description.size());
+        std::filesystem::path cache_path = state.get_cache_path(step.key);
+
+        std::error_code error;
+        bool cached = std::filesystem::exists(cache_path, error);
+
+        if (error) {
+            step.hr = E_FAIL;
+            state.failed_steps.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        if (cached) {
+            state.cached_steps.fetch_add(1, std::memory_order_relaxed);
+        }
+        else {
+            std::vector<std::uint8_t> result;
+            step.hr = step.run(step, result);
+
+            if (SUCCEEDED(step.hr) && !write_file(cache_path, result)) {
+                step.hr = E_FAIL;
+            }
+
+            if (FAILED(step.hr)) {
+                state.failed_steps.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+
+            state.built_steps.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        if (!step.output_name.empty() && !write_output(state, step)) {
+            step.hr = E_FAIL;
+            state.failed_steps.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    HRESULT decode_input_mesh(const BuildState& state, const BuildStep& input,
+                              std::vector<Vertex>& vertices, std::vector<std::uint32_t>& indices) {
+        std::vector<std::uint8_t> data;
+        HRESULT hr = read_input(state, input, data);
+        return SUCCEEDED(hr) ? decode_mesh(data.data(), data.size(), vertices, indices) : hr;
+    }
+
+    void serialize_meshlets(const Meshlets& meshlets, std::vector<std::uint8_t>& out) {
+        append(out, MESHLETS_MAGIC);
+        append(out, MESHLETS_VERSION);
+        append(out, static_cast<std::uint32_t>(meshlets.meshlets.size()));
+        append(out, static_cast<std::uint32_t>(meshlets.vertex_indices.size()));
+        append(out, static_cast<std::uint32_t>(meshlets.triangle_indices.size()));
+
+        for (const Meshlet& meshlet : meshlets.meshlets) {
+            append(out, meshlet.vertex_offset);
+            append(out, meshlet.vertex_count);
+            append(out, meshlet.triangle_offset);
+            append(out, meshlet.triangle_count);
+            append(out, meshlet.bounds.min);
+            append(out, meshlet.bounds.max);
+        }
+
+        append(out, meshlets.vertex_indices);
+        append(out, meshlets.triangle_indices);
+    }
+
+    // Number of levels, then the width, height and pixels of each
+    void serialize_mips(const std::vector<Image>& mips, std::vector<std::uint8_t>& out) {
+        append(out, static_cast<std::uint32_t>(mips.size()));
+
+        for (const Image& level : mips) {
+            append(out, level.width);
+            append(out, level.height);
+            append(out, level.pixels);
+        }
+    }
+
+    HRESULT deserialize_mips(const std::vector<std::uint8_t>& data, std::vector<Image>& mips) {
+        std::size_t position = 0;
+
+        auto read_u32 = [&](std::uint32_t& value) {
+            if (data.size() - position < sizeof(value)) {
+                return false;
+            }
+
+            std::memcpy(&value, data.data() + position, sizeof(value));
+            position += sizeof(value);
+            return true;
+        };
+
+        std::uint32_t levels = 0;
+
+        if (!read_u32(levels) || levels == 0) {
+            return E_FAIL;
+        }
+
+        mips.resize(levels);
+
+        for (Image& level : mips) {
+            if (!read_u32(level.width) || !read_u32(level.height)) {
+                return E_FAIL;
+            }
+
+            std::size_t size = static_cast<std::size_t>(level.width) * level.height * 4;
+
+            if (data.size() - position < size) {
+                return E_FAIL;
+            }
+
+            level.pixels.assign(data.begin() + static_cast<std::ptrdiff_t>(position),
+                                data.begin() + static_cast<std::ptrdiff_t>(position + size));
+            position += size;
+        }
+
+        return S_OK;
+    }
+}
+
+AssetBuilder::AssetBuilder(std::filesystem::path source_directory, std::filesystem::path output_directory)
+        : AssetBuilder(std::move(source_directory), std::move(output_directory), Options()) {}
+
+AssetBuilder::AssetBuilder(std::filesystem::path source_directory, std::filesystem::path output_directory, Options options)
+        : source_directory(std::move(source_directory)), output_directory(std::move(output_directory)), options(std::move(options)) {}
+
+HRESULT AssetBuilder::build(TaskScheduler& scheduler) {
+    auto start = Clock::now();
+    statistics = Statistics();
+
+    std::error_code error;
+    std::filesystem::path sources = std::filesystem::weakly_canonical(source_directory, error);
+
+    if (error || !std::filesystem::is_directory(sources, error)) {
+        return E_INVALIDARG;
+    }
+
+    BuildState state;
+    state.output_directory = std::filesystem::weakly_canonical(output_directory, error);
+    state.cache_directory = std::filesystem::weakly_canonical(
+            options.cache_directory.empty() ? output_directory / ".cache" : options.cache_directory, error);
+
+    if (!std::filesystem::create_directories(state.cache_directory, error) && error) {
+        return E_FAIL;
+    }
+
+    state.old_manifest.load(state.cache_directory / MANIFEST_NAME);
+
+    // Sorted, so the steps and the first reported failure do not depend on the order of the directory
+    std::vector<std::filesystem::path> files;
+
+    for (auto it = std::filesystem::recursive_directory_iterator(sources, std::filesystem::directory_options::skip_permission_denied, error);
+         !error && it != std::filesystem::recursive_directory_iterator(); it.increment(error)) {
+        const std::filesystem::path& path = it->path();
+
+        if (it->is_directory(error)) {
+            if (path == state.cache_directory || path == state.output_directory) {
+                it.disable_recursion_pending();
+            }
+        }
+        else if (!is_inside(path, state.cache_directory) && !is_inside(path, state.output_directory)) {
+            std::filesystem::path extension = path.extension();
+
+            if (extension == ".obj" || extension == ".png" || extension == ".mtl") {
+                files.push_back(path);
+            }
+        }
+    }
+
+    if (error) {
+        return E_FAIL;
+    }
+
+    std::sort(files.begin(), files.end());
+
+    std::vector<std::unique_ptr<BuildStep>> steps;
+    std::unordered_map<std::string, std::vector<BuildStep*>> libraries_of_directory;
+
+    auto add_step = [&steps](std::string name, std::string parameters, std::vector<BuildStep*> inputs, std::string output_name,
+                             std::function<HRESULT(const BuildStep&, std::vector<std::uint8_t>&)> run) {
+        auto step = std::make_unique<BuildStep>();
+        step->name = std::move(name);
+        step->parameters = std::move(parameters);
+        step->inputs = std::move(inputs);
+        step->output_name = std::move(output_name);
+        step->run = std::move(run);
+        steps.push_back(std::move(step));
+        return steps.back().get();
+    };
+
+    std::vector<BuildStep*> source_steps;
+
+    for (const auto& path : files) {
+        auto step = std::make_unique<BuildStep>();
+        step->source = path;
+        step->source_name = path.lexically_relative(sources).generic_string();
+        source_steps.push_back(step.get());
+
+        if (path.extension() == ".mtl") {
+            libraries_of_directory[path.parent_path().generic_string()].push_back(step.get());
+        }
+
+        steps.push_back(std::move(step));
+    }
+
+    const Options& build_options = options;
+    const BuildState& build_state = state;
+
+    char encode_parameters[64];
+    std::snprintf(encode_parameters, sizeof(encode_parameters), "bits %d %d %d", options.encode_options.position_bits,
+                  options.encode_options.texture_coordinate_bits, options.encode_options.normal_bits);
+
+    for (BuildStep* source : source_steps) {
+        std::filesystem::path relative = std::filesystem::path(source->source_name);
+        std::string stem = relative.parent_path().empty()
+                ? relative.stem().generic_string()
+                : (relative.parent_path() / relative.stem()).generic_string();
+
+        if (source->source.extension() == ".obj") {
+            std::vector<BuildStep*> inputs = {source};
+            const auto& libraries = libraries_of_directory[source->source.parent_path().generic_string()];
+            inputs.insert(inputs.end(), libraries.begin(), libraries.end());
+
+            char parameters[160];
+            std::snprintf(parameters, sizeof(parameters), "color %.9g %.9g %.9g %.9g %s", options.color.x, options.color.y,
+                          options.color.z, options.color.w, encode_parameters);
+
+            BuildStep* mesh = add_step("mesh", parameters, std::move(inputs), stem + ".mesh",
+                                       [&build_options](const BuildStep& step, std::vector<std::uint8_t>& result) {
+                std::filesystem::path uri = step.inputs[0]->source;
+                uri.replace_extension();
+                ObjectLoader loader(uri.string(), build_options.color);
+                HRESULT hr = loader.load();
+                return SUCCEEDED(hr) ? encode_mesh(loader.take_vertices(), result, build_options.encode_options) : hr;
+            });
+
+            for (unsigned level = 1; level <= options.lod_levels; level++) {
+                unsigned cells = std::max(options.lod_cells >> (level - 1), 1u);
+                std::snprintf(parameters, sizeof(parameters), "cells %u %s", cells, encode_parameters);
+
+                add_step("lod", parameters, {mesh}, stem + ".lod" + std::to_string(level) + ".mesh",
+                         [&build_options, &build_state, cells](const BuildStep& step, std::vector<std::uint8_t>& result) {
+                    std::vector<Vertex> vertices;
+                    std::vector<std::uint32_t> indices;
+                    HRESULT hr = decode_input_mesh(build_state, *step.inputs[0], vertices, indices);
+
+                    if (FAILED(hr)) {
+                        return hr;
+                    }
+
+                    std::vector<Vertex> simplified_vertices;
+                    std::vector<std::uint32_t> simplified_indices;
+                    simplify_mesh(vertices, indices, cells, simplified_vertices, simplified_indices);
+
+                    std::vector<Vertex> triangles;
+                    triangles.reserve(simplified_indices.size());
+
+                    for (std::uint32_t index : simplified_indices) {
+                        triangles.push_back(simplified_vertices[index]);
+                    }
+
+                    return encode_mesh(triangles, result, build_options.encode_options);
+                });
+            }
+
+            std::snprintf(parameters, sizeof(parameters), "limits %zu %zu", options.meshlet_vertices, options.meshlet_triangles);
+
+            add_step("meshlets", parameters, {mesh}, stem + ".meshlets",
+                     [&build_options, &build_state](const BuildStep& step, std::vector<std::uint8_t>& result) {
+                std::vector<Vertex> vertices;
+                std::vector<std::uint32_t> indices;
+                HRESULT hr = decode_input_mesh(build_state, *step.inputs[0], vertices, indices);
+
+                if (SUCCEEDED(hr)) {
+                    serialize_meshlets(build_meshlets(vertices, indices, build_options.meshlet_vertices, build_options.meshlet_triangles), result);
+                }
+
+                return hr;
+            });
+        }
+        else if (source->source.extension() == ".png") {
+            BuildStep* mips = add_step("mips", "box", {source}, "",
+                                       [&build_state](const BuildStep& step, std::vector<std::uint8_t>& result) {
+                std::vector<std::uint8_t> data;
+                Image image;
+                HRESULT hr = read_input(build_state, *step.inputs[0], data);
+
+                if (SUCCEEDED(hr)) {
+                    hr = decode_png(data.data(), data.size(), image);
+                }
+
+                if (SUCCEEDED(hr)) {
+                    serialize_mips(generate_mips(image), result);
+                }
+
+                return hr;
+            });
+
+            add_step("blocks", "bounding box", {mips}, stem + ".dds",
+                     [&build_state](const BuildStep& step, std::vector<std::uint8_t>& result) {
+                std::vector<std::uint8_t> data;
+                std::vector<Image> levels;
+                HRESULT hr = read_input(build_state, *step.inputs[0], data);
+
+                if (SUCCEEDED(hr)) {
+                    hr = deserialize_mips(data, levels);
+                }
+
+                if (SUCCEEDED(hr)) {
+                    result = write_dds(levels, choose_block_format(levels[0]));
+                }
+
+                return hr;
+            });
+        }
+    }
+
+    std::unordered_map<const BuildStep*, TaskGraph::NodeId> nodes;
+    TaskGraph graph;
+
+    for (const auto& step : steps) {
+        BuildStep* pointer = step.get();
+        nodes[pointer] = graph.add([&state, pointer] { run_step(state, *pointer); });
+
+        for (const BuildStep* input : pointer->inputs) {
+            graph.precede(nodes.at(input), nodes[pointer]);
+        }
+    }
+
+    graph.run(scheduler);
+
+    HRESULT hr = S_OK;
+
+    for (const auto& step : steps) {
+        if (step->run) {
+            statistics.steps++;
+        }
+        else {
+            statistics.sources++;
+        }
+
+        // A step that could not run because of another is not the cause
+        if (SUCCEEDED(hr) && FAILED(step->hr) && step->hr != E_ABORT) {
+            hr = step->hr;
+        }
+    }
+
+    if (!state.manifest.save(state.cache_directory / MANIFEST_NAME) && SUCCEEDED(hr)) {
+        hr = E_FAIL;
+    }
+
+    statistics.hashed_sources = state.hashed_sources.load();
+    statistics.built_steps = state.built_steps.load();
+    statistics.cached_steps = state.cached_steps.load();
+    statistics.failed_steps = state.failed_steps.load();
+    statistics.written_outputs = state.written_outputs.load();
+    statistics.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    return hr;
+}
+
+const AssetBuilder::Statistics& AssetBuilder::get_statistics() const {
+    return statistics;
+}
@@ -0,0 +1,85 @@
+#ifndef PROJECT3D_ASSET_BUILDER_H
+#define PROJECT3D_ASSET_BUILDER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <DirectXMath.h>
+
+#include "hresult.h"
+#include "mesh_codec.h"
+
+class TaskScheduler;
+
+// Incremental build of the assets of a directory (and its subdirectories)
+// into the output directory, keeping the relative paths:
+//  - every <name>.obj gives <name>.mesh, the vertices ObjectLoader loads
+//    compressed with encode_mesh, <name>.lod1.mesh ... simplified with
+//    simplify_mesh and <name>.meshlets (see build_meshlets) of the vertices
+//    decode_mesh gives for <name>.mesh. These hold only the geometry: the
+//    submeshes, materials and texture paths stay in the OBJ and MTL files,
+//  - every <name>.png gives <name>.dds, its mip chain compressed to BC1 or
+//    BC3 (see texture_codec.h).
+// Each step is a node of a TaskGraph, so independent ones run in parallel,
+// keyed by a hash of what it is built from (the contents of source files or
+// the keys of the steps before it) and of its parameters. Its result is kept
+// under that key in the cache directory, so a step only runs when something
+// it depends on changed, and outputs are only written when their key did.
+// Source files are hashed again only when their size or time of
+// modification changed, which a manifest in the cache directory remembers.
+// A model depends on every .mtl file in its directory. Nothing is ever
+// removed from the cache.
+//
+// <name>.meshlets holds a header (magic "P3ML", version, number of meshlets,
+// of vertex indices and of triangle indices as uint32), the meshlets (offsets
+// and counts as uint32, bounds as six floats) and both index arrays.
+class AssetBuilder {
+public:
+    struct Options {
+        // Empty for .cache in the output directory
+        std::filesystem::path cache_directory;
+
+        DirectX::XMFLOAT4 color = {1.0f, 1.0f, 1.0f, 1.0f};
+        MeshEncodeOptions encode_options;
+
+        // The first level has lod_cells cells along the longest side, every next one half as many
+        unsigned lod_levels = 3;
+        unsigned lod_cells = 64;
+
+        std::size_t meshlet_vertices = 64;
+        std::size_t meshlet_triangles = 124;
+    };
+
+    struct Statistics {
+        std::uint64_t sources = 0;
+
+        // Sources read because they were new or changed
+        std::uint64_t hashed_sources = 0;
+
+        // Steps that ran, were found in the cache and failed (or could not run
+        // because a step before them failed)
+        std::uint64_t steps = 0;
+        std::uint64_t built_steps = 0;
+        std::uint64_t cached_steps = 0;
+        std::uint64_t failed_steps = 0;
+
+        std::uint64_t written_outputs = 0;
+        double seconds = 0.0;
+    };
+
+    AssetBuilder(std::filesystem::path source_directory, std::filesystem::path output_directory);
+    AssetBuilder(std::filesystem::path source_directory, std::filesystem::path output_directory, Options options);
+
+    // Steps that do not depend on a failed one are built anyway; the first failure is returned.
+    HRESULT build(TaskScheduler& scheduler);
+
+    const Statistics& get_statistics() const;
+
+private:
+    const std::filesystem::path source_directory;
+    const std::filesystem::path output_directory;
+    const Options options;
+    Statistics statistics;
+};
+
+#endif //PROJECT3D_ASSET_BUILDER_H
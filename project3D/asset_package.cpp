@@ -0,0 +1,530 @@
+#include "asset_package.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    constexpr std::uint32_t PACKAGE_MAGIC = 0x50443350; // "P3DP"
+    constexpr std::uint32_t PACKAGE_VERSION = 1;
+
+    constexpr std::size_t MIN_MATCH = 4;
+    constexpr std::size_t MAX_OFFSET = 65535;
+    constexpr int HASH_BITS = 16;
+    constexpr std::uint32_t NO_POSITION = 0xFFFFFFFF;
+    constexpr std::size_t DECOMPRESS_SLACK = 16;
+
+    std::string normalize_name(std::string_view name) {
+        std::string normalized(name);
+        std::replace(normalized.begin(), normalized.end(), '\\', '/');
+        return normalized;
+    }
+
+    std::uint64_t align(std::uint64_t offset) {
+        return (offset + AssetPackageWriter::BLOB_ALIGNMENT - 1) / AssetPackageWriter::BLOB_ALIGNMENT * AssetPackageWriter::BLOB_ALIGNMENT;
+    }
+
+    std::uint32_t load_32(const std::uint8_t* data) {
+        std::uint32_t value;
+        std::memcpy(&value, data, sizeof(value));
+        return value;
+    }
+
+    // Lengths that do not fit in the 4 bits of the token continue in bytes of 255 and a last, smaller one.
+    void write_length(std::vector<std::uint8_t>& out, std::size_t length) {
+        for (; length >= 255; length -= 255) {
+            out.push_back(255);
+        }
+
+        out.push_back(static_cast<std::uint8_t>(length));
+    }
+
+    bool read_length(const std::uint8_t* in, std::size_t in_size, std::size_t& position, std::size_t& length) {
+        std::uint8_t byte = 255;
+
+        while (byte == 255) {
+            if (position == in_size) {
+                return false;
+            }
+
+            byte = in[position++];
+            length += byte;
+        }
+
+        return true;
+    }
+
+    // Sequences of a token (number of literals, match length - MIN_MATCH), the literals and a
+    // 16 bit offset back into the output; the last sequence has only literals.
+    void write_sequence(std::vector<std::uint8_t>& out, const std::uint8_t* literals, std::size_t number_of_literals,
+                        std::size_t offset, std::size_t match_length) {
+        std::size_t match_code = match_length == 0 ? 0 : match_length - MIN_MATCH;
+        out.push_back(static_cast<std::uint8_t>((std::min<std::size_t>(number_of_literals, 15) << 4) | std::min<std::size_t>(match_code, 15)));
+
+        if (number_of_literals >= 15) {
+            write_length(out, number_of_literals - 15);
+        }
+
+        out.insert(out.end(), literals, literals + number_of_literals);
+
+        if (match_length > 0) {
+            out.push_back(static_cast<std::uint8_t>(offset));
+            out.push_back(static_cast<std::uint8_t>(offset >> 8));
+
+            if (match_code >= 15) {
+                write_length(out, match_code - 15);
+            }
+        }
+    }
+
+    std::vector<std::uint8_t> compress(const std::vector<std::uint8_t>& in) {
+        std::vector<std::uint8_t> out;
+        std::vector<std::uint32_t> last_positions(std::size_t{1} << HASH_BITS, NO_POSITION);
+        out.reserve(in.size() / 2);
+        std::size_t anchor = 0;
+        std::size_t i = 0;
+
+        while (i + MIN_MATCH <= in.size()) {
+            std::uint32_t sequence = load_32(&in[i]);
+            std::uint32_t hash = (sequence * 2654435761u) >> (32 - HASH_BITS);
+            std::uint32_t candidate = last_positions[hash];
+            last_positions[hash] = static_cast<std::uint32_t>(i);
+
+            if (candidate == NO_POSITION || i - candidate > MAX_OFFSET || load_32(&in[candidate]) != sequence) {
+                i++;
+                continue;
+            }
+
+            std::size_t length = MIN_MATCH;
+
+            while (i + length < in.size() && in[candidate + length] == in[i + length]) {
+                length++;
+            }
+
+            write_sequence(out, &in[anchor], i - anchor, i - candidate, length);
+            i += length;
+            anchor = i;
+        }
+
+        write_sequence(out, in.data() + anchor, in.size() - anchor, 0, 0);
+        return out;
+    }
+
+    // out has to have DECOMPRESS_SLACK bytes past out_size, short literals and matches are copied
+    // in whole words and may write into them.
+    bool decompress(const std::uint8_t* in, std::size_t in_size, std::uint8_t* out, std::size_t out_size) {
+        std::size_t in_position = 0;
+        std::size_t out_position = 0;
+
+        while (in_position < in_size) {
+            std::uint8_t token = in[in_position++];
+            std::size_t number_of_literals = token >> 4;
+
+            if (number_of_literals == 15 && !read_length(in, in_size, in_position, number_of_literals)) {
+                return false;
+            }
+
+            if (number_of_literals > in_size - in_position || number_of_literals > out_size - out_position) {
+                return false;
+            }
+
+            if (number_of_literals <= 16 && in_size - in_position >= 16) {
+                std::memcpy(out + out_position, in + in_position, 16);
+            }
+            else {
+                std::memcpy(out + out_position, in + in_position, number_of_literals);
+            }
+
+            in_position += number_of_literals;
+            out_position += number_of_literals;
+
+            if (in_position == in_size) {
+                break;
+            }
+
+            if (in_size - in_position < 2) {
+                return false;
+            }
+
+            std::size_t offset = in[in_position] | (static_cast<std::size_t>(in[in_position + 1]) << 8);
+            std::size_t length = (token & 15) + MIN_MATCH;
+            in_position += 2;
+
+            if ((token & 15) == 15 && !read_length(in, in_size, in_position, length)) {
+                return false;
+            }
+
+            if (offset == 0 || offset > out_position || length > out_size - out_position) {
+                return false;
+            }
+
+            // Overlapping matches repeat the last offset bytes, so closer than a word they are copied byte by byte.
+            const std::uint8_t* source = out + out_position - offset;
+            std::uint8_t* destination = out + out_position;
+
+            if (offset >= 8) {
+                for (std::size_t k = 0; k < length; k += 8) {
+                    std::memcpy(destination + k, source + k, 8);
+                }
+            }
+            else {
+                for (std::size_t k = 0; k < length; k++) {
+                    destination[k] = source[k];
+                }
+            }
+
+            out_position += length;
+        }
+
+        return out_position == out_size;
+    }
+}
+
+struct AssetPackage::Header {
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint32_t number_of_entries;
+    std::uint32_t names_size;
+};
+
+// Sorted by name_hash; offsets are from the start of the file, names from the start of the names.
+struct AssetPackage::TableEntry {
+    std::uint64_t name_hash;
+    std::uint64_t offset;
+    std::uint64_t stored_size;
+    std::uint64_t size;
+    std::uint32_t name_offset;
+    std::uint32_t name_length;
+    std::uint32_t compression;
+    std::uint32_t reserved;
+};
+
+void AssetPackageWriter::add(std::string_view name, std::vector<std::uint8_t> data, AssetCompression compression) {
+    Entry entry = { normalize_name(name), {}, data.size(), AssetCompression::NONE };
+
+    if (compression == AssetCompression::LZ) {
+        std::vector<std::uint8_t> compressed = compress(data);
+
+        if (compressed.size() <= data.size() - data.size() / 8 && !data.empty()) {
+            entry.stored = std::move(compressed);
+            entry.compression = AssetCompression::LZ;
+        }
+    }
+
+    if (entry.compression == AssetCompression::NONE) {
+        entry.stored = std::move(data);
+    }
+
+    auto existing = std::find_if(entries.begin(), entries.end(), [&](const Entry& other) { return other.name == entry.name; });
+
+    if (existing != entries.end()) {
+        *existing = std::move(entry);
+    }
+    else {
+        entries.push_back(std::move(entry));
+    }
+}
+
+HRESULT AssetPackageWriter::add_file(std::string_view name, const std::filesystem::path& path, AssetCompression compression) {
+    std::ifstream file(path, std::ios::binary);
+
+    if (!file.is_open()) {
+        return E_FAIL;
+    }
+
+    std::vector<std::uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    if (file.bad()) {
+        return E_FAIL;
+    }
+
+    add(name, std::move(data), compression);
+    return S_OK;
+}
+
+HRESULT AssetPackageWriter::add_directory(const std::filesystem::path& directory, AssetCompression compression) {
+    std::error_code error;
+    std::filesystem::recursive_directory_iterator iterator(directory, error);
+    HRESULT hr = error ? E_FAIL : S_OK;
+
+    for (; SUCCEEDED(hr) && iterator != std::filesystem::recursive_directory_iterator(); iterator.increment(error)) {
+        if (iterator->is_regular_file()) {
+            hr = add_file(iterator->path().generic_string(), iterator->path(), compression);
+        }
+    }
+
+    return SUCCEEDED(hr) && error ? E_FAIL : hr;
+}
+
+HRESULT AssetPackageWriter::save(const std::filesystem::path& path) const {
+    std::vector<AssetPackage::TableEntry> table(entries.size());
+    std::vector<std::size_t> order(entries.size());
+    std::string names;
+
+    for (std::size_t i = 0; i < entries.size(); i++) {
+        order[i] = i;
+        table[i].name_hash = AssetPackage::hash_name(entries[i].name);
+    }
+
+    std::sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) { return table[a].name_hash < table[b].name_hash; });
+
+    std::vector<AssetPackage::TableEntry> sorted_table(entries.size());
+
+    for (std::size_t i = 0; i < order.size(); i++) {
+        const Entry& entry = entries[order[i]];
+        AssetPackage::TableEntry& table_entry = sorted_table[i];
+        table_entry = {};
+        table_entry.name_hash = table[order[i]].name_hash;
+        table_entry.stored_size = entry.stored.size();
+        table_entry.size = entry.size;
+        table_entry.name_offset = static_cast<std::uint32_t>(names.size());
+        table_entry.name_length = static_cast<std::uint32_t>(entry.name.size());
+        table_entry.compression = static_cast<std::uint32_t>(entry.compression);
+        names += entry.name;
+    }
+
+    AssetPackage::Header header = { PACKAGE_MAGIC, PACKAGE_VERSION, static_cast<std::uint32_t>(entries.size()), static_cast<std::uint32_t>(names.size()) };
+    std::uint64_t offset = align(sizeof(header) + sorted_table.size() * sizeof(AssetPackage::TableEntry) + names.size());
+
+    for (auto& table_entry : sorted_table) {
+        table_entry.offset = offset;
+        offset = align(offset + table_entry.stored_size);
+    }
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+
+    if (!file.is_open()) {
+        return E_FAIL;
+    }
+
+    const std::vector<char> padding(BLOB_ALIGNMENT, 0);
+    std::uint64_t written = sizeof(header) + sorted_table.size() * sizeof(AssetPackage::TableEntry) + names.size();
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(sorted_table.data()), static_cast<std::streamsize>(sorted_table.size() * sizeof(AssetPackage::TableEntry)));
+    file.write(names.data(), static_cast<std::streamsize>(names.size()));
+
+    for (std::size_t i = 0; i < order.size() && file.good(); i++) {
+        const std::vector<std::uint8_t>& stored = entries[order[i]].stored;
+        file.write(padding.data(), static_cast<std::streamsize>(sorted_table[i].offset - written));
+        file.write(reinterpret_cast<const char*>(stored.data()), static_cast<std::streamsize>(stored.size()));
+        written = sorted_table[i].offset + stored.size();
+    }
+
+    file.close();
+
+    return file.good() ? S_OK : E_FAIL;
+}
+
+AssetPackage::~AssetPackage() {
+    close();
+}
+
+HRESULT AssetPackage::open(const std::filesystem::path& path) {
+    close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+    if (file == INVALID_HANDLE_VALUE) {
+        return HRESULT_FROM_WIN32(GetLastError());
+    }
+
+    LARGE_INTEGER file_size = {};
+    HRESULT hr = GetFileSizeEx(file, &file_size) ? S_OK : HRESULT_FROM_WIN32(GetLastError());
+
+    if (SUCCEEDED(hr) && static_cast<std::uint64_t>(file_size.QuadPart) < sizeof(Header)) {
+        hr = E_FAIL;
+    }
+
+    if (SUCCEEDED(hr)) {
+        mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        hr = mapping != nullptr ? S_OK : HRESULT_FROM_WIN32(GetLastError());
+    }
+
+    CloseHandle(file);
+
+    if (SUCCEEDED(hr)) {
+        data = static_cast<const std::uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        hr = data != nullptr ? S_OK : HRESULT_FROM_WIN32(GetLastError());
+    }
+
+    if (FAILED(hr)) {
+        close();
+        return hr;
+    }
+
+    size = static_cast<std::size_t>(file_size.QuadPart);
+#else
+    int file = ::open(path.c_str(), O_RDONLY);
+
+    if (file < 0) {
+        return E_FAIL;
+    }
+
+    struct stat status = {};
+    HRESULT hr = fstat(file, &status) == 0 && static_cast<std::uint64_t>(status.st_size) >= sizeof(Header) ? S_OK : E_FAIL;
+
+    if (SUCCEEDED(hr)) {
+        void* view = mmap(nullptr, static_cast<std::size_t>(status.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+        hr = view != MAP_FAILED ? S_OK : E_FAIL;
+        data = SUCCEEDED(hr) ? static_cast<const std::uint8_t*>(view) : nullptr;
+        size = SUCCEEDED(hr) ? static_cast<std::size_t>(status.st_size) : 0;
+    }
+
+    ::close(file);
+
+    if (FAILED(hr)) {
+        return hr;
+    }
+#endif
+
+    Header header;
+    std::memcpy(&header, data, sizeof(header));
+    std::uint64_t table_end = sizeof(header) + static_cast<std::uint64_t>(header.number_of_entries) * sizeof(TableEntry);
+    bool valid = header.magic == PACKAGE_MAGIC && header.version == PACKAGE_VERSION && table_end + header.names_size <= size;
+
+    if (valid) {
+        table = reinterpret_cast<const TableEntry*>(data + sizeof(header));
+        number_of_entries = header.number_of_entries;
+        names = reinterpret_cast<const char*>(data + table_end);
+    }
+
+    // Everything get() relies on is checked once here, including that the names match their hashes
+    // and that compressed sizes are possible (a byte of LZ input gives at most 255 bytes).
+    for (std::size_t i = 0; valid && i < number_of_entries; i++) {
+        const TableEntry& entry = table[i];
+        valid = entry.offset % AssetPackageWriter::BLOB_ALIGNMENT == 0 && entry.offset >= table_end + header.names_size &&
+                entry.offset <= size && entry.stored_size <= size - entry.offset &&
+                static_cast<std::uint64_t>(entry.name_offset) + entry.name_length <= header.names_size &&
+                (i == 0 || table[i - 1].name_hash <= entry.name_hash) &&
+                hash_name(get_name(i)) == entry.name_hash &&
+                (entry.compression == static_cast<std::uint32_t>(AssetCompression::NONE) ? entry.size == entry.stored_size :
+                 entry.compression == static_cast<std::uint32_t>(AssetCompression::LZ) && entry.size / 256 <= entry.stored_size);
+    }
+
+    if (!valid) {
+        close();
+        return E_FAIL;
+    }
+
+    return S_OK;
+}
+
+void AssetPackage::close() {
+#ifdef _WIN32
+    if (data != nullptr) {
+        UnmapViewOfFile(data);
+    }
+
+    if (mapping != nullptr) {
+        CloseHandle(mapping);
+    }
+#else
+    if (data != nullptr) {
+        munmap(const_cast<std::uint8_t*>(data), size);
+    }
+#endif
+
+    data = nullptr;
+    size = 0;
+    table = nullptr;
+    number_of_entries = 0;
+    names = nullptr;
+    mapping = nullptr;
+}
+
+bool AssetPackage::is_open() const {
+    return data != nullptr;
+}
+
+bool AssetPackage::contains(std::string_view name) const {
+    return find(name) != nullptr;
+}
+
+std::size_t AssetPackage::get_number_of_entries() const {
+    return number_of_entries;
+}
+
+HRESULT AssetPackage::get(std::string_view name, std::span<const std::uint8_t>& entry_data, std::vector<std::uint8_t>& storage) const {
+    const TableEntry* entry = find(name);
+
+    if (entry == nullptr) {
+        entry_data = {};
+        return E_INVALIDARG;
+    }
+
+    std::span<const std::uint8_t> stored(data + entry->offset, static_cast<std::size_t>(entry->stored_size));
+
+    if (entry->compression == static_cast<std::uint32_t>(AssetCompression::NONE)) {
+        entry_data = stored;
+        return S_OK;
+    }
+
+    storage.resize(static_cast<std::size_t>(entry->size) + DECOMPRESS_SLACK);
+
+    if (!decompress(stored.data(), stored.size(), storage.data(), static_cast<std::size_t>(entry->size))) {
+        entry_data = {};
+        return E_FAIL;
+    }
+
+    entry_data = std::span<const std::uint8_t>(storage.data(), static_cast<std::size_t>(entry->size));
+    return S_OK;
+}
+
+std::string_view AssetPackage::get_name(std::size_t i) const {
+    return std::string_view(names + table[i].name_offset, table[i].name_length);
+}
+
+std::uint64_t AssetPackage::get_size(std::size_t i) const {
+    return table[i].size;
+}
+
+AssetCompression AssetPackage::get_compression(std::size_t i) const {
+    return static_cast<AssetCompression>(table[i].compression);
+}
+
+// 64 bit FNV-1a, with '\' hashed as '/'
+std::uint64_t AssetPackage::hash_name(std::string_view name) {
+    std::uint64_t hash = 14695981039346656037ull;
+
+    for (char c : name) {
+        hash ^= static_cast<std::uint8_t>(c == '\\' ? '/' : c);
+        hash *= 1099511628211ull;
+    }
+
+    return hash;
+}
+
+const AssetPackage::TableEntry* AssetPackage::find(std::string_view name) const {
+    std::uint64_t hash = hash_name(name);
+    const TableEntry* end = table + number_of_entries;
+    const TableEntry* entry = std::lower_bound(table, end, hash, [](const TableEntry& a, std::uint64_t b) { return a.name_hash < b; });
+
+    for (; entry != end && entry->name_hash == hash; entry++) {
+        std::string_view entry_name(names + entry->name_offset, entry->name_length);
+
+        if (entry_name.size() == name.size() &&
+            std::equal(name.begin(), name.end(), entry_name.begin(), [](char a, char b) { return (a == '\\' ? '/' : a) == b; })) {
+            return entry;
+        }
+    }
+
+    return nullptr;
+}
+
+AssetStreamBuffer::AssetStreamBuffer(std::span<const std::uint8_t> data) {
+    char* begin = const_cast<char*>(reinterpret_cast<const char*>(data.data()));
+    setg(begin, begin, begin + data.size());
+}
@@ -0,0 +1,106 @@
+#ifndef PROJECT3D_ASSET_PACKAGE_H
+#define PROJECT3D_ASSET_PACKAGE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "hresult.h"
+
+// Single file holding the assets of a scene, so that a scene is one open and
+// one mapping instead of hundreds of loose files. The file starts with a
+// table of contents sorted by the hash of the names, followed by the names
+// and the contents of the entries, each starting at a multiple of 64 KiB so
+// it can be mapped or read straight into aligned memory. Entries may be
+// compressed (LZ77, byte oriented) when that makes them at least 1/8 smaller.
+//
+// Names are paths relative to the working directory with '/' as separator;
+// '\' in names passed to either class is treated as '/'.
+enum class AssetCompression : std::uint32_t {
+    NONE = 0,
+    LZ = 1
+};
+
+class AssetPackageWriter {
+public:
+    static constexpr std::size_t BLOB_ALIGNMENT = std::size_t{64} << 10;
+
+    // A later entry with the same name replaces the earlier one.
+    void add(std::string_view name, std::vector<std::uint8_t> data, AssetCompression compression);
+    HRESULT add_file(std::string_view name, const std::filesystem::path& path, AssetCompression compression);
+
+    // Every regular file below directory, named by its path starting with directory as given.
+    HRESULT add_directory(const std::filesystem::path& directory, AssetCompression compression);
+
+    HRESULT save(const std::filesystem::path& path) const;
+
+private:
+    struct Entry {
+        std::string name;
+        std::vector<std::uint8_t> stored;
+        std::uint64_t size;
+        AssetCompression compression;
+    };
+
+    std::vector<Entry> entries;
+};
+
+// Read only view of a package file mapped into memory.
+class AssetPackage {
+public:
+    AssetPackage() = default;
+    ~AssetPackage();
+
+    AssetPackage(const AssetPackage&) = delete;
+    AssetPackage& operator=(const AssetPackage&) = delete;
+
+    // Maps the file and validates the table of contents; the entries themselves are not read.
+    HRESULT open(const std::filesystem::path& path);
+    void close();
+    bool is_open() const;
+
+    bool contains(std::string_view name) const;
+    std::size_t get_number_of_entries() const;
+
+    // Contents of an entry. For uncompressed entries data points into the mapping and stays valid
+    // until close(); compressed ones are decompressed into storage, which data then points to.
+    // E_INVALIDARG for names that are not in the package, E_FAIL for corrupt entries.
+    HRESULT get(std::string_view name, std::span<const std::uint8_t>& data, std::vector<std::uint8_t>& storage) const;
+
+    // Name, size and compression of the i-th entry, in table order.
+    std::string_view get_name(std::size_t i) const;
+    std::uint64_t get_size(std::size_t i) const;
+    AssetCompression get_compression(std::size_t i) const;
+
+    static std::uint64_t hash_name(std::string_view name);
+
+private:
+    friend class AssetPackageWriter;
+
+    struct Header;
+    struct TableEntry;
+
+    const std::uint8_t* data = nullptr;
+    std::size_t size = 0;
+    const TableEntry* table = nullptr;
+    std::size_t number_of_entries = 0;
+    const char* names = nullptr;
+
+    // Handle of the file mapping, Windows only
+    void* mapping = nullptr;
+
+    const TableEntry* find(std::string_view name) const;
+};
+
+// std::istream over bytes returned by AssetPackage::get, for parsers written against streams.
+class AssetStreamBuffer : public std::streambuf {
+public:
+    explicit AssetStreamBuffer(std::span<const std::uint8_t> data);
+};
+
+#endif //PROJECT3D_ASSET_PACKAGE_H
@@ -0,0 +1,550 @@
+#include "async_file_reader.h"
+
+#include <algorithm>
+#include <fstream>
+#include <new>
+#include <utility>
+
+#include "task_scheduler.h"
+
+#ifdef __linux__
+#include <atomic>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    constexpr std::size_t BUFFER_ALIGNMENT = 4096;
+
+#ifdef __linux__
+    // Operation a completion belongs to, in the low bits of its user_data (requests are 8 byte aligned).
+    constexpr std::uint64_t OPEN_OPERATION = 0;
+    constexpr std::uint64_t READ_OPERATION = 1;
+    constexpr std::uint64_t OPERATION_MASK = 7;
+
+    // Largest single read; longer files are read in several.
+    constexpr std::size_t MAX_READ_SIZE = std::size_t{1} << 30;
+
+    // Entries asked for from IORING_REGISTER_PROBE, the most the kernel fills in.
+    constexpr unsigned PROBE_OPERATIONS = 256;
+#endif
+}
+
+struct AsyncFileReader::Request {
+    std::filesystem::path path;
+    Callback callback;
+    FileData data;
+    int descriptor = -1;
+    std::size_t offset = 0;
+};
+
+#ifdef __linux__
+// The rings of an io_uring mapped into the process, driven without liburing.
+struct AsyncFileReader::Ring {
+    int descriptor = -1;
+    io_uring_params params = {};
+    void* sq_memory = MAP_FAILED;
+    std::size_t sq_memory_size = 0;
+    void* cq_memory = MAP_FAILED;
+    std::size_t cq_memory_size = 0;
+    io_uring_sqe* sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+    std::size_t sqes_size = 0;
+
+    unsigned* sq_head = nullptr;
+    unsigned* sq_tail = nullptr;
+    unsigned* sq_array = nullptr;
+    unsigned sq_mask = 0;
+    unsigned* cq_head = nullptr;
+    unsigned* cq_tail = nullptr;
+    io_uring_cqe* cqes = nullptr;
+    unsigned cq_mask = 0;
+
+    // Queued since the last enter()
+    unsigned unsubmitted = 0;
+
+    ~Ring() {
+        if (sqes != MAP_FAILED) {
+            munmap(sqes, sqes_size);
+        }
+
+        if (cq_memory != MAP_FAILED && cq_memory != sq_memory) {
+            munmap(cq_memory, cq_memory_size);
+        }
+
+        if (sq_memory != MAP_FAILED) {
+            munmap(sq_memory, sq_memory_size);
+        }
+
+        if (descriptor >= 0) {
+            close(descriptor);
+        }
+    }
+
+    bool create(unsigned entries) {
+        descriptor = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+
+        if (descriptor < 0) {
+            return false;
+        }
+
+        sq_memory_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cq_memory_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool single_mapping = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+
+        if (single_mapping) {
+            sq_memory_size = cq_memory_size = std::max(sq_memory_size, cq_memory_size);
+        }
+
+        sq_memory = mmap(nullptr, sq_memory_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, descriptor, IORING_OFF_SQ_RING);
+
+        if (sq_memory == MAP_FAILED) {
+            return false;
+        }
+
+        cq_memory = single_mapping ? sq_memory
+                                   : mmap(nullptr, cq_memory_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, descriptor, IORING_OFF_CQ_RING);
+        sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+        sqes = static_cast<io_uring_sqe*>(mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, descriptor, IORING_OFF_SQES));
+
+        if (cq_memory == MAP_FAILED || sqes == MAP_FAILED) {
+            return false;
+        }
+
+        auto* sq = static_cast<std::uint8_t*>(sq_memory);
+        auto* cq = static_cast<std::uint8_t*>(cq_memory);
+        sq_head = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+        sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        sq_mask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        cq_mask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+
+        return supports(IORING_OP_OPENAT) && supports(IORING_OP_READ);
+    }
+
+    // Both operations came with 5.6, as did the probe, so a failed probe means neither is there.
+    bool supports(unsigned opcode) const {
+        std::vector<std::uint8_t> memory(sizeof(io_uring_probe) + PROBE_OPERATIONS * sizeof(io_uring_probe_op));
+        auto* probe = reinterpret_cast<io_uring_probe*>(memory.data());
+
+        if (syscall(__NR_io_uring_register, descriptor, IORING_REGISTER_PROBE, probe, PROBE_OPERATIONS) != 0) {
+            return false;
+        }
+
+        return opcode < probe->ops_len && (probe->ops[opcode].flags & IO_URING_OP_SUPPORTED) != 0;
+    }
+
+    // Only this thread moves the tail; the kernel moves the head once it took the entries.
+    bool queue(const io_uring_sqe& sqe) {
+        unsigned tail = *sq_tail;
+
+        if (tail - std::atomic_ref<unsigned>(*sq_head).load(std::memory_order_acquire) >= params.sq_entries) {
+            return false;
+        }
+
+        unsigned index = tail & sq_mask;
+        sqes[index] = sqe;
+        sq_array[index] = index;
+        std::atomic_ref<unsigned>(*sq_tail).store(tail + 1, std::memory_order_release);
+        unsubmitted++;
+
+        return true;
+    }
+
+    // Submits what was queued and, with wait, blocks until at least one completion is there.
+    // Returns the number of submitted entries; whatever was not taken (interrupted wait,
+    // kernel short on memory) goes with the next call.
+    unsigned enter(bool wait) {
+        long submitted = syscall(__NR_io_uring_enter, descriptor, unsubmitted, wait ? 1u : 0u,
+                                 wait ? IORING_ENTER_GETEVENTS : 0u, nullptr, 0);
+
+        if (submitted < 0) {
+            return 0;
+        }
+
+        unsubmitted -= static_cast<unsigned>(submitted);
+        return static_cast<unsigned>(submitted);
+    }
+
+    bool next_completion(io_uring_cqe& cqe) {
+        unsigned head = *cq_head;
+
+        if (head == std::atomic_ref<unsigned>(*cq_tail).load(std::memory_order_acquire)) {
+            return false;
+        }
+
+        cqe = cqes[head & cq_mask];
+        std::atomic_ref<unsigned>(*cq_head).store(head + 1, std::memory_order_release);
+        return true;
+    }
+};
+#else
+struct AsyncFileReader::Ring {};
+#endif
+
+AsyncFileReader::FileData::~FileData() {
+    release();
+}
+
+AsyncFileReader::FileData::FileData(FileData&& other) noexcept {
+    *this = std::move(other);
+}
+
+AsyncFileReader::FileData& AsyncFileReader::FileData::operator=(FileData&& other) noexcept {
+    if (this != &other) {
+        release();
+        reader = std::exchange(other.reader, nullptr);
+        buffer = std::exchange(other.buffer, -1);
+        storage = std::move(other.storage);
+        data = std::exchange(other.data, nullptr);
+        size = std::exchange(other.size, 0);
+    }
+
+    return *this;
+}
+
+std::span<const std::uint8_t> AsyncFileReader::FileData::get() const {
+    return {data, size};
+}
+
+void AsyncFileReader::FileData::release() {
+    if (reader != nullptr && buffer >= 0) {
+        reader->release_buffer(buffer);
+    }
+
+    reader = nullptr;
+    buffer = -1;
+    std::vector<std::uint8_t>().swap(storage);
+    data = nullptr;
+    size = 0;
+}
+
+AsyncFileReader::ReadAwaiter::ReadAwaiter(AsyncFileReader& reader, std::filesystem::path path, TaskScheduler& scheduler)
+        : reader(reader), path(std::move(path)), scheduler(scheduler) {}
+
+bool AsyncFileReader::ReadAwaiter::await_ready() const noexcept {
+    return false;
+}
+
+void AsyncFileReader::ReadAwaiter::await_suspend(std::coroutine_handle<> handle) {
+    reader.read(std::move(path), [this, handle](HRESULT hr, FileData data) {
+        result.hr = hr;
+        result.data = std::move(data);
+        scheduler.spawn([handle] { handle.resume(); });
+    });
+}
+
+AsyncFileReader::ReadResult AsyncFileReader::ReadAwaiter::await_resume() {
+    return std::move(result);
+}
+
+AsyncFileReader::AsyncFileReader() : AsyncFileReader(Options()) {}
+
+AsyncFileReader::AsyncFileReader(Options options) : options(options) {
+    if (options.buffers > 0 && options.buffer_size > 0) {
+        buffer_memory = static_cast<std::uint8_t*>(::operator new(options.buffers * options.buffer_size, std::align_val_t{BUFFER_ALIGNMENT}));
+
+        for (int i = static_cast<int>(options.buffers) - 1; i >= 0; i--) {
+            free_buffers.push_back(i);
+        }
+    }
+
+#ifdef __linux__
+    auto created = std::make_unique<Ring>();
+
+    if (options.use_io_uring && created->create(std::max(options.queue_depth, 1u))) {
+        ring = std::move(created);
+        backend = Backend::IO_URING;
+
+        // Without registering (e.g. over RLIMIT_MEMLOCK) the buffers are read into with plain reads.
+        if (buffer_memory != nullptr) {
+            std::vector<iovec> vectors(options.buffers);
+
+            for (unsigned i = 0; i < options.buffers; i++) {
+                vectors[i] = {buffer_memory + i * options.buffer_size, options.buffer_size};
+            }
+
+            buffers_registered = syscall(__NR_io_uring_register, ring->descriptor, IORING_REGISTER_BUFFERS, vectors.data(), options.buffers) == 0;
+        }
+
+        threads.emplace_back(&AsyncFileReader::ring_main, this);
+        return;
+    }
+#endif
+
+    for (unsigned i = 0; i < std::max(options.pool_threads, 1u); i++) {
+        threads.emplace_back(&AsyncFileReader::pool_main, this);
+    }
+}
+
+AsyncFileReader::~AsyncFileReader() {
+    wait();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+
+    requests_available.notify_all();
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    ring.reset();
+
+    if (buffer_memory != nullptr) {
+        ::operator delete(buffer_memory, std::align_val_t{BUFFER_ALIGNMENT});
+    }
+}
+
+void AsyncFileReader::read(std::filesystem::path path, Callback callback) {
+    auto request = std::make_unique<Request>();
+    request->path = std::move(path);
+    request->callback = std::move(callback);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        requests.push_back(std::move(request));
+        unfinished_reads++;
+    }
+
+    requests_available.notify_one();
+}
+
+AsyncFileReader::ReadAwaiter AsyncFileReader::read(std::filesystem::path path, TaskScheduler& scheduler) {
+    return ReadAwaiter(*this, std::move(path), scheduler);
+}
+
+void AsyncFileReader::wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    reads_finished.wait(lock, [this] { return unfinished_reads == 0; });
+}
+
+AsyncFileReader::Backend AsyncFileReader::get_backend() const {
+    return backend;
+}
+
+AsyncFileReader::Statistics AsyncFileReader::get_statistics() const {
+    std::lock_guard<std::mutex> lock(const_cast<std::mutex&>(mutex));
+    return statistics;
+}
+
+void AsyncFileReader::ring_main() {
+#ifdef __linux__
+    std::deque<std::unique_ptr<Request>> waiting;
+    std::size_t in_flight = 0;
+
+    auto queue_read = [&](Request* request) {
+        std::size_t length = std::min(request->data.size - request->offset, MAX_READ_SIZE);
+        io_uring_sqe sqe = {};
+        sqe.opcode = request->data.buffer >= 0 && buffers_registered ? IORING_OP_READ_FIXED : IORING_OP_READ;
+        sqe.fd = request->descriptor;
+        sqe.addr = reinterpret_cast<std::uint64_t>(request->data.data + request->offset);
+        sqe.len = static_cast<std::uint32_t>(length);
+        sqe.off = request->offset;
+        sqe.buf_index = static_cast<std::uint16_t>(std::max(request->data.buffer, 0));
+        sqe.user_data = reinterpret_cast<std::uint64_t>(request) | READ_OPERATION;
+        return ring->queue(sqe);
+    };
+
+    auto complete = [&](Request* request, HRESULT hr) {
+        if (request->descriptor >= 0) {
+            close(request->descriptor);
+        }
+
+        in_flight--;
+        finish(std::unique_ptr<Request>(request), hr);
+    };
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+
+            // Sleeps only with nothing in flight; otherwise new requests are taken after the next completion.
+            if (in_flight == 0 && waiting.empty()) {
+                requests_available.wait(lock, [this] { return stopping || !requests.empty(); });
+            }
+
+            if (stopping && requests.empty() && in_flight == 0 && waiting.empty()) {
+                break;
+            }
+
+            std::move(requests.begin(), requests.end(), std::back_inserter(waiting));
+            requests.clear();
+        }
+
+        while (in_flight < std::max(options.queue_depth, 1u) && !waiting.empty()) {
+            Request* request = waiting.front().get();
+            io_uring_sqe sqe = {};
+            sqe.opcode = IORING_OP_OPENAT;
+            sqe.fd = AT_FDCWD;
+            sqe.addr = reinterpret_cast<std::uint64_t>(request->path.c_str());
+            sqe.open_flags = O_RDONLY | O_CLOEXEC;
+            sqe.user_data = reinterpret_cast<std::uint64_t>(request) | OPEN_OPERATION;
+
+            if (!ring->queue(sqe)) {
+                break;
+            }
+
+            waiting.front().release();
+            waiting.pop_front();
+            in_flight++;
+        }
+
+        unsigned queued = ring->unsubmitted;
+        unsigned submitted = ring->enter(in_flight > 0);
+
+        if (queued > 0) {
+            std::lock_guard<std::mutex> lock(mutex);
+            statistics.submit_calls++;
+            statistics.submitted_operations += static_cast<std::uint64_t>(submitted);
+            statistics.max_in_flight = std::max<std::uint64_t>(statistics.max_in_flight, in_flight);
+        }
+
+        io_uring_cqe cqe;
+
+        while (ring->next_completion(cqe)) {
+            auto* request = reinterpret_cast<Request*>(cqe.user_data & ~OPERATION_MASK);
+
+            if (cqe.res < 0) {
+                complete(request, E_FAIL);
+                continue;
+            }
+
+            if ((cqe.user_data & OPERATION_MASK) == OPEN_OPERATION) {
+                request->descriptor = cqe.res;
+                struct stat status = {};
+
+                if (fstat(request->descriptor, &status) != 0) {
+                    complete(request, E_FAIL);
+                    continue;
+                }
+
+                auto size = static_cast<std::size_t>(status.st_size);
+
+                if (!acquire_buffer(request->data, size)) {
+                    request->data.storage.resize(size);
+                    request->data.data = request->data.storage.data();
+                    request->data.size = size;
+                }
+            }
+            else if (cqe.res == 0) {
+                // The file got shorter since it was opened.
+                request->data.size = request->offset;
+            }
+            else {
+                request->offset += static_cast<std::size_t>(cqe.res);
+            }
+
+            if (request->offset >= request->data.size) {
+                complete(request, S_OK);
+            }
+            else if (!queue_read(request)) {
+                complete(request, E_FAIL);
+            }
+        }
+    }
+#endif
+}
+
+void AsyncFileReader::pool_main() {
+    while (true) {
+        std::unique_ptr<Request> request;
+
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            requests_available.wait(lock, [this] { return stopping || !requests.empty(); });
+
+            if (requests.empty()) {
+                return;
+            }
+
+            request = std::move(requests.front());
+            requests.pop_front();
+        }
+
+        HRESULT hr = read_blocking(*request);
+        finish(std::move(request), hr);
+    }
+}
+
+HRESULT AsyncFileReader::read_blocking(Request& request) {
+    std::ifstream file(request.path, std::ios::binary | std::ios::ate);
+    HRESULT hr = file.is_open() ? S_OK : E_FAIL;
+
+    if (SUCCEEDED(hr)) {
+        auto size = static_cast<std::size_t>(file.tellg());
+        file.seekg(0);
+
+        if (!acquire_buffer(request.data, size)) {
+            request.data.storage.resize(size);
+            request.data.data = request.data.storage.data();
+            request.data.size = size;
+        }
+
+        file.read(reinterpret_cast<char*>(request.data.data), static_cast<std::streamsize>(size));
+        hr = static_cast<std::size_t>(file.gcount()) == size ? S_OK : E_FAIL;
+    }
+
+    return hr;
+}
+
+void AsyncFileReader::finish(std::unique_ptr<Request> request, HRESULT hr) {
+    std::size_t size = request->data.size;
+
+    if (FAILED(hr)) {
+        request->data.release();
+    }
+
+    request->callback(hr, std::move(request->data));
+    request.reset();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        statistics.reads++;
+        statistics.failed_reads += FAILED(hr) ? 1 : 0;
+        statistics.bytes += SUCCEEDED(hr) ? size : 0;
+
+        if (--unfinished_reads > 0) {
+            return;
+        }
+    }
+
+    reads_finished.notify_all();
+}
+
+bool AsyncFileReader::acquire_buffer(FileData& data, std::size_t size) {
+    if (size > options.buffer_size) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (free_buffers.empty()) {
+        return false;
+    }
+
+    data.reader = this;
+    data.buffer = free_buffers.back();
+    data.data = buffer_memory + static_cast<std::size_t>(data.buffer) * options.buffer_size;
+    data.size = size;
+    free_buffers.pop_back();
+
+    statistics.buffered_reads++;
+    statistics.fixed_reads += buffers_registered ? 1 : 0;
+
+    return true;
+}
+
+void AsyncFileReader::release_buffer(int buffer) {
+    std::lock_guard<std::mutex> lock(mutex);
+    free_buffers.push_back(buffer);
+}
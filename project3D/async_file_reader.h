@@ -0,0 +1,170 @@
+#ifndef PROJECT3D_ASYNC_FILE_READER_H
+#define PROJECT3D_ASYNC_FILE_READER_H
+
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <vector>
+
+#include "hresult.h"
+
+class TaskScheduler;
+
+// Reads whole files in the background, many at a time, so a scene of many
+// meshes and textures keeps the disk queue deep instead of waiting for one
+// blocking read after another. On Linux a thread drives an io_uring: new
+// reads are batched into one submission with the completions reaped, every
+// file is opened and read through the ring, at most queue_depth at a time,
+// and reads into the preallocated buffers use their registered (fixed)
+// form. Elsewhere, or when the ring cannot be created or lacks the open and
+// read operations (kernels before 5.6, sandboxes), a pool of threads reads
+// with blocking calls.
+//
+// Files up to buffer_size go to one of the buffers while one is free, larger
+// ones (or when all are taken) to memory of their own. The callback of a read
+// runs on the reader's thread as soon as it completes and should hand the
+// data off (e.g. to a TaskScheduler job) rather than decode it there; the
+// FileData it gets keeps the buffer until it is destroyed.
+class AsyncFileReader {
+public:
+    enum class Backend {
+        IO_URING,
+        THREAD_POOL
+    };
+
+    struct Options {
+        // Reads in flight with io_uring, threads of the pool
+        unsigned queue_depth = 64;
+        unsigned pool_threads = 8;
+
+        std::size_t buffer_size = std::size_t{256} << 10;
+        unsigned buffers = 32;
+
+        bool use_io_uring = true;
+    };
+
+    struct Statistics {
+        std::uint64_t reads = 0;
+        std::uint64_t failed_reads = 0;
+        std::uint64_t bytes = 0;
+
+        // Reads that went to a buffer, registered ones with io_uring
+        std::uint64_t buffered_reads = 0;
+        std::uint64_t fixed_reads = 0;
+
+        // Calls into the kernel that submitted operations, and the operations
+        std::uint64_t submit_calls = 0;
+        std::uint64_t submitted_operations = 0;
+        std::uint64_t max_in_flight = 0;
+    };
+
+    // Contents of a read file. Gives its buffer back when destroyed, which
+    // has to happen before the reader is destroyed.
+    class FileData {
+    public:
+        FileData() = default;
+        ~FileData();
+
+        FileData(FileData&& other) noexcept;
+        FileData& operator=(FileData&& other) noexcept;
+
+        std::span<const std::uint8_t> get() const;
+
+    private:
+        friend class AsyncFileReader;
+
+        AsyncFileReader* reader = nullptr;
+        int buffer = -1;
+        std::vector<std::uint8_t> storage;
+        std::uint8_t* data = nullptr;
+        std::size_t size = 0;
+
+        void release();
+    };
+
+    // hr is E_FAIL when the file could not be opened or read.
+    using Callback = std::function<void(HRESULT hr, FileData data)>;
+
+    struct ReadResult {
+        HRESULT hr = E_FAIL;
+        FileData data;
+    };
+
+    // co_await read(path, scheduler) suspends the coroutine until the file is read and
+    // continues it as a task of the scheduler rather than on the reader's thread.
+    class ReadAwaiter {
+    public:
+        ReadAwaiter(AsyncFileReader& reader, std::filesystem::path path, TaskScheduler& scheduler);
+
+        bool await_ready() const noexcept;
+        void await_suspend(std::coroutine_handle<> handle);
+        ReadResult await_resume();
+
+    private:
+        AsyncFileReader& reader;
+        std::filesystem::path path;
+        TaskScheduler& scheduler;
+        ReadResult result;
+    };
+
+    AsyncFileReader();
+    explicit AsyncFileReader(Options options);
+
+    // Waits for the reads requested so far.
+    ~AsyncFileReader();
+
+    AsyncFileReader(const AsyncFileReader&) = delete;
+    AsyncFileReader& operator=(const AsyncFileReader&) = delete;
+
+    // May also be called from callbacks.
+    void read(std::filesystem::path path, Callback callback);
+    ReadAwaiter read(std::filesystem::path path, TaskScheduler& scheduler);
+
+    // Returns once every read requested so far has completed and its callback returned.
+    void wait();
+
+    Backend get_backend() const;
+    Statistics get_statistics() const;
+
+private:
+    struct Request;
+    struct Ring;
+
+    const Options options;
+    Backend backend = Backend::THREAD_POOL;
+
+    // buffers * buffer_size bytes, split into the buffers
+    std::uint8_t* buffer_memory = nullptr;
+    std::vector<int> free_buffers;
+    bool buffers_registered = false;
+
+    std::mutex mutex;
+    std::condition_variable requests_available;
+    std::condition_variable reads_finished;
+    std::deque<std::unique_ptr<Request>> requests;
+    std::size_t unfinished_reads = 0;
+    bool stopping = false;
+    Statistics statistics;
+
+    std::unique_ptr<Ring> ring;
+    std::vector<std::thread> threads;
+
+    void ring_main();
+    void pool_main();
+    HRESULT read_blocking(Request& request);
+    void finish(std::unique_ptr<Request> request, HRESULT hr);
+
+    // Takes a free buffer for a file of size bytes, false when it has to go elsewhere.
+    bool acquire_buffer(FileData& data, std::size_t size);
+    void release_buffer(int buffer);
+};
+
+#endif //PROJECT3D_ASYNC_FILE_READER_H
@@ -0,0 +1,17 @@
+#include "async_task.h"
+
+ScheduleAwaiter::ScheduleAwaiter(TaskScheduler& scheduler) : scheduler(scheduler) {}
+
+bool ScheduleAwaiter::await_ready() const noexcept {
+    return false;
+}
+
+void ScheduleAwaiter::await_suspend(std::coroutine_handle<> handle) {
+    scheduler.spawn([handle] { handle.resume(); });
+}
+
+void ScheduleAwaiter::await_resume() const noexcept {}
+
+ScheduleAwaiter schedule_on(TaskScheduler& scheduler) {
+    return ScheduleAwaiter(scheduler);
+}
@@ -0,0 +1,238 @@
+#ifndef PROJECT3D_ASYNC_TASK_H
+#define PROJECT3D_ASYNC_TASK_H
+
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "task_scheduler.h"
+
+// Result of a coroutine that another coroutine can co_await, so loading code
+// reads one step after another while it suspends on a file read
+// (AsyncFileReader::read), on work for the TaskScheduler (schedule_on) or on
+// the GPU, and hundreds of loads can be in flight without a thread each. A
+// Task starts when it is awaited (or passed to when_all or sync_wait) and
+// continues the awaiting coroutine on the thread it finished on. Errors are
+// returned as HRESULTs in T like everywhere else; an exception escaping the
+// coroutine terminates.
+template<class T>
+class Task {
+public:
+    struct promise_type {
+        std::optional<T> value;
+        std::coroutine_handle<> continuation = std::noop_coroutine();
+
+        Task get_return_object() noexcept {
+            return Task(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+
+        std::suspend_always initial_suspend() noexcept {
+            return {};
+        }
+
+        auto final_suspend() noexcept {
+            struct FinalAwaiter {
+                bool await_ready() noexcept {
+                    return false;
+                }
+
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> handle) noexcept {
+                    return handle.promise().continuation;
+                }
+
+                void await_resume() noexcept {}
+            };
+
+            return FinalAwaiter{};
+        }
+
+        template<class U>
+        void return_value(U&& result) {
+            value.emplace(std::forward<U>(result));
+        }
+
+        void unhandled_exception() noexcept {
+            std::terminate();
+        }
+    };
+
+    Task() = default;
+
+    Task(Task&& other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+
+    Task& operator=(Task&& other) noexcept {
+        if (this != &other) {
+            if (handle) {
+                handle.destroy();
+            }
+
+            handle = std::exchange(other.handle, nullptr);
+        }
+
+        return *this;
+    }
+
+    ~Task() {
+        if (handle) {
+            handle.destroy();
+        }
+    }
+
+    auto operator co_await() && noexcept {
+        struct Awaiter {
+            std::coroutine_handle<promise_type> handle;
+
+            bool await_ready() noexcept {
+                return false;
+            }
+
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+                handle.promise().continuation = awaiting;
+                return handle;
+            }
+
+            T await_resume() {
+                return std::move(*handle.promise().value);
+            }
+        };
+
+        return Awaiter{handle};
+    }
+
+private:
+    std::coroutine_handle<promise_type> handle;
+
+    explicit Task(std::coroutine_handle<promise_type> handle) : handle(handle) {}
+};
+
+// co_await schedule_on(scheduler) continues the coroutine as a task of the scheduler.
+class ScheduleAwaiter {
+public:
+    explicit ScheduleAwaiter(TaskScheduler& scheduler);
+
+    bool await_ready() const noexcept;
+    void await_suspend(std::coroutine_handle<> handle);
+    void await_resume() const noexcept;
+
+private:
+    TaskScheduler& scheduler;
+};
+
+ScheduleAwaiter schedule_on(TaskScheduler& scheduler);
+
+namespace async_task_detail {
+    // Starts right away and frees itself once it returns.
+    struct Detached {
+        struct promise_type {
+            Detached get_return_object() noexcept {
+                return {};
+            }
+
+            std::suspend_never initial_suspend() noexcept {
+                return {};
+            }
+
+            std::suspend_never final_suspend() noexcept {
+                return {};
+            }
+
+            void return_void() noexcept {}
+
+            void unhandled_exception() noexcept {
+                std::terminate();
+            }
+        };
+    };
+
+    // The last of the tasks (or the awaiting coroutine, when they all finished before it suspended) resumes it.
+    struct Join {
+        std::atomic<std::size_t> remaining{0};
+        std::coroutine_handle<> continuation;
+    };
+
+    template<class T>
+    Detached run_joined(Task<T> task, std::optional<T>& result, Join& join) {
+        result.emplace(co_await std::move(task));
+
+        if (join.remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            join.continuation.resume();
+        }
+    }
+
+    template<class T>
+    struct JoinAwaiter {
+        JoinAwaiter(std::vector<Task<T>>& tasks, std::vector<std::optional<T>>& results)
+                : tasks(tasks), results(results) {}
+
+        std::vector<Task<T>>& tasks;
+        std::vector<std::optional<T>>& results;
+        Join join;
+
+        bool await_ready() noexcept {
+            return tasks.empty();
+        }
+
+        bool await_suspend(std::coroutine_handle<> handle) {
+            join.remaining.store(tasks.size() + 1, std::memory_order_relaxed);
+            join.continuation = handle;
+
+            for (std::size_t i = 0; i < tasks.size(); i++) {
+                run_joined(std::move(tasks[i]), results[i], join);
+            }
+
+            return join.remaining.fetch_sub(1, std::memory_order_acq_rel) != 1;
+        }
+
+        void await_resume() noexcept {}
+    };
+
+    template<class T, class F>
+    Detached run_then(Task<T> task, F done) {
+        done(co_await std::move(task));
+    }
+
+    template<class T>
+    Detached run_signalled(Task<T> task, std::optional<T>& result, std::atomic<bool>& done) {
+        result.emplace(co_await std::move(task));
+        done.store(true, std::memory_order_release);
+    }
+}
+
+// Runs the tasks concurrently; the results are in the order of the tasks.
+template<class T>
+Task<std::vector<T>> when_all(std::vector<Task<T>> tasks) {
+    std::vector<std::optional<T>> results(tasks.size());
+    co_await async_task_detail::JoinAwaiter<T>(tasks, results);
+
+    std::vector<T> values;
+    values.reserve(results.size());
+
+    for (auto& result : results) {
+        values.push_back(std::move(*result));
+    }
+
+    co_return values;
+}
+
+// Starts the task without waiting for it; done(result) is called on the thread it finished on.
+template<class T, class F>
+void start(Task<T> task, F done) {
+    async_task_detail::run_then(std::move(task), std::move(done));
+}
+
+// Runs the task from code that is not a coroutine and returns its result. The calling
+// thread runs tasks of the scheduler in the meantime (see TaskScheduler::wait_until).
+template<class T>
+T sync_wait(Task<T> task, TaskScheduler& scheduler) {
+    std::optional<T> result;
+    std::atomic<bool> done{false};
+    async_task_detail::run_signalled(std::move(task), result, done);
+    scheduler.wait_until([&done] { return done.load(std::memory_order_acquire); });
+    return std::move(*result);
+}
+
+#endif //PROJECT3D_ASYNC_TASK_H
@@ -0,0 +1,137 @@
+#include "bounds.h"
+
+#include <algorithm>
+#include <cmath>
+
+Aabb Aabb::from_center_extents(DirectX::XMFLOAT3 center, DirectX::XMFLOAT3 extents) {
+    return {
+            { center.x - extents.x, center.y - extents.y, center.z - extents.z },
+            { center.x + extents.x, center.y + extents.y, center.z + extents.z }
+    };
+}
+
+bool Aabb::empty() const {
+    return min.x > max.x || min.y > max.y || min.z > max.z;
+}
+
+void Aabb::merge(DirectX::XMFLOAT3 point) {
+    min = { std::min(min.x, point.x), std::min(min.y, point.y), std::min(min.z, point.z) };
+    max = { std::max(max.x, point.x), std::max(max.y, point.y), std::max(max.z, point.z) };
+}
+
+void Aabb::merge(const Aabb& other) {
+    if (!other.empty()) {
+        merge(other.min);
+        merge(other.max);
+    }
+}
+
+DirectX::XMFLOAT3 Aabb::get_center() const {
+    return { (min.x + max.x) * 0.5f, (min.y + max.y) * 0.5f, (min.z + max.z) * 0.5f };
+}
+
+DirectX::XMFLOAT3 Aabb::get_extents() const {
+    return { (max.x - min.x) * 0.5f, (max.y - min.y) * 0.5f, (max.z - min.z) * 0.5f };
+}
+
+bool Aabb::intersects(const Aabb& other) const {
+    return min.x <= other.max.x && max.x >= other.min.x &&
+           min.y <= other.max.y && max.y >= other.min.y &&
+           min.z <= other.max.z && max.z >= other.min.z;
+}
+
+bool Aabb::contains(DirectX::XMFLOAT3 point) const {
+    return point.x >= min.x && point.x <= max.x &&
+           point.y >= min.y && point.y <= max.y &&
+           point.z >= min.z && point.z <= max.z;
+}
+
+// Arvo's method: the new center is the transformed center, the new extents
+// are the old extents multiplied by the absolute values of the rotation part.
+Aabb Aabb::transform(const DirectX::XMMATRIX& matrix) const {
+    if (empty()) {
+        return {};
+    }
+
+    DirectX::XMFLOAT3 center = get_center();
+    DirectX::XMFLOAT3 extents = get_extents();
+
+    DirectX::XMVECTOR new_center = DirectX::XMVector3TransformCoord(DirectX::XMLoadFloat3(&center), matrix);
+    DirectX::XMVECTOR new_extents = DirectX::XMVectorAdd(
+            DirectX::XMVectorAdd(
+                    DirectX::XMVectorScale(DirectX::XMVectorAbs(matrix.r[0]), extents.x),
+                    DirectX::XMVectorScale(DirectX::XMVectorAbs(matrix.r[1]), extents.y)),
+            DirectX::XMVectorScale(DirectX::XMVectorAbs(matrix.r[2]), extents.z));
+
+    DirectX::XMFLOAT3 result_center = {};
+    DirectX::XMFLOAT3 result_extents = {};
+    DirectX::XMStoreFloat3(&result_center, new_center);
+    DirectX::XMStoreFloat3(&result_extents, new_extents);
+
+    return from_center_extents(result_center, result_extents);
+}
+
+Ray Ray::from_screen(const DirectX::XMMATRIX& view_projection, float x, float y) {
+    DirectX::XMMATRIX inverse = DirectX::XMMatrixInverse(nullptr, view_projection);
+    DirectX::XMVECTOR near_point = DirectX::XMVector3TransformCoord(DirectX::XMVectorSet(x, y, 0.0f, 1.0f), inverse);
+    DirectX::XMVECTOR far_point = DirectX::XMVector3TransformCoord(DirectX::XMVectorSet(x, y, 1.0f, 1.0f), inverse);
+
+    Ray ray = {};
+    DirectX::XMStoreFloat3(&ray.origin, near_point);
+    DirectX::XMStoreFloat3(&ray.direction, DirectX::XMVector3Normalize(DirectX::XMVectorSubtract(far_point, near_point)));
+
+    return ray;
+}
+
+Frustum Frustum::from_matrix(const DirectX::XMMATRIX& view_projection) {
+    DirectX::XMFLOAT4X4 m = {};
+    DirectX::XMStoreFloat4x4(&m, view_projection);
+
+    // Points are row vectors, so clip coordinates are dot products with the columns.
+    DirectX::XMFLOAT4 column_x = { m.m[0][0], m.m[1][0], m.m[2][0], m.m[3][0] };
+    DirectX::XMFLOAT4 column_y = { m.m[0][1], m.m[1][1], m.m[2][1], m.m[3][1] };
+    DirectX::XMFLOAT4 column_z = { m.m[0][2], m.m[1][2], m.m[2][2], m.m[3][2] };
+    DirectX::XMFLOAT4 column_w = { m.m[0][3], m.m[1][3], m.m[2][3], m.m[3][3] };
+
+    auto add = [](DirectX::XMFLOAT4 a, DirectX::XMFLOAT4 b) {
+        return DirectX::XMFLOAT4(a.x + b.x, a.y + b.y, a.z + b.z, a.w + b.w);
+    };
+    auto subtract = [](DirectX::XMFLOAT4 a, DirectX::XMFLOAT4 b) {
+        return DirectX::XMFLOAT4(a.x - b.x, a.y - b.y, a.z - b.z, a.w - b.w);
+    };
+
+    Frustum frustum = {};
+    frustum.planes[LEFT_PLANE] = add(column_w, column_x);
+    frustum.planes[RIGHT_PLANE] = subtract(column_w, column_x);
+    frustum.planes[BOTTOM_PLANE] = add(column_w, column_y);
+    frustum.planes[TOP_PLANE] = subtract(column_w, column_y);
+    frustum.planes[NEAR_PLANE] = column_z;
+    frustum.planes[FAR_PLANE] = subtract(column_w, column_z);
+
+    for (auto& plane : frustum.planes) {
+        float length = std::sqrt(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+
+        if (length > 0.0f) {
+            plane = { plane.x / length, plane.y / length, plane.z / length, plane.w / length };
+        }
+    }
+
+    return frustum;
+}
+
+bool Frustum::intersects(const Aabb& box) const {
+    DirectX::XMFLOAT3 center = box.get_center();
+    DirectX::XMFLOAT3 extents = box.get_extents();
+
+    // The box is outside when even its corner furthest along the normal is behind a plane.
+    for (const auto& plane : planes) {
+        float distance = plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w;
+        float radius = std::fabs(plane.x) * extents.x + std::fabs(plane.y) * extents.y + std::fabs(plane.z) * extents.z;
+
+        if (distance + radius < 0.0f) {
+            return false;
+        }
+    }
+
+    return true;
+}
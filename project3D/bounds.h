@@ -0,0 +1,55 @@
+#ifndef PROJECT3D_BOUNDS_H
+#define PROJECT3D_BOUNDS_H
+
+#include <cfloat>
+#include <DirectXMath.h>
+
+// Axis-aligned bounding box. A default constructed box is empty and grows with merge().
+struct Aabb {
+    DirectX::XMFLOAT3 min = { FLT_MAX, FLT_MAX, FLT_MAX };
+    DirectX::XMFLOAT3 max = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+    static Aabb from_center_extents(DirectX::XMFLOAT3 center, DirectX::XMFLOAT3 extents);
+
+    bool empty() const;
+    void merge(DirectX::XMFLOAT3 point);
+    void merge(const Aabb& other);
+
+    DirectX::XMFLOAT3 get_center() const;
+
+    // Half of the size along every axis
+    DirectX::XMFLOAT3 get_extents() const;
+
+    bool intersects(const Aabb& other) const;
+    bool contains(DirectX::XMFLOAT3 point) const;
+
+    // Bounds of the transformed box (row-vector convention, like the rest of DirectXMath).
+    Aabb transform(const DirectX::XMMATRIX& matrix) const;
+};
+
+// Half-line origin + t * direction, t >= 0. The direction is normalized.
+struct Ray {
+    DirectX::XMFLOAT3 origin;
+    DirectX::XMFLOAT3 direction;
+
+    // Ray through a point of the screen, x and y in normalized device coordinates ([-1, 1], y up),
+    // starting on the near plane of the view * projection matrix.
+    static Ray from_screen(const DirectX::XMMATRIX& view_projection, float x, float y);
+};
+
+// Six planes (a, b, c, d) with normals pointing inside, ax + by + cz + d >= 0
+// for points in the frustum.
+struct Frustum {
+    // NEAR and FAR alone are macros in windows.h
+    enum Plane { LEFT_PLANE, RIGHT_PLANE, BOTTOM_PLANE, TOP_PLANE, NEAR_PLANE, FAR_PLANE, PLANE_COUNT };
+
+    DirectX::XMFLOAT4 planes[PLANE_COUNT];
+
+    // Planes of a Direct3D view * projection matrix (clip space z in [0, w]).
+    static Frustum from_matrix(const DirectX::XMMATRIX& view_projection);
+
+    // Conservative: boxes near the frustum corners may pass even though they are outside.
+    bool intersects(const Aabb& box) const;
+};
+
+#endif //PROJECT3D_BOUNDS_H
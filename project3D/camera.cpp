@@ -1,7 +1,8 @@
 #include <algorithm>
+#include <cmath>
 #include "camera.h"
 
-DirectX::XMMATRIX Camera::get_projection_matrix() {
+DirectX::XMMATRIX Camera::get_projection_matrix() const {
     DirectX::XMVECTOR base_vector = DirectX::XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f);
     auto look_vector = DirectX::XMVector3Transform(
             base_vector,
@@ -12,6 +13,28 @@ DirectX::XMMATRIX Camera::get_projection_matrix() {
     return DirectX::XMMatrixLookAtLH(camera_position, camera_target, DirectX::XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
 }
 
+DirectX::XMMATRIX Camera::get_perspective_matrix(float aspect_ratio) const {
+    return DirectX::XMMatrixPerspectiveFovLH(FIELD_OF_VIEW, aspect_ratio, NEAR_PLANE, FAR_PLANE);
+}
+
+Frustum Camera::get_frustum(float aspect_ratio) const {
+    return Frustum::from_matrix(DirectX::XMMatrixMultiply(get_projection_matrix(), get_perspective_matrix(aspect_ratio)));
+}
+
+Ray Camera::get_ray(float aspect_ratio, float x, float y) const {
+    return Ray::from_screen(DirectX::XMMatrixMultiply(get_projection_matrix(), get_perspective_matrix(aspect_ratio)), x, y);
+}
+
+CameraPose Camera::get_pose() const {
+    return {position, yaw, pitch};
+}
+
+void Camera::set_pose(const CameraPose& pose) {
+    position = pose.position;
+    yaw = pose.yaw;
+    pitch = pose.pitch;
+}
+
 void Camera::rotate(float delta_mouse_x, float delta_mouse_y) {
     pitch = std::clamp(pitch + delta_mouse_y * ROTATION_SPEED, -DirectX::XM_PI * 0.995f / 2.0f, DirectX::XM_PI * 0.995f / 2.0f);
     yaw += delta_mouse_x * ROTATION_SPEED;
@@ -25,14 +48,15 @@ void Camera::rotate(float delta_mouse_x, float delta_mouse_y) {
     }
 }
 
-void Camera::move(DirectX::XMFLOAT3 translation) {
+void Camera::move(DirectX::XMFLOAT3 translation, float delta_time) {
     DirectX::XMFLOAT3 movement = {};
+    const float distance = MOVE_SPEED * delta_time;
 
     DirectX::XMStoreFloat3(&movement, DirectX::XMVector3Transform(
             DirectX::XMLoadFloat3(&translation),
             DirectX::XMMatrixMultiply(
                     DirectX::XMMatrixRotationRollPitchYaw(pitch, yaw, 0.0f),
-                    DirectX::XMMatrixScaling(MOVE_SPEED, MOVE_SPEED, MOVE_SPEED)
+                    DirectX::XMMatrixScaling(distance, distance, distance)
             )
     ));
 
@@ -41,8 +65,46 @@ void Camera::move(DirectX::XMFLOAT3 translation) {
     position.z += movement.z;
 }
 
+DirectX::XMFLOAT3 Camera::get_walk_velocity(DirectX::XMFLOAT3 translation) const {
+    DirectX::XMFLOAT3 velocity = {};
+
+    DirectX::XMStoreFloat3(&velocity, DirectX::XMVector3Transform(
+            DirectX::XMVectorSet(translation.x, 0.0f, translation.z, 0.0f),
+            DirectX::XMMatrixMultiply(
+                    DirectX::XMMatrixRotationRollPitchYaw(0.0f, yaw, 0.0f),
+                    DirectX::XMMatrixScaling(MOVE_SPEED, MOVE_SPEED, MOVE_SPEED)
+            )
+    ));
+    velocity.y = 0.0f;
+
+    return velocity;
+}
+
 void Camera::reset() {
     yaw = DEF_YAW;
     pitch = DEF_PITCH;
     position = DEF_POSITION;
 }
+
+CameraPose Camera::interpolate(const CameraPose& from, const CameraPose& to, float alpha) {
+    float yaw_delta = std::remainder(to.yaw - from.yaw, 2.0f * DirectX::XM_PI);
+    float yaw = from.yaw + yaw_delta * alpha;
+
+    if (yaw < 0.0f) {
+        yaw += 2.0f * DirectX::XM_PI;
+    }
+    else if (yaw >= 2.0f * DirectX::XM_PI) {
+        yaw -= 2.0f * DirectX::XM_PI;
+    }
+
+    CameraPose pose = {};
+    DirectX::XMStoreFloat3(&pose.position, DirectX::XMVectorLerp(
+            DirectX::XMLoadFloat3(&from.position),
+            DirectX::XMLoadFloat3(&to.position),
+            alpha
+    ));
+    pose.yaw = yaw;
+    pose.pitch = from.pitch + (to.pitch - from.pitch) * alpha;
+
+    return pose;
+}
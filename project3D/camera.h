@@ -3,19 +3,42 @@
 
 #include <DirectXMath.h>
 
+#include "bounds.h"
+
+struct CameraPose {
+    DirectX::XMFLOAT3 position;
+    float yaw;
+    float pitch;
+};
+
 class Camera {
 public:
-    DirectX::XMMATRIX get_projection_matrix();
+    DirectX::XMMATRIX get_projection_matrix() const;
+    DirectX::XMMATRIX get_perspective_matrix(float aspect_ratio) const;
+    Frustum get_frustum(float aspect_ratio) const;
+    // x and y in normalized device coordinates, (0, 0) is the screen center
+    Ray get_ray(float aspect_ratio, float x, float y) const;
+    CameraPose get_pose() const;
+    void set_pose(const CameraPose& pose);
     void rotate(float delta_mouse_x, float delta_mouse_y);
-    void move(DirectX::XMFLOAT3 translation);
+    // translation is a direction in camera space, scaled by MOVE_SPEED units per second
+    void move(DirectX::XMFLOAT3 translation, float delta_time);
+    // Same directions for walking: only yaw is applied and the result is a horizontal velocity
+    DirectX::XMFLOAT3 get_walk_velocity(DirectX::XMFLOAT3 translation) const;
     void reset();
 
+    // Position is interpolated linearly, yaw along the shorter arc.
+    static CameraPose interpolate(const CameraPose& from, const CameraPose& to, float alpha);
+
 private:
     static constexpr float DEF_PITCH = 0.0f;
     static constexpr float DEF_YAW = 0.0f;
     static constexpr DirectX::XMFLOAT3 DEF_POSITION = {-2.0f, 1.8f, -15.0f};
     static constexpr float ROTATION_SPEED = 0.01f;
-    static constexpr float MOVE_SPEED = 0.1f;
+    static constexpr float MOVE_SPEED = 6.0f;
+    static constexpr float FIELD_OF_VIEW = 45.0f;
+    static constexpr float NEAR_PLANE = 1.0f;
+    static constexpr float FAR_PLANE = 100.0f;
 
     float pitch = DEF_PITCH;
     float yaw = DEF_YAW;
@@ -0,0 +1,126 @@
+#include "camera_path.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+HRESULT CameraPath::load(const std::filesystem::path& path) {
+    HRESULT hr = S_OK;
+    std::string line;
+    std::ifstream file(path);
+
+    keyframes.clear();
+
+    if (file.is_open()) {
+        while (std::getline(file, line)) {
+            if (line.empty() || line[0] == '#') {
+                continue;
+            }
+
+            CameraKeyframe keyframe = {};
+            std::istringstream line_stream(line);
+            line_stream >> keyframe.time
+                        >> keyframe.pose.position.x >> keyframe.pose.position.y >> keyframe.pose.position.z
+                        >> keyframe.pose.yaw >> keyframe.pose.pitch;
+
+            if (line_stream.fail() || (!keyframes.empty() && keyframe.time < keyframes.back().time)) {
+                hr = E_FAIL;
+                break;
+            }
+
+            keyframes.push_back(keyframe);
+        }
+    }
+    else {
+        hr = E_FAIL;
+    }
+
+    return hr;
+}
+
+HRESULT CameraPath::save(const std::filesystem::path& path) const {
+    std::ofstream file(path);
+
+    if (!file.is_open()) {
+        return E_FAIL;
+    }
+
+    file << "# time x y z yaw pitch\n";
+
+    for (const auto& keyframe : keyframes) {
+        file << keyframe.time << ' '
+             << keyframe.pose.position.x << ' ' << keyframe.pose.position.y << ' ' << keyframe.pose.position.z << ' '
+             << keyframe.pose.yaw << ' ' << keyframe.pose.pitch << '\n';
+    }
+
+    return file.fail() ? E_FAIL : S_OK;
+}
+
+void CameraPath::add_keyframe(const CameraKeyframe& keyframe) {
+    keyframes.push_back(keyframe);
+}
+
+CameraPose CameraPath::sample(float time) const {
+    if (keyframes.empty()) {
+        return {};
+    }
+
+    auto next = std::upper_bound(keyframes.begin(), keyframes.end(), time, [](float t, const CameraKeyframe& keyframe) {
+        return t < keyframe.time;
+    });
+
+    if (next == keyframes.begin()) {
+        return keyframes.front().pose;
+    }
+
+    if (next == keyframes.end()) {
+        return keyframes.back().pose;
+    }
+
+    const CameraKeyframe& a = *(next - 1);
+    const CameraKeyframe& b = *next;
+    float t = b.time > a.time ? (time - a.time) / (b.time - a.time) : 1.0f;
+
+    return Camera::interpolate(a.pose, b.pose, t);
+}
+
+float CameraPath::get_duration() const {
+    return keyframes.empty() ? 0.0f : keyframes.back().time;
+}
+
+bool CameraPath::empty() const {
+    return keyframes.empty();
+}
+
+std::size_t CameraPath::get_number_of_keyframes() const {
+    return keyframes.size();
+}
+
+CameraPath CameraPath::make_orbit(DirectX::XMFLOAT3 center, float radius, float duration, std::size_t keyframe_count) {
+    CameraPath path;
+
+    for (std::size_t i = 0; i <= keyframe_count; i++) {
+        float t = static_cast<float>(i) / static_cast<float>(keyframe_count);
+        float angle = t * 2.0f * DirectX::XM_PI;
+
+        CameraKeyframe keyframe = {};
+        keyframe.time = t * duration;
+        keyframe.pose.position = {
+                center.x - radius * std::sin(angle),
+                center.y,
+                center.z - radius * std::cos(angle)
+        };
+
+        // The camera looks along (sin(yaw), 0, cos(yaw)), here towards the center.
+        keyframe.pose.yaw = std::fmod(angle, 2.0f * DirectX::XM_PI);
+        keyframe.pose.pitch = 0.0f;
+        path.add_keyframe(keyframe);
+    }
+
+    return path;
+}
+
+CameraPath CameraPath::make_default_tour() {
+    return make_orbit({-10.0f, 1.8f, -5.0f}, 18.0f, 20.0f, 32);
+}
@@ -0,0 +1,42 @@
+#ifndef PROJECT3D_CAMERA_PATH_H
+#define PROJECT3D_CAMERA_PATH_H
+
+#include <filesystem>
+#include <vector>
+#include <DirectXMath.h>
+
+#include "camera.h"
+#include "hresult.h"
+
+struct CameraKeyframe {
+    float time;
+    CameraPose pose;
+};
+
+// Camera poses over time, either recorded from a walk through the scene or
+// generated. Stored as text, one "time x y z yaw pitch" keyframe per line.
+class CameraPath {
+public:
+    HRESULT load(const std::filesystem::path& path);
+    HRESULT save(const std::filesystem::path& path) const;
+
+    // Keyframes have to be added in increasing time order.
+    void add_keyframe(const CameraKeyframe& keyframe);
+
+    // Pose at the given time, linearly interpolated (yaw along the shorter arc).
+    CameraPose sample(float time) const;
+    float get_duration() const;
+    bool empty() const;
+    std::size_t get_number_of_keyframes() const;
+
+    // Circle around center at the given height, always looking at the center.
+    static CameraPath make_orbit(DirectX::XMFLOAT3 center, float radius, float duration, std::size_t keyframe_count);
+
+    // Scripted path around assets/model1 used when no recorded path is given.
+    static CameraPath make_default_tour();
+
+private:
+    std::vector<CameraKeyframe> keyframes;
+};
+
+#endif //PROJECT3D_CAMERA_PATH_H
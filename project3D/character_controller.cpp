@@ -0,0 +1,400 @@
+#include "character_controller.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    // Substeps move at most this fraction of the radius, so thin walls are not skipped.
+    constexpr float SUBSTEP_FRACTION = 0.25f;
+    constexpr int MAX_SUBSTEPS = 32;
+    constexpr int DEPENETRATION_ITERATIONS = 3;
+
+    // Contacts are pushed out slightly further than the radius.
+    constexpr float CONTACT_OFFSET = 0.001f;
+
+    // Contacts with normals pointing further down than this are ceilings.
+    constexpr float CEILING_NORMAL_Y = -0.7f;
+
+    // Contacts whose normal differs more than this from the triangle normal are on an edge or a corner.
+    constexpr float EDGE_NORMAL_DOT = 0.999f;
+
+    float dot(DirectX::FXMVECTOR a, DirectX::FXMVECTOR b) {
+        return DirectX::XMVectorGetX(DirectX::XMVector3Dot(a, b));
+    }
+
+    // Ericson, Real-Time Collision Detection, 5.1.5
+    DirectX::XMVECTOR closest_point_on_triangle(DirectX::FXMVECTOR p, DirectX::FXMVECTOR a, DirectX::FXMVECTOR b, DirectX::GXMVECTOR c) {
+        using namespace DirectX;
+
+        XMVECTOR ab = XMVectorSubtract(b, a);
+        XMVECTOR ac = XMVectorSubtract(c, a);
+        XMVECTOR ap = XMVectorSubtract(p, a);
+        float d1 = dot(ab, ap);
+        float d2 = dot(ac, ap);
+
+        if (d1 <= 0.0f && d2 <= 0.0f) {
+            return a;
+        }
+
+        XMVECTOR bp = XMVectorSubtract(p, b);
+        float d3 = dot(ab, bp);
+        float d4 = dot(ac, bp);
+
+        if (d3 >= 0.0f && d4 <= d3) {
+            return b;
+        }
+
+        float vc = d1 * d4 - d3 * d2;
+
+        if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) {
+            return XMVectorAdd(a, XMVectorScale(ab, d1 / (d1 - d3)));
+        }
+
+        XMVECTOR cp = XMVectorSubtract(p, c);
+        float d5 = dot(ab, cp);
+        float d6 = dot(ac, cp);
+
+        if (d6 >= 0.0f && d5 <= d6) {
+            return c;
+        }
+
+        float vb = d5 * d2 - d1 * d6;
+
+        if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) {
+            return XMVectorAdd(a, XMVectorScale(ac, d2 / (d2 - d6)));
+        }
+
+        float va = d3 * d6 - d5 * d4;
+
+        if (va <= 0.0f && d4 - d3 >= 0.0f && d5 - d6 >= 0.0f) {
+            return XMVectorAdd(b, XMVectorScale(XMVectorSubtract(c, b), (d4 - d3) / ((d4 - d3) + (d5 - d6))));
+        }
+
+        float denominator = 1.0f / (va + vb + vc);
+        return XMVectorAdd(a, XMVectorAdd(XMVectorScale(ab, vb * denominator), XMVectorScale(ac, vc * denominator)));
+    }
+
+    // Ericson, Real-Time Collision Detection, 5.1.9
+    void closest_points_on_segments(DirectX::FXMVECTOR p1, DirectX::FXMVECTOR q1, DirectX::FXMVECTOR p2, DirectX::GXMVECTOR q2,
+                                    DirectX::XMVECTOR& c1, DirectX::XMVECTOR& c2) {
+        using namespace DirectX;
+
+        constexpr float EPSILON = 1e-8f;
+        XMVECTOR d1 = XMVectorSubtract(q1, p1);
+        XMVECTOR d2 = XMVectorSubtract(q2, p2);
+        XMVECTOR r = XMVectorSubtract(p1, p2);
+        float a = dot(d1, d1);
+        float e = dot(d2, d2);
+        float f = dot(d2, r);
+        float s = 0.0f;
+        float t = 0.0f;
+
+        if (a <= EPSILON && e <= EPSILON) {
+            s = 0.0f;
+            t = 0.0f;
+        }
+        else if (a <= EPSILON) {
+            t = std::clamp(f / e, 0.0f, 1.0f);
+        }
+        else {
+            float c = dot(d1, r);
+
+            if (e <= EPSILON) {
+                s = std::clamp(-c / a, 0.0f, 1.0f);
+            }
+            else {
+                float b = dot(d1, d2);
+                float denominator = a * e - b * b;
+
+                s = denominator != 0.0f ? std::clamp((b * f - c * e) / denominator, 0.0f, 1.0f) : 0.0f;
+                t = (b * s + f) / e;
+
+                if (t < 0.0f) {
+                    t = 0.0f;
+                    s = std::clamp(-c / a, 0.0f, 1.0f);
+                }
+                else if (t > 1.0f) {
+                    t = 1.0f;
+                    s = std::clamp((b - c) / a, 0.0f, 1.0f);
+                }
+            }
+        }
+
+        c1 = XMVectorAdd(p1, XMVectorScale(d1, s));
+        c2 = XMVectorAdd(p2, XMVectorScale(d2, t));
+    }
+
+    // Closest points between the segment pq and the triangle. Returns the squared distance.
+    float closest_points_on_segment_triangle(DirectX::FXMVECTOR p, DirectX::FXMVECTOR q, const BvhTriangle& triangle,
+                                             DirectX::XMVECTOR& on_segment, DirectX::XMVECTOR& on_triangle) {
+        using namespace DirectX;
+
+        XMVECTOR a = XMLoadFloat3(&triangle.a);
+        XMVECTOR b = XMLoadFloat3(&triangle.b);
+        XMVECTOR c = XMLoadFloat3(&triangle.c);
+        XMVECTOR normal = XMVector3Cross(XMVectorSubtract(b, a), XMVectorSubtract(c, a));
+
+        // A segment crossing the triangle touches it.
+        float distance_p = dot(normal, XMVectorSubtract(p, a));
+        float distance_q = dot(normal, XMVectorSubtract(q, a));
+
+        if ((distance_p < 0.0f) != (distance_q < 0.0f) && distance_p != distance_q) {
+            XMVECTOR crossing = XMVectorAdd(p, XMVectorScale(XMVectorSubtract(q, p), distance_p / (distance_p - distance_q)));
+            XMVECTOR closest = closest_point_on_triangle(crossing, a, b, c);
+
+            float tolerance = 1e-10f * (1.0f + XMVectorGetX(XMVector3LengthSq(crossing)));
+
+            if (XMVectorGetX(XMVector3LengthSq(XMVectorSubtract(closest, crossing))) <= tolerance) {
+                on_segment = crossing;
+                on_triangle = crossing;
+                return 0.0f;
+            }
+        }
+
+        XMVECTOR segment_point = p;
+        XMVECTOR triangle_point = closest_point_on_triangle(p, a, b, c);
+        float best = XMVectorGetX(XMVector3LengthSq(XMVectorSubtract(segment_point, triangle_point)));
+
+        auto consider = [&](XMVECTOR candidate_segment, XMVECTOR candidate_triangle) {
+            float distance = XMVectorGetX(XMVector3LengthSq(XMVectorSubtract(candidate_segment, candidate_triangle)));
+
+            if (distance < best) {
+                best = distance;
+                segment_point = candidate_segment;
+                triangle_point = candidate_triangle;
+            }
+        };
+
+        consider(q, closest_point_on_triangle(q, a, b, c));
+
+        XMVECTOR edges[3][2] = {{a, b}, {b, c}, {c, a}};
+
+        for (const auto& edge : edges) {
+            XMVECTOR c1;
+            XMVECTOR c2;
+            closest_points_on_segments(p, q, edge[0], edge[1], c1, c2);
+            consider(c1, c2);
+        }
+
+        on_segment = segment_point;
+        on_triangle = triangle_point;
+        return best;
+    }
+}
+
+CharacterController::CharacterController(const TriangleBvh& bvh, DirectX::XMFLOAT3 feet_position, Options options)
+        : bvh(bvh), options(options), ground_normal_y(std::cos(options.max_slope)), position(feet_position) {
+}
+
+CharacterController::CharacterController(const TriangleBvh& bvh, DirectX::XMFLOAT3 feet_position)
+        : CharacterController(bvh, feet_position, Options()) {
+}
+
+void CharacterController::update(DirectX::XMFLOAT3 velocity, bool jump, float delta_time) {
+    bool was_grounded = grounded;
+
+    if (jump && grounded) {
+        vertical_velocity = options.jump_speed;
+        was_grounded = false;
+    }
+
+    vertical_velocity -= options.gravity * delta_time;
+
+    DirectX::XMFLOAT3 horizontal = {velocity.x * delta_time, 0.0f, velocity.z * delta_time};
+    float vertical = vertical_velocity * delta_time;
+    float horizontal_length = std::sqrt(horizontal.x * horizontal.x + horizontal.z * horizontal.z);
+
+    // Everything this update can touch, so the hierarchy is walked once.
+    float reach = horizontal_length + options.radius + CONTACT_OFFSET;
+    float reach_down = std::max(-vertical, 0.0f) + options.step_height + CONTACT_OFFSET;
+    float reach_up = std::max(vertical, 0.0f) + options.step_height + CONTACT_OFFSET;
+    Aabb region = {
+            {position.x - reach, position.y - reach_down, position.z - reach},
+            {position.x + reach, position.y + options.height + reach_up, position.z + reach}
+    };
+
+    candidates.clear();
+    bvh.query(region, candidates);
+
+    DirectX::XMFLOAT3 start = position;
+    float step_top = start.y + options.step_height;
+    Contacts contacts = slide(position, horizontal, step_top);
+
+    if (was_grounded && contacts.wall && options.step_height > 0.0f) {
+        DirectX::XMFLOAT3 stepped = start;
+        slide(stepped, {0.0f, options.step_height, 0.0f}, step_top);
+        slide(stepped, horizontal, step_top);
+        Contacts landing = slide(stepped, {0.0f, start.y - stepped.y - 2.0f * CONTACT_OFFSET, 0.0f}, step_top);
+
+        auto progress = [&](const DirectX::XMFLOAT3& end) {
+            return (end.x - start.x) * horizontal.x + (end.z - start.z) * horizontal.z;
+        };
+
+        if (landing.ground && progress(stepped) > progress(position) + 1e-6f) {
+            position = stepped;
+        }
+    }
+
+    contacts = slide(position, {0.0f, vertical, 0.0f}, step_top);
+
+    if (contacts.ground && vertical_velocity <= 0.0f) {
+        grounded = true;
+        vertical_velocity = 0.0f;
+    }
+    else if (contacts.ceiling && vertical_velocity > 0.0f) {
+        grounded = false;
+        vertical_velocity = 0.0f;
+    }
+    else if (was_grounded && vertical_velocity <= 0.0f) {
+        // Walking down slopes and stairs keeps the feet on the ground instead of falling in hops.
+        DirectX::XMFLOAT3 snapped = position;
+
+        if (slide(snapped, {0.0f, -options.step_height, 0.0f}, step_top).ground) {
+            position = snapped;
+            vertical_velocity = 0.0f;
+            grounded = true;
+        }
+        else {
+            grounded = false;
+        }
+    }
+    else {
+        grounded = false;
+    }
+}
+
+DirectX::XMFLOAT3 CharacterController::get_position() const {
+    return position;
+}
+
+void CharacterController::set_position(DirectX::XMFLOAT3 feet_position) {
+    position = feet_position;
+    vertical_velocity = 0.0f;
+    grounded = false;
+}
+
+bool CharacterController::is_grounded() const {
+    return grounded;
+}
+
+const CharacterController::Options& CharacterController::get_options() const {
+    return options;
+}
+
+std::size_t CharacterController::get_number_of_candidates() const {
+    return candidates.size();
+}
+
+CharacterController::Contacts CharacterController::slide(DirectX::XMFLOAT3& current, DirectX::XMFLOAT3 displacement, float step_top) const {
+    Contacts contacts;
+    float length = std::sqrt(displacement.x * displacement.x + displacement.y * displacement.y + displacement.z * displacement.z);
+
+    if (length == 0.0f) {
+        return contacts;
+    }
+
+    int substeps = std::clamp(static_cast<int>(std::ceil(length / (options.radius * SUBSTEP_FRACTION))), 1, MAX_SUBSTEPS);
+    DirectX::XMFLOAT3 step = {displacement.x / substeps, displacement.y / substeps, displacement.z / substeps};
+
+    for (int i = 0; i < substeps; i++) {
+        current = {current.x + step.x, current.y + step.y, current.z + step.z};
+
+        Contacts substep_contacts = depenetrate(current, step, step_top);
+        contacts.ground |= substep_contacts.ground;
+        contacts.wall |= substep_contacts.wall;
+        contacts.ceiling |= substep_contacts.ceiling;
+    }
+
+    return contacts;
+}
+
+CharacterController::Contacts CharacterController::depenetrate(DirectX::XMFLOAT3& current, DirectX::XMFLOAT3& motion, float step_top) const {
+    using namespace DirectX;
+
+    Contacts contacts;
+    float radius = options.radius;
+
+    for (int iteration = 0; iteration < DEPENETRATION_ITERATIONS; iteration++) {
+        bool pushed = false;
+
+        for (std::uint32_t triangle_index : candidates) {
+            const BvhTriangle& triangle = bvh.get_triangle(triangle_index);
+            XMVECTOR bottom = XMVectorSet(current.x, current.y + radius, current.z, 0.0f);
+            XMVECTOR top = XMVectorSet(current.x, current.y + options.height - radius, current.z, 0.0f);
+
+            XMVECTOR on_segment;
+            XMVECTOR on_triangle;
+            float distance_squared = closest_points_on_segment_triangle(bottom, top, triangle, on_segment, on_triangle);
+
+            if (distance_squared >= radius * radius) {
+                continue;
+            }
+
+            float distance = std::sqrt(distance_squared);
+            XMVECTOR a = XMLoadFloat3(&triangle.a);
+            XMVECTOR face_normal = XMVector3Normalize(XMVector3Cross(
+                    XMVectorSubtract(XMLoadFloat3(&triangle.b), a),
+                    XMVectorSubtract(XMLoadFloat3(&triangle.c), a)));
+            XMVECTOR normal;
+
+            if (distance > 1e-6f) {
+                normal = XMVectorScale(XMVectorSubtract(on_segment, on_triangle), 1.0f / distance);
+            }
+            else {
+                // The axis crosses the triangle, push out on the side the capsule center is on.
+                XMVECTOR center = XMVectorScale(XMVectorAdd(bottom, top), 0.5f);
+                normal = dot(face_normal, XMVectorSubtract(center, a)) < 0.0f ? XMVectorNegate(face_normal) : face_normal;
+            }
+
+            XMFLOAT3 n = {};
+            XMFLOAT3 point = {};
+            XMStoreFloat3(&n, normal);
+            XMStoreFloat3(&point, on_triangle);
+            float depth = radius - distance + CONTACT_OFFSET;
+
+            // Edges and corners at most step_height above the feet at the start of the update (the
+            // top of a stair) are ground as well, the bottom sphere is lifted until it rests on them.
+            bool edge = std::fabs(dot(normal, face_normal)) < EDGE_NORMAL_DOT;
+
+            if (edge && distance > 1e-6f && point.y <= step_top) {
+                float dx = point.x - current.x;
+                float dz = point.z - current.z;
+                float lifted = point.y + std::sqrt(std::max(radius * radius - dx * dx - dz * dz, 0.0f)) + CONTACT_OFFSET - radius;
+
+                contacts.ground = true;
+                current.y = std::max(current.y, lifted);
+                motion.y = std::max(motion.y, 0.0f);
+            }
+            else if (n.y >= ground_normal_y) {
+                // Walkable ground is resolved straight up, so standing on a slope does not slide.
+                contacts.ground = true;
+                current.y += depth / n.y;
+                motion.y = std::max(motion.y, 0.0f);
+            }
+            else {
+                if (n.y <= CEILING_NORMAL_Y) {
+                    contacts.ceiling = true;
+                }
+                else {
+                    contacts.wall = true;
+                }
+
+                current = {current.x + n.x * depth, current.y + n.y * depth, current.z + n.z * depth};
+
+                float into = motion.x * n.x + motion.y * n.y + motion.z * n.z;
+
+                if (into < 0.0f) {
+                    motion = {motion.x - n.x * into, motion.y - n.y * into, motion.z - n.z * into};
+                }
+            }
+
+            pushed = true;
+        }
+
+        if (!pushed) {
+            break;
+        }
+    }
+
+    return contacts;
+}
@@ -0,0 +1,66 @@
+#ifndef PROJECT3D_CHARACTER_CONTROLLER_H
+#define PROJECT3D_CHARACTER_CONTROLLER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <DirectXMath.h>
+
+#include "bounds.h"
+#include "triangle_bvh.h"
+
+// Upright capsule walking on the triangles of a TriangleBvh. Movement is split
+// into small substeps; after each one the capsule is pushed out of every
+// triangle it overlaps and the rest of the motion slides along the contact.
+// Contacts with slopes up to max_slope are ground: they stop falling and are
+// resolved vertically, so the capsule does not slide down walkable slopes.
+// Blocked horizontal moves are retried step_height higher (stairs, curbs).
+class CharacterController {
+public:
+    struct Options {
+        float radius = 0.3f;
+        float height = 1.8f;
+        float step_height = 0.35f;
+
+        // Steepest walkable slope, radians
+        float max_slope = 0.8f;
+
+        float gravity = 9.81f;
+        float jump_speed = 4.5f;
+    };
+
+    CharacterController(const TriangleBvh& bvh, DirectX::XMFLOAT3 feet_position, Options options);
+    CharacterController(const TriangleBvh& bvh, DirectX::XMFLOAT3 feet_position);
+
+    // velocity is the wanted horizontal velocity (y is ignored), gravity is added here.
+    void update(DirectX::XMFLOAT3 velocity, bool jump, float delta_time);
+
+    DirectX::XMFLOAT3 get_position() const;
+    void set_position(DirectX::XMFLOAT3 feet_position);
+    bool is_grounded() const;
+    const Options& get_options() const;
+
+    // Triangles tested by the last update, all gathered with a single BVH query
+    std::size_t get_number_of_candidates() const;
+
+private:
+    struct Contacts {
+        bool ground = false;
+        bool wall = false;
+        bool ceiling = false;
+    };
+
+    // Edges up to step_top can be stepped onto.
+    Contacts slide(DirectX::XMFLOAT3& position, DirectX::XMFLOAT3 displacement, float step_top) const;
+    Contacts depenetrate(DirectX::XMFLOAT3& position, DirectX::XMFLOAT3& motion, float step_top) const;
+
+    const TriangleBvh& bvh;
+    Options options;
+    float ground_normal_y;
+    DirectX::XMFLOAT3 position;
+    float vertical_velocity = 0.0f;
+    bool grounded = false;
+    std::vector<std::uint32_t> candidates;
+};
+
+#endif //PROJECT3D_CHARACTER_CONTROLLER_H
@@ -0,0 +1,88 @@
+#include "descriptor_allocator.h"
+
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+
+DescriptorAllocator::DescriptorAllocator(std::uint32_t capacity) : capacity(capacity) {
+    reset();
+}
+
+std::uint32_t DescriptorAllocator::allocate(std::uint32_t count) {
+    if (count == 0) {
+        return INVALID_INDEX;
+    }
+
+    auto it = std::find_if(free_ranges.begin(), free_ranges.end(), [count](const Range& range) {
+        return range.count >= count;
+    });
+
+    if (it == free_ranges.end()) {
+        return INVALID_INDEX;
+    }
+
+    std::uint32_t index = it->first;
+    it->first += count;
+    it->count -= count;
+
+    if (it->count == 0) {
+        free_ranges.erase(it);
+    }
+
+    allocated_count += count;
+
+    return index;
+}
+
+void DescriptorAllocator::free(std::uint32_t index, std::uint32_t count) {
+    if (index == INVALID_INDEX || count == 0) {
+        return;
+    }
+
+    assert(index + count <= capacity && count <= allocated_count);
+
+    auto next = std::lower_bound(free_ranges.begin(), free_ranges.end(), index, [](const Range& range, std::uint32_t first) {
+        return range.first < first;
+    });
+
+    bool merges_previous = next != free_ranges.begin() && std::prev(next)->first + std::prev(next)->count == index;
+    bool merges_next = next != free_ranges.end() && index + count == next->first;
+
+    if (merges_previous && merges_next) {
+        std::prev(next)->count += count + next->count;
+        free_ranges.erase(next);
+    }
+    else if (merges_previous) {
+        std::prev(next)->count += count;
+    }
+    else if (merges_next) {
+        next->first = index;
+        next->count += count;
+    }
+    else {
+        free_ranges.insert(next, {index, count});
+    }
+
+    allocated_count -= count;
+}
+
+void DescriptorAllocator::reset() {
+    free_ranges.clear();
+    allocated_count = 0;
+
+    if (capacity > 0) {
+        free_ranges.push_back({0, capacity});
+    }
+}
+
+std::uint32_t DescriptorAllocator::get_capacity() const {
+    return capacity;
+}
+
+std::uint32_t DescriptorAllocator::get_allocated_count() const {
+    return allocated_count;
+}
+
+std::size_t DescriptorAllocator::get_number_of_free_ranges() const {
+    return free_ranges.size();
+}
@@ -0,0 +1,40 @@
+#ifndef PROJECT3D_DESCRIPTOR_ALLOCATOR_H
+#define PROJECT3D_DESCRIPTOR_ALLOCATOR_H
+
+#include <cstdint>
+#include <vector>
+
+// Hands out ranges of slots in a descriptor heap of fixed capacity. Only the
+// indices are managed, creating the descriptors is up to the caller, so the
+// allocator works without a device. Free ranges are kept sorted by offset and
+// merged with their neighbours when released; allocation is first fit.
+class DescriptorAllocator {
+public:
+    static constexpr std::uint32_t INVALID_INDEX = UINT32_MAX;
+
+    explicit DescriptorAllocator(std::uint32_t capacity = 0);
+
+    // Index of the first of count consecutive slots, INVALID_INDEX when no free range is large enough.
+    std::uint32_t allocate(std::uint32_t count = 1);
+
+    // Releases a range returned by allocate (count must match).
+    void free(std::uint32_t index, std::uint32_t count = 1);
+
+    void reset();
+
+    std::uint32_t get_capacity() const;
+    std::uint32_t get_allocated_count() const;
+    std::size_t get_number_of_free_ranges() const;
+
+private:
+    struct Range {
+        std::uint32_t first;
+        std::uint32_t count;
+    };
+
+    std::uint32_t capacity;
+    std::uint32_t allocated_count = 0;
+    std::vector<Range> free_ranges;
+};
+
+#endif //PROJECT3D_DESCRIPTOR_ALLOCATOR_H
@@ -0,0 +1,60 @@
+#include "draw_batch.h"
+
+#include <algorithm>
+
+void create_submesh_draws(const ObjectLoader& object_loader, const std::vector<std::wstring>& texture_uris,
+                          std::vector<DrawBatch>& submesh_draws, SpatialIndex& index) {
+    const auto& materials = object_loader.get_materials();
+    const auto& submeshes = object_loader.get_submeshes();
+
+    submesh_draws.clear();
+
+    for (std::size_t i = 0; i < submeshes.size(); i++) {
+        const Submesh& submesh = submeshes[i];
+        const std::wstring& texture_uri = materials[submesh.material].diffuse_texture_uri;
+        std::uint32_t texture_index = 0;
+
+        if (!texture_uri.empty()) {
+            texture_index = static_cast<std::uint32_t>(std::find(texture_uris.begin(), texture_uris.end(), texture_uri) - texture_uris.begin()) + 1;
+        }
+
+        submesh_draws.push_back({
+                static_cast<std::uint32_t>(submesh.first_vertex),
+                static_cast<std::uint32_t>(submesh.number_of_vertices),
+                texture_index
+        });
+        index.insert(submesh.bounds, static_cast<std::uint32_t>(i));
+    }
+}
+
+void cull_submeshes(const SpatialIndex& index, const std::vector<DrawBatch>& submesh_draws, const DirectX::XMMATRIX& world_view_proj,
+                    std::vector<SpatialIndex::ObjectId>& visible_submeshes, std::vector<bool>& submesh_visible,
+                    std::vector<DrawBatch>& draw_batches) {
+    visible_submeshes.clear();
+    index.query_frustum(Frustum::from_matrix(world_view_proj), visible_submeshes);
+
+    submesh_visible.assign(submesh_draws.size(), false);
+
+    for (SpatialIndex::ObjectId object : visible_submeshes) {
+        submesh_visible[index.get_user_data(object)] = true;
+    }
+
+    draw_batches.clear();
+
+    for (std::size_t i = 0; i < submesh_draws.size(); i++) {
+        const DrawBatch& draw = submesh_draws[i];
+
+        if (!submesh_visible[i]) {
+            continue;
+        }
+
+        if (!draw_batches.empty() &&
+            draw_batches.back().texture_index == draw.texture_index &&
+            draw_batches.back().first_vertex + draw_batches.back().number_of_vertices == draw.first_vertex) {
+            draw_batches.back().number_of_vertices += draw.number_of_vertices;
+        }
+        else {
+            draw_batches.push_back(draw);
+        }
+    }
+}
@@ -0,0 +1,33 @@
+#ifndef PROJECT3D_DRAW_BATCH_H
+#define PROJECT3D_DRAW_BATCH_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <DirectXMath.h>
+
+#include "object_loader.h"
+#include "spatial_index.h"
+
+// A range of the vertex buffer drawn with one texture; texture_index is 0 for
+// none, otherwise 1 + the position of the texture in the model's texture uris.
+struct DrawBatch {
+    std::uint32_t first_vertex;
+    std::uint32_t number_of_vertices;
+    std::uint32_t texture_index;
+};
+
+// One draw per submesh of the loaded model, with the submesh bounds inserted
+// into index (user data is the position of the draw).
+void create_submesh_draws(const ObjectLoader& object_loader, const std::vector<std::wstring>& texture_uris,
+                          std::vector<DrawBatch>& submesh_draws, SpatialIndex& index);
+
+// Submeshes come sorted by texture, so every run of visible submeshes sharing
+// a texture becomes a single draw over a continuous range of the vertex buffer.
+// The index is in model space, so are the planes of world * view * projection.
+// visible_submeshes and submesh_visible are scratch space kept between frames.
+void cull_submeshes(const SpatialIndex& index, const std::vector<DrawBatch>& submesh_draws, const DirectX::XMMATRIX& world_view_proj,
+                    std::vector<SpatialIndex::ObjectId>& visible_submeshes, std::vector<bool>& submesh_visible,
+                    std::vector<DrawBatch>& draw_batches);
+
+#endif //PROJECT3D_DRAW_BATCH_H
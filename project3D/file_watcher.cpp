@@ -0,0 +1,182 @@
+#include "file_watcher.h"
+
+#include <cerrno>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+FileWatcher::FileWatcher(std::filesystem::path directory) : FileWatcher(std::move(directory), Options()) {}
+
+FileWatcher::FileWatcher(std::filesystem::path directory, Options options)
+        : directory(std::move(directory)), options(options) {
+#ifdef _WIN32
+    HANDLE handle = CreateFileW(this->directory.c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+
+    if (handle == INVALID_HANDLE_VALUE) {
+        return;
+    }
+
+    directory_handle = handle;
+    stop_event = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+
+    if (stop_event == nullptr) {
+        CloseHandle(directory_handle);
+        directory_handle = nullptr;
+        return;
+    }
+#else
+    notify_descriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+    // Written and closed covers editors saving in place, moved in the ones saving through a temporary file.
+    if (notify_descriptor < 0 || inotify_add_watch(notify_descriptor, this->directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0 ||
+        pipe2(wake_pipe, O_CLOEXEC) != 0) {
+        if (notify_descriptor >= 0) {
+            close(notify_descriptor);
+        }
+
+        notify_descriptor = -1;
+        return;
+    }
+#endif
+
+    thread = std::thread(&FileWatcher::thread_main, this);
+}
+
+FileWatcher::~FileWatcher() {
+    if (!thread.joinable()) {
+        return;
+    }
+
+#ifdef _WIN32
+    SetEvent(stop_event);
+    thread.join();
+    CloseHandle(stop_event);
+    CloseHandle(directory_handle);
+#else
+    char byte = 0;
+    [[maybe_unused]] ssize_t written = write(wake_pipe[1], &byte, 1);
+    thread.join();
+    close(wake_pipe[0]);
+    close(wake_pipe[1]);
+    close(notify_descriptor);
+#endif
+}
+
+bool FileWatcher::is_watching() const {
+    return thread.joinable();
+}
+
+std::vector<FileWatcher::Change> FileWatcher::poll() {
+    std::vector<Change> changes;
+    Clock::time_point now = Clock::now();
+    std::lock_guard<std::mutex> lock(mutex);
+
+    for (auto it = pending.begin(); it != pending.end();) {
+        if (now - it->second.last_time >= options.settle_time) {
+            changes.push_back({it->first, it->second.first_time});
+            it = pending.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+
+    return changes;
+}
+
+void FileWatcher::record(const std::filesystem::path& path) {
+    Clock::time_point now = Clock::now();
+    std::lock_guard<std::mutex> lock(mutex);
+    auto [it, inserted] = pending.try_emplace(path, Pending{now, now});
+    it->second.last_time = now;
+}
+
+void FileWatcher::thread_main() {
+#ifdef _WIN32
+    OVERLAPPED overlapped = {};
+    overlapped.hEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+    alignas(DWORD) BYTE buffer[16384];
+
+    while (overlapped.hEvent != nullptr) {
+        ResetEvent(overlapped.hEvent);
+
+        if (!ReadDirectoryChangesW(directory_handle, buffer, sizeof(buffer), FALSE,
+                                   FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_SIZE,
+                                   nullptr, &overlapped, nullptr)) {
+            break;
+        }
+
+        HANDLE handles[] = { overlapped.hEvent, stop_event };
+        DWORD bytes = 0;
+
+        if (WaitForMultipleObjects(2, handles, FALSE, INFINITE) != WAIT_OBJECT_0) {
+            CancelIoEx(directory_handle, &overlapped);
+            GetOverlappedResult(directory_handle, &overlapped, &bytes, TRUE);
+            break;
+        }
+
+        if (!GetOverlappedResult(directory_handle, &overlapped, &bytes, FALSE)) {
+            break;
+        }
+
+        // No bytes means the buffer overflowed and the changes are lost; the next save is reported again.
+        for (DWORD offset = 0; bytes > 0;) {
+            const auto* information = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(buffer + offset);
+
+            if (information->Action == FILE_ACTION_ADDED || information->Action == FILE_ACTION_MODIFIED ||
+                information->Action == FILE_ACTION_RENAMED_NEW_NAME) {
+                record(directory / std::wstring(information->FileName, information->FileNameLength / sizeof(WCHAR)));
+            }
+
+            if (information->NextEntryOffset == 0) {
+                break;
+            }
+
+            offset += information->NextEntryOffset;
+        }
+    }
+
+    if (overlapped.hEvent != nullptr) {
+        CloseHandle(overlapped.hEvent);
+    }
+#else
+    alignas(inotify_event) char buffer[16384];
+
+    while (true) {
+        pollfd descriptors[] = { { notify_descriptor, POLLIN, 0 }, { wake_pipe[0], POLLIN, 0 } };
+
+        int ready = ::poll(descriptors, 2, -1);
+
+        if (ready < 0 && errno == EINTR) {
+            continue;
+        }
+
+        if (ready < 0 || descriptors[1].revents != 0) {
+            break;
+        }
+
+        ssize_t length;
+
+        while ((length = read(notify_descriptor, buffer, sizeof(buffer))) > 0) {
+            for (ssize_t offset = 0; offset < length;) {
+                const auto* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+
+                if (event->len > 0) {
+                    record(directory / event->name);
+                }
+
+                offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+            }
+        }
+    }
+#endif
+}
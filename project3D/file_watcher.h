@@ -0,0 +1,69 @@
+#ifndef PROJECT3D_FILE_WATCHER_H
+#define PROJECT3D_FILE_WATCHER_H
+
+#include <chrono>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Reports files of one directory (not its subdirectories) that were written
+// or replaced, e.g. saved by an editor. A background thread waits for the
+// notifications (inotify on Linux, ReadDirectoryChangesW on Windows); a file
+// is reported once no further change arrived for settle_time, so a save
+// written in several parts or through a temporary file and a rename is
+// reported once and only after it is complete.
+class FileWatcher {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Options {
+        std::chrono::milliseconds settle_time{50};
+    };
+
+    struct Change {
+        std::filesystem::path path;
+
+        // Of the first notification of the burst, i.e. about when the save started
+        Clock::time_point first_time;
+    };
+
+    explicit FileWatcher(std::filesystem::path directory);
+    FileWatcher(std::filesystem::path directory, Options options);
+    ~FileWatcher();
+
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    // False when the directory could not be watched; poll() then never reports anything.
+    bool is_watching() const;
+
+    // Files whose changes have settled since the last call, each once.
+    std::vector<Change> poll();
+
+private:
+    struct Pending {
+        Clock::time_point first_time;
+        Clock::time_point last_time;
+    };
+
+    void thread_main();
+    void record(const std::filesystem::path& path);
+
+    const std::filesystem::path directory;
+    const Options options;
+    std::mutex mutex;
+    std::map<std::filesystem::path, Pending> pending;
+    std::thread thread;
+
+    // inotify descriptor and the pipe that wakes the thread up to stop, elsewhere than on Windows
+    int notify_descriptor = -1;
+    int wake_pipe[2] = { -1, -1 };
+
+    // Directory handle and the event that stops the thread, on Windows
+    void* directory_handle = nullptr;
+    void* stop_event = nullptr;
+};
+
+#endif //PROJECT3D_FILE_WATCHER_H
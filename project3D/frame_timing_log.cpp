@@ -0,0 +1,79 @@
+#include "frame_timing_log.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <numeric>
+
+FrameTimingLog::FrameTimingLog(std::vector<std::string> columns) : columns(std::move(columns)) {}
+
+void FrameTimingLog::add_frame(const std::vector<double>& values) {
+    frames.push_back(values);
+    frames.back().resize(columns.size(), 0.0);
+}
+
+std::size_t FrameTimingLog::get_number_of_frames() const {
+    return frames.size();
+}
+
+HRESULT FrameTimingLog::write_csv(const std::filesystem::path& path) const {
+    std::ofstream file(path);
+
+    if (!file.is_open()) {
+        return E_FAIL;
+    }
+
+    file << "frame";
+
+    for (const auto& column : columns) {
+        file << ',' << column;
+    }
+
+    file << '\n';
+
+    for (std::size_t i = 0; i < frames.size(); i++) {
+        file << i;
+
+        for (double value : frames[i]) {
+            file << ',' << value;
+        }
+
+        file << '\n';
+    }
+
+    return file.fail() ? E_FAIL : S_OK;
+}
+
+std::string FrameTimingLog::get_summary() const {
+    std::string summary = "frames: " + std::to_string(frames.size()) + "\n";
+    char line[160];
+
+    std::snprintf(line, sizeof(line), "%-24s %10s %10s %10s %10s %10s\n", "", "mean", "p50", "p95", "p99", "max");
+    summary += line;
+
+    if (frames.empty()) {
+        return summary;
+    }
+
+    std::vector<double> values(frames.size());
+
+    for (std::size_t column = 0; column < columns.size(); column++) {
+        for (std::size_t i = 0; i < frames.size(); i++) {
+            values[i] = frames[i][column];
+        }
+
+        std::sort(values.begin(), values.end());
+
+        auto percentile = [&values](double p) {
+            return values[static_cast<std::size_t>(p / 100.0 * static_cast<double>(values.size() - 1) + 0.5)];
+        };
+
+        double mean = std::accumulate(values.begin(), values.end(), 0.0) / static_cast<double>(values.size());
+
+        std::snprintf(line, sizeof(line), "%-24s %10.4f %10.4f %10.4f %10.4f %10.4f\n",
+                      columns[column].c_str(), mean, percentile(50.0), percentile(95.0), percentile(99.0), values.back());
+        summary += line;
+    }
+
+    return summary;
+}
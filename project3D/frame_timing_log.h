@@ -0,0 +1,28 @@
+#ifndef PROJECT3D_FRAME_TIMING_LOG_H
+#define PROJECT3D_FRAME_TIMING_LOG_H
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "hresult.h"
+
+// Per-frame timings of a benchmark run, one value per column for every frame.
+class FrameTimingLog {
+public:
+    explicit FrameTimingLog(std::vector<std::string> columns);
+
+    void add_frame(const std::vector<double>& values);
+    std::size_t get_number_of_frames() const;
+
+    HRESULT write_csv(const std::filesystem::path& path) const;
+
+    // Mean, p50, p95, p99 and max of every column as a text table.
+    std::string get_summary() const;
+
+private:
+    std::vector<std::string> columns;
+    std::vector<std::vector<double>> frames;
+};
+
+#endif //PROJECT3D_FRAME_TIMING_LOG_H
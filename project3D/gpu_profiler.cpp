@@ -0,0 +1,158 @@
+#include "gpu_profiler.h"
+
+#include <algorithm>
+#include <windows.h>
+
+#include "profiler.h"
+
+HRESULT GpuProfiler::initialize(ID3D12Device* device, ID3D12CommandQueue* command_queue, UINT max_zones) {
+    HRESULT hr = S_OK;
+
+    queue = command_queue;
+    query_capacity = 2 * max_zones;
+
+    D3D12_QUERY_HEAP_DESC query_heap_desc = {};
+    query_heap_desc.Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+    query_heap_desc.Count = query_capacity;
+    query_heap_desc.NodeMask = 0;
+
+    hr = device->CreateQueryHeap(&query_heap_desc, IID_PPV_ARGS(&query_heap));
+
+    if (SUCCEEDED(hr)) {
+        D3D12_HEAP_PROPERTIES heap_properties = {};
+        heap_properties.Type = D3D12_HEAP_TYPE_READBACK;
+        heap_properties.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+        heap_properties.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+        heap_properties.CreationNodeMask = 1;
+        heap_properties.VisibleNodeMask = 1;
+
+        D3D12_RESOURCE_DESC resource_desc = {};
+        resource_desc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+        resource_desc.Alignment = 0;
+        resource_desc.Width = query_capacity * sizeof(UINT64);
+        resource_desc.Height = 1;
+        resource_desc.DepthOrArraySize = 1;
+        resource_desc.MipLevels = 1;
+        resource_desc.Format = DXGI_FORMAT_UNKNOWN;
+        resource_desc.SampleDesc = { .Count = 1, .Quality = 0 };
+        resource_desc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+        resource_desc.Flags = D3D12_RESOURCE_FLAG_NONE;
+
+        hr = device->CreateCommittedResource(
+                &heap_properties,
+                D3D12_HEAP_FLAG_NONE,
+                &resource_desc,
+                D3D12_RESOURCE_STATE_COPY_DEST,
+                nullptr,
+                IID_PPV_ARGS(&readback_buffer)
+        );
+    }
+
+    if (SUCCEEDED(hr)) {
+        hr = queue->GetTimestampFrequency(&timestamp_frequency);
+    }
+
+    return hr;
+}
+
+void GpuProfiler::begin_zone(ID3D12GraphicsCommandList* command_list, const char* name) {
+    if (queries_used + 2 > query_capacity) {
+        return;
+    }
+
+    open_zones.push_back(zones.size());
+    zones.push_back({name, queries_used, queries_used + 1});
+    command_list->EndQuery(query_heap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, queries_used);
+    queries_used += 2;
+}
+
+void GpuProfiler::end_zone(ID3D12GraphicsCommandList* command_list) {
+    if (open_zones.empty()) {
+        return;
+    }
+
+    command_list->EndQuery(query_heap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, zones[open_zones.back()].end_query);
+    open_zones.pop_back();
+}
+
+void GpuProfiler::resolve(ID3D12GraphicsCommandList* command_list) {
+    if (queries_used == 0) {
+        return;
+    }
+
+    command_list->ResolveQueryData(query_heap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, 0, queries_used, readback_buffer.Get(), 0);
+    resolved = true;
+}
+
+HRESULT GpuProfiler::collect() {
+    HRESULT hr = S_OK;
+
+    if (!resolved) {
+        zones.clear();
+        open_zones.clear();
+        queries_used = 0;
+        return hr;
+    }
+
+    UINT64 gpu_calibration = 0;
+    UINT64 cpu_calibration = 0;
+    LARGE_INTEGER qpc_frequency;
+    LARGE_INTEGER qpc_now;
+    UINT64* timestamps = nullptr;
+
+    hr = queue->GetClockCalibration(&gpu_calibration, &cpu_calibration);
+
+    if (SUCCEEDED(hr)) {
+        D3D12_RANGE read_range = { 0, queries_used * sizeof(UINT64) };
+        hr = readback_buffer->Map(0, &read_range, reinterpret_cast<void**>(&timestamps));
+    }
+
+    if (SUCCEEDED(hr)) {
+        Profiler& profiler = Profiler::get();
+        Profiler::Track& track = profiler.get_track("GPU");
+
+        QueryPerformanceFrequency(&qpc_frequency);
+        QueryPerformanceCounter(&qpc_now);
+        const UINT64 profiler_now = Profiler::now();
+
+        // GPU ticks -> QPC via the queue calibration, QPC -> profiler ticks relative to "now".
+        auto to_profiler_ticks = [&](UINT64 gpu_timestamp) {
+            double gpu_seconds = (static_cast<double>(gpu_timestamp) - static_cast<double>(gpu_calibration)) /
+                                 static_cast<double>(timestamp_frequency);
+            double qpc = static_cast<double>(cpu_calibration) + gpu_seconds * static_cast<double>(qpc_frequency.QuadPart);
+            double seconds_ago = (static_cast<double>(qpc_now.QuadPart) - qpc) / static_cast<double>(qpc_frequency.QuadPart);
+            return static_cast<UINT64>(static_cast<double>(profiler_now) - seconds_ago * profiler.get_ticks_per_second());
+        };
+
+        UINT64 frame_begin = UINT64_MAX;
+        UINT64 frame_end = 0;
+
+        for (const auto& zone : zones) {
+            UINT64 begin = timestamps[zone.begin_query];
+            UINT64 end = timestamps[zone.end_query];
+
+            track.record(zone.name, to_profiler_ticks(begin), to_profiler_ticks(end));
+            frame_begin = std::min(frame_begin, begin);
+            frame_end = std::max(frame_end, end);
+        }
+
+        if (frame_end > frame_begin) {
+            frame_statistics.add(static_cast<double>(frame_end - frame_begin) * 1000.0 /
+                                 static_cast<double>(timestamp_frequency));
+        }
+
+        D3D12_RANGE written_range = { 0, 0 };
+        readback_buffer->Unmap(0, &written_range);
+    }
+
+    zones.clear();
+    open_zones.clear();
+    queries_used = 0;
+    resolved = false;
+
+    return hr;
+}
+
+RollingStatistics& GpuProfiler::get_frame_statistics() {
+    return frame_statistics;
+}
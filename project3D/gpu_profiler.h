@@ -0,0 +1,47 @@
+#ifndef PROJECT3D_GPU_PROFILER_H
+#define PROJECT3D_GPU_PROFILER_H
+
+#include <d3d12.h>
+#include <wrl.h>
+#include <vector>
+
+#include "rolling_statistics.h"
+
+// GPU zones measured with D3D12 timestamp queries. The results are converted
+// to the CPU profiler clock and appear on the "GPU" track of the Chrome trace.
+class GpuProfiler {
+public:
+    HRESULT initialize(ID3D12Device* device, ID3D12CommandQueue* command_queue, UINT max_zones);
+
+    void begin_zone(ID3D12GraphicsCommandList* command_list, const char* name);
+    void end_zone(ID3D12GraphicsCommandList* command_list);
+
+    // Records copying of the queries of this frame, call just before closing the command list.
+    void resolve(ID3D12GraphicsCommandList* command_list);
+
+    // Reads the resolved timestamps back, the command list must have finished executing.
+    HRESULT collect();
+
+    RollingStatistics& get_frame_statistics();
+
+private:
+    struct Zone {
+        const char* name;
+        UINT begin_query;
+        UINT end_query;
+    };
+
+    Microsoft::WRL::ComPtr<ID3D12QueryHeap> query_heap;
+    Microsoft::WRL::ComPtr<ID3D12Resource> readback_buffer;
+    Microsoft::WRL::ComPtr<ID3D12CommandQueue> queue;
+    UINT query_capacity = 0;
+    UINT queries_used = 0;
+    UINT64 timestamp_frequency = 0;
+    std::vector<Zone> zones;
+    std::vector<size_t> open_zones;
+    bool resolved = false;
+
+    RollingStatistics frame_statistics;
+};
+
+#endif //PROJECT3D_GPU_PROFILER_H
@@ -0,0 +1,26 @@
+#ifndef PROJECT3D_HRESULT_H
+#define PROJECT3D_HRESULT_H
+
+// Modules shared with the benchmarks report errors the same way as the rest
+// of the project, so outside of Windows the few HRESULT definitions they use
+// are provided here.
+#ifdef _WIN32
+#include <winerror.h>
+#else
+#include <cstdint>
+
+typedef std::int32_t HRESULT;
+
+#define S_OK ((HRESULT)0x00000000L)
+#define S_FALSE ((HRESULT)0x00000001L)
+#define E_NOTIMPL ((HRESULT)0x80004001L)
+#define E_ABORT ((HRESULT)0x80004004L)
+#define E_FAIL ((HRESULT)0x80004005L)
+#define E_OUTOFMEMORY ((HRESULT)0x8007000EL)
+#define E_INVALIDARG ((HRESULT)0x80070057L)
+
+#define SUCCEEDED(hr) (((HRESULT)(hr)) >= 0)
+#define FAILED(hr) (((HRESULT)(hr)) < 0)
+#endif
+
+#endif //PROJECT3D_HRESULT_H
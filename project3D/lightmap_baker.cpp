@@ -0,0 +1,206 @@
+#include "lightmap_baker.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+
+#include "sampling.h"
+
+namespace {
+    // With fewer samples the spread estimate is too noisy to call a texel converged.
+    constexpr std::uint32_t MIN_CONVERGED_SAMPLES = 8;
+
+    float get_luminance(const DirectX::XMFLOAT3& color) {
+        return 0.2126f * color.x + 0.7152f * color.y + 0.0722f * color.z;
+    }
+
+    DirectX::XMFLOAT3 normalize(DirectX::XMFLOAT3 v) {
+        DirectX::XMStoreFloat3(&v, DirectX::XMVector3Normalize(DirectX::XMLoadFloat3(&v)));
+        return v;
+    }
+
+    // Cosine weighted direction around the normal
+    DirectX::XMFLOAT3 sample_hemisphere(const DirectX::XMFLOAT3& n, Random& random) {
+        float radius = std::sqrt(random.next());
+        float angle = 2.0f * DirectX::XM_PI * random.next();
+        float x = radius * std::cos(angle);
+        float y = radius * std::sin(angle);
+        float z = std::sqrt(std::max(0.0f, 1.0f - x * x - y * y));
+
+        DirectX::XMFLOAT3 tangent;
+        DirectX::XMFLOAT3 bitangent;
+        get_orthonormal_basis(n, tangent, bitangent);
+
+        return {
+                x * tangent.x + y * bitangent.x + z * n.x,
+                x * tangent.y + y * bitangent.y + z * n.y,
+                x * tangent.z + y * bitangent.z + z * n.z
+        };
+    }
+}
+
+LightmapBaker::LightmapBaker(const std::vector<Vertex>& vertices, const TriangleBvh& bvh, Options options)
+        : vertices(vertices), bvh(bvh), options(options) {
+    this->options.sun_direction = normalize(options.sun_direction);
+    texels = rasterize_uvs(vertices, options.width, options.height);
+    texel_sums.assign(texels.size(), {0.0f, 0.0f, 0.0f});
+    texel_luminance_squares.assign(texels.size(), 0.0f);
+    statistics.texels = texels.size();
+    statistics.relative_error = 1.0;
+}
+
+LightmapBaker::LightmapBaker(const std::vector<Vertex>& vertices, const TriangleBvh& bvh)
+        : LightmapBaker(vertices, bvh, Options()) {
+}
+
+const LightmapBaker::Statistics& LightmapBaker::refine(TaskScheduler& scheduler) {
+    auto start = std::chrono::steady_clock::now();
+    std::uint32_t pass = statistics.samples;
+    std::atomic<std::uint64_t> rays = 0;
+
+    scheduler.parallel_for(0, texels.size(), [&](std::size_t begin, std::size_t end) {
+        std::uint64_t range_rays = 0;
+
+        // One random stream per texel and pass, so the result does not depend on the thread that traced it.
+        for (std::size_t i = begin; i < end; i++) {
+            DirectX::XMFLOAT3 sample = trace({texels[i].position, texels[i].normal}, hash_seed(static_cast<std::uint32_t>(i) ^ hash_seed(pass)), range_rays);
+            DirectX::XMFLOAT3& sum = texel_sums[i];
+            sum = {sum.x + sample.x, sum.y + sample.y, sum.z + sample.z};
+
+            float luminance = get_luminance(sample);
+            texel_luminance_squares[i] += luminance * luminance;
+        }
+
+        rays.fetch_add(range_rays, std::memory_order_relaxed);
+    }, 256);
+
+    statistics.samples++;
+    statistics.pass_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    statistics.rays_per_second = statistics.pass_ms > 0.0 ? static_cast<double>(rays.load()) / (statistics.pass_ms / 1000.0) : 0.0;
+
+    // Standard error of the mean from the running sums; the first pass has no spread to measure.
+    double samples = statistics.samples;
+    double error_sum = 0.0;
+    std::size_t converged = 0;
+
+    for (std::size_t i = 0; i < texels.size() && samples > 1.0; i++) {
+        double mean = get_luminance(texel_sums[i]) / samples;
+        double variance = std::max(0.0, (texel_luminance_squares[i] / samples - mean * mean) * samples / (samples - 1.0));
+        double error = std::sqrt(variance / samples) / std::max(mean, 1e-4);
+
+        error_sum += error;
+        converged += error < options.target_error && statistics.samples >= MIN_CONVERGED_SAMPLES ? 1 : 0;
+    }
+
+    if (samples > 1.0 && !texels.empty()) {
+        statistics.relative_error = error_sum / static_cast<double>(texels.size());
+        statistics.converged = static_cast<double>(converged) / static_cast<double>(texels.size());
+    }
+
+    return statistics;
+}
+
+DirectX::XMFLOAT3 LightmapBaker::get_sun_light(const Surface& surface, std::uint64_t& rays) const {
+    const DirectX::XMFLOAT3& n = surface.normal;
+    const DirectX::XMFLOAT3& l = options.sun_direction;
+    float cosine = n.x * l.x + n.y * l.y + n.z * l.z;
+
+    if (cosine <= 0.0f) {
+        return {0.0f, 0.0f, 0.0f};
+    }
+
+    Ray ray = {
+            {surface.position.x + n.x * options.ray_offset, surface.position.y + n.y * options.ray_offset, surface.position.z + n.z * options.ray_offset},
+            l
+    };
+    rays++;
+
+    if (bvh.occluded(ray)) {
+        return {0.0f, 0.0f, 0.0f};
+    }
+
+    return {options.sun_color.x * cosine, options.sun_color.y * cosine, options.sun_color.z * cosine};
+}
+
+// Light leaving the surface towards the viewer: albedo * (sun + light gathered over the hemisphere).
+DirectX::XMFLOAT3 LightmapBaker::trace(Surface surface, std::uint32_t seed, std::uint64_t& rays) const {
+    Random random = {seed};
+    DirectX::XMFLOAT3 light = get_sun_light(surface, rays);
+    float throughput = 1.0f;
+
+    for (std::uint32_t bounce = 0; bounce <= options.max_bounces; bounce++) {
+        const DirectX::XMFLOAT3& n = surface.normal;
+        Ray ray = {
+                {surface.position.x + n.x * options.ray_offset, surface.position.y + n.y * options.ray_offset, surface.position.z + n.z * options.ray_offset},
+                normalize(sample_hemisphere(n, random))
+        };
+        RayHit hit = {};
+        rays++;
+
+        if (!bvh.intersect(ray, hit)) {
+            light = {light.x + throughput * options.sky_color.x, light.y + throughput * options.sky_color.y, light.z + throughput * options.sky_color.z};
+            break;
+        }
+
+        if (bounce == options.max_bounces) {
+            break;
+        }
+
+        DirectX::XMFLOAT3 hit_normal = get_interpolated_normal(&vertices[3 * static_cast<std::size_t>(hit.triangle)], hit.u, hit.v);
+        DirectX::XMVECTOR normal = DirectX::XMLoadFloat3(&hit_normal);
+
+        // Scans are not consistently wound, the side the ray came from is the lit one.
+        if (DirectX::XMVectorGetX(DirectX::XMVector3Dot(normal, DirectX::XMLoadFloat3(&ray.direction))) > 0.0f) {
+            normal = DirectX::XMVectorNegate(normal);
+        }
+
+        surface.position = hit.position;
+        DirectX::XMStoreFloat3(&surface.normal, normal);
+        throughput *= options.albedo;
+
+        DirectX::XMFLOAT3 sun = get_sun_light(surface, rays);
+        light = {light.x + throughput * sun.x, light.y + throughput * sun.y, light.z + throughput * sun.z};
+    }
+
+    return {options.albedo * light.x, options.albedo * light.y, options.albedo * light.z};
+}
+
+const LightmapBaker::Statistics& LightmapBaker::get_statistics() const {
+    return statistics;
+}
+
+void LightmapBaker::get_bitmap(std::vector<std::uint8_t>& bitmap) const {
+    std::size_t pixel_count = static_cast<std::size_t>(options.width) * options.height;
+    std::vector<float> colors(pixel_count * 3, 0.0f);
+    float scale = statistics.samples > 0 ? 1.0f / static_cast<float>(statistics.samples) : 0.0f;
+
+    for (std::size_t i = 0; i < texels.size(); i++) {
+        float* color = &colors[3 * static_cast<std::size_t>(texels[i].pixel)];
+        color[0] = texel_sums[i].x * scale;
+        color[1] = texel_sums[i].y * scale;
+        color[2] = texel_sums[i].z * scale;
+    }
+
+    pad_uv_charts(colors, 3, texels, options.width, options.height, options.padding);
+    bitmap.resize(pixel_count * 4);
+
+    auto encode = [](float value) {
+        return static_cast<std::uint8_t>(std::lround(255.0f * std::pow(std::clamp(value, 0.0f, 1.0f), 1.0f / 2.2f)));
+    };
+
+    for (std::size_t pixel = 0; pixel < pixel_count; pixel++) {
+        bitmap[4 * pixel + 0] = encode(colors[3 * pixel + 0]);
+        bitmap[4 * pixel + 1] = encode(colors[3 * pixel + 1]);
+        bitmap[4 * pixel + 2] = encode(colors[3 * pixel + 2]);
+        bitmap[4 * pixel + 3] = 0xff;
+    }
+}
+
+std::uint32_t LightmapBaker::get_width() const {
+    return options.width;
+}
+
+std::uint32_t LightmapBaker::get_height() const {
+    return options.height;
+}
@@ -0,0 +1,97 @@
+#ifndef PROJECT3D_LIGHTMAP_BAKER_H
+#define PROJECT3D_LIGHTMAP_BAKER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <DirectXMath.h>
+
+#include "common.h"
+#include "task_scheduler.h"
+#include "triangle_bvh.h"
+#include "uv_rasterizer.h"
+
+// Bakes lighting (a sun and a uniform sky, direct and indirect) into a
+// texture over the uvs of a mesh. Every triangle is rasterized into uv space
+// once; each covered texel keeps its surface point and normal. refine() then
+// traces one more path per texel on all workers, so the result can be shown
+// or stopped at any time and gets less noisy with every pass.
+//
+// The mesh has no materials other than the texture being baked, so every
+// surface is grey with the same albedo.
+class LightmapBaker {
+public:
+    struct Options {
+        std::uint32_t width = 1024;
+        std::uint32_t height = 1024;
+
+        // Indirect bounces after the first hit, 0 is direct light only (sun and sky).
+        std::uint32_t max_bounces = 2;
+
+        // Towards the sun
+        DirectX::XMFLOAT3 sun_direction = {0.4f, 1.0f, 0.3f};
+        DirectX::XMFLOAT3 sun_color = {1.0f, 0.95f, 0.85f};
+        DirectX::XMFLOAT3 sky_color = {0.35f, 0.42f, 0.55f};
+        float albedo = 0.7f;
+
+        // Ray origins are moved this far along the normal, so they do not hit their own triangle.
+        float ray_offset = 1e-3f;
+
+        // Relative standard error below which a texel counts as converged
+        float target_error = 0.02f;
+
+        // Texels around uv charts filled from their neighbours, so bilinear filtering does not bleed the background in
+        std::uint32_t padding = 2;
+    };
+
+    struct Statistics {
+        // Paths traced per texel so far
+        std::uint32_t samples = 0;
+        std::size_t texels = 0;
+        double pass_ms = 0.0;
+        double rays_per_second = 0.0;
+
+        // Mean over texels of the standard error of the luminance relative to the luminance
+        double relative_error = 0.0;
+
+        // Fraction of texels below target_error
+        double converged = 0.0;
+    };
+
+    // bvh has to be built from vertices (in the same order).
+    LightmapBaker(const std::vector<Vertex>& vertices, const TriangleBvh& bvh, Options options);
+    LightmapBaker(const std::vector<Vertex>& vertices, const TriangleBvh& bvh);
+
+    // Traces one path for every texel.
+    const Statistics& refine(TaskScheduler& scheduler);
+
+    const Statistics& get_statistics() const;
+
+    // 8-bit RGBA (gamma 2.2), rows from the top, ready for a texture upload.
+    void get_bitmap(std::vector<std::uint8_t>& bitmap) const;
+
+    std::uint32_t get_width() const;
+    std::uint32_t get_height() const;
+
+private:
+    struct Surface {
+        DirectX::XMFLOAT3 position;
+        DirectX::XMFLOAT3 normal;
+    };
+
+    DirectX::XMFLOAT3 trace(Surface surface, std::uint32_t seed, std::uint64_t& rays) const;
+    DirectX::XMFLOAT3 get_sun_light(const Surface& surface, std::uint64_t& rays) const;
+
+    const std::vector<Vertex>& vertices;
+    const TriangleBvh& bvh;
+    Options options;
+
+    // Covered texels and their accumulated samples
+    std::vector<UvTexel> texels;
+    std::vector<DirectX::XMFLOAT3> texel_sums;
+    std::vector<float> texel_luminance_squares;
+
+    Statistics statistics;
+};
+
+#endif //PROJECT3D_LIGHTMAP_BAKER_H
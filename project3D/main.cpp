@@ -1,10 +1,27 @@
 #include "app.h"
+#include "app_options.h"
+
+#include <utility>
 
 INT WINAPI wWinMain(_In_ [[maybe_unused]] HINSTANCE instance,
         _In_opt_ [[maybe_unused]] HINSTANCE prev_instance,
-        _In_ [[maybe_unused]] PWSTR cmd_line,
+        _In_ PWSTR cmd_line,
         _In_ [[maybe_unused]] INT cmd_show) {
-    App app(L"JNP3 - 3D Project");
+    AppOptions options = ParseAppOptions(cmd_line);
+
+    if (!options.pack_path.empty()) {
+        return SUCCEEDED(App::WriteAssetPackage(options.pack_path)) ? 0 : 1;
+    }
+
+    if (!options.cook_path.empty()) {
+        return SUCCEEDED(App::CookModel(options.cook_path, options.cook_budget)) ? 0 : 1;
+    }
+
+    if (!options.build_path.empty()) {
+        return SUCCEEDED(App::BuildAssets(options.build_path)) ? 0 : 1;
+    }
+
+    App app(L"JNP3 - 3D Project", std::move(options));
 
     if (SUCCEEDED(app.Initialize(instance, cmd_show))) {
         app.RunMessageLoop();
@@ -0,0 +1,205 @@
+#include "mesh_attributes.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "sampling.h"
+
+namespace {
+    constexpr std::size_t TRIANGLE_GRAIN = 4096;
+    constexpr std::size_t POSITION_GRAIN = 4096;
+
+    // Corners (vertex indices) of every position, stored one position after another.
+    struct CornerLists {
+        std::vector<std::uint32_t> offsets;
+        std::vector<std::uint32_t> corners;
+    };
+
+    CornerLists get_corner_lists(const std::vector<std::uint32_t>& position_indices) {
+        CornerLists lists;
+        std::uint32_t position_count = position_indices.empty() ? 0 : *std::max_element(position_indices.begin(), position_indices.end()) + 1;
+        lists.offsets.assign(static_cast<std::size_t>(position_count) + 1, 0);
+
+        for (std::uint32_t position : position_indices) {
+            lists.offsets[position + 1]++;
+        }
+
+        for (std::size_t i = 1; i < lists.offsets.size(); i++) {
+            lists.offsets[i] += lists.offsets[i - 1];
+        }
+
+        std::vector<std::uint32_t> next(lists.offsets.begin(), lists.offsets.end() - 1);
+        lists.corners.resize(position_indices.size());
+
+        for (std::size_t i = 0; i < position_indices.size(); i++) {
+            lists.corners[next[position_indices[i]]++] = static_cast<std::uint32_t>(i);
+        }
+
+        return lists;
+    }
+
+    float get_corner_angle(DirectX::FXMVECTOR corner, DirectX::FXMVECTOR next, DirectX::FXMVECTOR previous) {
+        DirectX::XMVECTOR a = DirectX::XMVector3Normalize(DirectX::XMVectorSubtract(next, corner));
+        DirectX::XMVECTOR b = DirectX::XMVector3Normalize(DirectX::XMVectorSubtract(previous, corner));
+        return std::acos(std::clamp(DirectX::XMVectorGetX(DirectX::XMVector3Dot(a, b)), -1.0f, 1.0f));
+    }
+
+    // Below this squared length sums of unit vectors are rounding noise, they cancelled out.
+    constexpr float MIN_SUM_LENGTH_SQUARED = 1e-8f;
+
+    // Normalized, or zero when too short to have a direction.
+    DirectX::XMVECTOR get_direction(DirectX::FXMVECTOR v, float min_length_squared = 1e-24f) {
+        return DirectX::XMVectorGetX(DirectX::XMVector3LengthSq(v)) > min_length_squared ? DirectX::XMVector3Normalize(v) : DirectX::XMVectorZero();
+    }
+
+    bool equal_bits(const void* a, const void* b, std::size_t size) {
+        return std::memcmp(a, b, size) == 0;
+    }
+}
+
+void generate_normals(std::vector<Vertex>& vertices, const std::vector<std::uint32_t>& position_indices,
+                      const std::vector<std::uint32_t>& smoothing_groups, TaskScheduler& scheduler) {
+    using namespace DirectX;
+
+    std::size_t triangle_count = vertices.size() / 3;
+    std::vector<XMFLOAT3> face_normals(triangle_count);
+    std::vector<XMFLOAT3> weighted_normals(vertices.size());
+
+    // Face normals and their angle weighted copies at every corner; flat triangles are done here.
+    scheduler.parallel_for(0, triangle_count, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t triangle = begin; triangle < end; triangle++) {
+            if (smoothing_groups[triangle] == KEEP_NORMALS) {
+                continue;
+            }
+
+            Vertex* corners = &vertices[3 * triangle];
+            XMVECTOR p[3] = {XMLoadFloat3(&corners[0].position), XMLoadFloat3(&corners[1].position), XMLoadFloat3(&corners[2].position)};
+            XMVECTOR normal = get_direction(XMVector3Cross(XMVectorSubtract(p[1], p[0]), XMVectorSubtract(p[2], p[0])));
+            XMStoreFloat3(&face_normals[triangle], normal);
+
+            for (int k = 0; k < 3; k++) {
+                if (smoothing_groups[triangle] == 0) {
+                    corners[k].normal = face_normals[triangle];
+                }
+                else {
+                    float angle = get_corner_angle(p[k], p[(k + 1) % 3], p[(k + 2) % 3]);
+                    XMStoreFloat3(&weighted_normals[3 * triangle + k], XMVectorScale(normal, angle));
+                }
+            }
+        }
+    }, TRIANGLE_GRAIN);
+
+    CornerLists lists = get_corner_lists(position_indices);
+
+    // Every corner belongs to exactly one position, so positions can be smoothed independently.
+    scheduler.parallel_for(0, lists.offsets.size() - 1, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t position = begin; position < end; position++) {
+            const std::uint32_t* first = &lists.corners[lists.offsets[position]];
+            const std::uint32_t* last = &lists.corners[lists.offsets[position + 1]];
+
+            for (const std::uint32_t* corner = first; corner != last; corner++) {
+                std::uint32_t group = smoothing_groups[*corner / 3];
+
+                if (group == KEEP_NORMALS || group == 0) {
+                    continue;
+                }
+
+                XMVECTOR sum = XMVectorZero();
+
+                for (const std::uint32_t* other = first; other != last; other++) {
+                    if (smoothing_groups[*other / 3] == group) {
+                        sum = XMVectorAdd(sum, XMLoadFloat3(&weighted_normals[*other]));
+                    }
+                }
+
+                // Faces cancelling each other out (a sheet folded back onto itself) keep their own normal.
+                XMVECTOR normal = get_direction(sum, MIN_SUM_LENGTH_SQUARED);
+                XMStoreFloat3(&vertices[*corner].normal,
+                              XMVectorGetX(XMVector3LengthSq(normal)) > 0.0f ? normal : XMLoadFloat3(&face_normals[*corner / 3]));
+            }
+        }
+    }, POSITION_GRAIN);
+}
+
+std::vector<DirectX::XMFLOAT4> generate_tangents(const std::vector<Vertex>& vertices, const std::vector<std::uint32_t>& position_indices,
+                                                 TaskScheduler& scheduler) {
+    using namespace DirectX;
+
+    std::size_t triangle_count = vertices.size() / 3;
+    std::vector<XMFLOAT4> weighted_tangents(vertices.size());
+    std::vector<XMFLOAT4> tangents(vertices.size());
+
+    scheduler.parallel_for(0, triangle_count, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t triangle = begin; triangle < end; triangle++) {
+            const Vertex* corners = &vertices[3 * triangle];
+            XMVECTOR p[3] = {XMLoadFloat3(&corners[0].position), XMLoadFloat3(&corners[1].position), XMLoadFloat3(&corners[2].position)};
+            XMVECTOR edge1 = XMVectorSubtract(p[1], p[0]);
+            XMVECTOR edge2 = XMVectorSubtract(p[2], p[0]);
+            float du1 = corners[1].texture_coordinates.x - corners[0].texture_coordinates.x;
+            float du2 = corners[2].texture_coordinates.x - corners[0].texture_coordinates.x;
+            float dv1 = corners[0].texture_coordinates.y - corners[1].texture_coordinates.y;
+            float dv2 = corners[0].texture_coordinates.y - corners[2].texture_coordinates.y;
+            float determinant = du1 * dv2 - du2 * dv1;
+
+            // Directions of increasing u and v, zero for triangles without a uv mapping.
+            XMVECTOR tangent = XMVectorZero();
+            XMVECTOR bitangent = XMVectorZero();
+
+            if (std::fabs(determinant) > 1e-20f) {
+                float sign = determinant > 0.0f ? 1.0f : -1.0f;
+                tangent = get_direction(XMVectorScale(XMVectorSubtract(XMVectorScale(edge1, dv2), XMVectorScale(edge2, dv1)), sign));
+                bitangent = XMVectorScale(XMVectorSubtract(XMVectorScale(edge2, du1), XMVectorScale(edge1, du2)), sign);
+            }
+
+            for (int k = 0; k < 3; k++) {
+                XMVECTOR normal = get_direction(XMLoadFloat3(&corners[k].normal));
+                XMVECTOR projected = get_direction(XMVectorSubtract(tangent, XMVectorScale(normal, XMVectorGetX(XMVector3Dot(normal, tangent)))),
+                                                   MIN_SUM_LENGTH_SQUARED);
+                float handedness = XMVectorGetX(XMVector3Dot(XMVector3Cross(normal, projected), bitangent)) < 0.0f ? -1.0f : 1.0f;
+                float angle = get_corner_angle(p[k], p[(k + 1) % 3], p[(k + 2) % 3]);
+
+                XMStoreFloat4(&weighted_tangents[3 * triangle + k], XMVectorSetW(XMVectorScale(projected, angle), handedness));
+            }
+        }
+    }, TRIANGLE_GRAIN);
+
+    CornerLists lists = get_corner_lists(position_indices);
+
+    scheduler.parallel_for(0, lists.offsets.size() - 1, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t position = begin; position < end; position++) {
+            const std::uint32_t* first = &lists.corners[lists.offsets[position]];
+            const std::uint32_t* last = &lists.corners[lists.offsets[position + 1]];
+
+            for (const std::uint32_t* corner = first; corner != last; corner++) {
+                const Vertex& vertex = vertices[*corner];
+                float handedness = weighted_tangents[*corner].w;
+                XMVECTOR sum = XMVectorZero();
+
+                for (const std::uint32_t* other = first; other != last; other++) {
+                    const Vertex& other_vertex = vertices[*other];
+
+                    if (weighted_tangents[*other].w == handedness &&
+                        equal_bits(&other_vertex.normal, &vertex.normal, sizeof(vertex.normal)) &&
+                        equal_bits(&other_vertex.texture_coordinates, &vertex.texture_coordinates, sizeof(vertex.texture_coordinates))) {
+                        sum = XMVectorAdd(sum, XMVectorSetW(XMLoadFloat4(&weighted_tangents[*other]), 0.0f));
+                    }
+                }
+
+                XMVECTOR tangent = get_direction(sum, MIN_SUM_LENGTH_SQUARED);
+                XMFLOAT3 result = {};
+                XMStoreFloat3(&result, tangent);
+
+                // Without uv gradients any direction perpendicular to the normal will do.
+                if (XMVectorGetX(XMVector3LengthSq(tangent)) == 0.0f) {
+                    XMFLOAT3 bitangent;
+                    get_orthonormal_basis(vertex.normal, result, bitangent);
+                }
+
+                tangents[*corner] = {result.x, result.y, result.z, handedness};
+            }
+        }
+    }, POSITION_GRAIN);
+
+    return tangents;
+}
@@ -0,0 +1,35 @@
+#ifndef PROJECT3D_MESH_ATTRIBUTES_H
+#define PROJECT3D_MESH_ATTRIBUTES_H
+
+#include <cstdint>
+#include <vector>
+#include <DirectXMath.h>
+
+#include "common.h"
+#include "task_scheduler.h"
+
+// Normals and tangents for triangle lists (every three vertices form a
+// triangle) loaded without them. position_indices holds, for every vertex,
+// the position it was made from (the v of an OBJ face corner), so corners
+// meeting at a position are found without comparing floats. Both run in
+// parallel, first over triangles and then over positions.
+
+// Smoothing group of a triangle whose normals are kept
+constexpr std::uint32_t KEEP_NORMALS = UINT32_MAX;
+
+// Replaces the normals of every triangle whose smoothing group is not
+// KEEP_NORMALS. Group 0 is flat shaded, in the other groups a corner gets
+// the face normals of the triangles of its group around its position,
+// weighted by their angle at it.
+void generate_normals(std::vector<Vertex>& vertices, const std::vector<std::uint32_t>& position_indices,
+                      const std::vector<std::uint32_t>& smoothing_groups, TaskScheduler& scheduler);
+
+// Per vertex tangents following MikkTSpace: the uv derivative of each
+// triangle projected onto the plane of the vertex normal, weighted by the
+// corner angle and summed over corners sharing position, normal, uv and
+// handedness. w is the sign of the bitangent, cross(normal, tangent) * w.
+// Uvs are taken with v pointing up like in the file (the loader stores -v).
+std::vector<DirectX::XMFLOAT4> generate_tangents(const std::vector<Vertex>& vertices, const std::vector<std::uint32_t>& position_indices,
+                                                 TaskScheduler& scheduler);
+
+#endif //PROJECT3D_MESH_ATTRIBUTES_H
@@ -0,0 +1,179 @@
+#include "mesh_chunk.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <utility>
+
+namespace {
+    constexpr std::uint32_t CHUNK_MAGIC = 0x43443350; // "P3DC"
+    constexpr std::uint32_t CHUNK_VERSION = 1;
+
+    // The header is followed by number_of_vertices encoded with encode_mesh instead of the raw ones.
+    constexpr std::uint32_t COMPRESSED_CHUNK_VERSION = 2;
+
+    struct ChunkHeader {
+        std::uint32_t magic;
+        std::uint32_t version;
+        std::uint64_t number_of_vertices;
+        DirectX::XMFLOAT3 bounds_min;
+        DirectX::XMFLOAT3 bounds_max;
+    };
+
+    // Bytes from the read position to the end of the file
+    std::size_t get_remaining_bytes(std::ifstream& file) {
+        std::streamoff begin = file.tellg();
+        file.seekg(0, std::ios::end);
+        std::streamoff end = file.tellg();
+        file.seekg(begin);
+
+        return static_cast<std::size_t>(std::max<std::streamoff>(end - begin, 0));
+    }
+
+    HRESULT load_compressed(std::ifstream& file, std::uint64_t number_of_vertices, std::vector<Vertex>& vertices) {
+        std::vector<std::uint8_t> encoded(get_remaining_bytes(file));
+
+        if (!file.read(reinterpret_cast<char*>(encoded.data()), static_cast<std::streamsize>(encoded.size()))) {
+            return E_FAIL;
+        }
+
+        HRESULT hr = decode_mesh(encoded.data(), encoded.size(), vertices);
+
+        if (SUCCEEDED(hr) && vertices.size() != number_of_vertices) {
+            hr = E_INVALIDARG;
+        }
+
+        return hr;
+    }
+
+    HRESULT read_chunk_header(std::ifstream& file, ChunkHeader& header) {
+        if (!file.is_open() || !file.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+            return E_FAIL;
+        }
+
+        if (header.magic != CHUNK_MAGIC || (header.version != CHUNK_VERSION && header.version != COMPRESSED_CHUNK_VERSION)) {
+            return E_INVALIDARG;
+        }
+
+        return S_OK;
+    }
+}
+
+HRESULT MeshChunk::load(const std::filesystem::path& path) {
+    std::ifstream file(path, std::ios::binary);
+    ChunkHeader header = {};
+    HRESULT hr = read_chunk_header(file, header);
+
+    if (FAILED(hr)) {
+        return hr;
+    }
+
+    bounds = {header.bounds_min, header.bounds_max};
+
+    if (header.version == COMPRESSED_CHUNK_VERSION) {
+        hr = load_compressed(file, header.number_of_vertices, vertices);
+
+        if (FAILED(hr)) {
+            vertices.clear();
+        }
+
+        return hr;
+    }
+
+    // A damaged or truncated header must not size the allocation.
+    if (header.number_of_vertices > get_remaining_bytes(file) / sizeof(Vertex)) {
+        vertices.clear();
+        return E_FAIL;
+    }
+
+    vertices.resize(static_cast<std::size_t>(header.number_of_vertices));
+
+    if (!file.read(reinterpret_cast<char*>(vertices.data()), static_cast<std::streamsize>(get_size_bytes()))) {
+        vertices.clear();
+        return E_FAIL;
+    }
+
+    return S_OK;
+}
+
+HRESULT MeshChunk::read_header(const std::filesystem::path& path, Aabb& bounds, std::size_t& size_bytes) {
+    std::ifstream file(path, std::ios::binary);
+    ChunkHeader header = {};
+    HRESULT hr = read_chunk_header(file, header);
+
+    if (SUCCEEDED(hr)) {
+        bounds = {header.bounds_min, header.bounds_max};
+        size_bytes = static_cast<std::size_t>(header.number_of_vertices) * sizeof(Vertex);
+    }
+
+    return hr;
+}
+
+HRESULT MeshChunk::save(const std::filesystem::path& path) const {
+    std::ofstream file(path, std::ios::binary);
+
+    if (!file.is_open()) {
+        return E_FAIL;
+    }
+
+    ChunkHeader header = {CHUNK_MAGIC, CHUNK_VERSION, vertices.size(), bounds.min, bounds.max};
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(vertices.data()), static_cast<std::streamsize>(get_size_bytes()));
+
+    return file.good() ? S_OK : E_FAIL;
+}
+
+HRESULT MeshChunk::save_compressed(const std::filesystem::path& path, const MeshEncodeOptions& options) const {
+    std::vector<std::uint8_t> encoded;
+    HRESULT hr = encode_mesh(vertices, encoded, options);
+    std::ofstream file;
+
+    if (SUCCEEDED(hr)) {
+        file.open(path, std::ios::binary);
+        hr = file.is_open() ? S_OK : E_FAIL;
+    }
+
+    if (SUCCEEDED(hr)) {
+        ChunkHeader header = {CHUNK_MAGIC, COMPRESSED_CHUNK_VERSION, vertices.size(), bounds.min, bounds.max};
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(encoded.data()), static_cast<std::streamsize>(encoded.size()));
+        hr = file.good() ? S_OK : E_FAIL;
+    }
+
+    return hr;
+}
+
+std::size_t MeshChunk::get_size_bytes() const {
+    return vertices.size() * sizeof(Vertex);
+}
+
+std::vector<MeshChunk> MeshChunk::split(const std::vector<Vertex>& vertices, float chunk_size) {
+    std::map<std::pair<std::int32_t, std::int32_t>, MeshChunk> cells;
+
+    for (std::size_t i = 0; i + 2 < vertices.size(); i += 3) {
+        float x = (vertices[i].position.x + vertices[i + 1].position.x + vertices[i + 2].position.x) / 3.0f;
+        float z = (vertices[i].position.z + vertices[i + 1].position.z + vertices[i + 2].position.z) / 3.0f;
+        std::pair<std::int32_t, std::int32_t> cell = {
+                static_cast<std::int32_t>(std::floor(z / chunk_size)),
+                static_cast<std::int32_t>(std::floor(x / chunk_size))
+        };
+
+        MeshChunk& chunk = cells[cell];
+
+        for (std::size_t j = i; j < i + 3; j++) {
+            chunk.vertices.push_back(vertices[j]);
+            chunk.bounds.merge(vertices[j].position);
+        }
+    }
+
+    std::vector<MeshChunk> chunks;
+    chunks.reserve(cells.size());
+
+    for (auto& [cell, chunk] : cells) {
+        chunks.push_back(std::move(chunk));
+    }
+
+    return chunks;
+}
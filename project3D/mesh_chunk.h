@@ -0,0 +1,34 @@
+#ifndef PROJECT3D_MESH_CHUNK_H
+#define PROJECT3D_MESH_CHUNK_H
+
+#include <filesystem>
+#include <vector>
+
+#include "bounds.h"
+#include "common.h"
+#include "hresult.h"
+#include "mesh_codec.h"
+
+// Part of a scene that is streamed in and out as a whole. Stored as a small
+// binary header followed by the raw vertices, so loading is a single read,
+// or by the vertices encoded with encode_mesh for shipping over slow links.
+struct MeshChunk {
+    Aabb bounds;
+    std::vector<Vertex> vertices;
+
+    // Reads both raw and compressed chunks.
+    HRESULT load(const std::filesystem::path& path);
+
+    // Bounds and size of the vertices from the header alone, so chunks can be listed without loading them.
+    static HRESULT read_header(const std::filesystem::path& path, Aabb& bounds, std::size_t& size_bytes);
+
+    HRESULT save(const std::filesystem::path& path) const;
+    HRESULT save_compressed(const std::filesystem::path& path, const MeshEncodeOptions& options = {}) const;
+    std::size_t get_size_bytes() const;
+
+    // Groups triangles by the chunk_size x chunk_size cell (x / z) their
+    // centroid falls into. Empty cells get no chunk, chunks are ordered by row.
+    static std::vector<MeshChunk> split(const std::vector<Vertex>& vertices, float chunk_size);
+};
+
+#endif //PROJECT3D_MESH_CHUNK_H
@@ -0,0 +1,787 @@
+#include "mesh_codec.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define MESH_CODEC_SSE2
+#endif
+
+namespace {
+    constexpr std::uint32_t MESH_MAGIC = 0x4D443350; // "P3DM"
+    constexpr std::uint32_t MESH_VERSION = 1;
+
+    constexpr std::size_t VERTEX_BLOCK_SIZE = 256;
+    constexpr std::size_t GROUP_SIZE = 16;
+
+    // Code of a triangle: edge slot in the high nibble and the third vertex in the low one
+    // (0 the next new vertex, 1 to 14 a slot of the vertex FIFO, 15 a delta in the data
+    // stream). High nibble 15 is a triangle without a shared edge, its low three bits mark
+    // the corners that are new vertices, the others are deltas.
+    constexpr std::size_t FIFO_SIZE = 16;
+    constexpr std::uint8_t EDGE_SLOTS = 15;
+    constexpr std::uint8_t VERTEX_SLOTS = 14;
+    constexpr std::uint8_t NO_EDGE = 0xF0;
+    constexpr std::uint8_t NEXT_VERTEX = 0;
+    constexpr std::uint8_t EXPLICIT_VERTEX = 15;
+    constexpr std::uint32_t NO_VERTEX = std::numeric_limits<std::uint32_t>::max();
+
+    // Position xyz, octahedral normal and uv as 16 bit words, color as bytes
+    constexpr std::size_t WORD_COMPONENTS = 7;
+    constexpr std::size_t BYTE_COMPONENTS = 4;
+    constexpr std::size_t PLANES = 2 * WORD_COMPONENTS + BYTE_COMPONENTS;
+
+    struct QuantizedVertex {
+        std::uint16_t words[WORD_COMPONENTS];
+        std::uint8_t bytes[BYTE_COMPONENTS];
+    };
+
+    struct MeshHeader {
+        std::uint32_t magic;
+        std::uint32_t version;
+        std::uint32_t number_of_vertices;
+        std::uint32_t number_of_indices;
+        std::uint32_t index_size;
+        std::uint32_t vertex_size;
+        float position_min[3];
+        float position_scale[3];
+        float texture_coordinate_min[2];
+        float texture_coordinate_scale[2];
+        std::uint32_t normal_bits;
+    };
+
+    struct EdgeFifo {
+        std::uint32_t first[FIFO_SIZE];
+        std::uint32_t second[FIFO_SIZE];
+        std::size_t head = 0;
+
+        EdgeFifo() {
+            std::fill(std::begin(first), std::end(first), NO_VERTEX);
+            std::fill(std::begin(second), std::end(second), NO_VERTEX);
+        }
+
+        // Slot 0 is the edge pushed last.
+        std::size_t get_index(std::size_t slot) const {
+            return (head - 1 - slot) & (FIFO_SIZE - 1);
+        }
+
+        void push(std::uint32_t a, std::uint32_t b) {
+            first[head & (FIFO_SIZE - 1)] = a;
+            second[head & (FIFO_SIZE - 1)] = b;
+            head++;
+        }
+
+        // The edges of the triangle reversed, as a neighbour with the same winding has them.
+        void push_triangle(std::uint32_t a, std::uint32_t b, std::uint32_t c) {
+            push(b, a);
+            push(c, b);
+            push(a, c);
+        }
+    };
+
+    struct VertexFifo {
+        std::uint32_t vertices[FIFO_SIZE];
+        std::size_t head = 0;
+
+        VertexFifo() {
+            std::fill(std::begin(vertices), std::end(vertices), NO_VERTEX);
+        }
+
+        std::uint32_t get(std::size_t slot) const {
+            return vertices[(head - 1 - slot) & (FIFO_SIZE - 1)];
+        }
+
+        void push(std::uint32_t vertex) {
+            vertices[head++ & (FIFO_SIZE - 1)] = vertex;
+        }
+    };
+
+    void write_varint(std::uint32_t value, std::vector<std::uint8_t>& out) {
+        while (value >= 0x80) {
+            out.push_back(static_cast<std::uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+
+        out.push_back(static_cast<std::uint8_t>(value));
+    }
+
+    // Returns nullptr when the data ends in the middle of the number.
+    const std::uint8_t* read_varint(const std::uint8_t* data, const std::uint8_t* end, std::uint32_t& value) {
+        value = 0;
+
+        for (int shift = 0; shift < 35 && data < end; shift += 7) {
+            std::uint8_t byte = *data++;
+            value |= static_cast<std::uint32_t>(byte & 0x7F) << shift;
+
+            if (byte < 0x80) {
+                return data;
+            }
+        }
+
+        return nullptr;
+    }
+
+    std::uint16_t zigzag(std::uint16_t delta) {
+        return static_cast<std::uint16_t>((delta << 1) ^ (0 - (delta >> 15)));
+    }
+
+    std::uint8_t zigzag(std::uint8_t delta) {
+        return static_cast<std::uint8_t>((delta << 1) ^ (0 - (delta >> 7)));
+    }
+
+    std::uint16_t unzigzag(std::uint16_t value) {
+        return static_cast<std::uint16_t>((value >> 1) ^ (0 - (value & 1)));
+    }
+
+    std::uint8_t unzigzag(std::uint8_t value) {
+        return static_cast<std::uint8_t>((value >> 1) ^ (0 - (value & 1)));
+    }
+
+    std::uint32_t get_max_value(int bits) {
+        return (std::uint32_t{1} << bits) - 1;
+    }
+
+    std::uint16_t quantize(float value, float min, float inverse_scale, std::uint32_t max_value) {
+        float quantized = (value - min) * inverse_scale + 0.5f;
+        return static_cast<std::uint16_t>(std::clamp(quantized, 0.0f, static_cast<float>(max_value)));
+    }
+
+    // Octahedral mapping of the unit sphere to [-1, 1]^2, then to bits per coordinate.
+    void encode_normal(const DirectX::XMFLOAT3& normal, int bits, std::uint16_t& u, std::uint16_t& v) {
+        float sum = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+        float x = sum > 0.0f ? normal.x / sum : 0.0f;
+        float y = sum > 0.0f ? normal.y / sum : 0.0f;
+
+        if (normal.z < 0.0f) {
+            float folded_x = (1.0f - std::abs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+            float folded_y = (1.0f - std::abs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+            x = folded_x;
+            y = folded_y;
+        }
+
+        float max_value = static_cast<float>(get_max_value(bits));
+        u = quantize(x, -1.0f, max_value * 0.5f, get_max_value(bits));
+        v = quantize(y, -1.0f, max_value * 0.5f, get_max_value(bits));
+    }
+
+    DirectX::XMFLOAT3 decode_normal(std::uint16_t u, std::uint16_t v, float scale) {
+        float x = static_cast<float>(u) * scale - 1.0f;
+        float y = static_cast<float>(v) * scale - 1.0f;
+        float z = 1.0f - std::abs(x) - std::abs(y);
+        float fold = std::max(-z, 0.0f);
+        x += x >= 0.0f ? -fold : fold;
+        y += y >= 0.0f ? -fold : fold;
+
+        float inverse_length = 1.0f / std::sqrt(x * x + y * y + z * z);
+        return {x * inverse_length, y * inverse_length, z * inverse_length};
+    }
+
+    std::uint64_t get_hash(const QuantizedVertex& vertex) {
+        std::uint64_t a = 0;
+        std::uint64_t b = 0;
+        std::uint16_t c = 0;
+        static_assert(sizeof(QuantizedVertex) == 18);
+        std::memcpy(&a, &vertex, 8);
+        std::memcpy(&b, reinterpret_cast<const std::uint8_t*>(&vertex) + 8, 8);
+        std::memcpy(&c, reinterpret_cast<const std::uint8_t*>(&vertex) + 16, 2);
+
+        std::uint64_t hash = a * 0x9E3779B97F4A7C15ull ^ b * 0xC2B2AE3D27D4EB4Full ^ c * 0x165667B19E3779F9ull;
+        return hash ^ (hash >> 29);
+    }
+
+    // Merges equal quantized vertices, numbering them in the order of first use.
+    void build_index_buffer(const std::vector<QuantizedVertex>& corners, std::vector<QuantizedVertex>& vertices, std::vector<std::uint32_t>& indices) {
+        std::size_t capacity = 16;
+
+        while (capacity < 2 * corners.size()) {
+            capacity *= 2;
+        }
+
+        // Open addressing, slots hold a vertex number + 1
+        std::vector<std::uint32_t> table(capacity, 0);
+        indices.resize(corners.size());
+
+        for (std::size_t i = 0; i < corners.size(); i++) {
+            std::size_t slot = get_hash(corners[i]) & (capacity - 1);
+
+            while (table[slot] != 0 && std::memcmp(&vertices[table[slot] - 1], &corners[i], sizeof(QuantizedVertex)) != 0) {
+                slot = (slot + 1) & (capacity - 1);
+            }
+
+            if (table[slot] == 0) {
+                vertices.push_back(corners[i]);
+                table[slot] = static_cast<std::uint32_t>(vertices.size());
+            }
+
+            indices[i] = table[slot] - 1;
+        }
+    }
+
+    std::uint8_t get_group_code(const std::uint8_t* values) {
+        std::uint8_t max_value = *std::max_element(values, values + GROUP_SIZE);
+        return max_value == 0 ? 0 : max_value < 4 ? 1 : max_value < 16 ? 2 : 3;
+    }
+
+    // Header of 2 bit group codes (0, 2, 4 or 8 bits per value), then the packed groups. Value
+    // i of a group goes to byte i % (2 * bits) at bit bits * (i / (2 * bits)), so unpacking is
+    // a few shifts and interleaves.
+    void encode_plane(const std::uint8_t* plane, std::size_t groups, std::vector<std::uint8_t>& out) {
+        std::size_t header = out.size();
+        out.resize(out.size() + (groups + 3) / 4, 0);
+
+        for (std::size_t group = 0; group < groups; group++) {
+            const std::uint8_t* values = plane + group * GROUP_SIZE;
+            std::uint8_t code = get_group_code(values);
+            out[header + group / 4] |= static_cast<std::uint8_t>(code << (2 * (group % 4)));
+
+            if (code == 3) {
+                out.insert(out.end(), values, values + GROUP_SIZE);
+            }
+            else if (code > 0) {
+                int bits = 2 * code;
+                std::size_t bytes = static_cast<std::size_t>(2 * bits);
+                std::size_t begin = out.size();
+                out.resize(begin + bytes, 0);
+
+                for (std::size_t i = 0; i < GROUP_SIZE; i++) {
+                    out[begin + i % bytes] |= static_cast<std::uint8_t>(values[i] << (bits * (i / bytes)));
+                }
+            }
+        }
+    }
+
+    void unpack_group(const std::uint8_t* data, std::uint8_t code, std::uint8_t* values) {
+#ifdef MESH_CODEC_SSE2
+        __m128i result;
+
+        if (code == 0) {
+            result = _mm_setzero_si128();
+        }
+        else if (code == 1) {
+            std::uint32_t packed;
+            std::memcpy(&packed, data, 4);
+            __m128i x = _mm_cvtsi32_si128(static_cast<int>(packed));
+            __m128i mask = _mm_set1_epi8(3);
+            __m128i v0 = _mm_and_si128(x, mask);
+            __m128i v1 = _mm_and_si128(_mm_srli_epi16(x, 2), mask);
+            __m128i v2 = _mm_and_si128(_mm_srli_epi16(x, 4), mask);
+            __m128i v3 = _mm_and_si128(_mm_srli_epi16(x, 6), mask);
+            result = _mm_unpacklo_epi64(_mm_unpacklo_epi32(v0, v1), _mm_unpacklo_epi32(v2, v3));
+        }
+        else if (code == 2) {
+            __m128i x = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(data));
+            __m128i mask = _mm_set1_epi8(15);
+            result = _mm_unpacklo_epi64(_mm_and_si128(x, mask), _mm_and_si128(_mm_srli_epi16(x, 4), mask));
+        }
+        else {
+            result = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+        }
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(values), result);
+#else
+        if (code == 0) {
+            std::memset(values, 0, GROUP_SIZE);
+            return;
+        }
+
+        if (code == 3) {
+            std::memcpy(values, data, GROUP_SIZE);
+            return;
+        }
+
+        int bits = 2 * code;
+        std::size_t bytes = static_cast<std::size_t>(2 * bits);
+        std::uint8_t mask = static_cast<std::uint8_t>((1 << bits) - 1);
+
+        for (std::size_t i = 0; i < GROUP_SIZE; i++) {
+            values[i] = code == 0 ? 0 : static_cast<std::uint8_t>((data[i % bytes] >> (bits * (i / bytes))) & mask);
+        }
+#endif
+    }
+
+    // Returns the end of the plane, nullptr when the data is too short.
+    const std::uint8_t* decode_plane(const std::uint8_t* data, const std::uint8_t* end, std::size_t groups, std::uint8_t* plane) {
+        constexpr std::size_t GROUP_BYTES[] = {0, 4, 8, 16};
+        const std::uint8_t* header = data;
+        data += (groups + 3) / 4;
+
+        if (data > end) {
+            return nullptr;
+        }
+
+        for (std::size_t group = 0; group < groups; group++) {
+            std::uint8_t code = (header[group / 4] >> (2 * (group % 4))) & 3;
+
+            // Unpacking reads whole 4 or 8 bytes, the check covers them.
+            if (static_cast<std::size_t>(end - data) < GROUP_BYTES[code]) {
+                return nullptr;
+            }
+
+            unpack_group(data, code, plane + group * GROUP_SIZE);
+            data += GROUP_BYTES[code];
+        }
+
+        return data;
+    }
+
+    void encode_vertices(const std::vector<QuantizedVertex>& vertices, std::vector<std::uint8_t>& out) {
+        std::uint16_t previous_words[WORD_COMPONENTS] = {};
+        std::uint8_t previous_bytes[BYTE_COMPONENTS] = {};
+        std::uint8_t planes[PLANES][VERTEX_BLOCK_SIZE];
+
+        for (std::size_t begin = 0; begin < vertices.size(); begin += VERTEX_BLOCK_SIZE) {
+            std::size_t count = std::min(VERTEX_BLOCK_SIZE, vertices.size() - begin);
+            std::size_t groups = (count + GROUP_SIZE - 1) / GROUP_SIZE;
+            std::memset(planes, 0, sizeof(planes));
+
+            for (std::size_t i = 0; i < count; i++) {
+                const QuantizedVertex& vertex = vertices[begin + i];
+
+                for (std::size_t c = 0; c < WORD_COMPONENTS; c++) {
+                    std::uint16_t delta = zigzag(static_cast<std::uint16_t>(vertex.words[c] - previous_words[c]));
+                    planes[2 * c][i] = static_cast<std::uint8_t>(delta);
+                    planes[2 * c + 1][i] = static_cast<std::uint8_t>(delta >> 8);
+                    previous_words[c] = vertex.words[c];
+                }
+
+                for (std::size_t c = 0; c < BYTE_COMPONENTS; c++) {
+                    planes[2 * WORD_COMPONENTS + c][i] = zigzag(static_cast<std::uint8_t>(vertex.bytes[c] - previous_bytes[c]));
+                    previous_bytes[c] = vertex.bytes[c];
+                }
+            }
+
+            for (auto& plane : planes) {
+                encode_plane(plane, groups, out);
+            }
+        }
+    }
+
+    struct Dequantization {
+        float position_min[3];
+        float position_scale[3];
+        float texture_coordinate_min[2];
+        float texture_coordinate_scale[2];
+        float normal_scale;
+    };
+
+    // Prefix sums of the deltas of one 16 bit component over a block.
+    void decode_words(const std::uint8_t* low, const std::uint8_t* high, std::size_t count, std::uint16_t& previous, std::uint16_t* words) {
+        std::uint16_t value = previous;
+
+        for (std::size_t i = 0; i < count; i++) {
+            value = static_cast<std::uint16_t>(value + unzigzag(static_cast<std::uint16_t>(low[i] | high[i] << 8)));
+            words[i] = value;
+        }
+
+        previous = value;
+    }
+
+    HRESULT decode_vertices(const std::uint8_t* data, std::size_t size, const Dequantization& dequantization, std::size_t number_of_vertices,
+                            Vertex* vertices) {
+        const std::uint8_t* end = data + size;
+        std::uint16_t previous_words[WORD_COMPONENTS] = {};
+        std::uint8_t previous_bytes[BYTE_COMPONENTS] = {};
+        alignas(16) std::uint8_t planes[PLANES][VERTEX_BLOCK_SIZE];
+        alignas(16) std::uint16_t words[WORD_COMPONENTS][VERTEX_BLOCK_SIZE];
+        constexpr float COLOR_SCALE = 1.0f / 255.0f;
+
+        for (std::size_t begin = 0; begin < number_of_vertices; begin += VERTEX_BLOCK_SIZE) {
+            std::size_t count = std::min(VERTEX_BLOCK_SIZE, number_of_vertices - begin);
+            std::size_t groups = (count + GROUP_SIZE - 1) / GROUP_SIZE;
+
+            for (auto& plane : planes) {
+                data = decode_plane(data, end, groups, plane);
+
+                if (data == nullptr) {
+                    return E_INVALIDARG;
+                }
+            }
+
+            for (std::size_t c = 0; c < WORD_COMPONENTS; c++) {
+                decode_words(planes[2 * c], planes[2 * c + 1], count, previous_words[c], words[c]);
+            }
+
+            Vertex* block = vertices + begin;
+
+            for (std::size_t i = 0; i < count; i++) {
+                block[i].position = {
+                        static_cast<float>(words[0][i]) * dequantization.position_scale[0] + dequantization.position_min[0],
+                        static_cast<float>(words[1][i]) * dequantization.position_scale[1] + dequantization.position_min[1],
+                        static_cast<float>(words[2][i]) * dequantization.position_scale[2] + dequantization.position_min[2]
+                };
+                block[i].normal = decode_normal(words[3][i], words[4][i], dequantization.normal_scale);
+                block[i].texture_coordinates = {
+                        static_cast<float>(words[5][i]) * dequantization.texture_coordinate_scale[0] + dequantization.texture_coordinate_min[0],
+                        static_cast<float>(words[6][i]) * dequantization.texture_coordinate_scale[1] + dequantization.texture_coordinate_min[1]
+                };
+            }
+
+            for (std::size_t c = 0; c < BYTE_COMPONENTS; c++) {
+                const std::uint8_t* plane = planes[2 * WORD_COMPONENTS + c];
+                std::uint8_t value = previous_bytes[c];
+
+                for (std::size_t i = 0; i < count; i++) {
+                    value = static_cast<std::uint8_t>(value + unzigzag(plane[i]));
+                    (&block[i].color.x)[c] = static_cast<float>(value) * COLOR_SCALE;
+                }
+
+                previous_bytes[c] = value;
+            }
+        }
+
+        return data == end ? S_OK : E_INVALIDARG;
+    }
+
+    bool find_edge(const EdgeFifo& edges, const std::uint32_t* triangle, std::uint8_t& slot, int& rotation) {
+        for (std::uint8_t s = 0; s < EDGE_SLOTS; s++) {
+            std::size_t index = edges.get_index(s);
+
+            for (int r = 0; r < 3; r++) {
+                if (edges.first[index] == triangle[r] && edges.second[index] == triangle[(r + 1) % 3]) {
+                    slot = s;
+                    rotation = r;
+                    return true;
+                }
+            }
+        }
+
+        return false;
+    }
+
+    // Sets next to one past the highest vertex used.
+    HRESULT decode_indices(const std::uint8_t* data, std::size_t size, std::size_t number_of_indices, std::uint32_t* indices, std::uint32_t& next) {
+        std::size_t number_of_triangles = number_of_indices / 3;
+
+        if (number_of_indices % 3 != 0 || size < number_of_triangles) {
+            return E_INVALIDARG;
+        }
+
+        const std::uint8_t* codes = data;
+        const std::uint8_t* deltas = data + number_of_triangles;
+        const std::uint8_t* end = data + size;
+        EdgeFifo edges;
+        VertexFifo fifo;
+        next = 0;
+
+        // Reads a vertex given as a delta back from the next new one.
+        auto read_explicit = [&](std::uint32_t& vertex) {
+            std::uint32_t delta = 0;
+            deltas = read_varint(deltas, end, delta);
+
+            if (deltas == nullptr || delta >= next) {
+                return false;
+            }
+
+            vertex = next - 1 - delta;
+            fifo.push(vertex);
+            return true;
+        };
+
+        for (std::size_t t = 0; t < number_of_triangles; t++) {
+            std::uint8_t code = codes[t];
+            std::uint32_t* triangle = indices + 3 * t;
+
+            if (code < NO_EDGE) {
+                std::size_t index = edges.get_index(code >> 4);
+                std::uint8_t third = code & 15;
+                triangle[0] = edges.first[index];
+                triangle[1] = edges.second[index];
+
+                if (third == NEXT_VERTEX) {
+                    triangle[2] = next++;
+                    fifo.push(triangle[2]);
+                }
+                else if (third <= VERTEX_SLOTS) {
+                    triangle[2] = fifo.get(third - 1);
+                }
+                else if (!read_explicit(triangle[2])) {
+                    return E_INVALIDARG;
+                }
+            }
+            else {
+                for (int corner = 0; corner < 3; corner++) {
+                    if (code & (1 << corner)) {
+                        triangle[corner] = next++;
+                        fifo.push(triangle[corner]);
+                    }
+                    else if (!read_explicit(triangle[corner])) {
+                        return E_INVALIDARG;
+                    }
+                }
+            }
+
+            // Empty FIFO slots hold NO_VERTEX, which is never below next.
+            if (triangle[0] >= next || triangle[1] >= next || triangle[2] >= next) {
+                return E_INVALIDARG;
+            }
+
+            edges.push_triangle(triangle[0], triangle[1], triangle[2]);
+        }
+
+        return deltas == end ? S_OK : E_INVALIDARG;
+    }
+}
+
+HRESULT encode_index_buffer(const std::vector<std::uint32_t>& indices, std::vector<std::uint8_t>& encoded) {
+    if (indices.size() % 3 != 0) {
+        return E_INVALIDARG;
+    }
+
+    std::size_t number_of_triangles = indices.size() / 3;
+    std::vector<std::uint8_t> deltas;
+    EdgeFifo edges;
+    VertexFifo fifo;
+    std::uint32_t next = 0;
+
+    std::size_t codes = encoded.size();
+    encoded.resize(codes + number_of_triangles);
+
+    // Returns the code of the third vertex of a triangle with a shared edge.
+    auto encode_vertex = [&](std::uint32_t vertex) -> std::uint8_t {
+        if (vertex == next) {
+            next++;
+            fifo.push(vertex);
+            return NEXT_VERTEX;
+        }
+
+        for (std::uint8_t slot = 0; slot < VERTEX_SLOTS; slot++) {
+            if (fifo.get(slot) == vertex) {
+                return static_cast<std::uint8_t>(slot + 1);
+            }
+        }
+
+        write_varint(next - 1 - vertex, deltas);
+        fifo.push(vertex);
+        return EXPLICIT_VERTEX;
+    };
+
+    for (std::size_t t = 0; t < number_of_triangles; t++) {
+        const std::uint32_t* triangle = indices.data() + 3 * t;
+
+        // Vertices have to be first used in order, anything else is not representable.
+        if (std::max({triangle[0], triangle[1], triangle[2]}) > next + 2) {
+            return E_INVALIDARG;
+        }
+
+        std::uint8_t slot = 0;
+        int rotation = 0;
+        std::uint32_t rotated[3];
+        std::uint8_t code = NO_EDGE;
+
+        if (find_edge(edges, triangle, slot, rotation)) {
+            rotated[0] = triangle[rotation];
+            rotated[1] = triangle[(rotation + 1) % 3];
+            rotated[2] = triangle[(rotation + 2) % 3];
+
+            if (rotated[2] > next) {
+                return E_INVALIDARG;
+            }
+
+            code = static_cast<std::uint8_t>(slot << 4 | encode_vertex(rotated[2]));
+        }
+        else {
+            for (int corner = 0; corner < 3; corner++) {
+                rotated[corner] = triangle[corner];
+
+                if (triangle[corner] > next) {
+                    return E_INVALIDARG;
+                }
+
+                if (triangle[corner] == next) {
+                    next++;
+                    fifo.push(triangle[corner]);
+                    code |= static_cast<std::uint8_t>(1 << corner);
+                }
+                else {
+                    write_varint(next - 1 - triangle[corner], deltas);
+                    fifo.push(triangle[corner]);
+                }
+            }
+        }
+
+        encoded[codes + t] = code;
+        edges.push_triangle(rotated[0], rotated[1], rotated[2]);
+    }
+
+    encoded.insert(encoded.end(), deltas.begin(), deltas.end());
+    return S_OK;
+}
+
+HRESULT decode_index_buffer(const std::uint8_t* data, std::size_t size, std::size_t number_of_indices, std::vector<std::uint32_t>& indices) {
+    std::uint32_t next = 0;
+    indices.resize(number_of_indices);
+    HRESULT hr = decode_indices(data, size, number_of_indices, indices.data(), next);
+
+    if (FAILED(hr)) {
+        indices.clear();
+    }
+
+    return hr;
+}
+
+HRESULT encode_mesh(const std::vector<Vertex>& vertices, std::vector<std::uint8_t>& encoded, const MeshEncodeOptions& options) {
+    auto valid_bits = [](int bits) { return bits > 0 && bits <= 16; };
+
+    if (vertices.size() % 3 != 0 || vertices.size() > std::numeric_limits<std::uint32_t>::max() ||
+        !valid_bits(options.position_bits) || !valid_bits(options.texture_coordinate_bits) || !valid_bits(options.normal_bits)) {
+        return E_INVALIDARG;
+    }
+
+    MeshHeader header = {};
+    header.magic = MESH_MAGIC;
+    header.version = MESH_VERSION;
+    header.normal_bits = static_cast<std::uint32_t>(options.normal_bits);
+
+    float position_max[3];
+    float texture_coordinate_max[2];
+    std::fill(std::begin(header.position_min), std::end(header.position_min), std::numeric_limits<float>::max());
+    std::fill(std::begin(position_max), std::end(position_max), std::numeric_limits<float>::lowest());
+    std::fill(std::begin(header.texture_coordinate_min), std::end(header.texture_coordinate_min), std::numeric_limits<float>::max());
+    std::fill(std::begin(texture_coordinate_max), std::end(texture_coordinate_max), std::numeric_limits<float>::lowest());
+
+    for (const auto& vertex : vertices) {
+        const float* position = &vertex.position.x;
+        const float* texture_coordinates = &vertex.texture_coordinates.x;
+
+        for (int c = 0; c < 3; c++) {
+            header.position_min[c] = std::min(header.position_min[c], position[c]);
+            position_max[c] = std::max(position_max[c], position[c]);
+        }
+
+        for (int c = 0; c < 2; c++) {
+            header.texture_coordinate_min[c] = std::min(header.texture_coordinate_min[c], texture_coordinates[c]);
+            texture_coordinate_max[c] = std::max(texture_coordinate_max[c], texture_coordinates[c]);
+        }
+    }
+
+    float position_inverse_scale[3] = {};
+    float texture_coordinate_inverse_scale[2] = {};
+
+    for (int c = 0; c < 3 && !vertices.empty(); c++) {
+        float extent = position_max[c] - header.position_min[c];
+        header.position_scale[c] = extent / static_cast<float>(get_max_value(options.position_bits));
+        position_inverse_scale[c] = extent > 0.0f ? 1.0f / header.position_scale[c] : 0.0f;
+    }
+
+    for (int c = 0; c < 2 && !vertices.empty(); c++) {
+        float extent = texture_coordinate_max[c] - header.texture_coordinate_min[c];
+        header.texture_coordinate_scale[c] = extent / static_cast<float>(get_max_value(options.texture_coordinate_bits));
+        texture_coordinate_inverse_scale[c] = extent > 0.0f ? 1.0f / header.texture_coordinate_scale[c] : 0.0f;
+    }
+
+    std::vector<QuantizedVertex> corners(vertices.size());
+
+    for (std::size_t i = 0; i < vertices.size(); i++) {
+        const Vertex& vertex = vertices[i];
+        QuantizedVertex& corner = corners[i];
+        const float* position = &vertex.position.x;
+        const float* texture_coordinates = &vertex.texture_coordinates.x;
+        const float* color = &vertex.color.x;
+
+        for (int c = 0; c < 3; c++) {
+            corner.words[c] = quantize(position[c], header.position_min[c], position_inverse_scale[c], get_max_value(options.position_bits));
+        }
+
+        encode_normal(vertex.normal, options.normal_bits, corner.words[3], corner.words[4]);
+
+        for (int c = 0; c < 2; c++) {
+            corner.words[5 + c] = quantize(texture_coordinates[c], header.texture_coordinate_min[c], texture_coordinate_inverse_scale[c],
+                                           get_max_value(options.texture_coordinate_bits));
+        }
+
+        for (int c = 0; c < 4; c++) {
+            corner.bytes[c] = static_cast<std::uint8_t>(quantize(color[c], 0.0f, 255.0f, 255));
+        }
+    }
+
+    std::vector<QuantizedVertex> unique_vertices;
+    std::vector<std::uint32_t> indices;
+    build_index_buffer(corners, unique_vertices, indices);
+
+    header.number_of_vertices = static_cast<std::uint32_t>(unique_vertices.size());
+    header.number_of_indices = static_cast<std::uint32_t>(indices.size());
+
+    encoded.assign(sizeof(MeshHeader), 0);
+    HRESULT hr = encode_index_buffer(indices, encoded);
+
+    if (SUCCEEDED(hr)) {
+        header.index_size = static_cast<std::uint32_t>(encoded.size() - sizeof(MeshHeader));
+        encode_vertices(unique_vertices, encoded);
+        header.vertex_size = static_cast<std::uint32_t>(encoded.size() - sizeof(MeshHeader) - header.index_size);
+        std::memcpy(encoded.data(), &header, sizeof(header));
+    }
+
+    return hr;
+}
+
+HRESULT encode_mesh(const std::vector<Vertex>& vertices, std::vector<std::uint8_t>& encoded) {
+    return encode_mesh(vertices, encoded, MeshEncodeOptions());
+}
+
+HRESULT decode_mesh(const std::uint8_t* data, std::size_t size, std::vector<Vertex>& vertices, std::vector<std::uint32_t>& indices) {
+    MeshHeader header = {};
+
+    if (size < sizeof(header)) {
+        return E_INVALIDARG;
+    }
+
+    std::memcpy(&header, data, sizeof(header));
+
+    if (header.magic != MESH_MAGIC || header.version != MESH_VERSION || header.normal_bits == 0 || header.normal_bits > 16 ||
+        static_cast<std::uint64_t>(header.index_size) + header.vertex_size != size - sizeof(header)) {
+        return E_INVALIDARG;
+    }
+
+    // Every triangle takes at least a byte and every vertex is used, so corrupt counts fail before allocating
+    if (header.number_of_indices % 3 != 0 || header.number_of_indices / 3 > header.index_size ||
+        header.number_of_vertices > header.number_of_indices) {
+        return E_INVALIDARG;
+    }
+
+    const std::uint8_t* index_data = data + sizeof(header);
+    std::uint32_t next = 0;
+    indices.resize(header.number_of_indices);
+    HRESULT hr = decode_indices(index_data, header.index_size, header.number_of_indices, indices.data(), next);
+
+    if (SUCCEEDED(hr) && next != header.number_of_vertices) {
+        hr = E_INVALIDARG;
+    }
+
+    if (SUCCEEDED(hr)) {
+        Dequantization dequantization = {};
+        std::copy(std::begin(header.position_min), std::end(header.position_min), dequantization.position_min);
+        std::copy(std::begin(header.position_scale), std::end(header.position_scale), dequantization.position_scale);
+        std::copy(std::begin(header.texture_coordinate_min), std::end(header.texture_coordinate_min), dequantization.texture_coordinate_min);
+        std::copy(std::begin(header.texture_coordinate_scale), std::end(header.texture_coordinate_scale), dequantization.texture_coordinate_scale);
+        dequantization.normal_scale = 2.0f / static_cast<float>(get_max_value(static_cast<int>(header.normal_bits)));
+
+        vertices.resize(header.number_of_vertices);
+        hr = decode_vertices(index_data + header.index_size, header.vertex_size, dequantization, header.number_of_vertices, vertices.data());
+    }
+
+    if (FAILED(hr)) {
+        vertices.clear();
+        indices.clear();
+    }
+
+    return hr;
+}
+
+HRESULT decode_mesh(const std::uint8_t* data, std::size_t size, std::vector<Vertex>& vertices) {
+    std::vector<Vertex> indexed_vertices;
+    std::vector<std::uint32_t> indices;
+    HRESULT hr = decode_mesh(data, size, indexed_vertices, indices);
+
+    if (SUCCEEDED(hr)) {
+        vertices.resize(indices.size());
+
+        for (std::size_t i = 0; i < indices.size(); i++) {
+            vertices[i] = indexed_vertices[indices[i]];
+        }
+    }
+
+    return hr;
+}
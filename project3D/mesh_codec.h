@@ -0,0 +1,45 @@
+#ifndef PROJECT3D_MESH_CODEC_H
+#define PROJECT3D_MESH_CODEC_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "common.h"
+#include "hresult.h"
+
+// Compression of triangle lists for cooked assets. Encoding quantizes the
+// vertices, merges the ones that became equal and stores:
+//  - indices with edge based coding: a triangle sharing an edge with one of
+//    the last few triangles takes one byte, a vertex used for the first time
+//    is implied (vertices are numbered in the order of first use),
+//  - vertices as deltas to the previous vertex, per attribute, split into
+//    byte planes; every 16 bytes of a plane are packed with the 0, 2, 4 or
+//    8 bits the largest of them needs.
+// Decoding restores the vertices up to the quantization; triangles keep
+// their winding but may start at another corner.
+struct MeshEncodeOptions {
+    // Of the bounding box of the positions / uvs, at most 16
+    int position_bits = 16;
+    int texture_coordinate_bits = 12;
+
+    // Of each of the two octahedral coordinates, at most 16
+    int normal_bits = 10;
+};
+
+// vertices is a triangle list (every three vertices form a triangle).
+HRESULT encode_mesh(const std::vector<Vertex>& vertices, std::vector<std::uint8_t>& encoded, const MeshEncodeOptions& options);
+HRESULT encode_mesh(const std::vector<Vertex>& vertices, std::vector<std::uint8_t>& encoded);
+
+// Indexed, as stored
+HRESULT decode_mesh(const std::uint8_t* data, std::size_t size, std::vector<Vertex>& vertices, std::vector<std::uint32_t>& indices);
+
+// Expanded back to a triangle list
+HRESULT decode_mesh(const std::uint8_t* data, std::size_t size, std::vector<Vertex>& vertices);
+
+// The index stage on its own. Vertices have to be numbered in the order of
+// first use (as encode_mesh does), otherwise E_INVALIDARG is returned.
+HRESULT encode_index_buffer(const std::vector<std::uint32_t>& indices, std::vector<std::uint8_t>& encoded);
+HRESULT decode_index_buffer(const std::uint8_t* data, std::size_t size, std::size_t number_of_indices, std::vector<std::uint32_t>& indices);
+
+#endif //PROJECT3D_MESH_CODEC_H
@@ -0,0 +1,693 @@
+#include "mesh_cooker.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "mesh_attributes.h"
+#include "mesh_chunk.h"
+#include "obj_statements.h"
+#include "object_loader.h"
+#include "task_scheduler.h"
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+    constexpr std::uint32_t NO_INDEX = std::numeric_limits<std::uint32_t>::max();
+    constexpr std::uint32_t NO_MATERIAL = std::numeric_limits<std::uint32_t>::max();
+    constexpr std::size_t FILE_BUFFER_BYTES = std::size_t{1} << 20;
+    constexpr std::size_t MIN_RUN_BUFFER_BYTES = std::size_t{64} << 10;
+
+    // What the joins fill in; colors come from the materials once the triangles are together again.
+    struct CornerAttributes {
+        DirectX::XMFLOAT3 position;
+        DirectX::XMFLOAT3 normal;
+        DirectX::XMFLOAT2 texture_coordinates;
+    };
+
+    // Records are sorted by key and then by order, which is unique.
+    struct CornerRecord {
+        std::uint64_t key;
+
+        // 3 * triangle + the corner within it
+        std::uint64_t order;
+        std::uint32_t position_index;
+        std::uint32_t normal_index;
+        std::uint32_t uv_index;
+        CornerAttributes attributes;
+    };
+
+    struct TriangleRecord {
+        // Row and column of the cell, ordered like MeshChunk::split
+        std::uint64_t key;
+
+        // Triangle in file order
+        std::uint64_t order;
+        std::uint32_t position_indices[3];
+        std::uint32_t smoothing_group;
+        std::uint32_t material;
+        CornerAttributes corners[3];
+    };
+
+    struct FaceRecord {
+        std::uint32_t material;
+        std::uint32_t smoothing_group;
+    };
+
+    template <typename T>
+    class RecordWriter {
+    public:
+        explicit RecordWriter(const std::filesystem::path& path) : file(path, std::ios::binary | std::ios::trunc) {
+            buffer.reserve(FILE_BUFFER_BYTES / sizeof(T));
+        }
+
+        bool is_open() const {
+            return file.is_open();
+        }
+
+        bool write(const T& record) {
+            buffer.push_back(record);
+            return buffer.size() < FILE_BUFFER_BYTES / sizeof(T) || flush();
+        }
+
+        bool flush() {
+            file.write(reinterpret_cast<const char*>(buffer.data()), static_cast<std::streamsize>(buffer.size() * sizeof(T)));
+            written += buffer.size();
+            buffer.clear();
+            return file.good();
+        }
+
+        std::uint64_t get_count() const {
+            return written + buffer.size();
+        }
+
+    private:
+        std::ofstream file;
+        std::vector<T> buffer;
+        std::uint64_t written = 0;
+    };
+
+    // Reads a file of records a block at a time, front to back.
+    template <typename T>
+    class RecordReader {
+    public:
+        RecordReader(const std::filesystem::path& path, std::size_t buffer_bytes)
+                : file(path, std::ios::binary), capacity(std::max<std::size_t>(buffer_bytes / sizeof(T), 1)) {}
+
+        // Record number index; skipping forward is cheap, going back rereads the block. False past the end.
+        bool get(std::uint64_t index, T& record) {
+            if ((index < first || index >= first + buffer.size()) && !fill(index)) {
+                return false;
+            }
+
+            record = buffer[static_cast<std::size_t>(index - first)];
+            return true;
+        }
+
+        bool next(T& record) {
+            return get(position++, record);
+        }
+
+    private:
+        std::ifstream file;
+        std::size_t capacity;
+        std::vector<T> buffer;
+        std::uint64_t first = 0;
+        std::uint64_t position = 0;
+
+        bool fill(std::uint64_t index) {
+            if (index != first + buffer.size()) {
+                file.clear();
+                file.seekg(static_cast<std::streamoff>(index * sizeof(T)));
+            }
+
+            buffer.resize(capacity);
+            file.read(reinterpret_cast<char*>(buffer.data()), static_cast<std::streamsize>(capacity * sizeof(T)));
+            buffer.resize(static_cast<std::size_t>(file.gcount()) / sizeof(T));
+            first = index;
+
+            return !buffer.empty();
+        }
+    };
+
+    // Sorts more records than fit in memory. push() collects them in a buffer,
+    // which is sorted and written to a run file whenever it is full; after
+    // finish() next() merges the runs, each read through its share of
+    // merge_bytes (but at least 64 KiB). Nothing is written when all records
+    // fit in the buffer. The runs are removed with the sorter.
+    template <typename T>
+    class ExternalSorter {
+    public:
+        ExternalSorter(std::filesystem::path directory, std::string name, std::size_t buffer_bytes, std::size_t merge_bytes)
+                : directory(std::move(directory)), name(std::move(name)),
+                  capacity(std::max<std::size_t>(buffer_bytes / sizeof(T), 1)), merge_bytes(merge_bytes) {}
+
+        ~ExternalSorter() {
+            readers.clear();
+
+            for (const auto& run : runs) {
+                std::error_code error;
+                std::filesystem::remove(run, error);
+            }
+        }
+
+        ExternalSorter(const ExternalSorter&) = delete;
+        ExternalSorter& operator=(const ExternalSorter&) = delete;
+
+        HRESULT push(const T& record) {
+            if (buffer.empty()) {
+                buffer.reserve(capacity);
+            }
+
+            buffer.push_back(record);
+            pushed++;
+
+            return buffer.size() < capacity ? S_OK : spill();
+        }
+
+        HRESULT finish() {
+            if (runs.empty()) {
+                std::sort(buffer.begin(), buffer.end(), is_less);
+                return S_OK;
+            }
+
+            HRESULT hr = buffer.empty() ? S_OK : spill();
+            std::vector<T>().swap(buffer);
+
+            std::size_t run_bytes = std::max(merge_bytes / runs.size(), MIN_RUN_BUFFER_BYTES);
+
+            heads.resize(runs.size());
+
+            for (std::size_t i = 0; SUCCEEDED(hr) && i < runs.size(); i++) {
+                readers.push_back(std::make_unique<RecordReader<T>>(runs[i], run_bytes));
+
+                if (readers.back()->next(heads[i])) {
+                    heap.push_back(i);
+                    std::push_heap(heap.begin(), heap.end(), get_greater());
+                }
+            }
+
+            return hr;
+        }
+
+        bool next(T& record) {
+            if (readers.empty()) {
+                if (next_in_buffer == buffer.size()) {
+                    return false;
+                }
+
+                record = buffer[next_in_buffer++];
+                popped++;
+                return true;
+            }
+
+            if (heap.empty()) {
+                return false;
+            }
+
+            std::pop_heap(heap.begin(), heap.end(), get_greater());
+            std::size_t run = heap.back();
+            record = heads[run];
+            popped++;
+
+            if (readers[run]->next(heads[run])) {
+                std::push_heap(heap.begin(), heap.end(), get_greater());
+            }
+            else {
+                heap.pop_back();
+            }
+
+            return true;
+        }
+
+        // False when a run could not be read back whole.
+        bool is_complete() const {
+            return popped == pushed;
+        }
+
+        std::size_t get_number_of_runs() const {
+            return runs.size();
+        }
+
+        std::uint64_t get_written_bytes() const {
+            return written_bytes;
+        }
+
+    private:
+        const std::filesystem::path directory;
+        const std::string name;
+        const std::size_t capacity;
+        const std::size_t merge_bytes;
+        std::vector<T> buffer;
+        std::size_t next_in_buffer = 0;
+        std::vector<std::filesystem::path> runs;
+        std::vector<std::unique_ptr<RecordReader<T>>> readers;
+
+        // The next record of every run and the runs that have one left, by it
+        std::vector<T> heads;
+        std::vector<std::size_t> heap;
+
+        std::uint64_t pushed = 0;
+        std::uint64_t popped = 0;
+        std::uint64_t written_bytes = 0;
+
+        static bool is_less(const T& a, const T& b) {
+            return a.key != b.key ? a.key < b.key : a.order < b.order;
+        }
+
+        auto get_greater() const {
+            return [this](std::size_t a, std::size_t b) {
+                return is_less(heads[b], heads[a]);
+            };
+        }
+
+        HRESULT spill() {
+            std::sort(buffer.begin(), buffer.end(), is_less);
+
+            char file_name[64];
+            std::snprintf(file_name, sizeof(file_name), "%s_%05zu.run", name.c_str(), runs.size());
+            runs.push_back(directory / file_name);
+
+            std::ofstream file(runs.back(), std::ios::binary | std::ios::trunc);
+            file.write(reinterpret_cast<const char*>(buffer.data()), static_cast<std::streamsize>(buffer.size() * sizeof(T)));
+            written_bytes += buffer.size() * sizeof(T);
+            buffer.clear();
+
+            return file.good() ? S_OK : E_FAIL;
+        }
+    };
+
+    using CornerSorter = ExternalSorter<CornerRecord>;
+    using TriangleSorter = ExternalSorter<TriangleRecord>;
+
+    struct AttributeCounts {
+        std::uint64_t positions = 0;
+        std::uint64_t normals = 0;
+        std::uint64_t uvs = 0;
+        std::uint64_t triangles = 0;
+
+        // Every face uses the index of the position for them as well (f 1/1/1 2/2/2 3/3/3), as scans usually do.
+        bool normals_follow_positions = true;
+        bool uvs_follow_positions = true;
+    };
+
+    struct TemporaryFiles {
+        std::filesystem::path positions;
+        std::filesystem::path normals;
+        std::filesystem::path uvs;
+        std::filesystem::path faces;
+    };
+
+    // The statements of the file written to the attribute and face files, and the corners, keyed by
+    // their position, to the sort.
+    class Statements {
+    public:
+        Statements(const TemporaryFiles& files, const std::filesystem::path& directory, ObjectLoader& materials, CornerSorter& corners)
+                : positions(files.positions), normals(files.normals), uvs(files.uvs), faces(files.faces),
+                  directory(directory), materials(materials), corners(corners) {}
+
+        RecordWriter<DirectX::XMFLOAT3> positions;
+        RecordWriter<DirectX::XMFLOAT3> normals;
+        RecordWriter<DirectX::XMFLOAT2> uvs;
+        RecordWriter<FaceRecord> faces;
+        std::uint64_t triangles = 0;
+        bool normals_follow_positions = true;
+        bool uvs_follow_positions = true;
+        bool has_material_library = false;
+
+        HRESULT add_position(const DirectX::XMFLOAT3& position) {
+            return write(positions, position);
+        }
+
+        HRESULT add_normal(const DirectX::XMFLOAT3& normal) {
+            return write(normals, normal);
+        }
+
+        HRESULT add_texture_coordinates(const DirectX::XMFLOAT2& uv) {
+            return write(uvs, uv);
+        }
+
+        HRESULT add_triangle(const ObjTriangle& triangle) {
+            HRESULT hr = S_OK;
+            std::uint64_t order = 3 * triangles;
+
+            for (const ObjCorner& corner : triangle.corners) {
+                CornerRecord record = {};
+                record.key = corner.position;
+                record.order = order++;
+                record.position_index = static_cast<std::uint32_t>(corner.position);
+                record.normal_index = corner.normal != OBJ_NO_INDEX ? static_cast<std::uint32_t>(corner.normal) : NO_INDEX;
+                record.uv_index = corner.texture_coordinates != OBJ_NO_INDEX ? static_cast<std::uint32_t>(corner.texture_coordinates) : NO_INDEX;
+                normals_follow_positions = normals_follow_positions && (record.normal_index == NO_INDEX || record.normal_index == record.position_index);
+                uvs_follow_positions = uvs_follow_positions && (record.uv_index == NO_INDEX || record.uv_index == record.position_index);
+                hr = SUCCEEDED(hr) ? corners.push(record) : hr;
+            }
+
+            if (SUCCEEDED(hr) && !faces.write({current_material, triangle.has_normals ? KEEP_NORMALS : triangle.smoothing_group})) {
+                hr = E_FAIL;
+            }
+
+            triangles++;
+            return hr;
+        }
+
+        HRESULT set_object(const std::string&) {
+            return S_OK;
+        }
+
+        HRESULT use_material(const std::string& name) {
+            current_material = static_cast<std::uint32_t>(materials.find_material(name));
+            return S_OK;
+        }
+
+        HRESULT load_material_library(const std::string& file_name) {
+            has_material_library = true;
+            return materials.load_material_library(directory / file_name);
+        }
+
+    private:
+        std::filesystem::path directory;
+        ObjectLoader& materials;
+        CornerSorter& corners;
+        std::uint32_t current_material = NO_MATERIAL;
+
+        // Indices into the attribute files are 32 bit.
+        template <typename T>
+        static HRESULT write(RecordWriter<T>& writer, const T& value) {
+            if (writer.get_count() >= NO_INDEX) {
+                return E_INVALIDARG;
+            }
+
+            return writer.write(value) ? S_OK : E_FAIL;
+        }
+    };
+
+    // Streams the OBJ file with the statement loop of ObjectLoader::load.
+    HRESULT parse(const std::string& uri, const TemporaryFiles& files, std::size_t scan_bytes, ObjectLoader& materials,
+                  CornerSorter& corners, AttributeCounts& counts) {
+        std::ifstream file(uri + ".obj", std::ios::binary);
+        ObjScanner scanner(file, scan_bytes);
+        Statements statements(files, std::filesystem::path(uri).parent_path(), materials, corners);
+        HRESULT hr = S_OK;
+
+        if (!file.is_open() || !statements.positions.is_open() || !statements.normals.is_open() ||
+            !statements.uvs.is_open() || !statements.faces.is_open()) {
+            hr = E_FAIL;
+        }
+
+        if (SUCCEEDED(hr)) {
+            hr = visit_obj_statements(scanner, statements);
+        }
+
+        if (SUCCEEDED(hr) && (file.bad() || !statements.positions.flush() || !statements.normals.flush() ||
+                              !statements.uvs.flush() || !statements.faces.flush())) {
+            hr = E_FAIL;
+        }
+
+        if (SUCCEEDED(hr) && !statements.has_material_library && std::filesystem::exists(uri + ".mtl")) {
+            hr = materials.load_material_library(uri + ".mtl");
+        }
+
+        counts = {statements.positions.get_count(), statements.normals.get_count(), statements.uvs.get_count(), statements.triangles,
+                  statements.normals_follow_positions, statements.uvs_follow_positions};
+        return hr;
+    }
+
+    // Attributes a join reads, the ones the corners were sorted by and any that follow them.
+    struct JoinedAttributes {
+        bool positions = false;
+        bool normals = false;
+        bool uvs = false;
+    };
+
+    // Merges the sorted corners alongside the attribute files they point into, which are
+    // thereby read front to back, and pushes them to the next sort keyed by next_key (by
+    // their order alone when it is null).
+    HRESULT join(CornerSorter& sorted, const TemporaryFiles& files, JoinedAttributes joined,
+                 std::uint32_t CornerRecord::* next_key, CornerSorter& next) {
+        std::optional<RecordReader<DirectX::XMFLOAT3>> positions;
+        std::optional<RecordReader<DirectX::XMFLOAT3>> normals;
+        std::optional<RecordReader<DirectX::XMFLOAT2>> uvs;
+
+        if (joined.positions) {
+            positions.emplace(files.positions, FILE_BUFFER_BYTES);
+        }
+
+        if (joined.normals) {
+            normals.emplace(files.normals, FILE_BUFFER_BYTES);
+        }
+
+        if (joined.uvs) {
+            uvs.emplace(files.uvs, FILE_BUFFER_BYTES);
+        }
+
+        CornerRecord corner;
+        HRESULT hr = sorted.finish();
+
+        while (SUCCEEDED(hr) && sorted.next(corner)) {
+            CornerAttributes& attributes = corner.attributes;
+
+            if ((positions && !positions->get(corner.position_index, attributes.position)) ||
+                (normals && corner.normal_index != NO_INDEX && !normals->get(corner.normal_index, attributes.normal)) ||
+                (uvs && corner.uv_index != NO_INDEX && !uvs->get(corner.uv_index, attributes.texture_coordinates))) {
+                hr = E_FAIL;
+                break;
+            }
+
+            corner.key = next_key != nullptr ? corner.*next_key : 0;
+            hr = next.push(corner);
+        }
+
+        return SUCCEEDED(hr) && !sorted.is_complete() ? E_FAIL : hr;
+    }
+
+    // Brings the corners, in order, together into triangles and sorts them by their cell.
+    HRESULT assemble(CornerSorter& corners, const std::filesystem::path& faces_path, float chunk_size, TriangleSorter& triangles) {
+        RecordReader<FaceRecord> faces(faces_path, FILE_BUFFER_BYTES);
+        CornerRecord corner;
+        TriangleRecord triangle = {};
+        std::uint64_t number_of_corners = 0;
+        HRESULT hr = corners.finish();
+
+        while (SUCCEEDED(hr) && corners.next(corner)) {
+            std::size_t k = number_of_corners % 3;
+
+            if (corner.order != number_of_corners++) {
+                hr = E_FAIL;
+                break;
+            }
+
+            triangle.corners[k] = corner.attributes;
+            triangle.position_indices[k] = corner.position_index;
+
+            if (k < 2) {
+                continue;
+            }
+
+            FaceRecord face = {};
+
+            if (!faces.next(face)) {
+                hr = E_FAIL;
+                break;
+            }
+
+            const CornerAttributes* c = triangle.corners;
+            float x = (c[0].position.x + c[1].position.x + c[2].position.x) / 3.0f;
+            float z = (c[0].position.z + c[1].position.z + c[2].position.z) / 3.0f;
+            auto row = static_cast<std::uint32_t>(static_cast<std::int32_t>(std::floor(z / chunk_size)));
+            auto column = static_cast<std::uint32_t>(static_cast<std::int32_t>(std::floor(x / chunk_size)));
+
+            // Flipping the sign bits orders negative cells first, like the signed pairs of split.
+            triangle.key = (static_cast<std::uint64_t>(row ^ 0x80000000u) << 32) | (column ^ 0x80000000u);
+            triangle.order = corner.order / 3;
+            triangle.smoothing_group = face.smoothing_group;
+            triangle.material = face.material;
+            hr = triangles.push(triangle);
+        }
+
+        return SUCCEEDED(hr) && (!corners.is_complete() || number_of_corners % 3 != 0) ? E_FAIL : hr;
+    }
+}
+
+MeshCooker::MeshCooker(std::string uri, DirectX::XMFLOAT4 color) : MeshCooker(std::move(uri), color, Options()) {}
+
+MeshCooker::MeshCooker(std::string uri, DirectX::XMFLOAT4 color, Options options)
+        : uri(std::move(uri)), color(color), options(std::move(options)) {}
+
+HRESULT MeshCooker::cook(const std::filesystem::path& output_directory) {
+    auto start = Clock::now();
+    statistics = {};
+
+    // A third of the budget for the sort being filled and one for the one being merged (or only
+    // its merge buffers once it spilled), the rest for the chunk being written.
+    std::size_t sort_bytes = options.memory_budget / 3;
+    std::size_t merge_bytes = options.memory_budget / 8;
+    std::size_t max_chunk_triangles = std::max<std::size_t>(options.memory_budget / 6 / sizeof(TriangleRecord), 1);
+    std::size_t scan_bytes = std::clamp<std::size_t>(options.memory_budget / 16, 1 << 16, ObjScanner::DEFAULT_CHUNK_SIZE);
+
+    std::filesystem::path temporary = (options.temporary_directory.empty() ? output_directory : options.temporary_directory) / "cook.tmp";
+    TemporaryFiles files = {temporary / "positions.bin", temporary / "normals.bin", temporary / "uvs.bin", temporary / "faces.bin"};
+    std::error_code error;
+    std::filesystem::create_directories(output_directory, error);
+
+    if (!error) {
+        std::filesystem::create_directories(temporary, error);
+    }
+
+    HRESULT hr = error ? E_FAIL : S_OK;
+    ObjectLoader materials(uri, color);
+    AttributeCounts counts;
+    auto sorted = std::make_unique<CornerSorter>(temporary, "positions", sort_bytes, merge_bytes);
+
+    if (SUCCEEDED(hr)) {
+        hr = parse(uri, files, scan_bytes, materials, *sorted, counts);
+        statistics.input_bytes = std::filesystem::file_size(uri + ".obj", error);
+        statistics.triangles = counts.triangles;
+        statistics.temporary_bytes = (counts.positions + counts.normals) * sizeof(DirectX::XMFLOAT3) +
+                                     counts.uvs * sizeof(DirectX::XMFLOAT2) + counts.triangles * sizeof(FaceRecord);
+        statistics.parse_seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    // Normals and uvs get sorts of their own only when the file has them and they do not follow the positions.
+    bool sort_normals = counts.normals > 0 && !counts.normals_follow_positions;
+    bool sort_uvs = counts.uvs > 0 && !counts.uvs_follow_positions;
+    std::uint32_t CornerRecord::* normal_key = sort_normals ? &CornerRecord::normal_index : nullptr;
+    std::uint32_t CornerRecord::* uv_key = sort_uvs ? &CornerRecord::uv_index : nullptr;
+
+    auto advance = [&](const char* name, JoinedAttributes joined, std::uint32_t CornerRecord::* next_key) {
+        auto next = std::make_unique<CornerSorter>(temporary, name, sort_bytes, merge_bytes);
+        hr = SUCCEEDED(hr) ? join(*sorted, files, joined, next_key, *next) : hr;
+        statistics.sorted_runs += sorted->get_number_of_runs();
+        statistics.temporary_bytes += sorted->get_written_bytes();
+        sorted = std::move(next);
+    };
+
+    advance(sort_normals ? "normals" : sort_uvs ? "uvs" : "corners", {true, !sort_normals, !sort_uvs}, sort_normals ? normal_key : uv_key);
+
+    if (sort_normals) {
+        advance(sort_uvs ? "uvs" : "corners", {false, true, false}, uv_key);
+    }
+
+    if (sort_uvs) {
+        advance("corners", {false, false, true}, nullptr);
+    }
+
+    auto triangles = std::make_unique<TriangleSorter>(temporary, "triangles", sort_bytes, merge_bytes);
+
+    if (SUCCEEDED(hr)) {
+        hr = assemble(*sorted, files.faces, options.chunk_size, *triangles);
+    }
+
+    statistics.sorted_runs += sorted->get_number_of_runs();
+    statistics.temporary_bytes += sorted->get_written_bytes();
+    sorted.reset();
+
+    // Every cell is complete once the sort moves on to the next one.
+    std::vector<Vertex> vertices;
+    std::vector<std::uint32_t> position_indices;
+    std::vector<std::uint32_t> smoothing_groups;
+    std::unordered_map<std::uint32_t, std::uint32_t> local_positions;
+    TriangleRecord triangle;
+    std::uint64_t cell = 0;
+
+    // Faces before the first usemtl get the first material of the library, see ObjectLoader::load.
+    const std::vector<Material>& material_list = materials.get_materials();
+    DirectX::XMFLOAT4 default_diffuse = material_list.empty() ? DirectX::XMFLOAT4{1.0f, 1.0f, 1.0f, 1.0f} : material_list[0].diffuse_color;
+
+    auto write_chunk = [&]() {
+        if (std::any_of(smoothing_groups.begin(), smoothing_groups.end(), [](std::uint32_t group) { return group != KEEP_NORMALS; })) {
+            generate_normals(vertices, position_indices, smoothing_groups, TaskScheduler::get_default());
+        }
+
+        MeshChunk chunk;
+        chunk.vertices = std::move(vertices);
+
+        for (const Vertex& vertex : chunk.vertices) {
+            chunk.bounds.merge(vertex.position);
+        }
+
+        std::filesystem::path path = get_chunk_path(output_directory, statistics.chunks);
+        HRESULT chunk_hr = options.compress ? chunk.save_compressed(path, options.encode_options) : chunk.save(path);
+
+        statistics.chunks++;
+        statistics.output_bytes += std::filesystem::file_size(path, error);
+        statistics.max_chunk_triangles = std::max<std::uint64_t>(statistics.max_chunk_triangles, chunk.vertices.size() / 3);
+
+        // Keeps the memory for the next chunk.
+        vertices = std::move(chunk.vertices);
+        vertices.clear();
+        position_indices.clear();
+        smoothing_groups.clear();
+        local_positions.clear();
+
+        return chunk_hr;
+    };
+
+    if (SUCCEEDED(hr)) {
+        hr = triangles->finish();
+    }
+
+    while (SUCCEEDED(hr) && triangles->next(triangle)) {
+        if (!smoothing_groups.empty() && triangle.key != cell) {
+            hr = write_chunk();
+        }
+
+        if (smoothing_groups.size() >= max_chunk_triangles) {
+            hr = E_OUTOFMEMORY;
+        }
+
+        cell = triangle.key;
+
+        const DirectX::XMFLOAT4& diffuse = triangle.material == NO_MATERIAL ? default_diffuse : material_list[triangle.material].diffuse_color;
+
+        for (std::size_t k = 0; SUCCEEDED(hr) && k < 3; k++) {
+            const CornerAttributes& corner = triangle.corners[k];
+            auto [it, inserted] = local_positions.try_emplace(triangle.position_indices[k], static_cast<std::uint32_t>(local_positions.size()));
+            vertices.push_back({
+                    corner.position,
+                    corner.normal,
+                    {color.x * diffuse.x, color.y * diffuse.y, color.z * diffuse.z, color.w * diffuse.w},
+                    corner.texture_coordinates
+            });
+            position_indices.push_back(it->second);
+        }
+
+        smoothing_groups.push_back(triangle.smoothing_group);
+    }
+
+    if (SUCCEEDED(hr) && !smoothing_groups.empty()) {
+        hr = write_chunk();
+    }
+
+    if (SUCCEEDED(hr) && !triangles->is_complete()) {
+        hr = E_FAIL;
+    }
+
+    statistics.sorted_runs += triangles->get_number_of_runs();
+    statistics.temporary_bytes += triangles->get_written_bytes();
+    statistics.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    // Closes the runs before they are removed.
+    triangles.reset();
+
+    std::filesystem::remove_all(temporary, error);
+    return hr;
+}
+
+std::filesystem::path MeshCooker::get_chunk_path(const std::filesystem::path& directory, std::size_t index) {
+    char file_name[32];
+    std::snprintf(file_name, sizeof(file_name), "chunk_%05zu.bin", index);
+    return directory / file_name;
+}
+
+const MeshCooker::Statistics& MeshCooker::get_statistics() const {
+    return statistics;
+}
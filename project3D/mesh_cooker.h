@@ -0,0 +1,81 @@
+#ifndef PROJECT3D_MESH_COOKER_H
+#define PROJECT3D_MESH_COOKER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <DirectXMath.h>
+
+#include "hresult.h"
+#include "mesh_codec.h"
+
+// Cooks <uri>.obj into MeshChunk files (chunk_00000.bin, ... in the order of
+// MeshChunk::split) for models that do not fit in memory, like photogrammetry
+// scans. Nothing but the current chunk is held whole; the file is streamed
+// once and the rest goes through external sorts in the temporary directory:
+//  - positions, normals and uvs are written to attribute files and the face
+//    corners, with their indices, to a sort by position index,
+//  - every sort is merged alongside the matching attribute file, which is
+//    read front to back, and feeds the next sort (normals, uvs and finally
+//    the corner order, which brings the triangles together again); normals
+//    and uvs indexed like the positions, as in scans, are read with them,
+//  - triangles are sorted by the chunk_size x chunk_size cell of their
+//    centroid and every cell is written once it is complete, with normals
+//    generated for the faces that have none and, unless compress is off,
+//    merged vertices (see encode_mesh).
+// The vertices are the ones ObjectLoader gives (flipped axes, diffuse colors
+// multiplied in). Smoothing groups are followed within a chunk only, so
+// generated smooth normals may differ along chunk borders.
+class MeshCooker {
+public:
+    struct Options {
+        // Buffers of the sorts, the scanned part of the file and the chunk being written
+        std::size_t memory_budget = std::size_t{2} << 30;
+
+        float chunk_size = 32.0f;
+        bool compress = true;
+        MeshEncodeOptions encode_options;
+
+        // For the attribute files and sorted runs; empty for the output directory
+        std::filesystem::path temporary_directory;
+    };
+
+    struct Statistics {
+        std::uint64_t input_bytes = 0;
+        std::uint64_t triangles = 0;
+        std::uint64_t chunks = 0;
+        std::uint64_t output_bytes = 0;
+
+        // Written to the temporary directory, attribute files and sorted runs together
+        std::uint64_t temporary_bytes = 0;
+        std::uint64_t sorted_runs = 0;
+
+        // The largest chunk, which had to be held whole
+        std::uint64_t max_chunk_triangles = 0;
+
+        double parse_seconds = 0.0;
+        double seconds = 0.0;
+    };
+
+    MeshCooker(std::string uri, DirectX::XMFLOAT4 color);
+    MeshCooker(std::string uri, DirectX::XMFLOAT4 color, Options options);
+
+    // Fails with E_OUTOFMEMORY when a single chunk does not fit in a quarter of the
+    // budget (a smaller chunk_size helps) and with E_INVALIDARG for more than 2^32 - 1
+    // positions, normals or uvs.
+    HRESULT cook(const std::filesystem::path& output_directory);
+
+    const Statistics& get_statistics() const;
+
+    // chunk_<index>.bin, the index padded to five digits
+    static std::filesystem::path get_chunk_path(const std::filesystem::path& directory, std::size_t index);
+
+private:
+    const std::string uri;
+    const DirectX::XMFLOAT4 color;
+    const Options options;
+    Statistics statistics;
+};
+
+#endif //PROJECT3D_MESH_COOKER_H
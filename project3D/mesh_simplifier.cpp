@@ -0,0 +1,128 @@
+#include "mesh_simplifier.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <unordered_map>
+
+#include "bounds.h"
+
+namespace {
+    // Cells along an axis are numbered with 21 bits
+    constexpr unsigned MAX_CELLS = (1u << 21) - 1;
+
+    struct Cluster {
+        DirectX::XMFLOAT3 position = {0.0f, 0.0f, 0.0f};
+        DirectX::XMFLOAT3 normal = {0.0f, 0.0f, 0.0f};
+        DirectX::XMFLOAT4 color = {0.0f, 0.0f, 0.0f, 0.0f};
+        DirectX::XMFLOAT2 texture_coordinates = {0.0f, 0.0f};
+        float count = 0.0f;
+    };
+
+    std::uint64_t get_cell(float value, float min, float scale, unsigned cells) {
+        float cell = std::floor((value - min) * scale);
+        return static_cast<std::uint64_t>(std::clamp(cell, 0.0f, static_cast<float>(cells - 1)));
+    }
+}
+
+void simplify_mesh(const std::vector<Vertex>& vertices, const std::vector<std::uint32_t>& indices,
+                   unsigned cells_along_longest_axis,
+                   std::vector<Vertex>& simplified_vertices, std::vector<std::uint32_t>& simplified_indices) {
+    simplified_vertices.clear();
+    simplified_indices.clear();
+
+    Aabb bounds;
+
+    for (const Vertex& vertex : vertices) {
+        bounds.merge(vertex.position);
+    }
+
+    if (bounds.empty()) {
+        return;
+    }
+
+    unsigned cells = std::clamp(cells_along_longest_axis, 1u, MAX_CELLS);
+    float longest = std::max({bounds.max.x - bounds.min.x, bounds.max.y - bounds.min.y, bounds.max.z - bounds.min.z});
+    float scale = longest > 0.0f ? static_cast<float>(cells) / longest : 0.0f;
+
+    // Cluster of every vertex, numbered in the order of first use
+    std::unordered_map<std::uint64_t, std::uint32_t> cluster_of_cell;
+    std::vector<std::uint32_t> cluster_of_vertex(vertices.size());
+    std::vector<Cluster> clusters;
+
+    for (std::size_t i = 0; i < vertices.size(); i++) {
+        const Vertex& vertex = vertices[i];
+        std::uint64_t cell = get_cell(vertex.position.x, bounds.min.x, scale, cells) |
+                             get_cell(vertex.position.y, bounds.min.y, scale, cells) << 21 |
+                             get_cell(vertex.position.z, bounds.min.z, scale, cells) << 42;
+        auto [it, inserted] = cluster_of_cell.try_emplace(cell, static_cast<std::uint32_t>(clusters.size()));
+
+        if (inserted) {
+            clusters.emplace_back();
+        }
+
+        Cluster& cluster = clusters[it->second];
+        cluster.position.x += vertex.position.x;
+        cluster.position.y += vertex.position.y;
+        cluster.position.z += vertex.position.z;
+        cluster.normal.x += vertex.normal.x;
+        cluster.normal.y += vertex.normal.y;
+        cluster.normal.z += vertex.normal.z;
+        cluster.color.x += vertex.color.x;
+        cluster.color.y += vertex.color.y;
+        cluster.color.z += vertex.color.z;
+        cluster.color.w += vertex.color.w;
+        cluster.texture_coordinates.x += vertex.texture_coordinates.x;
+        cluster.texture_coordinates.y += vertex.texture_coordinates.y;
+        cluster.count += 1.0f;
+        cluster_of_vertex[i] = it->second;
+    }
+
+    std::vector<std::array<std::uint32_t, 3>> triangles;
+    triangles.reserve(indices.size() / 3);
+
+    for (std::size_t i = 0; i + 2 < indices.size(); i += 3) {
+        std::array<std::uint32_t, 3> triangle = {
+                cluster_of_vertex[indices[i]], cluster_of_vertex[indices[i + 1]], cluster_of_vertex[indices[i + 2]]};
+
+        if (triangle[0] == triangle[1] || triangle[1] == triangle[2] || triangle[2] == triangle[0]) {
+            continue;
+        }
+
+        // The smallest corner first keeps the winding and makes repeated triangles equal
+        std::rotate(triangle.begin(), std::min_element(triangle.begin(), triangle.end()), triangle.end());
+        triangles.push_back(triangle);
+    }
+
+    std::sort(triangles.begin(), triangles.end());
+    triangles.erase(std::unique(triangles.begin(), triangles.end()), triangles.end());
+
+    // Only the clusters the remaining triangles use are kept
+    constexpr std::uint32_t UNUSED = 0xFFFFFFFFu;
+    std::vector<std::uint32_t> remap(clusters.size(), UNUSED);
+    simplified_indices.reserve(triangles.size() * 3);
+
+    for (const auto& triangle : triangles) {
+        for (std::uint32_t cluster_index : triangle) {
+            if (remap[cluster_index] == UNUSED) {
+                const Cluster& cluster = clusters[cluster_index];
+                float inverse = 1.0f / cluster.count;
+                Vertex vertex;
+                vertex.position = {cluster.position.x * inverse, cluster.position.y * inverse, cluster.position.z * inverse};
+                vertex.color = {cluster.color.x * inverse, cluster.color.y * inverse, cluster.color.z * inverse, cluster.color.w * inverse};
+                vertex.texture_coordinates = {cluster.texture_coordinates.x * inverse, cluster.texture_coordinates.y * inverse};
+
+                float length = std::sqrt(cluster.normal.x * cluster.normal.x + cluster.normal.y * cluster.normal.y +
+                                         cluster.normal.z * cluster.normal.z);
+                vertex.normal = length > 0.0f
+                        ? DirectX::XMFLOAT3(cluster.normal.x / length, cluster.normal.y / length, cluster.normal.z / length)
+                        : DirectX::XMFLOAT3(0.0f, 1.0f, 0.0f);
+
+                remap[cluster_index] = static_cast<std::uint32_t>(simplified_vertices.size());
+                simplified_vertices.push_back(vertex);
+            }
+
+            simplified_indices.push_back(remap[cluster_index]);
+        }
+    }
+}
@@ -0,0 +1,21 @@
+#ifndef PROJECT3D_MESH_SIMPLIFIER_H
+#define PROJECT3D_MESH_SIMPLIFIER_H
+
+#include <cstdint>
+#include <vector>
+
+#include "common.h"
+
+// Levels of detail by vertex clustering: positions are snapped to a grid of
+// cubic cells, cells_along_longest_axis of them along the longest side of the
+// bounds, the vertices of a cell merged into one with their averaged
+// attributes and triangles left with fewer than three distinct corners (or
+// repeating another one) dropped. It takes one pass and works on any input,
+// at the price of quality next to error driven simplification: seams of
+// texture coordinates and hard edges are averaged away and thin parts may
+// collapse. The simplified triangles are sorted by their corners.
+void simplify_mesh(const std::vector<Vertex>& vertices, const std::vector<std::uint32_t>& indices,
+                   unsigned cells_along_longest_axis,
+                   std::vector<Vertex>& simplified_vertices, std::vector<std::uint32_t>& simplified_indices);
+
+#endif //PROJECT3D_MESH_SIMPLIFIER_H
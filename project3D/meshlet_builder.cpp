@@ -0,0 +1,67 @@
+#include "meshlet_builder.h"
+
+#include <algorithm>
+
+namespace {
+    constexpr std::uint32_t NOT_IN_MESHLET = 0xFFFFFFFFu;
+    constexpr std::size_t MAX_MESHLET_VERTICES = 256;
+}
+
+Meshlets build_meshlets(const std::vector<Vertex>& vertices, const std::vector<std::uint32_t>& indices,
+                        std::size_t max_vertices, std::size_t max_triangles) {
+    max_vertices = std::clamp<std::size_t>(max_vertices, 3, MAX_MESHLET_VERTICES);
+    max_triangles = std::max<std::size_t>(max_triangles, 1);
+
+    Meshlets result;
+    result.vertex_indices.reserve(indices.size() / 2);
+    result.triangle_indices.reserve(indices.size());
+
+    // Position of every vertex in the current meshlet
+    std::vector<std::uint32_t> local_index(vertices.size(), NOT_IN_MESHLET);
+    Meshlet current = {0, 0, 0, 0, Aabb()};
+
+    auto finish = [&] {
+        if (current.triangle_count == 0) {
+            return;
+        }
+
+        for (std::size_t i = current.vertex_offset; i < result.vertex_indices.size(); i++) {
+            local_index[result.vertex_indices[i]] = NOT_IN_MESHLET;
+        }
+
+        result.meshlets.push_back(current);
+        current = {static_cast<std::uint32_t>(result.vertex_indices.size()), 0,
+                   static_cast<std::uint32_t>(result.triangle_indices.size() / 3), 0, Aabb()};
+    };
+
+    for (std::size_t i = 0; i + 2 < indices.size(); i += 3) {
+        std::size_t new_vertices = 0;
+
+        for (std::size_t corner = 0; corner < 3; corner++) {
+            std::uint32_t vertex = indices[i + corner];
+            bool repeated = (corner > 0 && vertex == indices[i]) || (corner > 1 && vertex == indices[i + 1]);
+            new_vertices += local_index[vertex] == NOT_IN_MESHLET && !repeated ? 1 : 0;
+        }
+
+        if (current.vertex_count + new_vertices > max_vertices || current.triangle_count + 1 > max_triangles) {
+            finish();
+        }
+
+        for (std::size_t corner = 0; corner < 3; corner++) {
+            std::uint32_t vertex = indices[i + corner];
+
+            if (local_index[vertex] == NOT_IN_MESHLET) {
+                local_index[vertex] = current.vertex_count++;
+                result.vertex_indices.push_back(vertex);
+                current.bounds.merge(vertices[vertex].position);
+            }
+
+            result.triangle_indices.push_back(static_cast<std::uint8_t>(local_index[vertex]));
+        }
+
+        current.triangle_count++;
+    }
+
+    finish();
+    return result;
+}
@@ -0,0 +1,43 @@
+#ifndef PROJECT3D_MESHLET_BUILDER_H
+#define PROJECT3D_MESHLET_BUILDER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "bounds.h"
+#include "common.h"
+
+// Meshlets of an indexed mesh, the unit mesh shaders and cluster culling
+// work on: small groups of triangles with their own list of (at most 256)
+// vertices, so a triangle's corners fit in a byte each.
+struct Meshlet {
+    // Into Meshlets::vertex_indices
+    std::uint32_t vertex_offset;
+    std::uint32_t vertex_count;
+
+    // In triangles, into Meshlets::triangle_indices (three per triangle)
+    std::uint32_t triangle_offset;
+    std::uint32_t triangle_count;
+
+    Aabb bounds;
+};
+
+struct Meshlets {
+    std::vector<Meshlet> meshlets;
+
+    // Vertices of the mesh
+    std::vector<std::uint32_t> vertex_indices;
+
+    // Vertices of the meshlet
+    std::vector<std::uint8_t> triangle_indices;
+};
+
+// Takes the triangles in their order and starts a new meshlet whenever the next one would
+// bring the current over max_vertices (at most 256) or max_triangles. 64 and 124 are what
+// most hardware handles best; the order of the triangles decides how well vertices are
+// shared, so it should be a local one (as from encode_mesh / decode_mesh).
+Meshlets build_meshlets(const std::vector<Vertex>& vertices, const std::vector<std::uint32_t>& indices,
+                        std::size_t max_vertices, std::size_t max_triangles);
+
+#endif //PROJECT3D_MESHLET_BUILDER_H
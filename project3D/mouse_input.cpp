@@ -0,0 +1,45 @@
+#include "mouse_input.h"
+
+void MouseInput::add(std::int32_t delta_x, std::int32_t delta_y, std::uint64_t timestamp) {
+    // The oldest timestamp is only set by the first event after consume().
+    std::uint64_t expected = 0;
+    first_timestamp.compare_exchange_strong(expected, timestamp, std::memory_order_relaxed);
+    last_timestamp.store(timestamp, std::memory_order_relaxed);
+
+    packed_delta.fetch_add(pack(delta_x, delta_y), std::memory_order_relaxed);
+    event_count.fetch_add(1, std::memory_order_release);
+}
+
+MouseInput::Sample MouseInput::consume() {
+    Sample sample;
+
+    sample.event_count = event_count.exchange(0, std::memory_order_acquire);
+
+    if (sample.event_count == 0) {
+        return sample;
+    }
+
+    unpack(packed_delta.exchange(0, std::memory_order_relaxed), sample.delta_x, sample.delta_y);
+    sample.first_timestamp = first_timestamp.exchange(0, std::memory_order_relaxed);
+    sample.last_timestamp = last_timestamp.load(std::memory_order_relaxed);
+
+    // An event racing with consume() may already have stored its timestamp
+    // after the exchange above, it then simply counts towards the next sample.
+    if (sample.first_timestamp == 0) {
+        sample.first_timestamp = sample.last_timestamp;
+    }
+
+    return sample;
+}
+
+std::uint64_t MouseInput::pack(std::int32_t delta_x, std::int32_t delta_y) {
+    // Two's complement wrap-around makes the carry out of the low half cancel
+    // out when unpacking, as long as each sum fits into 32 bits.
+    return (static_cast<std::uint64_t>(static_cast<std::uint32_t>(delta_y)) << 32) +
+           static_cast<std::uint64_t>(static_cast<std::int64_t>(delta_x));
+}
+
+void MouseInput::unpack(std::uint64_t packed, std::int32_t& delta_x, std::int32_t& delta_y) {
+    delta_x = static_cast<std::int32_t>(static_cast<std::uint32_t>(packed));
+    delta_y = static_cast<std::int32_t>(static_cast<std::uint32_t>((packed - static_cast<std::uint64_t>(static_cast<std::int64_t>(delta_x))) >> 32));
+}
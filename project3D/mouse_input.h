@@ -0,0 +1,46 @@
+#ifndef PROJECT3D_MOUSE_INPUT_H
+#define PROJECT3D_MOUSE_INPUT_H
+
+#include <atomic>
+#include <cstdint>
+
+#include "profiler.h"
+
+// Raw mouse deltas summed between frames. add() can be called from any thread
+// (window procedure, a dedicated input thread) at the same time as consume(),
+// neither of them takes a lock, and no motion is lost however many events
+// arrive during a frame.
+class MouseInput {
+public:
+    struct Sample {
+        std::int32_t delta_x = 0;
+        std::int32_t delta_y = 0;
+        std::uint32_t event_count = 0;
+
+        // Profiler ticks of the oldest and the newest event in the sample.
+        std::uint64_t first_timestamp = 0;
+        std::uint64_t last_timestamp = 0;
+
+        bool empty() const {
+            return event_count == 0;
+        }
+    };
+
+    void add(std::int32_t delta_x, std::int32_t delta_y, std::uint64_t timestamp = Profiler::now());
+
+    // Everything added since the previous call.
+    Sample consume();
+
+private:
+    // Both deltas live in one 64-bit word (delta_y * 2^32 + delta_x), so they
+    // are summed with a single fetch_add and taken with a single exchange.
+    static std::uint64_t pack(std::int32_t delta_x, std::int32_t delta_y);
+    static void unpack(std::uint64_t packed, std::int32_t& delta_x, std::int32_t& delta_y);
+
+    std::atomic<std::uint64_t> packed_delta{0};
+    std::atomic<std::uint32_t> event_count{0};
+    std::atomic<std::uint64_t> first_timestamp{0};
+    std::atomic<std::uint64_t> last_timestamp{0};
+};
+
+#endif //PROJECT3D_MOUSE_INPUT_H
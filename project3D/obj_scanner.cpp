@@ -0,0 +1,456 @@
+#include "obj_scanner.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#define OBJ_SCANNER_X86
+#elif defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define OBJ_SCANNER_X86
+#endif
+
+// GCC and Clang only emit vector instructions the function is compiled for, MSVC emits any intrinsic.
+#if defined(OBJ_SCANNER_X86) && defined(__GNUC__)
+#define OBJ_SCANNER_TARGET(isa) __attribute__((target(isa)))
+#else
+#define OBJ_SCANNER_TARGET(isa)
+#endif
+
+namespace {
+    constexpr std::size_t BLOCK_SIZE = 64;
+
+    // Powers of ten exactly representable in double
+    constexpr double DOUBLE_POWERS_OF_TEN[] = {
+            1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+            1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+
+    struct Masks {
+        std::uint64_t* newlines;
+        std::uint64_t* whitespace;
+        std::uint64_t* slashes;
+    };
+
+    void scan_scalar(const char* text, std::size_t blocks, Masks masks) {
+        for (std::size_t block = 0; block < blocks; block++) {
+            std::uint64_t newlines = 0;
+            std::uint64_t whitespace = 0;
+            std::uint64_t slashes = 0;
+
+            for (std::size_t i = 0; i < BLOCK_SIZE; i++) {
+                char c = text[block * BLOCK_SIZE + i];
+                newlines |= static_cast<std::uint64_t>(c == '\n') << i;
+                whitespace |= static_cast<std::uint64_t>(c == ' ' || c == '\t' || c == '\r') << i;
+                slashes |= static_cast<std::uint64_t>(c == '/') << i;
+            }
+
+            masks.newlines[block] = newlines;
+            masks.whitespace[block] = whitespace;
+            masks.slashes[block] = slashes;
+        }
+    }
+
+#ifdef OBJ_SCANNER_X86
+    OBJ_SCANNER_TARGET("sse2")
+    void scan_sse2(const char* text, std::size_t blocks, Masks masks) {
+        const __m128i newline = _mm_set1_epi8('\n');
+        const __m128i space = _mm_set1_epi8(' ');
+        const __m128i tab = _mm_set1_epi8('\t');
+        const __m128i carriage_return = _mm_set1_epi8('\r');
+        const __m128i slash = _mm_set1_epi8('/');
+
+        for (std::size_t block = 0; block < blocks; block++) {
+            std::uint64_t newlines = 0;
+            std::uint64_t whitespace = 0;
+            std::uint64_t slashes = 0;
+
+            for (int part = 0; part < 4; part++) {
+                __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + block * BLOCK_SIZE + 16 * part));
+                __m128i blank = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(bytes, space), _mm_cmpeq_epi8(bytes, tab)),
+                                             _mm_cmpeq_epi8(bytes, carriage_return));
+
+                newlines |= static_cast<std::uint64_t>(static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, newline)))) << (16 * part);
+                whitespace |= static_cast<std::uint64_t>(static_cast<std::uint32_t>(_mm_movemask_epi8(blank))) << (16 * part);
+                slashes |= static_cast<std::uint64_t>(static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, slash)))) << (16 * part);
+            }
+
+            masks.newlines[block] = newlines;
+            masks.whitespace[block] = whitespace;
+            masks.slashes[block] = slashes;
+        }
+    }
+
+    OBJ_SCANNER_TARGET("avx2")
+    void scan_avx2(const char* text, std::size_t blocks, Masks masks) {
+        const __m256i newline = _mm256_set1_epi8('\n');
+        const __m256i space = _mm256_set1_epi8(' ');
+        const __m256i tab = _mm256_set1_epi8('\t');
+        const __m256i carriage_return = _mm256_set1_epi8('\r');
+        const __m256i slash = _mm256_set1_epi8('/');
+
+        for (std::size_t block = 0; block < blocks; block++) {
+            std::uint64_t newlines = 0;
+            std::uint64_t whitespace = 0;
+            std::uint64_t slashes = 0;
+
+            for (int part = 0; part < 2; part++) {
+                __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + block * BLOCK_SIZE + 32 * part));
+                __m256i blank = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(bytes, space), _mm256_cmpeq_epi8(bytes, tab)),
+                                                _mm256_cmpeq_epi8(bytes, carriage_return));
+
+                newlines |= static_cast<std::uint64_t>(static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, newline)))) << (32 * part);
+                whitespace |= static_cast<std::uint64_t>(static_cast<std::uint32_t>(_mm256_movemask_epi8(blank))) << (32 * part);
+                slashes |= static_cast<std::uint64_t>(static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, slash)))) << (32 * part);
+            }
+
+            masks.newlines[block] = newlines;
+            masks.whitespace[block] = whitespace;
+            masks.slashes[block] = slashes;
+        }
+    }
+
+    struct CpuFeatures {
+        bool sse2 = false;
+        bool avx2 = false;
+    };
+
+    CpuFeatures detect_cpu_features() {
+        CpuFeatures features;
+#ifdef _MSC_VER
+        int info[4] = {};
+        __cpuid(info, 0);
+        int max_leaf = info[0];
+
+        __cpuid(info, 1);
+        features.sse2 = (info[3] & (1 << 26)) != 0;
+
+        // AVX2 also needs the OS to save the upper halves of the registers (OSXSAVE, XCR0 bits 1 and 2).
+        bool os_saves_avx = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 && (_xgetbv(0) & 6) == 6;
+
+        if (max_leaf >= 7 && os_saves_avx) {
+            __cpuidex(info, 7, 0);
+            features.avx2 = (info[1] & (1 << 5)) != 0;
+        }
+#else
+        __builtin_cpu_init();
+        features.sse2 = __builtin_cpu_supports("sse2");
+        features.avx2 = __builtin_cpu_supports("avx2");
+#endif
+        return features;
+    }
+
+    const CpuFeatures& get_cpu_features() {
+        static const CpuFeatures features = detect_cpu_features();
+        return features;
+    }
+#endif
+
+    using ScanFunction = void (*)(const char*, std::size_t, Masks);
+
+    ScanFunction get_scan_function(ScanKernel kernel) {
+#ifdef OBJ_SCANNER_X86
+        if (kernel == ScanKernel::AVX2 && get_cpu_features().avx2) {
+            return scan_avx2;
+        }
+
+        if (kernel == ScanKernel::SSE2 && get_cpu_features().sse2) {
+            return scan_sse2;
+        }
+#endif
+        return scan_scalar;
+    }
+
+    bool is_digit(char c) {
+        return static_cast<unsigned>(c - '0') < 10u;
+    }
+
+    // Rounding the double quotient to float gives the correctly rounded result unless the
+    // dropped bits are next to a halfway point, where the double itself may have been rounded.
+    bool is_near_float_halfway(double value) {
+        std::uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        std::uint64_t dropped = bits & ((std::uint64_t(1) << 29) - 1);
+        return dropped + 1 >= (std::uint64_t(1) << 28) && dropped <= (std::uint64_t(1) << 28) + 1;
+    }
+}
+
+ScanKernel get_best_scan_kernel() {
+    if (is_scan_kernel_supported(ScanKernel::AVX2)) {
+        return ScanKernel::AVX2;
+    }
+
+    if (is_scan_kernel_supported(ScanKernel::SSE2)) {
+        return ScanKernel::SSE2;
+    }
+
+    return ScanKernel::SCALAR;
+}
+
+bool is_scan_kernel_supported(ScanKernel kernel) {
+#ifdef OBJ_SCANNER_X86
+    switch (kernel) {
+        case ScanKernel::AVX2:
+            return get_cpu_features().avx2;
+        case ScanKernel::SSE2:
+            return get_cpu_features().sse2;
+        default:
+            return true;
+    }
+#else
+    return kernel == ScanKernel::SCALAR;
+#endif
+}
+
+const char* get_scan_kernel_name(ScanKernel kernel) {
+    switch (kernel) {
+        case ScanKernel::AVX2:
+            return "avx2";
+        case ScanKernel::SSE2:
+            return "sse2";
+        default:
+            return "scalar";
+    }
+}
+
+void build_structural_index(std::string_view text, StructuralIndex& index, ScanKernel kernel) {
+    std::size_t full_blocks = text.size() / BLOCK_SIZE;
+    index.newlines.resize(full_blocks + 1);
+    index.whitespace.resize(full_blocks + 1);
+    index.slashes.resize(full_blocks + 1);
+
+    Masks masks = {index.newlines.data(), index.whitespace.data(), index.slashes.data()};
+    get_scan_function(kernel)(text.data(), full_blocks, masks);
+
+    // The tail, possibly empty, goes through a zero padded block, NUL is none of the classified characters.
+    char tail[BLOCK_SIZE] = {};
+    std::memcpy(tail, text.data() + full_blocks * BLOCK_SIZE, text.size() - full_blocks * BLOCK_SIZE);
+    scan_scalar(tail, 1, {masks.newlines + full_blocks, masks.whitespace + full_blocks, masks.slashes + full_blocks});
+}
+
+void build_structural_index(std::string_view text, StructuralIndex& index) {
+    build_structural_index(text, index, get_best_scan_kernel());
+}
+
+const char* parse_float(const char* text, float& value) {
+    const char* p = text;
+    bool negative = *p == '-';
+    p += *p == '-' || *p == '+' ? 1 : 0;
+
+    std::uint64_t mantissa = 0;
+    int digits = 0;
+    int fraction_digits = 0;
+
+    while (is_digit(*p)) {
+        mantissa = mantissa * 10 + static_cast<std::uint64_t>(*p - '0');
+        digits++;
+        p++;
+    }
+
+    if (*p == '.') {
+        p++;
+
+        while (is_digit(*p)) {
+            mantissa = mantissa * 10 + static_cast<std::uint64_t>(*p - '0');
+            digits++;
+            fraction_digits++;
+            p++;
+        }
+    }
+
+    // The quotient of two doubles is correctly rounded, mantissa and the power of ten are exact.
+    if (digits > 0 && digits <= 19 && mantissa <= (std::uint64_t(1) << 53) && *p != 'e' && *p != 'E') {
+        double quotient = static_cast<double>(mantissa) / DOUBLE_POWERS_OF_TEN[fraction_digits];
+
+        if (!is_near_float_halfway(quotient)) {
+            value = static_cast<float>(negative ? -quotient : quotient);
+            return p;
+        }
+    }
+
+    char* end = nullptr;
+    value = std::strtof(text, &end);
+    return end == text ? nullptr : end;
+}
+
+const char* parse_integer(const char* text, long long& value) {
+    const char* p = text;
+    bool negative = *p == '-';
+    p += *p == '-' || *p == '+' ? 1 : 0;
+
+    const char* digits = p;
+    long long result = 0;
+
+    while (is_digit(*p) && p - digits < 18) {
+        result = result * 10 + (*p - '0');
+        p++;
+    }
+
+    if (p == digits || is_digit(*p)) {
+        return nullptr;
+    }
+
+    value = negative ? -result : result;
+    return p;
+}
+
+bool resolve_obj_index(long long value, std::size_t count, std::size_t& index) {
+    if (value > 0 && static_cast<std::size_t>(value) <= count) {
+        index = static_cast<std::size_t>(value) - 1;
+        return true;
+    }
+
+    if (value < 0 && static_cast<std::size_t>(-value) <= count) {
+        index = count - static_cast<std::size_t>(-value);
+        return true;
+    }
+
+    return false;
+}
+
+ObjScanner::ObjScanner(const std::string& text) : ObjScanner(text, get_best_scan_kernel()) {}
+
+ObjScanner::ObjScanner(const std::string& text, ScanKernel kernel) : text(text), kernel(kernel) {
+    build_structural_index(text, index, kernel);
+}
+
+ObjScanner::ObjScanner(std::istream& input, std::size_t chunk_size) : ObjScanner(input, chunk_size, get_best_scan_kernel()) {}
+
+ObjScanner::ObjScanner(std::istream& input, std::size_t chunk_size, ScanKernel kernel)
+        : kernel(kernel), input(&input), chunk_size(std::max<std::size_t>(chunk_size, 1)) {}
+
+bool ObjScanner::next_line() {
+    if (next_line_begin >= text.size() && !refill()) {
+        return false;
+    }
+
+    line_end = find_next(index.newlines, next_line_begin, text.size());
+    keyword_begin = find_next(index.whitespace, next_line_begin, line_end, false);
+    keyword_end = find_next(index.whitespace, keyword_begin, line_end);
+    argument_begin = find_next(index.whitespace, keyword_end, line_end, false);
+    position = argument_begin;
+    next_line_begin = line_end + 1;
+    return true;
+}
+
+std::string_view ObjScanner::get_keyword() const {
+    return {text.data() + keyword_begin, keyword_end - keyword_begin};
+}
+
+std::string_view ObjScanner::get_argument() const {
+    std::size_t end = line_end;
+
+    while (end > argument_begin && is_whitespace(end - 1)) {
+        end--;
+    }
+
+    return {text.data() + argument_begin, end - argument_begin};
+}
+
+bool ObjScanner::at_line_end() const {
+    return position == line_end;
+}
+
+bool ObjScanner::read_float(float& value) {
+    if (at_line_end()) {
+        return false;
+    }
+
+    const char* end = parse_float(text.data() + position, value);
+    return end != nullptr && finish_field(static_cast<std::size_t>(end - text.data()));
+}
+
+bool ObjScanner::read_face_corner(ObjFaceCorner& corner) {
+    if (at_line_end()) {
+        return false;
+    }
+
+    // v, v/vt, v//vn or v/vt/vn. Indices start at 1, a written 0 is an error rather than a missing index.
+    corner = {};
+    std::size_t offset = position;
+
+    auto read = [&](long long& value) {
+        const char* end = parse_integer(text.data() + offset, value);
+        offset = end == nullptr ? offset : static_cast<std::size_t>(end - text.data());
+        return end != nullptr && value != 0;
+    };
+
+    auto is_empty = [&] {
+        return offset == line_end || is_whitespace(offset) || is_slash(offset);
+    };
+
+    bool valid = read(corner.position);
+
+    if (valid && is_slash(offset)) {
+        offset++;
+        valid = is_empty() || read(corner.texture_coordinates);
+
+        if (valid && is_slash(offset)) {
+            offset++;
+            valid = is_empty() || read(corner.normal);
+        }
+    }
+
+    return finish_field(offset) && valid;
+}
+
+// Reads the next chunk of whole lines, a line longer than chunk_size takes several reads.
+bool ObjScanner::refill() {
+    chunk.clear();
+
+    while (input != nullptr && chunk.empty() && (input->good() || !carry.empty())) {
+        std::size_t carried = carry.size();
+        carry.resize(carried + chunk_size);
+        input->read(carry.data() + carried, static_cast<std::streamsize>(chunk_size));
+        carry.resize(carried + static_cast<std::size_t>(input->gcount()));
+
+        // npos + 1 is 0: no line is complete yet.
+        std::size_t lines_end = input->good() ? carry.rfind('\n') + 1 : carry.size();
+        chunk.assign(carry, 0, lines_end);
+        carry.erase(0, lines_end);
+    }
+
+    if (chunk.empty()) {
+        return false;
+    }
+
+    text = chunk;
+    build_structural_index(text, index, kernel);
+    next_line_begin = 0;
+    return true;
+}
+
+// Moves past the field ending at end and the whitespace after it, false when the field goes on.
+bool ObjScanner::finish_field(std::size_t end) {
+    bool complete = end == line_end || is_whitespace(end);
+    end = complete ? end : find_next(index.whitespace, end, line_end);
+    position = find_next(index.whitespace, end, line_end, false);
+    return complete;
+}
+
+bool ObjScanner::is_whitespace(std::size_t offset) const {
+    return (index.whitespace[offset / BLOCK_SIZE] >> (offset % BLOCK_SIZE) & 1) != 0;
+}
+
+bool ObjScanner::is_slash(std::size_t offset) const {
+    return (index.slashes[offset / BLOCK_SIZE] >> (offset % BLOCK_SIZE) & 1) != 0;
+}
+
+// First byte in [from, limit) whose bit in mask is set (or clear), limit when there is none.
+std::size_t ObjScanner::find_next(const std::vector<std::uint64_t>& mask, std::size_t from, std::size_t limit, bool set) const {
+    while (from < limit) {
+        std::size_t word = from / BLOCK_SIZE;
+        std::uint64_t bits = (set ? mask[word] : ~mask[word]) >> (from % BLOCK_SIZE);
+
+        if (bits != 0) {
+            return std::min(from + static_cast<std::size_t>(std::countr_zero(bits)), limit);
+        }
+
+        from = (word + 1) * BLOCK_SIZE;
+    }
+
+    return limit;
+}
@@ -0,0 +1,110 @@
+#ifndef PROJECT3D_OBJ_SCANNER_H
+#define PROJECT3D_OBJ_SCANNER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// First stage of OBJ parsing, after simdjson: the text is classified 64
+// bytes at a time into bitmasks of newlines, whitespace and slashes, so the
+// second stage can jump between lines and fields with bit scans instead of
+// testing every character. The kernel is picked at runtime from what the CPU
+// supports; all of them give the same result.
+enum class ScanKernel {
+    SCALAR,
+    SSE2,
+    AVX2
+};
+
+struct StructuralIndex {
+    // Bit i of word w stands for byte 64 * w + i of the text. The last word
+    // always lies past the end, so the byte at text.size() can be tested.
+    std::vector<std::uint64_t> newlines;
+
+    // ' ', '\t' and '\r'
+    std::vector<std::uint64_t> whitespace;
+    std::vector<std::uint64_t> slashes;
+};
+
+ScanKernel get_best_scan_kernel();
+bool is_scan_kernel_supported(ScanKernel kernel);
+const char* get_scan_kernel_name(ScanKernel kernel);
+
+void build_structural_index(std::string_view text, StructuralIndex& index, ScanKernel kernel);
+void build_structural_index(std::string_view text, StructuralIndex& index);
+
+// Second stage number parsing. Fixed notation with up to 19 digits ("-0.250000", what Blender writes with
+// %f) is read without strtof; exponents and everything else fall back to it. text has to be NUL terminated
+// (std::string data). Return the end of the number, or nullptr when there is none.
+const char* parse_float(const char* text, float& value);
+const char* parse_integer(const char* text, long long& value);
+
+struct ObjFaceCorner {
+    // As written in the file: 1 based, negative ones count back, 0 when left out.
+    long long position = 0;
+    long long texture_coordinates = 0;
+    long long normal = 0;
+};
+
+// Index of a face corner field into the count elements defined so far, false when it points outside of them.
+bool resolve_obj_index(long long value, std::size_t count, std::size_t& index);
+
+// Second stage: walks the lines of the text and the fields of the current
+// line with bit scans over its structural index. A text passed in has to
+// outlive the scanner; a stream is read and indexed chunk_size bytes (cut
+// after the last whole line) at a time, so parsing starts right away and
+// only one chunk is held in memory.
+class ObjScanner {
+public:
+    static constexpr std::size_t DEFAULT_CHUNK_SIZE = std::size_t{4} << 20;
+
+    explicit ObjScanner(const std::string& text);
+    ObjScanner(const std::string& text, ScanKernel kernel);
+    explicit ObjScanner(std::istream& input, std::size_t chunk_size = DEFAULT_CHUNK_SIZE);
+    ObjScanner(std::istream& input, std::size_t chunk_size, ScanKernel kernel);
+
+    // Moves to the next line, false after the last one.
+    bool next_line();
+
+    // First field of the line, empty for blank lines.
+    std::string_view get_keyword() const;
+
+    // Everything after the keyword without the surrounding whitespace, names may contain spaces.
+    std::string_view get_argument() const;
+
+    // True when no fields are left on the line.
+    bool at_line_end() const;
+
+    // Read the next field of the line; false when it is missing or malformed.
+    bool read_float(float& value);
+    bool read_face_corner(ObjFaceCorner& corner);
+
+private:
+    std::string_view text;
+    StructuralIndex index;
+    ScanKernel kernel;
+
+    // Stream input: the chunk being scanned and the partial line after it
+    std::istream* input = nullptr;
+    std::size_t chunk_size = 0;
+    std::string chunk;
+    std::string carry;
+
+    std::size_t next_line_begin = 0;
+    std::size_t line_end = 0;
+    std::size_t keyword_begin = 0;
+    std::size_t keyword_end = 0;
+    std::size_t argument_begin = 0;
+    std::size_t position = 0;
+
+    bool refill();
+    bool finish_field(std::size_t end);
+    bool is_whitespace(std::size_t offset) const;
+    bool is_slash(std::size_t offset) const;
+    std::size_t find_next(const std::vector<std::uint64_t>& mask, std::size_t from, std::size_t limit, bool set = true) const;
+};
+
+#endif //PROJECT3D_OBJ_SCANNER_H
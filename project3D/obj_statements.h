@@ -0,0 +1,143 @@
+#ifndef PROJECT3D_OBJ_STATEMENTS_H
+#define PROJECT3D_OBJ_STATEMENTS_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <DirectXMath.h>
+
+#include "hresult.h"
+#include "obj_scanner.h"
+
+constexpr std::size_t OBJ_NO_INDEX = std::numeric_limits<std::size_t>::max();
+
+// Corner of a triangle, 0 based into the attributes visited so far.
+struct ObjCorner {
+    std::size_t position = OBJ_NO_INDEX;
+
+    // OBJ_NO_INDEX when left out; normals also unless every corner of the face has one.
+    std::size_t texture_coordinates = OBJ_NO_INDEX;
+    std::size_t normal = OBJ_NO_INDEX;
+};
+
+struct ObjTriangle {
+    ObjCorner corners[3];
+
+    // Of the last s statement, 0 for off and before the first one
+    std::uint32_t smoothing_group;
+    bool has_normals;
+};
+
+// The statement loop of ObjectLoader and MeshCooker. Walks the lines of the
+// scanner and hands the statements they use to the visitor, in the space of
+// the app (positions and normals turned half around the y axis, v flipped),
+// with polygons split into a fan of triangles:
+//
+//     HRESULT add_position(const DirectX::XMFLOAT3& position);
+//     HRESULT add_normal(const DirectX::XMFLOAT3& normal);
+//     HRESULT add_texture_coordinates(const DirectX::XMFLOAT2& uv);
+//     HRESULT add_triangle(const ObjTriangle& triangle);
+//     HRESULT set_object(const std::string& name);          // o and g
+//     HRESULT use_material(const std::string& name);
+//     HRESULT load_material_library(const std::string& file_name);
+//
+// Stops at the first malformed statement (E_FAIL) or failed call.
+template <typename Visitor>
+HRESULT visit_obj_statements(ObjScanner& scanner, Visitor& visitor) {
+    HRESULT hr = S_OK;
+    std::size_t positions = 0;
+    std::size_t normals = 0;
+    std::size_t uvs = 0;
+    std::uint32_t smoothing_group = 0;
+    std::vector<ObjCorner> face;
+    ObjFaceCorner corner;
+
+    while (SUCCEEDED(hr) && scanner.next_line()) {
+        std::string_view keyword = scanner.get_keyword();
+
+        if (keyword == "v" || keyword == "vn") {
+            DirectX::XMFLOAT3 value = {};
+
+            if (!scanner.read_float(value.x) || !scanner.read_float(value.y) || !scanner.read_float(value.z)) {
+                hr = E_FAIL;
+            }
+            else if (keyword == "v") {
+                hr = visitor.add_position({value.x * -1.0f, value.y, value.z * -1.0f});
+                positions++;
+            }
+            else {
+                // The same turn as the positions; mirroring only x would put normals behind their faces.
+                hr = visitor.add_normal({value.x * -1.0f, value.y, value.z * -1.0f});
+                normals++;
+            }
+        }
+        else if (keyword == "vt") {
+            // v is optional in the format.
+            DirectX::XMFLOAT2 uv = {};
+
+            if (!scanner.read_float(uv.x) || !(scanner.at_line_end() || scanner.read_float(uv.y))) {
+                hr = E_FAIL;
+            }
+            else {
+                hr = visitor.add_texture_coordinates({uv.x, uv.y * -1.0f});
+                uvs++;
+            }
+        }
+        else if (keyword == "f") {
+            // Corners are v, v/vt, v//vn or v/vt/vn.
+            face.clear();
+
+            while (SUCCEEDED(hr) && !scanner.at_line_end()) {
+                ObjCorner resolved;
+
+                if (!scanner.read_face_corner(corner) ||
+                    !resolve_obj_index(corner.position, positions, resolved.position) ||
+                    (corner.texture_coordinates != 0 && !resolve_obj_index(corner.texture_coordinates, uvs, resolved.texture_coordinates)) ||
+                    (corner.normal != 0 && !resolve_obj_index(corner.normal, normals, resolved.normal))) {
+                    hr = E_FAIL;
+                }
+
+                face.push_back(resolved);
+            }
+
+            bool has_normals = std::all_of(face.begin(), face.end(), [](const ObjCorner& face_corner) {
+                return face_corner.normal != OBJ_NO_INDEX;
+            });
+
+            for (std::size_t i = 1; SUCCEEDED(hr) && i + 1 < face.size(); i++) {
+                ObjTriangle triangle = {{face[0], face[i], face[i + 1]}, smoothing_group, has_normals};
+
+                for (ObjCorner& triangle_corner : triangle.corners) {
+                    triangle_corner.normal = has_normals ? triangle_corner.normal : OBJ_NO_INDEX;
+                }
+
+                hr = visitor.add_triangle(triangle);
+            }
+        }
+        else if (keyword == "s" || keyword == "o" || keyword == "g" || keyword == "usemtl" || keyword == "mtllib") {
+            std::string argument(scanner.get_argument());
+
+            if (keyword == "s") {
+                smoothing_group = argument == "off" ? 0 : static_cast<std::uint32_t>(std::strtoul(argument.c_str(), nullptr, 10));
+            }
+            else if (keyword == "usemtl") {
+                hr = visitor.use_material(argument);
+            }
+            else if (keyword == "mtllib") {
+                hr = visitor.load_material_library(argument);
+            }
+            else {
+                hr = visitor.set_object(argument);
+            }
+        }
+    }
+
+    return hr;
+}
+
+#endif //PROJECT3D_OBJ_STATEMENTS_H
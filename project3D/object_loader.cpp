@@ -1,12 +1,86 @@
 #include "object_loader.h"
 
-#include <iostream>
+#include <algorithm>
 #include <fstream>
+#include <limits>
 #include <utility>
 
+#include "asset_package.h"
+#include "async_file_reader.h"
+#include "mesh_attributes.h"
+#include "obj_statements.h"
+#include "task_scheduler.h"
+
 using Position = DirectX::XMFLOAT3;
 using UV = DirectX::XMFLOAT2;
 
+namespace {
+    constexpr std::size_t NO_MATERIAL = std::numeric_limits<std::size_t>::max();
+
+    // Unlike clear(), frees the memory.
+    template <typename T>
+    void release(std::vector<T>& vector) {
+        std::vector<T>().swap(vector);
+    }
+
+    // Everything after the keyword, names of objects, materials and files may contain spaces.
+    std::string get_argument(const std::string& line, const std::string& keyword) {
+        std::string argument = line.substr(std::min(line.size(), keyword.size()));
+        std::size_t begin = argument.find_first_not_of(" \t");
+        std::size_t end = argument.find_last_not_of(" \t\r");
+
+        if (begin == std::string::npos) {
+            return {};
+        }
+
+        return argument.substr(begin, end - begin + 1);
+    }
+
+    // A whole field of an MTL line, parsed the way the OBJ values are.
+    bool parse_field(const std::string& field, float& value) {
+        const char* end = parse_float(field.c_str(), value);
+        return end != nullptr && (*end == '\0' || *end == '\r');
+    }
+
+    // A file read either from disk or, when a package is given, from the package, unless its contents are given.
+    class InputFile {
+    public:
+        InputFile(const AssetPackage* package, const std::filesystem::path& path, std::ios::openmode mode,
+                  std::optional<std::span<const std::uint8_t>> contents = std::nullopt)
+                : packed_buffer(contents ? get_given(*contents) : get_packed(package, path)), packed_stream(&packed_buffer) {
+            if (package == nullptr && !found) {
+                file.open(path, mode);
+            }
+        }
+
+        bool is_open() const {
+            return found || file.is_open();
+        }
+
+        std::istream& get() {
+            return found ? packed_stream : static_cast<std::istream&>(file);
+        }
+
+    private:
+        std::vector<std::uint8_t> storage;
+        bool found = false;
+        AssetStreamBuffer packed_buffer;
+        std::istream packed_stream;
+        std::ifstream file;
+
+        std::span<const std::uint8_t> get_given(std::span<const std::uint8_t> contents) {
+            found = true;
+            return contents;
+        }
+
+        std::span<const std::uint8_t> get_packed(const AssetPackage* package, const std::filesystem::path& path) {
+            std::span<const std::uint8_t> data;
+            found = package != nullptr && SUCCEEDED(package->get(path.string(), data, storage));
+            return data;
+        }
+    };
+}
+
 std::vector<std::string> ObjectLoader::split(const std::string& str, const std::string& delimiter) {
     std::size_t start_position = 0;
     std::size_t end_position;
@@ -27,99 +101,440 @@ std::vector<std::string> ObjectLoader::split(const std::string& str, const std::
 ObjectLoader::ObjectLoader(std::string uri, DirectX::XMFLOAT4 color) : uri(std::move(uri)), color(color) {}
 
 HRESULT ObjectLoader::load() {
-    HRESULT hr = S_OK;
-    std::string line;
-    std::vector<Position> vertices;
-    std::vector<Position> normals;
-    std::vector<UV> texture_coordinates;
-
-    std::ifstream obj_file(uri + ".obj");
-
-    if (obj_file.is_open()) {
-        while (obj_file.good()) {
-            std::getline(obj_file, line);
-            auto line_split = split(line, " ");
-
-            if (line_split[0] == "v") {
-                vertices.emplace_back(
-                        std::stof(line_split[1]) * -1.0f,
-                        std::stof(line_split[2]),
-                        std::stof(line_split[3]) * -1.0f
-                );
-            }
-            else if (line_split[0] == "vt") {
-                texture_coordinates.emplace_back(
-                        std::stof(line_split[1]),
-                        std::stof(line_split[2]) * -1.0f
-                );
+    // The statements of the file, gathered into the mesh and its submeshes.
+    class Statements {
+    public:
+        Statements(ObjectLoader& loader, std::filesystem::path directory) : loader(loader), directory(std::move(directory)) {}
+
+        std::vector<Position> vertices;
+        std::vector<Position> normals;
+        std::vector<UV> texture_coordinates;
+        bool has_material_library = false;
+
+        // For generating attributes the files leave out: the position every vertex was made from and the
+        // smoothing group of every triangle (KEEP_NORMALS when the face had normals). Smoothing is off
+        // until the first s statement.
+        std::vector<std::uint32_t> position_indices;
+        std::vector<std::uint32_t> smoothing_groups;
+
+        HRESULT add_position(const Position& position) {
+            vertices.push_back(position);
+            return S_OK;
+        }
+
+        HRESULT add_normal(const Position& normal) {
+            normals.push_back(normal);
+            return S_OK;
+        }
+
+        HRESULT add_texture_coordinates(const UV& uv) {
+            texture_coordinates.push_back(uv);
+            return S_OK;
+        }
+
+        HRESULT add_triangle(const ObjTriangle& triangle) {
+            std::vector<Vertex>& mesh = loader.mesh;
+            std::vector<Submesh>& submeshes = loader.submeshes;
+
+            if (submeshes.empty() ||
+                submeshes.back().object_name != current_object ||
+                submeshes.back().material != current_material) {
+                submeshes.push_back({current_object, current_material, mesh.size(), 0, {}});
             }
-            else if (line_split[0] == "vn") {
-                normals.emplace_back(
-                        std::stof(line_split[1]) * -1.0f,
-                        std::stof(line_split[2]),
-                        std::stof(line_split[3])
-                );
+
+            for (const ObjCorner& corner : triangle.corners) {
+                mesh.push_back({
+                        vertices[corner.position],
+                        triangle.has_normals ? normals[corner.normal] : Position{},
+                        loader.color,
+                        corner.texture_coordinates != OBJ_NO_INDEX ? texture_coordinates[corner.texture_coordinates] : UV{}
+                });
+                position_indices.push_back(static_cast<std::uint32_t>(corner.position));
             }
-            else if (line_split[0] == "f") {
-                for (std::size_t i = 1; i < line_split.size(); i++) {
-                    auto vertex = split(line_split[i], "/");
-
-                    mesh.push_back({
-                            vertices[std::stoi(vertex[0]) - 1],
-                            normals[std::stoi(vertex[2]) - 1],
-                            color,
-                            texture_coordinates[std::stoi(vertex[1]) - 1]
-                    });
-                }
+
+            smoothing_groups.push_back(triangle.has_normals ? KEEP_NORMALS : triangle.smoothing_group);
+            submeshes.back().number_of_vertices = mesh.size() - submeshes.back().first_vertex;
+
+            // Batches are cut at a fixed size, regardless of the faces they split.
+            HRESULT hr = S_OK;
+
+            while (SUCCEEDED(hr) && loader.batch_callback && mesh.size() - loader.emitted_vertices >= loader.batch_vertices) {
+                hr = loader.emit_batch(loader.emitted_vertices + loader.batch_vertices, smoothing_groups);
             }
+
+            return hr;
+        }
+
+        HRESULT set_object(const std::string& name) {
+            current_object = name;
+            return S_OK;
+        }
+
+        HRESULT use_material(const std::string& name) {
+            current_material = loader.find_material(name);
+            return S_OK;
+        }
+
+        HRESULT load_material_library(const std::string& file_name) {
+            has_material_library = true;
+            return loader.load_material_library(directory / file_name);
         }
+
+    private:
+        ObjectLoader& loader;
+        std::filesystem::path directory;
+        std::string current_object;
+        std::size_t current_material = NO_MATERIAL;
+    };
+
+    HRESULT hr = S_OK;
+    Statements statements(*this, std::filesystem::path(uri).parent_path());
+    emitted_vertices = 0;
+    emitted_submesh = 0;
+
+    // The file is read, indexed and parsed one chunk at a time.
+    InputFile input(package, uri + ".obj", std::ios::binary, obj_data);
+    std::istream& obj_file = input.get();
+    ObjScanner scanner(obj_file);
+
+    if (!input.is_open()) {
+        hr = E_FAIL;
+    }
+
+    if (SUCCEEDED(hr)) {
+        hr = visit_obj_statements(scanner, statements);
     }
-    else {
+
+    if (SUCCEEDED(hr) && obj_file.bad()) {
         hr = E_FAIL;
     }
 
-    obj_file.close();
+    if (SUCCEEDED(hr) && batch_callback && mesh.size() > emitted_vertices) {
+        hr = emit_batch(mesh.size(), statements.smoothing_groups);
+    }
+
+    // Older exports reference <uri>.mtl implicitly.
+    bool has_default_library = package != nullptr ? package->contains(uri + ".mtl") : std::filesystem::exists(uri + ".mtl");
+
+    if (SUCCEEDED(hr) && !statements.has_material_library && has_default_library) {
+        hr = load_material_library(uri + ".mtl");
+    }
 
     if (SUCCEEDED(hr)) {
-        std::ifstream mtl_file(uri + ".mtl");
+        TaskScheduler& scheduler = TaskScheduler::get_default();
 
-        if (mtl_file.is_open()) {
-            while (mtl_file.good()) {
-                std::getline(mtl_file, line);
-                auto line_split = split(line, " ");
+        if (std::any_of(statements.smoothing_groups.begin(), statements.smoothing_groups.end(), [](std::uint32_t group) { return group != KEEP_NORMALS; })) {
+            generate_normals(mesh, statements.position_indices, statements.smoothing_groups, scheduler);
+        }
 
-                if (line_split[0] == "map_Kd") {
-                    texture_name = line_split[1];
-                }
-            }
+        if (with_tangents) {
+            tangents = generate_tangents(mesh, statements.position_indices, scheduler);
         }
         else {
-            hr = E_FAIL;
+            release(tangents);
         }
+    }
+
+    // Sorting may briefly hold the mesh twice, nothing else from parsing is needed by then.
+    release(statements.vertices);
+    release(statements.normals);
+    release(statements.texture_coordinates);
+    release(statements.position_indices);
+    release(statements.smoothing_groups);
+
+    if (SUCCEEDED(hr)) {
+        // Faces before the first usemtl get the first material of the library,
+        // which is how single-material models were drawn so far.
+        std::size_t default_material = materials.empty() ? find_material("") : 0;
 
-        mtl_file.close();
+        for (auto& submesh : submeshes) {
+            if (submesh.material == NO_MATERIAL) {
+                submesh.material = default_material;
+            }
+        }
+
+        hr = sort_by_material();
     }
 
     return hr;
 }
 
-std::vector<Vertex> ObjectLoader::get_vertices() {
-    return mesh;
+void ObjectLoader::set_batch_callback(std::size_t triangles_per_batch, BatchCallback callback) {
+    batch_vertices = 3 * std::max<std::size_t>(triangles_per_batch, 1);
+    batch_callback = std::move(callback);
+}
+
+HRESULT ObjectLoader::emit_batch(std::size_t end, const std::vector<std::uint32_t>& smoothing_groups) {
+    using namespace DirectX;
+
+    // Faces before the first usemtl will get the first material of the library, see load().
+    XMFLOAT4 default_diffuse = materials.empty() ? XMFLOAT4{1.0f, 1.0f, 1.0f, 1.0f} : materials[0].diffuse_color;
+    batch.assign(mesh.begin() + static_cast<std::ptrdiff_t>(emitted_vertices), mesh.begin() + static_cast<std::ptrdiff_t>(end));
+
+    for (std::size_t i = 0; i < batch.size(); i++) {
+        std::size_t vertex = emitted_vertices + i;
+
+        while (submeshes[emitted_submesh].first_vertex + submeshes[emitted_submesh].number_of_vertices <= vertex) {
+            emitted_submesh++;
+        }
+
+        std::size_t material = submeshes[emitted_submesh].material;
+        XMVECTOR diffuse = XMLoadFloat4(material == NO_MATERIAL ? &default_diffuse : &materials[material].diffuse_color);
+        XMStoreFloat4(&batch[i].color, XMVectorMultiply(XMLoadFloat4(&batch[i].color), diffuse));
+
+        // Smoothing needs the whole mesh, until then generated normals are flat.
+        if (vertex % 3 == 0 && smoothing_groups[vertex / 3] != KEEP_NORMALS && i + 2 < batch.size()) {
+            XMVECTOR p0 = XMLoadFloat3(&batch[i].position);
+            XMVECTOR normal = XMVector3Normalize(XMVector3Cross(XMVectorSubtract(XMLoadFloat3(&batch[i + 1].position), p0),
+                                                                XMVectorSubtract(XMLoadFloat3(&batch[i + 2].position), p0)));
+
+            for (std::size_t k = 0; k < 3; k++) {
+                XMStoreFloat3(&batch[i + k].normal, normal);
+            }
+        }
+    }
+
+    emitted_vertices = end;
+    return batch_callback(batch) ? S_OK : E_ABORT;
+}
+
+HRESULT ObjectLoader::load_material_library(const std::filesystem::path& path) {
+    InputFile input(package, path, std::ios::in);
+    std::istream& mtl_file = input.get();
+
+    if (!input.is_open()) {
+        return E_FAIL;
+    }
+
+    std::filesystem::path directory = path.parent_path();
+    std::string line;
+    Material* material = nullptr;
+
+    while (mtl_file.good()) {
+        std::getline(mtl_file, line);
+
+        std::size_t begin = line.find_first_not_of(" \t");
+
+        if (begin == std::string::npos) {
+            continue;
+        }
+
+        line = line.substr(begin);
+        auto line_split = split(line, " ");
+
+        if (line_split[0] == "newmtl") {
+            material = &materials[find_material(get_argument(line, "newmtl"))];
+        }
+        else if (material == nullptr) {
+            continue;
+        }
+        else if (line_split[0] == "Kd" && line_split.size() >= 4) {
+            if (!parse_field(line_split[1], material->diffuse_color.x) ||
+                !parse_field(line_split[2], material->diffuse_color.y) ||
+                !parse_field(line_split[3], material->diffuse_color.z)) {
+                return E_FAIL;
+            }
+        }
+        else if (line_split[0] == "d" && line_split.size() >= 2) {
+            if (!parse_field(line_split[1], material->diffuse_color.w)) {
+                return E_FAIL;
+            }
+        }
+        else if (line_split[0] == "Tr" && line_split.size() >= 2) {
+            float transparency = 0.0f;
+
+            if (!parse_field(line_split[1], transparency)) {
+                return E_FAIL;
+            }
+
+            material->diffuse_color.w = 1.0f - transparency;
+        }
+        else if (line_split[0] == "map_Kd") {
+            // Texture options (-s, -o, ...) come before the file name, which is the last argument.
+            std::string texture_name = get_argument(line, "map_Kd");
+            std::size_t options_end = texture_name.rfind(' ');
+
+            if (!texture_name.empty() && texture_name[0] == '-' && options_end != std::string::npos) {
+                texture_name = texture_name.substr(options_end + 1);
+            }
+
+            material->diffuse_texture_uri = (directory / texture_name).wstring();
+        }
+    }
+
+    return S_OK;
+}
+
+std::size_t ObjectLoader::find_material(const std::string& name) {
+    auto it = material_indices.find(name);
+
+    if (it != material_indices.end()) {
+        return it->second;
+    }
+
+    // Materials used before (or without) being defined are white and untextured.
+    Material material;
+    material.name = name;
+    materials.push_back(std::move(material));
+    material_indices.emplace(name, materials.size() - 1);
+
+    return materials.size() - 1;
+}
+
+HRESULT ObjectLoader::sort_by_material() {
+    std::stable_sort(submeshes.begin(), submeshes.end(), [this](const Submesh& a, const Submesh& b) {
+        const std::wstring& a_texture = materials[a.material].diffuse_texture_uri;
+        const std::wstring& b_texture = materials[b.material].diffuse_texture_uri;
+
+        if (a_texture != b_texture) {
+            return a_texture < b_texture;
+        }
+
+        return a.material < b.material;
+    });
+
+    // Files already in that order (single material ones at least) are not copied. With a sink
+    // the vertices are written once, straight to their destination.
+    bool in_place = !vertex_sink;
+    std::size_t offset = 0;
+
+    for (const auto& submesh : submeshes) {
+        in_place = in_place && submesh.first_vertex == offset;
+        offset += submesh.number_of_vertices;
+    }
+
+    std::vector<Vertex> sorted_mesh;
+    Vertex* destination = mesh.data();
+
+    if (vertex_sink) {
+        destination = vertex_sink(mesh.size());
+
+        if (destination == nullptr) {
+            return E_OUTOFMEMORY;
+        }
+    }
+    else if (!in_place) {
+        sorted_mesh.resize(mesh.size());
+        destination = sorted_mesh.data();
+    }
+
+    std::vector<DirectX::XMFLOAT4> sorted_tangents;
+    std::vector<Submesh> merged_submeshes;
+    std::size_t written = 0;
+    sorted_tangents.reserve(in_place ? 0 : tangents.size());
+
+    for (const auto& submesh : submeshes) {
+        const DirectX::XMFLOAT4& diffuse = materials[submesh.material].diffuse_color;
+
+        if (!merged_submeshes.empty() &&
+            merged_submeshes.back().object_name == submesh.object_name &&
+            merged_submeshes.back().material == submesh.material) {
+            merged_submeshes.back().number_of_vertices += submesh.number_of_vertices;
+        }
+        else {
+            merged_submeshes.push_back({submesh.object_name, submesh.material, written, submesh.number_of_vertices, {}});
+        }
+
+        for (std::size_t i = 0; i < submesh.number_of_vertices; i++) {
+            Vertex vertex = mesh[submesh.first_vertex + i];
+            vertex.color = {
+                    vertex.color.x * diffuse.x,
+                    vertex.color.y * diffuse.y,
+                    vertex.color.z * diffuse.z,
+                    vertex.color.w * diffuse.w
+            };
+            destination[written++] = vertex;
+
+            if (!in_place && !tangents.empty()) {
+                sorted_tangents.push_back(tangents[submesh.first_vertex + i]);
+            }
+
+            merged_submeshes.back().bounds.merge(vertex.position);
+        }
+
+        bounds.merge(merged_submeshes.back().bounds);
+    }
+
+    if (!in_place) {
+        mesh = std::move(sorted_mesh);
+        tangents = std::move(sorted_tangents);
+    }
+
+    submeshes = std::move(merged_submeshes);
+    number_of_vertices = written;
+
+    return S_OK;
 }
 
-std::wstring ObjectLoader::get_texture_uri() {
-    auto path = split(uri, "\\");
-    std::string result;
+Task<HRESULT> ObjectLoader::load_async(AsyncFileReader& reader, TaskScheduler& scheduler) {
+    if (package != nullptr) {
+        co_await schedule_on(scheduler);
+        co_return load();
+    }
+
+    AsyncFileReader::ReadResult file = co_await reader.read(uri + ".obj", scheduler);
 
-    for (std::size_t i = 0; i < path.size() - 1; i++) {
-        result += (path[i] + "\\");
+    if (FAILED(file.hr)) {
+        co_return file.hr;
     }
 
-    result += texture_name;
+    obj_data = file.data.get();
+    HRESULT hr = load();
+    obj_data.reset();
 
-    return {result.begin(), result.end()};
+    co_return hr;
+}
+
+void ObjectLoader::set_package(const AssetPackage* package) {
+    this->package = package;
+}
+
+void ObjectLoader::set_vertex_sink(VertexSink sink) {
+    vertex_sink = std::move(sink);
+}
+
+void ObjectLoader::set_generate_tangents(bool generate) {
+    with_tangents = generate;
+}
+
+std::vector<Vertex> ObjectLoader::get_vertices() {
+    return mesh;
+}
+
+std::vector<Vertex> ObjectLoader::take_vertices() {
+    return std::move(mesh);
 }
 
 std::size_t ObjectLoader::get_number_of_vertices() {
-    return mesh.size();
+    return number_of_vertices;
+}
+
+const std::vector<DirectX::XMFLOAT4>& ObjectLoader::get_tangents() const {
+    return tangents;
+}
+
+const std::vector<Submesh>& ObjectLoader::get_submeshes() const {
+    return submeshes;
+}
+
+const std::vector<Material>& ObjectLoader::get_materials() const {
+    return materials;
+}
+
+const Aabb& ObjectLoader::get_bounds() const {
+    return bounds;
+}
+
+std::vector<std::wstring> ObjectLoader::get_texture_uris() const {
+    std::vector<std::wstring> texture_uris;
+
+    for (const auto& submesh : submeshes) {
+        const std::wstring& texture_uri = materials[submesh.material].diffuse_texture_uri;
+
+        if (!texture_uri.empty() && std::find(texture_uris.begin(), texture_uris.end(), texture_uri) == texture_uris.end()) {
+            texture_uris.push_back(texture_uri);
+        }
+    }
+
+    return texture_uris;
 }
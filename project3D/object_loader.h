@@ -1,25 +1,121 @@
 #ifndef PROJECT3D_OBJECT_LOADER_H
 #define PROJECT3D_OBJECT_LOADER_H
 
+#include <filesystem>
+#include <functional>
+#include <optional>
+#include <span>
 #include <string>
+#include <unordered_map>
 #include <vector>
-#include <winerror.h>
 #include <DirectXMath.h>
+#include "async_task.h"
+#include "bounds.h"
 #include "common.h"
+#include "hresult.h"
+
+class AssetPackage;
+class AsyncFileReader;
+
+struct Material {
+    std::string name;
+
+    // Kd and d, multiplied into the vertex color
+    DirectX::XMFLOAT4 diffuse_color = { 1.0f, 1.0f, 1.0f, 1.0f };
+
+    // map_Kd, empty for untextured materials; an entry of the package when loading from one
+    std::wstring diffuse_texture_uri;
+};
+
+// Continuous range of vertices of one object (o / g) drawn with one material.
+struct Submesh {
+    std::string object_name;
+    std::size_t material;
+    std::size_t first_vertex;
+    std::size_t number_of_vertices;
+    Aabb bounds;
+};
 
 class ObjectLoader {
 public:
+    // Preview of triangles parsed so far, in file order: diffuse colors of the materials known
+    // at that point are applied and normals left out by the file are flat. Returning false
+    // stops the load, which then fails with E_ABORT.
+    using BatchCallback = std::function<bool(const std::vector<Vertex>& batch)>;
+
     ObjectLoader(std::string uri, DirectX::XMFLOAT4 color);
     HRESULT load();
+
+    // load() with <uri>.obj read through the reader: the coroutine suspends until the file is in
+    // memory and parses it as a task of the scheduler. Material libraries are small and read
+    // directly, with a package set nothing goes through the reader.
+    Task<HRESULT> load_async(AsyncFileReader& reader, TaskScheduler& scheduler);
+
+    // load() passes every triangles_per_batch parsed triangles (and the rest at the end) to callback.
+    void set_batch_callback(std::size_t triangles_per_batch, BatchCallback callback);
+
+    // Makes load() read <uri>.obj and the material libraries from the package (which has to stay
+    // open during load()) instead of from disk; nullptr goes back to loose files.
+    void set_package(const AssetPackage* package);
+
+    // Makes load() write the final vertices to the memory the sink returns for their number
+    // (e.g. a mapped upload buffer) instead of keeping them; nullptr fails the load with E_OUTOFMEMORY.
+    using VertexSink = std::function<Vertex*(std::size_t number_of_vertices)>;
+    void set_vertex_sink(VertexSink sink);
+
+    // get_vertices copies the vertices, take_vertices moves them out of the loader.
     std::vector<Vertex> get_vertices();
-    std::wstring get_texture_uri();
+    std::vector<Vertex> take_vertices();
     std::size_t get_number_of_vertices();
 
+    // Makes load() generate tangents; off by default, since nothing drawn samples normal maps.
+    void set_generate_tangents(bool generate);
+
+    // With set_generate_tangents one per vertex: xyz the tangent, w the sign of the bitangent (see
+    // generate_tangents), empty otherwise. Normals missing in the file are generated from the smoothing groups.
+    const std::vector<DirectX::XMFLOAT4>& get_tangents() const;
+
+    // Vertices are grouped by texture and then by material, so neighbouring
+    // submeshes that share a texture can be drawn without state changes.
+    const std::vector<Submesh>& get_submeshes() const;
+    const std::vector<Material>& get_materials() const;
+
+    // Bounds of the whole mesh, in the same space as the vertices
+    const Aabb& get_bounds() const;
+
+    // Distinct diffuse textures, in the order their draws are sorted in.
+    std::vector<std::wstring> get_texture_uris() const;
+
+    // The material handling of load() on its own, for tools that walk the OBJ statements themselves
+    // (see MeshCooker and visit_obj_statements). find_material adds unknown materials white and untextured.
+    HRESULT load_material_library(const std::filesystem::path& path);
+    std::size_t find_material(const std::string& name);
+
 private:
     const std::string uri;
     const DirectX::XMFLOAT4 color;
     std::vector<Vertex> mesh;
-    std::string texture_name;
+    std::vector<DirectX::XMFLOAT4> tangents;
+    std::vector<Submesh> submeshes;
+    std::vector<Material> materials;
+    std::unordered_map<std::string, std::size_t> material_indices;
+    Aabb bounds;
+    std::size_t number_of_vertices = 0;
+    VertexSink vertex_sink;
+    const AssetPackage* package = nullptr;
+    bool with_tangents = false;
+
+    // Contents of <uri>.obj read by load_async
+    std::optional<std::span<const std::uint8_t>> obj_data;
+
+    std::size_t batch_vertices = 0;
+    BatchCallback batch_callback;
+    std::vector<Vertex> batch;
+    std::size_t emitted_vertices = 0;
+    std::size_t emitted_submesh = 0;
+
+    HRESULT emit_batch(std::size_t end, const std::vector<std::uint32_t>& smoothing_groups);
+    HRESULT sort_by_material();
 
     static std::vector<std::string> split(const std::string& str, const std::string& delimiter);
 };
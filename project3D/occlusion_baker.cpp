@@ -0,0 +1,204 @@
+#include "occlusion_baker.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+#include "sampling.h"
+#include "uv_rasterizer.h"
+
+namespace {
+    // Small packets stay coherent enough for the shared traversal to pay off.
+    constexpr std::uint32_t PACKET_SIZE = 8;
+
+    float get_radical_inverse(std::uint32_t bits) {
+        bits = (bits << 16u) | (bits >> 16u);
+        bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xaaaaaaaau) >> 1u);
+        bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xccccccccu) >> 2u);
+        bits = ((bits & 0x0f0f0f0fu) << 4u) | ((bits & 0xf0f0f0f0u) >> 4u);
+        bits = ((bits & 0x00ff00ffu) << 8u) | ((bits & 0xff00ff00u) >> 8u);
+        return static_cast<float>(bits) * 2.3283064365386963e-10f;
+    }
+
+    // Bit patterns of a position and a normal, vertices with equal keys get the same occlusion.
+    using VertexKey = std::array<std::uint32_t, 6>;
+
+    VertexKey get_key(const DirectX::XMFLOAT3& position, const DirectX::XMFLOAT3& normal) {
+        VertexKey key;
+        std::memcpy(&key[0], &position, sizeof(position));
+        std::memcpy(&key[3], &normal, sizeof(normal));
+        return key;
+    }
+}
+
+OcclusionBaker::OcclusionBaker(const std::vector<Vertex>& vertices, const TriangleBvh& bvh, Options options)
+        : vertices(vertices), bvh(bvh), options(options) {
+    this->options.rays = std::max(this->options.rays, 1u);
+
+    // Hammersley set, the same for every point up to the rotation. Sorted by azimuth, so that every packet
+    // covers a narrow slice of the hemisphere.
+    for (std::uint32_t i = 0; i < this->options.rays; i++) {
+        sample_points.push_back({(static_cast<float>(i) + 0.5f) / static_cast<float>(this->options.rays), get_radical_inverse(i)});
+    }
+
+    std::sort(sample_points.begin(), sample_points.end(), [](const DirectX::XMFLOAT2& left, const DirectX::XMFLOAT2& right) {
+        return left.y < right.y;
+    });
+}
+
+OcclusionBaker::OcclusionBaker(const std::vector<Vertex>& vertices, const TriangleBvh& bvh)
+        : OcclusionBaker(vertices, bvh, Options()) {
+}
+
+float OcclusionBaker::get_accessibility(const DirectX::XMFLOAT3& position, const DirectX::XMFLOAT3& normal, std::uint32_t seed) const {
+    const DirectX::XMFLOAT3& n = normal;
+    DirectX::XMFLOAT3 origin = {
+            position.x + n.x * options.ray_offset,
+            position.y + n.y * options.ray_offset,
+            position.z + n.z * options.ray_offset
+    };
+
+    DirectX::XMFLOAT3 tangent;
+    DirectX::XMFLOAT3 bitangent;
+    get_orthonormal_basis(n, tangent, bitangent);
+
+    // Cranley-Patterson rotation of the point set
+    float shift_u = to_unit_float(hash_seed(seed));
+    float shift_v = to_unit_float(hash_seed(seed ^ 0x9e3779b9u));
+
+    DirectX::XMFLOAT3 directions[PACKET_SIZE];
+    std::uint32_t occluded = 0;
+
+    for (std::uint32_t first = 0; first < options.rays; first += PACKET_SIZE) {
+        std::uint32_t count = std::min(PACKET_SIZE, options.rays - first);
+
+        for (std::uint32_t i = 0; i < count; i++) {
+            const DirectX::XMFLOAT2& point = sample_points[first + i];
+            float s = point.x + shift_u;
+            float t = point.y + shift_v;
+            s -= s >= 1.0f ? 1.0f : 0.0f;
+            t -= t >= 1.0f ? 1.0f : 0.0f;
+
+            float radius = std::sqrt(s);
+            float angle = 2.0f * DirectX::XM_PI * t;
+            float x = radius * std::cos(angle);
+            float y = radius * std::sin(angle);
+            float z = std::sqrt(std::max(0.0f, 1.0f - s));
+
+            directions[i] = {
+                    x * tangent.x + y * bitangent.x + z * n.x,
+                    x * tangent.y + y * bitangent.y + z * n.y,
+                    x * tangent.z + y * bitangent.z + z * n.z
+            };
+        }
+
+        occluded += static_cast<std::uint32_t>(std::popcount(bvh.occluded(origin, directions, count, options.max_distance)));
+    }
+
+    return 1.0f - static_cast<float>(occluded) / static_cast<float>(options.rays);
+}
+
+std::vector<float> OcclusionBaker::bake_vertices(TaskScheduler& scheduler) {
+    auto start = std::chrono::steady_clock::now();
+
+    // Normals of meshes without them fall back to the face normal.
+    std::vector<DirectX::XMFLOAT3> normals(vertices.size());
+    std::vector<std::uint32_t> order(vertices.size());
+
+    for (std::size_t i = 0; i < vertices.size(); i++) {
+        std::size_t corner = i % 3;
+        normals[i] = get_interpolated_normal(&vertices[i - corner], corner == 1 ? 1.0f : 0.0f, corner == 2 ? 1.0f : 0.0f);
+        order[i] = static_cast<std::uint32_t>(i);
+    }
+
+    std::sort(order.begin(), order.end(), [&](std::uint32_t left, std::uint32_t right) {
+        return get_key(vertices[left].position, normals[left]) < get_key(vertices[right].position, normals[right]);
+    });
+
+    // First entry of order of every distinct vertex
+    std::vector<std::uint32_t> groups;
+
+    for (std::size_t i = 0; i < order.size(); i++) {
+        if (i == 0 || get_key(vertices[order[i]].position, normals[order[i]]) != get_key(vertices[order[i - 1]].position, normals[order[i - 1]])) {
+            groups.push_back(static_cast<std::uint32_t>(i));
+        }
+    }
+
+    groups.push_back(static_cast<std::uint32_t>(order.size()));
+    std::vector<float> result(vertices.size(), 1.0f);
+
+    scheduler.parallel_for(0, groups.size() - 1, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t group = begin; group < end; group++) {
+            std::uint32_t vertex = order[groups[group]];
+            float accessibility = get_accessibility(vertices[vertex].position, normals[vertex], hash_seed(static_cast<std::uint32_t>(group)));
+
+            for (std::uint32_t i = groups[group]; i < groups[group + 1]; i++) {
+                result[order[i]] = accessibility;
+            }
+        }
+    }, 64);
+
+    statistics.points = groups.size() - 1;
+    statistics.rays = statistics.points * options.rays;
+    statistics.bake_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    statistics.rays_per_second = statistics.bake_ms > 0.0 ? static_cast<double>(statistics.rays) / (statistics.bake_ms / 1000.0) : 0.0;
+
+    return result;
+}
+
+std::vector<float> OcclusionBaker::bake_texels(TaskScheduler& scheduler, std::uint32_t width, std::uint32_t height) {
+    auto start = std::chrono::steady_clock::now();
+    std::vector<UvTexel> texels = rasterize_uvs(vertices, width, height);
+    std::vector<float> result(static_cast<std::size_t>(width) * height, 1.0f);
+
+    scheduler.parallel_for(0, texels.size(), [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; i++) {
+            result[texels[i].pixel] = get_accessibility(texels[i].position, texels[i].normal, hash_seed(texels[i].pixel));
+        }
+    }, 64);
+
+    pad_uv_charts(result, 1, texels, width, height, options.padding);
+
+    statistics.points = texels.size();
+    statistics.rays = statistics.points * options.rays;
+    statistics.bake_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    statistics.rays_per_second = statistics.bake_ms > 0.0 ? static_cast<double>(statistics.rays) / (statistics.bake_ms / 1000.0) : 0.0;
+
+    return result;
+}
+
+const OcclusionBaker::Statistics& OcclusionBaker::get_statistics() const {
+    return statistics;
+}
+
+void OcclusionBaker::apply_to_vertices(std::vector<Vertex>& vertices, const std::vector<float>& occlusion) {
+    for (std::size_t i = 0; i < vertices.size() && i < occlusion.size(); i++) {
+        vertices[i].color.x *= occlusion[i];
+        vertices[i].color.y *= occlusion[i];
+        vertices[i].color.z *= occlusion[i];
+    }
+}
+
+void OcclusionBaker::apply_to_bitmap(std::uint8_t* bitmap, std::uint32_t bitmap_width, std::uint32_t bitmap_height,
+                                     const std::vector<float>& occlusion, std::uint32_t width, std::uint32_t height) {
+    if (width == 0 || height == 0 || occlusion.size() < static_cast<std::size_t>(width) * height) {
+        return;
+    }
+
+    for (std::uint32_t y = 0; y < bitmap_height; y++) {
+        std::uint32_t source_y = static_cast<std::uint32_t>(static_cast<std::uint64_t>(y) * height / bitmap_height);
+
+        for (std::uint32_t x = 0; x < bitmap_width; x++) {
+            std::uint32_t source_x = static_cast<std::uint32_t>(static_cast<std::uint64_t>(x) * width / bitmap_width);
+            float accessibility = occlusion[static_cast<std::size_t>(source_y) * width + source_x];
+            std::uint8_t* pixel = &bitmap[4 * (static_cast<std::size_t>(y) * bitmap_width + x)];
+
+            for (int channel = 0; channel < 3; channel++) {
+                pixel[channel] = static_cast<std::uint8_t>(std::lround(static_cast<float>(pixel[channel]) * accessibility));
+            }
+        }
+    }
+}
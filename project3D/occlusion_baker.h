@@ -0,0 +1,74 @@
+#ifndef PROJECT3D_OCCLUSION_BAKER_H
+#define PROJECT3D_OCCLUSION_BAKER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <DirectXMath.h>
+
+#include "common.h"
+#include "task_scheduler.h"
+#include "triangle_bvh.h"
+
+// Bakes ambient occlusion (the fraction of a cosine weighted hemisphere that
+// is open within max_distance) either per vertex or per texel of the uvs of a
+// mesh. Rays of one point share an origin and are traced in packets with
+// TriangleBvh::occluded. Vertices of a triangle list repeat: every distinct
+// position and normal pair is baked once.
+class OcclusionBaker {
+public:
+    struct Options {
+        // Rays per vertex or texel
+        std::uint32_t rays = 64;
+
+        // Geometry further away does not occlude, so open rooms do not come out black.
+        float max_distance = 2.0f;
+
+        // Ray origins are moved this far along the normal, so they do not hit their own triangle.
+        float ray_offset = 1e-3f;
+
+        // Texels around uv charts filled from their neighbours
+        std::uint32_t padding = 2;
+    };
+
+    struct Statistics {
+        // Points actually traced: distinct vertices or covered texels
+        std::size_t points = 0;
+        std::size_t rays = 0;
+        double bake_ms = 0.0;
+        double rays_per_second = 0.0;
+    };
+
+    // bvh has to be built from vertices (in the same order).
+    OcclusionBaker(const std::vector<Vertex>& vertices, const TriangleBvh& bvh, Options options);
+    OcclusionBaker(const std::vector<Vertex>& vertices, const TriangleBvh& bvh);
+
+    // Accessibility of every vertex, 1 is fully open.
+    std::vector<float> bake_vertices(TaskScheduler& scheduler);
+
+    // Accessibility of every pixel (y * width + x) of a width x height texture over the uvs, 1 outside the charts.
+    std::vector<float> bake_texels(TaskScheduler& scheduler, std::uint32_t width, std::uint32_t height);
+
+    const Statistics& get_statistics() const;
+
+    // Multiplies the color of every vertex by its accessibility.
+    static void apply_to_vertices(std::vector<Vertex>& vertices, const std::vector<float>& occlusion);
+
+    // Multiplies an 8-bit RGBA bitmap by a texture baked at another size (nearest texel, wrapping like the uvs).
+    static void apply_to_bitmap(std::uint8_t* bitmap, std::uint32_t bitmap_width, std::uint32_t bitmap_height,
+                                const std::vector<float>& occlusion, std::uint32_t width, std::uint32_t height);
+
+private:
+    float get_accessibility(const DirectX::XMFLOAT3& position, const DirectX::XMFLOAT3& normal, std::uint32_t seed) const;
+
+    const std::vector<Vertex>& vertices;
+    const TriangleBvh& bvh;
+    Options options;
+
+    // Cosine weighted directions around +z, rotated per point to decorrelate neighbours
+    std::vector<DirectX::XMFLOAT2> sample_points;
+
+    Statistics statistics;
+};
+
+#endif //PROJECT3D_OCCLUSION_BAKER_H
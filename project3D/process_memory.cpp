@@ -0,0 +1,80 @@
+#include "process_memory.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <cstdio>
+#include <cstring>
+#endif
+
+namespace {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS get_counters() {
+        PROCESS_MEMORY_COUNTERS counters = {};
+        counters.cb = sizeof(counters);
+
+        if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+            counters = {};
+        }
+
+        return counters;
+    }
+#else
+    // Value of a "<field>: <n> kB" line of /proc/self/status.
+    std::size_t read_status_field(const char* field) {
+        std::FILE* file = std::fopen("/proc/self/status", "r");
+        std::size_t field_length = std::strlen(field);
+        std::size_t bytes = 0;
+        char line[256];
+
+        if (file == nullptr) {
+            return 0;
+        }
+
+        while (std::fgets(line, sizeof(line), file) != nullptr) {
+            if (std::strncmp(line, field, field_length) == 0 && line[field_length] == ':') {
+                unsigned long long kilobytes = 0;
+                std::sscanf(line + field_length + 1, "%llu", &kilobytes);
+                bytes = static_cast<std::size_t>(kilobytes) * 1024;
+                break;
+            }
+        }
+
+        std::fclose(file);
+        return bytes;
+    }
+#endif
+}
+
+std::size_t get_resident_bytes() {
+#ifdef _WIN32
+    return get_counters().WorkingSetSize;
+#else
+    return read_status_field("VmRSS");
+#endif
+}
+
+std::size_t get_peak_resident_bytes() {
+#ifdef _WIN32
+    return get_counters().PeakWorkingSetSize;
+#else
+    return read_status_field("VmHWM");
+#endif
+}
+
+bool reset_peak_resident_bytes() {
+#ifdef _WIN32
+    return false;
+#else
+    std::FILE* file = std::fopen("/proc/self/clear_refs", "w");
+
+    if (file == nullptr) {
+        return false;
+    }
+
+    bool reset = std::fputs("5", file) >= 0;
+    return std::fclose(file) == 0 && reset;
+#endif
+}
@@ -0,0 +1,14 @@
+#ifndef PROJECT3D_PROCESS_MEMORY_H
+#define PROJECT3D_PROCESS_MEMORY_H
+
+#include <cstddef>
+
+// Resident memory of the process (the working set under Windows), in bytes, 0 when unknown.
+std::size_t get_resident_bytes();
+std::size_t get_peak_resident_bytes();
+
+// Starts measuring the peak again from the current resident memory. Only Linux
+// supports it (through /proc/self/clear_refs); returns false elsewhere.
+bool reset_peak_resident_bytes();
+
+#endif //PROJECT3D_PROCESS_MEMORY_H
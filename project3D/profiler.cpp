@@ -0,0 +1,175 @@
+#include "profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <thread>
+
+#if defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#define PROFILER_USE_RDTSC
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define PROFILER_USE_RDTSC
+#endif
+
+namespace {
+    constexpr auto CALIBRATION_TIME = std::chrono::milliseconds(20);
+
+    thread_local Profiler::Track* thread_track = nullptr;
+
+    void write_json_string(std::ofstream& stream, const std::string& value) {
+        stream << '"';
+
+        for (char c : value) {
+            if (c == '"' || c == '\\') {
+                stream << '\\' << c;
+            }
+            else if (static_cast<unsigned char>(c) < 0x20) {
+                char escaped[8];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                stream << escaped;
+            }
+            else {
+                stream << c;
+            }
+        }
+
+        stream << '"';
+    }
+}
+
+Profiler::Track::Track(std::string name, std::uint32_t id, std::size_t capacity) :
+        name(std::move(name)), id(id), zones(capacity), mask(capacity - 1) {}
+
+void Profiler::Track::record(const char* zone_name, std::uint64_t begin, std::uint64_t end) {
+    std::uint64_t index = written.load(std::memory_order_relaxed);
+    zones[index & mask] = {zone_name, begin, end};
+    written.store(index + 1, std::memory_order_release);
+}
+
+Profiler& Profiler::get() {
+    static Profiler profiler;
+    return profiler;
+}
+
+Profiler::Profiler() {
+#ifdef PROFILER_USE_RDTSC
+    auto clock_start = std::chrono::steady_clock::now();
+    std::uint64_t ticks_start = now();
+    std::chrono::steady_clock::time_point clock_end;
+
+    do {
+        clock_end = std::chrono::steady_clock::now();
+    } while (clock_end - clock_start < CALIBRATION_TIME);
+
+    std::uint64_t ticks_end = now();
+    ticks_per_second = static_cast<double>(ticks_end - ticks_start) /
+                       std::chrono::duration<double>(clock_end - clock_start).count();
+#else
+    ticks_per_second = 1e9;
+#endif
+
+    start_ticks = now();
+}
+
+std::uint64_t Profiler::now() {
+#ifdef PROFILER_USE_RDTSC
+    return __rdtsc();
+#else
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+double Profiler::get_ticks_per_second() const {
+    return ticks_per_second;
+}
+
+double Profiler::ticks_to_milliseconds(std::uint64_t ticks) const {
+    return static_cast<double>(ticks) * 1000.0 / ticks_per_second;
+}
+
+Profiler::Track& Profiler::get_thread_track() {
+    if (thread_track == nullptr) {
+        auto id = std::hash<std::thread::id>{}(std::this_thread::get_id());
+        thread_track = &create_track("Thread " + std::to_string(id % 100000));
+    }
+
+    return *thread_track;
+}
+
+Profiler::Track& Profiler::get_track(const std::string& name) {
+    {
+        std::lock_guard lock(tracks_mutex);
+
+        for (auto& track : tracks) {
+            if (track->name == name) {
+                return *track;
+            }
+        }
+    }
+
+    return create_track(name);
+}
+
+void Profiler::set_thread_name(const std::string& name) {
+    Track& track = get_thread_track();
+    std::lock_guard lock(tracks_mutex);
+    track.name = name;
+}
+
+Profiler::Track& Profiler::create_track(std::string name) {
+    std::lock_guard lock(tracks_mutex);
+    auto id = static_cast<std::uint32_t>(tracks.size() + 1);
+    tracks.push_back(std::make_unique<Track>(std::move(name), id, TRACK_CAPACITY));
+    return *tracks.back();
+}
+
+HRESULT Profiler::export_chrome_trace(const std::filesystem::path& path) {
+    std::ofstream file(path, std::ios::binary);
+
+    if (!file.is_open()) {
+        return E_FAIL;
+    }
+
+    std::lock_guard lock(tracks_mutex);
+    const double ticks_per_microsecond = ticks_per_second / 1e6;
+    bool first = true;
+    char buffer[128];
+
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+    for (auto& track : tracks) {
+        file << (first ? "" : ",\n") << R"({"ph":"M","pid":1,"tid":)" << track->id
+             << R"(,"name":"thread_name","args":{"name":)";
+        write_json_string(file, track->name);
+        file << "}}";
+        first = false;
+
+        std::uint64_t written = track->written.load(std::memory_order_acquire);
+        std::uint64_t count = std::min<std::uint64_t>(written, track->zones.size());
+
+        for (std::uint64_t i = written - count; i < written; i++) {
+            const Zone& zone = track->zones[i & track->mask];
+
+            // Zones from before the profiler was created (GPU clock drift) would get negative times.
+            double begin = zone.begin > start_ticks ? static_cast<double>(zone.begin - start_ticks) : 0.0;
+            double duration = zone.end > zone.begin ? static_cast<double>(zone.end - zone.begin) : 0.0;
+
+            std::snprintf(buffer, sizeof(buffer), R"(,"ts":%.3f,"dur":%.3f})",
+                          begin / ticks_per_microsecond, duration / ticks_per_microsecond);
+
+            file << R"(,
+{"ph":"X","pid":1,"tid":)" << track->id << ",\"name\":";
+            write_json_string(file, zone.name);
+            file << buffer;
+        }
+    }
+
+    file << "\n]}\n";
+    file.close();
+
+    return file.fail() ? E_FAIL : S_OK;
+}
@@ -0,0 +1,104 @@
+#ifndef PROJECT3D_PROFILER_H
+#define PROJECT3D_PROFILER_H
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "hresult.h"
+#include "rolling_statistics.h"
+
+// Scoped-zone CPU profiler. Every thread writes into its own ring buffer, so
+// recording a zone is two timestamp reads and one store without any locking.
+// Zone names must be string literals (only the pointer is kept).
+class Profiler {
+public:
+    struct Zone {
+        const char* name;
+        std::uint64_t begin;
+        std::uint64_t end;
+    };
+
+    class Track {
+    public:
+        Track(std::string name, std::uint32_t id, std::size_t capacity);
+
+        void record(const char* name, std::uint64_t begin, std::uint64_t end);
+
+    private:
+        friend class Profiler;
+
+        std::string name;
+        std::uint32_t id;
+        std::vector<Zone> zones;
+        std::size_t mask;
+        std::atomic<std::uint64_t> written{0};
+    };
+
+    static Profiler& get();
+
+    // Timestamp in profiler ticks (rdtsc on x86, steady_clock elsewhere).
+    static std::uint64_t now();
+    double get_ticks_per_second() const;
+    double ticks_to_milliseconds(std::uint64_t ticks) const;
+
+    // Ring buffer of the calling thread, created on first use.
+    Track& get_thread_track();
+
+    // Named track for zones that do not come from a CPU thread (e.g. GPU timestamps).
+    Track& get_track(const std::string& name);
+
+    void set_thread_name(const std::string& name);
+
+    // Writes the contents of all ring buffers in the Chrome trace event format
+    // (chrome://tracing, ui.perfetto.dev). Should be called while other threads
+    // are not recording, zones written concurrently may come out torn.
+    HRESULT export_chrome_trace(const std::filesystem::path& path);
+
+private:
+    static constexpr std::size_t TRACK_CAPACITY = 1 << 16;
+
+    Profiler();
+
+    Track& create_track(std::string name);
+
+    std::uint64_t start_ticks;
+    double ticks_per_second;
+
+    std::mutex tracks_mutex;
+    std::vector<std::unique_ptr<Track>> tracks;
+};
+
+class ScopedZone {
+public:
+    explicit ScopedZone(const char* name, RollingStatistics* statistics = nullptr) :
+            name(name), statistics(statistics), begin(Profiler::now()) {}
+
+    ~ScopedZone() {
+        std::uint64_t end = Profiler::now();
+        Profiler& profiler = Profiler::get();
+        profiler.get_thread_track().record(name, begin, end);
+
+        if (statistics) {
+            statistics->add(profiler.ticks_to_milliseconds(end - begin));
+        }
+    }
+
+    ScopedZone(const ScopedZone&) = delete;
+    ScopedZone& operator=(const ScopedZone&) = delete;
+
+private:
+    const char* name;
+    RollingStatistics* statistics;
+    std::uint64_t begin;
+};
+
+#define PROFILE_CONCAT_IMPL(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_IMPL(a, b)
+#define PROFILE_ZONE(...) ScopedZone PROFILE_CONCAT(profile_zone_, __LINE__)(__VA_ARGS__)
+
+#endif //PROJECT3D_PROFILER_H
@@ -0,0 +1,77 @@
+#include "progressive_mesh_loader.h"
+
+ProgressiveMeshLoader::ProgressiveMeshLoader(std::string uri, DirectX::XMFLOAT4 color)
+        : ProgressiveMeshLoader(std::move(uri), color, Options()) {}
+
+ProgressiveMeshLoader::ProgressiveMeshLoader(std::string uri, DirectX::XMFLOAT4 color, Options options)
+        : loader(std::move(uri), color), finish(std::move(options.finish)), start(std::chrono::steady_clock::now()) {
+    loader.set_package(options.package);
+    loader.set_batch_callback(options.triangles_per_batch, [this, preview = options.preview](const std::vector<Vertex>& batch) {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        if (first_batch_ms < 0.0) {
+            first_batch_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+
+        if (preview) {
+            pending.insert(pending.end(), batch.begin(), batch.end());
+        }
+
+        return !stopping;
+    });
+
+    thread = std::thread(&ProgressiveMeshLoader::thread_main, this);
+}
+
+ProgressiveMeshLoader::~ProgressiveMeshLoader() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+
+    thread.join();
+}
+
+std::size_t ProgressiveMeshLoader::collect(std::vector<Vertex>& vertices) {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::size_t count = pending.size();
+    vertices.insert(vertices.end(), pending.begin(), pending.end());
+    pending.clear();
+    return count;
+}
+
+bool ProgressiveMeshLoader::is_finished() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return finished;
+}
+
+HRESULT ProgressiveMeshLoader::get_result() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return result;
+}
+
+ObjectLoader& ProgressiveMeshLoader::get_loader() {
+    return loader;
+}
+
+double ProgressiveMeshLoader::get_first_batch_ms() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return first_batch_ms;
+}
+
+void ProgressiveMeshLoader::thread_main() {
+    HRESULT hr = loader.load();
+
+    // A loader being destroyed does not start it any more.
+    if (SUCCEEDED(hr) && finish) {
+        std::unique_lock<std::mutex> lock(mutex);
+        bool stop = stopping;
+        lock.unlock();
+
+        hr = stop ? E_ABORT : finish(loader);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    result = hr;
+    finished = true;
+}
@@ -0,0 +1,72 @@
+#ifndef PROJECT3D_PROGRESSIVE_MESH_LOADER_H
+#define PROJECT3D_PROGRESSIVE_MESH_LOADER_H
+
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <DirectXMath.h>
+#include "common.h"
+#include "hresult.h"
+#include "object_loader.h"
+
+// Runs ObjectLoader::load on a background thread and hands out the triangles
+// parsed so far, so that the renderer can draw a preview of a large model
+// while the rest of the file is still being read. The preview batches are
+// appended in file order; once is_finished() returns true get_loader() holds
+// the complete, sorted mesh (which replaces the preview) and Options::finish
+// has run.
+class ProgressiveMeshLoader {
+public:
+    struct Options {
+        std::size_t triangles_per_batch = 16384;
+
+        // Without it collect() gets nothing, e.g. when the model is reloaded behind the one on screen.
+        // Batches are still cut, so that destroying the loader stops it early.
+        bool preview = true;
+
+        // See ObjectLoader::set_package; has to outlive the loader.
+        const AssetPackage* package = nullptr;
+
+        // Runs on the loader thread after a successful load and before is_finished(), its result
+        // becoming get_result(): whatever has to be built from the mesh before it can be swapped in.
+        std::function<HRESULT(ObjectLoader& loader)> finish;
+    };
+
+    ProgressiveMeshLoader(std::string uri, DirectX::XMFLOAT4 color);
+    ProgressiveMeshLoader(std::string uri, DirectX::XMFLOAT4 color, Options options);
+    ~ProgressiveMeshLoader();
+
+    ProgressiveMeshLoader(const ProgressiveMeshLoader&) = delete;
+    ProgressiveMeshLoader& operator=(const ProgressiveMeshLoader&) = delete;
+
+    // Appends the vertices that arrived since the last call, returns their number.
+    std::size_t collect(std::vector<Vertex>& vertices);
+
+    bool is_finished() const;
+    HRESULT get_result() const;
+
+    // Only to be used after is_finished() returned true.
+    ObjectLoader& get_loader();
+
+    // Time from construction to the first batch, negative until it arrives.
+    double get_first_batch_ms() const;
+
+private:
+    void thread_main();
+
+    ObjectLoader loader;
+    std::function<HRESULT(ObjectLoader& loader)> finish;
+    std::chrono::steady_clock::time_point start;
+    std::thread thread;
+    mutable std::mutex mutex;
+    std::vector<Vertex> pending;
+    double first_batch_ms = -1.0;
+    HRESULT result = S_OK;
+    bool finished = false;
+    bool stopping = false;
+};
+
+#endif //PROJECT3D_PROGRESSIVE_MESH_LOADER_H
@@ -0,0 +1,65 @@
+#include "rolling_statistics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+RollingStatistics::RollingStatistics(std::size_t window_size) : samples(std::max<std::size_t>(1, window_size)) {}
+
+void RollingStatistics::add(double value) {
+    samples[next] = value;
+    next = (next + 1) % samples.size();
+    filled = std::min(filled + 1, samples.size());
+    sorted_valid = false;
+}
+
+void RollingStatistics::clear() {
+    next = 0;
+    filled = 0;
+    sorted_valid = false;
+}
+
+double RollingStatistics::percentile(double p) const {
+    if (filled == 0) {
+        return 0.0;
+    }
+
+    if (!sorted_valid) {
+        sorted.assign(samples.begin(), samples.begin() + static_cast<std::ptrdiff_t>(filled));
+        std::sort(sorted.begin(), sorted.end());
+        sorted_valid = true;
+    }
+
+    double rank = std::clamp(p, 0.0, 100.0) / 100.0 * static_cast<double>(filled - 1);
+    auto index = static_cast<std::size_t>(std::round(rank));
+    return sorted[index];
+}
+
+double RollingStatistics::mean() const {
+    if (filled == 0) {
+        return 0.0;
+    }
+
+    return std::accumulate(samples.begin(), samples.begin() + static_cast<std::ptrdiff_t>(filled), 0.0) /
+           static_cast<double>(filled);
+}
+
+double RollingStatistics::max() const {
+    if (filled == 0) {
+        return 0.0;
+    }
+
+    return *std::max_element(samples.begin(), samples.begin() + static_cast<std::ptrdiff_t>(filled));
+}
+
+double RollingStatistics::last() const {
+    if (filled == 0) {
+        return 0.0;
+    }
+
+    return samples[(next + samples.size() - 1) % samples.size()];
+}
+
+std::size_t RollingStatistics::count() const {
+    return filled;
+}
@@ -0,0 +1,30 @@
+#ifndef PROJECT3D_ROLLING_STATISTICS_H
+#define PROJECT3D_ROLLING_STATISTICS_H
+
+#include <cstddef>
+#include <vector>
+
+// Keeps the last window_size samples and answers percentile queries over them.
+class RollingStatistics {
+public:
+    explicit RollingStatistics(std::size_t window_size = 512);
+
+    void add(double value);
+    void clear();
+
+    // p in [0, 100], 0 when there are no samples yet
+    double percentile(double p) const;
+    double mean() const;
+    double max() const;
+    double last() const;
+    std::size_t count() const;
+
+private:
+    std::vector<double> samples;
+    std::size_t next = 0;
+    std::size_t filled = 0;
+    mutable std::vector<double> sorted;
+    mutable bool sorted_valid = false;
+};
+
+#endif //PROJECT3D_ROLLING_STATISTICS_H
@@ -0,0 +1,49 @@
+#ifndef PROJECT3D_SAMPLING_H
+#define PROJECT3D_SAMPLING_H
+
+#include <cmath>
+#include <cstdint>
+#include <DirectXMath.h>
+
+// Shared by the bakers and the attribute generation: seeds, random numbers
+// and a frame around a normal to turn hemisphere samples into directions.
+
+// Integer hash, for seeds that depend only on what is sampled (a texel, a
+// vertex, a pass) and not on the thread sampling it.
+inline std::uint32_t hash_seed(std::uint32_t x) {
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+// The top 24 bits as a float in [0, 1)
+inline float to_unit_float(std::uint32_t bits) {
+    return static_cast<float>(bits >> 8) * (1.0f / 16777216.0f);
+}
+
+// PCG, one stream per seed.
+struct Random {
+    std::uint32_t state;
+
+    float next() {
+        state = state * 747796405u + 2891336453u;
+        std::uint32_t word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+        word = (word >> 22u) ^ word;
+        return to_unit_float(word);
+    }
+};
+
+// Unit tangent and bitangent perpendicular to the unit normal n and to each other
+// (Duff et al., "Building an Orthonormal Basis, Revisited").
+inline void get_orthonormal_basis(const DirectX::XMFLOAT3& n, DirectX::XMFLOAT3& tangent, DirectX::XMFLOAT3& bitangent) {
+    float sign = std::copysign(1.0f, n.z);
+    float a = -1.0f / (sign + n.z);
+    float b = n.x * n.y * a;
+    tangent = {1.0f + sign * n.x * n.x * a, sign * b, -sign * n.x};
+    bitangent = {b, sign + n.y * n.y * a, -n.y};
+}
+
+#endif //PROJECT3D_SAMPLING_H
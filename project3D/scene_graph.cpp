@@ -0,0 +1,334 @@
+#include "scene_graph.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <type_traits>
+
+#include "task_scheduler.h"
+
+SceneGraph::NodeId SceneGraph::create_node(NodeId parent, const Transform& transform) {
+    assert(parent == INVALID_NODE || contains(parent));
+
+    NodeId node;
+
+    if (free_ids.empty()) {
+        node = static_cast<NodeId>(node_slots.size());
+        node_slots.push_back(0);
+    }
+    else {
+        node = free_ids.back();
+        free_ids.pop_back();
+    }
+
+    std::uint32_t parent_slot = parent == INVALID_NODE ? NO_PARENT : node_slots[parent];
+    std::uint32_t depth = parent == INVALID_NODE ? 0 : depths[parent_slot] + 1;
+
+    // Appending keeps the order valid as long as the depth does not decrease.
+    if (!depths.empty() && depth < depths.back()) {
+        order_dirty = true;
+    }
+
+    node_slots[node] = static_cast<std::uint32_t>(slot_nodes.size());
+    slot_nodes.push_back(node);
+    parents.push_back(parent_slot);
+    depths.push_back(depth);
+    positions.push_back(transform.position);
+    rotations.push_back(transform.rotation);
+    scales.push_back(transform.scale);
+    local_dirty.push_back(1);
+    world_changed.push_back(0);
+    world_matrices.push_back(DirectX::XMMatrixIdentity());
+
+    if (!order_dirty) {
+        if (level_offsets.size() < depth + 2) {
+            level_offsets.resize(depth + 2, level_offsets.empty() ? 0 : level_offsets.back());
+        }
+
+        level_offsets.back() = slot_nodes.size();
+    }
+
+    any_dirty = true;
+
+    return node;
+}
+
+void SceneGraph::destroy_node(NodeId node) {
+    assert(contains(node));
+
+    if (order_dirty) {
+        sort_by_depth();
+    }
+
+    // Descendants always come after their ancestors, one pass finds the whole subtree.
+    std::size_t count = slot_nodes.size();
+    std::uint32_t first = node_slots[node];
+    std::vector<std::uint8_t> removed(count, 0);
+    std::vector<std::uint32_t> new_slots(count, NO_PARENT);
+    removed[first] = 1;
+
+    for (std::size_t i = first + 1; i < count; i++) {
+        removed[i] = parents[i] != NO_PARENT && removed[parents[i]];
+    }
+
+    std::size_t next = 0;
+
+    for (std::size_t i = 0; i < count; i++) {
+        if (removed[i]) {
+            node_slots[slot_nodes[i]] = NO_PARENT;
+            free_ids.push_back(slot_nodes[i]);
+            continue;
+        }
+
+        new_slots[i] = static_cast<std::uint32_t>(next);
+        node_slots[slot_nodes[i]] = static_cast<std::uint32_t>(next);
+
+        slot_nodes[next] = slot_nodes[i];
+        parents[next] = parents[i] == NO_PARENT ? NO_PARENT : new_slots[parents[i]];
+        depths[next] = depths[i];
+        positions[next] = positions[i];
+        rotations[next] = rotations[i];
+        scales[next] = scales[i];
+        local_dirty[next] = local_dirty[i];
+        world_changed[next] = world_changed[i];
+        world_matrices[next] = world_matrices[i];
+        next++;
+    }
+
+    slot_nodes.resize(next);
+    parents.resize(next);
+    depths.resize(next);
+    positions.resize(next);
+    rotations.resize(next);
+    scales.resize(next);
+    local_dirty.resize(next);
+    world_changed.resize(next);
+    world_matrices.resize(next);
+
+    // Removal keeps the order, only the level boundaries move.
+    level_offsets = count_levels(depths);
+}
+
+void SceneGraph::set_parent(NodeId node, NodeId parent) {
+    assert(contains(node) && (parent == INVALID_NODE || contains(parent)));
+
+    std::uint32_t parent_slot = parent == INVALID_NODE ? NO_PARENT : node_slots[parent];
+
+    // A node cannot become a child of its own subtree.
+    for (std::uint32_t slot = parent_slot; slot != NO_PARENT; slot = parents[slot]) {
+        assert(slot != node_slots[node]);
+    }
+
+    parents[node_slots[node]] = parent_slot;
+    order_dirty = true;
+    mark_dirty(node);
+}
+
+SceneGraph::NodeId SceneGraph::get_parent(NodeId node) const {
+    std::uint32_t parent_slot = parents[node_slots[node]];
+    return parent_slot == NO_PARENT ? INVALID_NODE : slot_nodes[parent_slot];
+}
+
+void SceneGraph::set_transform(NodeId node, const Transform& transform) {
+    std::uint32_t slot = node_slots[node];
+    positions[slot] = transform.position;
+    rotations[slot] = transform.rotation;
+    scales[slot] = transform.scale;
+    mark_dirty(node);
+}
+
+void SceneGraph::set_position(NodeId node, DirectX::XMFLOAT3 position) {
+    positions[node_slots[node]] = position;
+    mark_dirty(node);
+}
+
+void SceneGraph::set_rotation(NodeId node, DirectX::XMFLOAT4 rotation) {
+    rotations[node_slots[node]] = rotation;
+    mark_dirty(node);
+}
+
+void SceneGraph::set_scale(NodeId node, DirectX::XMFLOAT3 scale) {
+    scales[node_slots[node]] = scale;
+    mark_dirty(node);
+}
+
+Transform SceneGraph::get_transform(NodeId node) const {
+    std::uint32_t slot = node_slots[node];
+    return {positions[slot], rotations[slot], scales[slot]};
+}
+
+DirectX::XMMATRIX SceneGraph::get_world_matrix(NodeId node) const {
+    return world_matrices[node_slots[node]];
+}
+
+void SceneGraph::update(TaskScheduler* scheduler) {
+    if (order_dirty) {
+        sort_by_depth();
+    }
+
+    updated_nodes = 0;
+
+    if (!any_dirty) {
+        return;
+    }
+
+    std::atomic<std::size_t> updated{0};
+
+    for (std::size_t level = 0; level + 1 < level_offsets.size(); level++) {
+        std::size_t begin = level_offsets[level];
+        std::size_t end = level_offsets[level + 1];
+
+        if (scheduler != nullptr && end - begin >= PARALLEL_LEVEL_SIZE) {
+            scheduler->parallel_for(begin, end, [this, &updated](std::size_t range_begin, std::size_t range_end) {
+                updated.fetch_add(update_range(range_begin, range_end), std::memory_order_relaxed);
+            }, 1024);
+        }
+        else {
+            updated.fetch_add(update_range(begin, end), std::memory_order_relaxed);
+        }
+    }
+
+    updated_nodes = updated.load();
+    any_dirty = false;
+}
+
+bool SceneGraph::contains(NodeId node) const {
+    return node < node_slots.size() && node_slots[node] != NO_PARENT;
+}
+
+std::size_t SceneGraph::size() const {
+    return slot_nodes.size();
+}
+
+std::size_t SceneGraph::get_depth() const {
+    return level_offsets.empty() ? 0 : level_offsets.size() - 1;
+}
+
+std::size_t SceneGraph::get_number_of_updated_nodes() const {
+    return updated_nodes;
+}
+
+// Counting sort of all arrays by depth, stable so siblings keep their relative order.
+void SceneGraph::sort_by_depth() {
+    std::size_t count = slot_nodes.size();
+
+    // Depths of reparented subtrees are stale, recompute all of them from the roots down.
+    std::vector<std::uint32_t> new_depths(count, NO_PARENT);
+    std::vector<std::uint32_t> chain;
+
+    for (std::size_t i = 0; i < count; i++) {
+        std::uint32_t slot = static_cast<std::uint32_t>(i);
+
+        while (new_depths[slot] == NO_PARENT && parents[slot] != NO_PARENT) {
+            chain.push_back(slot);
+            slot = parents[slot];
+        }
+
+        if (new_depths[slot] == NO_PARENT) {
+            new_depths[slot] = 0;
+        }
+
+        while (!chain.empty()) {
+            new_depths[chain.back()] = new_depths[slot] + 1;
+            slot = chain.back();
+            chain.pop_back();
+        }
+    }
+
+    level_offsets = count_levels(new_depths);
+
+    std::vector<std::size_t> next(level_offsets.begin(), level_offsets.end() - 1);
+    std::vector<std::uint32_t> new_slots(count);
+
+    for (std::size_t i = 0; i < count; i++) {
+        new_slots[i] = static_cast<std::uint32_t>(next[new_depths[i]]++);
+    }
+
+    auto permute = [&](auto& array) {
+        std::remove_reference_t<decltype(array)> sorted(array.size());
+
+        for (std::size_t i = 0; i < count; i++) {
+            sorted[new_slots[i]] = array[i];
+        }
+
+        array.swap(sorted);
+    };
+
+    for (auto& parent : parents) {
+        parent = parent == NO_PARENT ? NO_PARENT : new_slots[parent];
+    }
+
+    depths.swap(new_depths);
+    permute(slot_nodes);
+    permute(parents);
+    permute(depths);
+    permute(positions);
+    permute(rotations);
+    permute(scales);
+    permute(local_dirty);
+    permute(world_changed);
+    permute(world_matrices);
+
+    for (std::size_t i = 0; i < count; i++) {
+        node_slots[slot_nodes[i]] = static_cast<std::uint32_t>(i);
+    }
+
+    order_dirty = false;
+}
+
+std::vector<std::size_t> SceneGraph::count_levels(const std::vector<std::uint32_t>& depths) {
+    std::uint32_t max_depth = 0;
+
+    for (std::uint32_t depth : depths) {
+        max_depth = std::max(max_depth, depth);
+    }
+
+    std::vector<std::size_t> offsets(depths.empty() ? 1 : max_depth + 2, 0);
+
+    for (std::uint32_t depth : depths) {
+        offsets[depth + 1]++;
+    }
+
+    for (std::size_t level = 1; level < offsets.size(); level++) {
+        offsets[level] += offsets[level - 1];
+    }
+
+    return offsets;
+}
+
+std::size_t SceneGraph::update_range(std::size_t begin, std::size_t end) {
+    std::size_t updated = 0;
+
+    for (std::size_t i = begin; i < end; i++) {
+        std::uint32_t parent = parents[i];
+        bool changed = local_dirty[i] || (parent != NO_PARENT && world_changed[parent]);
+        world_changed[i] = changed;
+
+        if (!changed) {
+            continue;
+        }
+
+        local_dirty[i] = 0;
+
+        // Scale * rotation * translation, built directly in SIMD registers.
+        DirectX::XMMATRIX matrix = DirectX::XMMatrixRotationQuaternion(DirectX::XMLoadFloat4(&rotations[i]));
+        matrix.r[0] = DirectX::XMVectorScale(matrix.r[0], scales[i].x);
+        matrix.r[1] = DirectX::XMVectorScale(matrix.r[1], scales[i].y);
+        matrix.r[2] = DirectX::XMVectorScale(matrix.r[2], scales[i].z);
+        matrix.r[3] = DirectX::XMVectorSet(positions[i].x, positions[i].y, positions[i].z, 1.0f);
+
+        if (parent != NO_PARENT) {
+            matrix = DirectX::XMMatrixMultiply(matrix, world_matrices[parent]);
+        }
+
+        world_matrices[i] = matrix;
+        updated++;
+    }
+
+    return updated;
+}
+
+void SceneGraph::mark_dirty(NodeId node) {
+    local_dirty[node_slots[node]] = 1;
+    any_dirty = true;
+}
@@ -0,0 +1,87 @@
+#ifndef PROJECT3D_SCENE_GRAPH_H
+#define PROJECT3D_SCENE_GRAPH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <DirectXMath.h>
+
+class TaskScheduler;
+
+struct Transform {
+    DirectX::XMFLOAT3 position = { 0.0f, 0.0f, 0.0f };
+    DirectX::XMFLOAT4 rotation = { 0.0f, 0.0f, 0.0f, 1.0f };
+    DirectX::XMFLOAT3 scale = { 1.0f, 1.0f, 1.0f };
+};
+
+// Transform hierarchy stored as structure of arrays. Nodes are kept sorted by
+// depth, so every parent comes before its children and update() is a single
+// linear pass per level: a node is recomputed when its local transform changed
+// or its parent's world matrix did. Nodes are referred to by ids that stay
+// valid until the node is destroyed; the array position of a node changes
+// whenever the hierarchy does.
+class SceneGraph {
+public:
+    using NodeId = std::uint32_t;
+    static constexpr NodeId INVALID_NODE = UINT32_MAX;
+
+    NodeId create_node(NodeId parent = INVALID_NODE, const Transform& transform = {});
+
+    // Destroys the node together with all of its descendants.
+    void destroy_node(NodeId node);
+
+    void set_parent(NodeId node, NodeId parent);
+    NodeId get_parent(NodeId node) const;
+
+    void set_transform(NodeId node, const Transform& transform);
+    void set_position(NodeId node, DirectX::XMFLOAT3 position);
+    void set_rotation(NodeId node, DirectX::XMFLOAT4 rotation);
+    void set_scale(NodeId node, DirectX::XMFLOAT3 scale);
+    Transform get_transform(NodeId node) const;
+
+    // World matrix as of the last update().
+    DirectX::XMMATRIX get_world_matrix(NodeId node) const;
+
+    // Recomputes world matrices of changed nodes. With a scheduler, large levels
+    // of the hierarchy are split between its workers.
+    void update(TaskScheduler* scheduler = nullptr);
+
+    bool contains(NodeId node) const;
+    std::size_t size() const;
+    std::size_t get_depth() const;
+    std::size_t get_number_of_updated_nodes() const;
+
+private:
+    static constexpr std::uint32_t NO_PARENT = UINT32_MAX;
+
+    // Levels smaller than this are updated on the calling thread.
+    static constexpr std::size_t PARALLEL_LEVEL_SIZE = 4096;
+
+    void sort_by_depth();
+    std::size_t update_range(std::size_t begin, std::size_t end);
+    static std::vector<std::size_t> count_levels(const std::vector<std::uint32_t>& depths);
+    void mark_dirty(NodeId node);
+
+    // Indexed by node id
+    std::vector<std::uint32_t> node_slots;
+    std::vector<NodeId> free_ids;
+
+    // Indexed by slot, sorted by depth
+    std::vector<NodeId> slot_nodes;
+    std::vector<std::uint32_t> parents;
+    std::vector<std::uint32_t> depths;
+    std::vector<DirectX::XMFLOAT3> positions;
+    std::vector<DirectX::XMFLOAT4> rotations;
+    std::vector<DirectX::XMFLOAT3> scales;
+    std::vector<std::uint8_t> local_dirty;
+    std::vector<std::uint8_t> world_changed;
+    std::vector<DirectX::XMMATRIX> world_matrices;
+
+    // First slot of every depth, plus the end
+    std::vector<std::size_t> level_offsets;
+    bool order_dirty = false;
+    bool any_dirty = false;
+    std::size_t updated_nodes = 0;
+};
+
+#endif //PROJECT3D_SCENE_GRAPH_H
@@ -0,0 +1,48 @@
+#include "simulation_clock.h"
+
+#include <algorithm>
+
+SimulationClock::SimulationClock(double timestep, double max_frame_time) :
+        timestep(timestep),
+        max_frame_time(max_frame_time),
+        previous_time(std::chrono::steady_clock::now()) {}
+
+void SimulationClock::advance() {
+    auto now = std::chrono::steady_clock::now();
+    std::chrono::duration<double> frame_time = now - previous_time;
+    previous_time = now;
+
+    advance(frame_time.count());
+}
+
+void SimulationClock::advance(double frame_time) {
+    accumulator += std::clamp(frame_time, 0.0, max_frame_time);
+}
+
+bool SimulationClock::step() {
+    if (accumulator < timestep) {
+        return false;
+    }
+
+    accumulator -= timestep;
+    simulation_time += timestep;
+    return true;
+}
+
+void SimulationClock::reset() {
+    accumulator = 0.0;
+    simulation_time = 0.0;
+    previous_time = std::chrono::steady_clock::now();
+}
+
+double SimulationClock::get_timestep() const {
+    return timestep;
+}
+
+double SimulationClock::get_simulation_time() const {
+    return simulation_time;
+}
+
+float SimulationClock::get_interpolation_alpha() const {
+    return static_cast<float>(accumulator / timestep);
+}
@@ -0,0 +1,48 @@
+#ifndef PROJECT3D_SIMULATION_CLOCK_H
+#define PROJECT3D_SIMULATION_CLOCK_H
+
+#include <chrono>
+
+// Fixed-timestep simulation clock. Rendered frames add the real time they
+// took, the simulation then runs as many fixed steps as fit into the
+// accumulated time and the rest is used to interpolate between the last two
+// simulation states:
+//
+//     clock.advance();
+//     while (clock.step()) { previous = current; simulate(current, clock.get_timestep()); }
+//     render(interpolate(previous, current, clock.get_interpolation_alpha()));
+class SimulationClock {
+public:
+    explicit SimulationClock(double timestep = DEFAULT_TIMESTEP, double max_frame_time = DEFAULT_MAX_FRAME_TIME);
+
+    // Adds the real time elapsed since the previous call (or reset).
+    void advance();
+
+    // Adds the given amount of time, used for deterministic replays.
+    void advance(double frame_time);
+
+    // Consumes one timestep of accumulated time, false when less than a step is left.
+    bool step();
+
+    void reset();
+
+    double get_timestep() const;
+    double get_simulation_time() const;
+
+    // How far between the previous and the current simulation state the rendered frame is, in [0, 1).
+    float get_interpolation_alpha() const;
+
+private:
+    static constexpr double DEFAULT_TIMESTEP = 1.0 / 120.0;
+
+    // Longer frames (window drag, breakpoints) are clamped so the simulation does not try to catch up.
+    static constexpr double DEFAULT_MAX_FRAME_TIME = 0.25;
+
+    double timestep;
+    double max_frame_time;
+    double accumulator = 0.0;
+    double simulation_time = 0.0;
+    std::chrono::steady_clock::time_point previous_time;
+};
+
+#endif //PROJECT3D_SIMULATION_CLOCK_H
@@ -0,0 +1,286 @@
+#include "spatial_index.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cassert>
+#include <cmath>
+
+#include "task_scheduler.h"
+
+namespace {
+    constexpr float LOOSENESS = 2.0f;
+
+    struct StackEntry {
+        std::int32_t node;
+        std::uint64_t mask;
+    };
+}
+
+SpatialIndex::SpatialIndex(const Aabb& world_bounds, unsigned max_depth) : max_depth(max_depth) {
+    DirectX::XMFLOAT3 extents = world_bounds.get_extents();
+    float half_size = std::max({extents.x, extents.y, extents.z, 1.0f});
+
+    create_node(NO_NODE, world_bounds.get_center(), half_size);
+}
+
+SpatialIndex::ObjectId SpatialIndex::insert(const Aabb& bounds, std::uint32_t user_data) {
+    ObjectId object;
+
+    if (free_objects.empty()) {
+        object = static_cast<ObjectId>(objects.size());
+        objects.emplace_back();
+    }
+    else {
+        object = free_objects.back();
+        free_objects.pop_back();
+    }
+
+    objects[object].bounds = bounds;
+    objects[object].user_data = user_data;
+    add_to_node(find_node(bounds), object);
+    object_count++;
+
+    return object;
+}
+
+void SpatialIndex::move(ObjectId object, const Aabb& bounds) {
+    assert(object < objects.size() && objects[object].node != NO_NODE);
+
+    objects[object].bounds = bounds;
+
+    // Removing first keeps the old branch alive when the object only moves deeper into it.
+    remove_from_node(object);
+    add_to_node(find_node(bounds), object);
+}
+
+void SpatialIndex::remove(ObjectId object) {
+    assert(object < objects.size() && objects[object].node != NO_NODE);
+
+    remove_from_node(object);
+    free_objects.push_back(object);
+    object_count--;
+}
+
+const Aabb& SpatialIndex::get_bounds(ObjectId object) const {
+    return objects[object].bounds;
+}
+
+std::uint32_t SpatialIndex::get_user_data(ObjectId object) const {
+    return objects[object].user_data;
+}
+
+std::size_t SpatialIndex::size() const {
+    return object_count;
+}
+
+std::size_t SpatialIndex::get_number_of_nodes() const {
+    return nodes.size() - free_nodes.size();
+}
+
+std::size_t SpatialIndex::query_range(const Aabb& range, std::vector<ObjectId>& result) const {
+    return query_batch(&range, 1, &result);
+}
+
+std::size_t SpatialIndex::query_frustum(const Frustum& frustum, std::vector<ObjectId>& result) const {
+    return query_batch(&frustum, 1, &result);
+}
+
+std::size_t SpatialIndex::query_ranges(const std::vector<Aabb>& ranges,
+                                       std::vector<std::vector<ObjectId>>& results,
+                                       TaskScheduler* scheduler) const {
+    return query_batches(ranges, results, scheduler);
+}
+
+std::size_t SpatialIndex::query_frustums(const std::vector<Frustum>& frustums,
+                                         std::vector<std::vector<ObjectId>>& results,
+                                         TaskScheduler* scheduler) const {
+    return query_batches(frustums, results, scheduler);
+}
+
+std::int32_t SpatialIndex::find_node(const Aabb& bounds) {
+    const Node& root = nodes[0];
+    DirectX::XMFLOAT3 center = bounds.get_center();
+    DirectX::XMFLOAT3 extents = bounds.get_extents();
+    float size = std::max({extents.x, extents.y, extents.z});
+
+    // Centers outside the root cell would not fit into the loose bounds of any node.
+    if (std::abs(center.x - root.center.x) > root.half_size ||
+        std::abs(center.y - root.center.y) > root.half_size ||
+        std::abs(center.z - root.center.z) > root.half_size) {
+        return 0;
+    }
+
+    std::int32_t node = 0;
+
+    // An object fits a node as long as its extents are not larger than the node's half size.
+    for (unsigned depth = 0; depth < max_depth && nodes[node].half_size * 0.5f >= size; depth++) {
+        const Node& current = nodes[node];
+        int octant = (center.x >= current.center.x ? 1 : 0) |
+                     (center.y >= current.center.y ? 2 : 0) |
+                     (center.z >= current.center.z ? 4 : 0);
+
+        if (current.children[octant] == NO_NODE) {
+            float child_half_size = current.half_size * 0.5f;
+            DirectX::XMFLOAT3 child_center = {
+                    current.center.x + ((octant & 1) ? child_half_size : -child_half_size),
+                    current.center.y + ((octant & 2) ? child_half_size : -child_half_size),
+                    current.center.z + ((octant & 4) ? child_half_size : -child_half_size)
+            };
+
+            std::int32_t child = create_node(node, child_center, child_half_size);
+            nodes[node].children[octant] = child;
+        }
+
+        node = nodes[node].children[octant];
+    }
+
+    return node;
+}
+
+std::int32_t SpatialIndex::create_node(std::int32_t parent, DirectX::XMFLOAT3 center, float half_size) {
+    std::int32_t index;
+
+    if (free_nodes.empty()) {
+        index = static_cast<std::int32_t>(nodes.size());
+        nodes.emplace_back();
+    }
+    else {
+        index = free_nodes.back();
+        free_nodes.pop_back();
+    }
+
+    Node& node = nodes[index];
+    float loose_half_size = half_size * LOOSENESS;
+
+    node.center = center;
+    node.half_size = half_size;
+    node.loose_bounds = Aabb::from_center_extents(center, {loose_half_size, loose_half_size, loose_half_size});
+    node.parent = parent;
+    std::fill(std::begin(node.children), std::end(node.children), NO_NODE);
+    node.subtree_objects = 0;
+    node.objects.clear();
+
+    return index;
+}
+
+void SpatialIndex::add_to_node(std::int32_t node, ObjectId object) {
+    objects[object].node = node;
+    objects[object].index_in_node = static_cast<std::uint32_t>(nodes[node].objects.size());
+    nodes[node].objects.push_back(object);
+
+    for (std::int32_t current = node; current != NO_NODE; current = nodes[current].parent) {
+        nodes[current].subtree_objects++;
+    }
+}
+
+void SpatialIndex::remove_from_node(ObjectId object) {
+    std::int32_t node = objects[object].node;
+    auto& node_objects = nodes[node].objects;
+    std::uint32_t index = objects[object].index_in_node;
+
+    node_objects[index] = node_objects.back();
+    objects[node_objects[index]].index_in_node = index;
+    node_objects.pop_back();
+    objects[object].node = NO_NODE;
+
+    for (std::int32_t current = node; current != NO_NODE; current = nodes[current].parent) {
+        nodes[current].subtree_objects--;
+    }
+
+    // Release the now empty branch, the root always stays.
+    while (node != 0 && nodes[node].subtree_objects == 0) {
+        std::int32_t parent = nodes[node].parent;
+        std::replace(std::begin(nodes[parent].children), std::end(nodes[parent].children), node, NO_NODE);
+        nodes[node].objects.shrink_to_fit();
+        free_nodes.push_back(node);
+        node = parent;
+    }
+}
+
+template<class Shape>
+std::size_t SpatialIndex::query_batch(const Shape* shapes, std::size_t count, std::vector<ObjectId>* results) const {
+    assert(count > 0 && count <= MAX_BATCH_SIZE);
+
+    std::uint64_t all = count == MAX_BATCH_SIZE ? ~0ull : (1ull << count) - 1;
+    std::vector<StackEntry> stack;
+    std::size_t visited = 0;
+
+    // The root is always entered, it also holds objects outside the world bounds.
+    if (nodes[0].subtree_objects > 0) {
+        stack.push_back({0, all});
+    }
+
+    while (!stack.empty()) {
+        StackEntry entry = stack.back();
+        stack.pop_back();
+        visited++;
+
+        const Node& node = nodes[entry.node];
+
+        for (ObjectId object : node.objects) {
+            const Aabb& bounds = objects[object].bounds;
+
+            for (std::uint64_t mask = entry.mask; mask != 0; mask &= mask - 1) {
+                int query = std::countr_zero(mask);
+
+                if (shapes[query].intersects(bounds)) {
+                    results[query].push_back(object);
+                }
+            }
+        }
+
+        for (std::int32_t child : node.children) {
+            if (child == NO_NODE) {
+                continue;
+            }
+
+            std::uint64_t child_mask = 0;
+
+            for (std::uint64_t mask = entry.mask; mask != 0; mask &= mask - 1) {
+                int query = std::countr_zero(mask);
+
+                if (shapes[query].intersects(nodes[child].loose_bounds)) {
+                    child_mask |= 1ull << query;
+                }
+            }
+
+            if (child_mask != 0) {
+                stack.push_back({child, child_mask});
+            }
+        }
+    }
+
+    return visited;
+}
+
+template<class Shape>
+std::size_t SpatialIndex::query_batches(const std::vector<Shape>& shapes,
+                                        std::vector<std::vector<ObjectId>>& results,
+                                        TaskScheduler* scheduler) const {
+    results.resize(shapes.size());
+
+    for (auto& result : results) {
+        result.clear();
+    }
+
+    std::size_t batch_count = (shapes.size() + MAX_BATCH_SIZE - 1) / MAX_BATCH_SIZE;
+    std::atomic<std::size_t> visited{0};
+
+    auto run_batches = [&](std::size_t begin, std::size_t end) {
+        for (std::size_t batch = begin; batch < end; batch++) {
+            std::size_t first = batch * MAX_BATCH_SIZE;
+            std::size_t count = std::min(MAX_BATCH_SIZE, shapes.size() - first);
+            visited.fetch_add(query_batch(&shapes[first], count, &results[first]), std::memory_order_relaxed);
+        }
+    };
+
+    if (scheduler != nullptr && batch_count > 1) {
+        scheduler->parallel_for(0, batch_count, run_batches, 1);
+    }
+    else {
+        run_batches(0, batch_count);
+    }
+
+    return visited.load();
+}
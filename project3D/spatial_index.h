@@ -0,0 +1,93 @@
+#ifndef PROJECT3D_SPATIAL_INDEX_H
+#define PROJECT3D_SPATIAL_INDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "bounds.h"
+
+class TaskScheduler;
+
+// Loose octree over object bounds. Every object lives in exactly one node: the
+// deepest one whose cell is at least as large as the object, chosen by the
+// object's center. Node bounds are loosened to twice the cell size, so an
+// object never straddles a node boundary and moving it is usually just an
+// update of its bounds. Nodes are created on demand and released once their
+// subtree is empty; objects outside world_bounds are kept in the root.
+class SpatialIndex {
+public:
+    using ObjectId = std::uint32_t;
+    static constexpr ObjectId INVALID_OBJECT = UINT32_MAX;
+
+    // Number of queries answered by a single traversal in the batched queries
+    static constexpr std::size_t MAX_BATCH_SIZE = 64;
+
+    explicit SpatialIndex(const Aabb& world_bounds, unsigned max_depth = 8);
+
+    ObjectId insert(const Aabb& bounds, std::uint32_t user_data = 0);
+    void move(ObjectId object, const Aabb& bounds);
+    void remove(ObjectId object);
+
+    const Aabb& get_bounds(ObjectId object) const;
+    std::uint32_t get_user_data(ObjectId object) const;
+    std::size_t size() const;
+    std::size_t get_number_of_nodes() const;
+
+    // Append the objects whose bounds intersect the range / frustum to result.
+    // Both return the number of octree nodes visited.
+    std::size_t query_range(const Aabb& range, std::vector<ObjectId>& result) const;
+    std::size_t query_frustum(const Frustum& frustum, std::vector<ObjectId>& result) const;
+
+    // Batched queries walk the tree once per MAX_BATCH_SIZE queries, entering a
+    // node while any query of the batch still overlaps it. With a scheduler the
+    // batches are spread over its workers. results[i] gets the objects of query i.
+    std::size_t query_ranges(const std::vector<Aabb>& ranges,
+                             std::vector<std::vector<ObjectId>>& results,
+                             TaskScheduler* scheduler = nullptr) const;
+    std::size_t query_frustums(const std::vector<Frustum>& frustums,
+                               std::vector<std::vector<ObjectId>>& results,
+                               TaskScheduler* scheduler = nullptr) const;
+
+private:
+    static constexpr std::int32_t NO_NODE = -1;
+
+    struct Node {
+        DirectX::XMFLOAT3 center;
+        float half_size;
+        Aabb loose_bounds;
+        std::int32_t parent;
+        std::int32_t children[8];
+        std::size_t subtree_objects;
+        std::vector<ObjectId> objects;
+    };
+
+    struct Object {
+        Aabb bounds;
+        std::uint32_t user_data;
+        std::int32_t node;
+        std::uint32_t index_in_node;
+    };
+
+    std::int32_t find_node(const Aabb& bounds);
+    std::int32_t create_node(std::int32_t parent, DirectX::XMFLOAT3 center, float half_size);
+    void add_to_node(std::int32_t node, ObjectId object);
+    void remove_from_node(ObjectId object);
+
+    template<class Shape>
+    std::size_t query_batch(const Shape* shapes, std::size_t count, std::vector<ObjectId>* results) const;
+
+    template<class Shape>
+    std::size_t query_batches(const std::vector<Shape>& shapes,
+                              std::vector<std::vector<ObjectId>>& results,
+                              TaskScheduler* scheduler) const;
+
+    unsigned max_depth;
+    std::vector<Node> nodes;
+    std::vector<std::int32_t> free_nodes;
+    std::vector<Object> objects;
+    std::vector<ObjectId> free_objects;
+    std::size_t object_count = 0;
+};
+
+#endif //PROJECT3D_SPATIAL_INDEX_H
@@ -0,0 +1,329 @@
+#include "task_scheduler.h"
+
+#include <algorithm>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace {
+    struct WorkerContext {
+        const TaskScheduler* scheduler = nullptr;
+        int index = -1;
+    };
+
+    thread_local WorkerContext current_context;
+
+    constexpr int IDLE_SPIN_COUNT = 64;
+}
+
+TaskScheduler::TaskScheduler() : TaskScheduler(Options{}) {}
+
+TaskScheduler::TaskScheduler(Options options) {
+    unsigned worker_count = options.worker_count;
+
+    if (worker_count == 0) {
+        worker_count = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    for (unsigned i = 0; i < worker_count; i++) {
+        workers.push_back(std::make_unique<Worker>());
+        workers.back()->rng_state = 0x9E3779B9u * (i + 1);
+    }
+
+    // The constructing thread is worker 0 and runs tasks while it waits.
+    current_context = {this, 0};
+
+    if (options.pin_threads) {
+        pin_current_thread(0);
+    }
+
+    for (unsigned i = 1; i < worker_count; i++) {
+        workers[i]->thread = std::thread([this, i, pin = options.pin_threads] {
+            if (pin) {
+                pin_current_thread(i);
+            }
+
+            worker_main(i);
+        });
+    }
+}
+
+TaskScheduler::~TaskScheduler() {
+    stopping.store(true);
+    work_epoch.fetch_add(1);
+    work_epoch.notify_all();
+
+    for (auto& worker : workers) {
+        if (worker->thread.joinable()) {
+            worker->thread.join();
+        }
+    }
+
+    if (current_context.scheduler == this) {
+        current_context = {};
+    }
+}
+
+void TaskScheduler::spawn(TaskCounter& counter, std::function<void()> work) {
+    counter.pending.fetch_add(1, std::memory_order_relaxed);
+    submit(new Task{std::move(work), &counter});
+}
+
+void TaskScheduler::spawn(std::function<void()> work) {
+    submit(new Task{std::move(work), nullptr});
+}
+
+void TaskScheduler::submit(Task* task) {
+    int index = get_current_worker();
+
+    if (index >= 0) {
+        workers[index]->queue.push(task);
+    }
+    else {
+        std::lock_guard lock(injection_mutex);
+        injection_queue.push_back(task);
+        injection_size.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Pairs with the increment of sleeping_workers in worker_main.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    if (sleeping_workers.load(std::memory_order_relaxed) > 0) {
+        wake_workers();
+    }
+}
+
+void TaskScheduler::wait(TaskCounter& counter) {
+    int index = get_current_worker();
+
+    while (!counter.done()) {
+        if (!try_run_one(index)) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void TaskScheduler::wait_until(const std::function<bool()>& done) {
+    int index = get_current_worker();
+
+    while (!done()) {
+        if (!try_run_one(index)) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void TaskScheduler::parallel_for(std::size_t begin, std::size_t end,
+                                 const std::function<void(std::size_t, std::size_t)>& work,
+                                 std::size_t grain_size) {
+    if (begin >= end) {
+        return;
+    }
+
+    if (grain_size == 0) {
+        grain_size = std::max<std::size_t>(1, (end - begin) / (workers.size() * 8));
+    }
+
+    TaskCounter counter;
+    parallel_for_range(begin, end, grain_size, work, counter);
+    wait(counter);
+}
+
+unsigned TaskScheduler::get_worker_count() const {
+    return static_cast<unsigned>(workers.size());
+}
+
+int TaskScheduler::get_current_worker() const {
+    return current_context.scheduler == this ? current_context.index : -1;
+}
+
+TaskScheduler& TaskScheduler::get_default() {
+    static TaskScheduler scheduler;
+    return scheduler;
+}
+
+void TaskScheduler::worker_main(unsigned index) {
+    current_context = {this, static_cast<int>(index)};
+
+    while (!stopping.load(std::memory_order_relaxed)) {
+        bool found = false;
+
+        for (int i = 0; i < IDLE_SPIN_COUNT && !found; i++) {
+            found = try_run_one(static_cast<int>(index));
+        }
+
+        if (found) {
+            continue;
+        }
+
+        std::uint32_t epoch = work_epoch.load();
+        sleeping_workers.fetch_add(1);
+
+        if (try_run_one(static_cast<int>(index))) {
+            sleeping_workers.fetch_sub(1);
+            continue;
+        }
+
+        if (!stopping.load()) {
+            work_epoch.wait(epoch);
+        }
+
+        sleeping_workers.fetch_sub(1);
+    }
+
+    current_context = {};
+}
+
+void TaskScheduler::execute(Task* task) {
+    task->work();
+
+    if (task->counter != nullptr) {
+        task->counter->pending.fetch_sub(1, std::memory_order_release);
+    }
+
+    delete task;
+}
+
+bool TaskScheduler::try_run_one(int worker_index) {
+    Task* task = find_task(worker_index);
+
+    if (task == nullptr) {
+        return false;
+    }
+
+    execute(task);
+    return true;
+}
+
+TaskScheduler::Task* TaskScheduler::find_task(int worker_index) {
+    Task* task = nullptr;
+
+    if (worker_index >= 0 && workers[worker_index]->queue.pop(task)) {
+        return task;
+    }
+
+    if (injection_size.load(std::memory_order_relaxed) > 0) {
+        std::lock_guard lock(injection_mutex);
+
+        if (!injection_queue.empty()) {
+            task = injection_queue.front();
+            injection_queue.pop_front();
+            injection_size.fetch_sub(1, std::memory_order_relaxed);
+            return task;
+        }
+    }
+
+    std::size_t worker_count = workers.size();
+    std::size_t start = 0;
+
+    if (worker_index >= 0) {
+        // xorshift, only used to spread thieves over victims
+        std::uint32_t& state = workers[worker_index]->rng_state;
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        start = state % worker_count;
+    }
+
+    for (std::size_t i = 0; i < worker_count; i++) {
+        std::size_t victim = (start + i) % worker_count;
+
+        if (static_cast<int>(victim) != worker_index && workers[victim]->queue.steal(task)) {
+            return task;
+        }
+    }
+
+    return nullptr;
+}
+
+void TaskScheduler::parallel_for_range(std::size_t begin, std::size_t end, std::size_t grain_size,
+                                       const std::function<void(std::size_t, std::size_t)>& work,
+                                       TaskCounter& counter) {
+    int index = get_current_worker();
+
+    while (begin < end) {
+        bool idle_thieves = index < 0 || workers[index]->queue.size() == 0;
+
+        if (end - begin > grain_size && idle_thieves) {
+            std::size_t middle = begin + (end - begin) / 2;
+
+            spawn(counter, [this, middle, end, grain_size, &work, &counter] {
+                parallel_for_range(middle, end, grain_size, work, counter);
+            });
+
+            end = middle;
+            continue;
+        }
+
+        std::size_t chunk_end = std::min(end, begin + grain_size);
+        work(begin, chunk_end);
+        begin = chunk_end;
+    }
+}
+
+void TaskScheduler::wake_workers() {
+    work_epoch.fetch_add(1);
+    work_epoch.notify_one();
+}
+
+void TaskScheduler::pin_current_thread(unsigned core) {
+    unsigned core_count = std::max(1u, std::thread::hardware_concurrency());
+    core %= core_count;
+
+#ifdef _WIN32
+    SetThreadAffinityMask(GetCurrentThread(), static_cast<DWORD_PTR>(1) << (core % (sizeof(DWORD_PTR) * 8)));
+#else
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    CPU_SET(core, &cpu_set);
+    pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+#endif
+}
+
+TaskGraph::NodeId TaskGraph::add(std::function<void()> work) {
+    nodes.push_back({});
+    nodes.back().work = std::move(work);
+    return nodes.size() - 1;
+}
+
+void TaskGraph::precede(NodeId before, NodeId after) {
+    nodes[before].successors.push_back(after);
+    nodes[after].dependency_count++;
+}
+
+void TaskGraph::run(TaskScheduler& scheduler) {
+    TaskCounter counter;
+
+    for (auto& node : nodes) {
+        node.remaining->store(node.dependency_count, std::memory_order_relaxed);
+    }
+
+    for (NodeId id = 0; id < nodes.size(); id++) {
+        if (nodes[id].dependency_count == 0) {
+            spawn_node(scheduler, counter, id);
+        }
+    }
+
+    scheduler.wait(counter);
+}
+
+std::size_t TaskGraph::size() const {
+    return nodes.size();
+}
+
+void TaskGraph::spawn_node(TaskScheduler& scheduler, TaskCounter& counter, NodeId id) {
+    scheduler.spawn(counter, [this, &scheduler, &counter, id] {
+        nodes[id].work();
+
+        for (NodeId successor : nodes[id].successors) {
+            if (nodes[successor].remaining->fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                spawn_node(scheduler, counter, successor);
+            }
+        }
+    });
+}
@@ -0,0 +1,233 @@
+#ifndef PROJECT3D_TASK_SCHEDULER_H
+#define PROJECT3D_TASK_SCHEDULER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Chase-Lev work-stealing deque (Le et al., "Correct and Efficient Work-Stealing
+// for Weak Memory Models"). push/pop may only be called by the owning thread,
+// steal may be called by any thread.
+template<class T>
+class WorkStealingDeque {
+public:
+    explicit WorkStealingDeque(std::size_t initial_capacity = 1024) {
+        std::size_t capacity = 1;
+        while (capacity < initial_capacity) {
+            capacity <<= 1;
+        }
+
+        buffers.push_back(std::make_unique<Buffer>(capacity));
+        buffer.store(buffers.back().get(), std::memory_order_relaxed);
+    }
+
+    WorkStealingDeque(const WorkStealingDeque&) = delete;
+    WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+    void push(T item) {
+        std::int64_t b = bottom.load(std::memory_order_relaxed);
+        std::int64_t t = top.load(std::memory_order_acquire);
+        Buffer* current = buffer.load(std::memory_order_relaxed);
+
+        if (b - t > static_cast<std::int64_t>(current->mask)) {
+            current = grow(current, t, b);
+        }
+
+        current->put(b, item);
+        bottom.store(b + 1, std::memory_order_release);
+    }
+
+    bool pop(T& item) {
+        std::int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+        Buffer* current = buffer.load(std::memory_order_relaxed);
+        bottom.store(b, std::memory_order_seq_cst);
+        std::int64_t t = top.load(std::memory_order_seq_cst);
+
+        if (t > b) {
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return false;
+        }
+
+        item = current->get(b);
+
+        if (t == b) {
+            bool won = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return won;
+        }
+
+        return true;
+    }
+
+    bool steal(T& item) {
+        std::int64_t t = top.load(std::memory_order_seq_cst);
+        std::int64_t b = bottom.load(std::memory_order_seq_cst);
+
+        if (t >= b) {
+            return false;
+        }
+
+        item = buffer.load(std::memory_order_acquire)->get(t);
+        return top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+    }
+
+    std::size_t size() const {
+        std::int64_t b = bottom.load(std::memory_order_relaxed);
+        std::int64_t t = top.load(std::memory_order_relaxed);
+        return b > t ? static_cast<std::size_t>(b - t) : 0;
+    }
+
+private:
+    struct Buffer {
+        explicit Buffer(std::size_t capacity) : mask(capacity - 1), items(new std::atomic<T>[capacity]) {}
+
+        T get(std::int64_t index) const {
+            return items[static_cast<std::size_t>(index) & mask].load(std::memory_order_relaxed);
+        }
+
+        void put(std::int64_t index, T item) {
+            items[static_cast<std::size_t>(index) & mask].store(item, std::memory_order_relaxed);
+        }
+
+        std::size_t mask;
+        std::unique_ptr<std::atomic<T>[]> items;
+    };
+
+    // Old buffers stay alive until the deque is destroyed, a thief may still be reading from them.
+    Buffer* grow(Buffer* current, std::int64_t t, std::int64_t b) {
+        auto bigger = std::make_unique<Buffer>((current->mask + 1) * 2);
+
+        for (std::int64_t i = t; i < b; i++) {
+            bigger->put(i, current->get(i));
+        }
+
+        buffers.push_back(std::move(bigger));
+        buffer.store(buffers.back().get(), std::memory_order_release);
+        return buffers.back().get();
+    }
+
+    alignas(64) std::atomic<std::int64_t> top{0};
+    alignas(64) std::atomic<std::int64_t> bottom{0};
+    std::atomic<Buffer*> buffer{nullptr};
+    std::vector<std::unique_ptr<Buffer>> buffers;
+};
+
+// Number of outstanding tasks of a fork-join region. TaskScheduler::wait keeps
+// executing other tasks until the counter drops to zero.
+class TaskCounter {
+public:
+    bool done() const {
+        return pending.load(std::memory_order_acquire) == 0;
+    }
+
+private:
+    friend class TaskScheduler;
+
+    std::atomic<std::size_t> pending{0};
+};
+
+class TaskScheduler {
+public:
+    struct Options {
+        // 0 - one thread per hardware thread (the calling thread counts as worker 0)
+        unsigned worker_count = 0;
+        bool pin_threads = false;
+    };
+
+    TaskScheduler();
+    explicit TaskScheduler(Options options);
+    ~TaskScheduler();
+
+    TaskScheduler(const TaskScheduler&) = delete;
+    TaskScheduler& operator=(const TaskScheduler&) = delete;
+
+    void spawn(TaskCounter& counter, std::function<void()> work);
+    void wait(TaskCounter& counter);
+
+    // A task nobody waits for as such, e.g. one resuming a coroutine (see async_task.h).
+    void spawn(std::function<void()> work);
+
+    // Like wait, until done() returns true.
+    void wait_until(const std::function<bool()>& done);
+
+    // Calls work(range_begin, range_end) over disjoint subranges of [begin, end).
+    // Ranges are split lazily: a worker only hands off half of its range while it
+    // has nothing queued locally, so chunk sizes adapt to how busy the other workers
+    // are. grain_size = 0 picks a grain from the range length and worker count.
+    void parallel_for(std::size_t begin, std::size_t end,
+                      const std::function<void(std::size_t, std::size_t)>& work,
+                      std::size_t grain_size = 0);
+
+    unsigned get_worker_count() const;
+
+    // Index of the calling thread in this scheduler, or -1 for foreign threads.
+    int get_current_worker() const;
+
+    static TaskScheduler& get_default();
+
+private:
+    struct Task {
+        std::function<void()> work;
+        TaskCounter* counter;
+    };
+
+    struct alignas(64) Worker {
+        WorkStealingDeque<Task*> queue;
+        std::thread thread;
+        std::uint32_t rng_state = 0;
+    };
+
+    void worker_main(unsigned index);
+    void submit(Task* task);
+    void execute(Task* task);
+    bool try_run_one(int worker_index);
+    Task* find_task(int worker_index);
+    void parallel_for_range(std::size_t begin, std::size_t end, std::size_t grain_size,
+                            const std::function<void(std::size_t, std::size_t)>& work,
+                            TaskCounter& counter);
+    void wake_workers();
+
+    static void pin_current_thread(unsigned core);
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::atomic<bool> stopping{false};
+
+    std::mutex injection_mutex;
+    std::deque<Task*> injection_queue;
+    std::atomic<std::size_t> injection_size{0};
+
+    std::atomic<std::uint32_t> work_epoch{0};
+    std::atomic<int> sleeping_workers{0};
+};
+
+// Set of tasks with "runs before" edges. A graph can be run several times;
+// every run executes each node once all its predecessors have finished.
+class TaskGraph {
+public:
+    using NodeId = std::size_t;
+
+    NodeId add(std::function<void()> work);
+    void precede(NodeId before, NodeId after);
+    void run(TaskScheduler& scheduler);
+    std::size_t size() const;
+
+private:
+    struct Node {
+        std::function<void()> work;
+        std::vector<NodeId> successors;
+        std::size_t dependency_count = 0;
+        std::unique_ptr<std::atomic<std::size_t>> remaining = std::make_unique<std::atomic<std::size_t>>(0);
+    };
+
+    void spawn_node(TaskScheduler& scheduler, TaskCounter& counter, NodeId id);
+
+    std::vector<Node> nodes;
+};
+
+#endif //PROJECT3D_TASK_SCHEDULER_H
@@ -0,0 +1,973 @@
+#include "texture_codec.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+
+namespace {
+    constexpr std::uint8_t PNG_SIGNATURE[8] = {137, 80, 78, 71, 13, 10, 26, 10};
+
+    // Larger images are rejected before anything is allocated for them.
+    constexpr std::uint64_t MAX_TEXELS = std::uint64_t{1} << 28;
+
+    constexpr std::size_t BC1_BLOCK_BYTES = 8;
+    constexpr std::size_t BC3_BLOCK_BYTES = 16;
+
+    constexpr std::uint32_t DDS_MAGIC = 0x20534444; // "DDS "
+    constexpr std::uint32_t FOURCC_DXT1 = 0x31545844;
+    constexpr std::uint32_t FOURCC_DXT5 = 0x35545844;
+
+    // DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT | DDSD_LINEARSIZE
+    constexpr std::uint32_t DDS_HEADER_FLAGS = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | 0x80000;
+    constexpr std::uint32_t DDPF_FOURCC = 0x4;
+    constexpr std::uint32_t DDSCAPS_COMPLEX = 0x8;
+    constexpr std::uint32_t DDSCAPS_TEXTURE = 0x1000;
+    constexpr std::uint32_t DDSCAPS_MIPMAP = 0x400000;
+
+    constexpr std::uint16_t LENGTH_BASES[29] = {
+            3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+    constexpr std::uint8_t LENGTH_EXTRA_BITS[29] = {
+            0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+    constexpr std::uint16_t DISTANCE_BASES[30] = {
+            1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073,
+            4097, 6145, 8193, 12289, 16385, 24577};
+    constexpr std::uint8_t DISTANCE_EXTRA_BITS[30] = {
+            0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+    constexpr std::uint8_t CODE_LENGTH_ORDER[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+    constexpr int MAX_CODE_LENGTH = 15;
+
+    std::uint32_t read_big_endian(const std::uint8_t* data) {
+        return (static_cast<std::uint32_t>(data[0]) << 24) | (static_cast<std::uint32_t>(data[1]) << 16) |
+               (static_cast<std::uint32_t>(data[2]) << 8) | data[3];
+    }
+
+    std::uint32_t get_crc32(const std::uint8_t* data, std::size_t size) {
+        static const std::array<std::uint32_t, 256> table = [] {
+            std::array<std::uint32_t, 256> entries{};
+
+            for (std::uint32_t i = 0; i < 256; i++) {
+                std::uint32_t value = i;
+
+                for (int bit = 0; bit < 8; bit++) {
+                    value = (value & 1) ? 0xEDB88320u ^ (value >> 1) : value >> 1;
+                }
+
+                entries[i] = value;
+            }
+
+            return entries;
+        }();
+
+        std::uint32_t crc = 0xFFFFFFFFu;
+
+        for (std::size_t i = 0; i < size; i++) {
+            crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+        }
+
+        return crc ^ 0xFFFFFFFFu;
+    }
+
+    std::uint32_t get_adler32(const std::uint8_t* data, std::size_t size) {
+        std::uint32_t a = 1;
+        std::uint32_t b = 0;
+
+        while (size > 0) {
+            // The largest run that cannot overflow b before the modulo
+            std::size_t run = std::min<std::size_t>(size, 5552);
+
+            for (std::size_t i = 0; i < run; i++) {
+                a += data[i];
+                b += a;
+            }
+
+            a %= 65521;
+            b %= 65521;
+            data += run;
+            size -= run;
+        }
+
+        return (b << 16) | a;
+    }
+
+    // Bits of a deflate stream, least significant first.
+    class BitReader {
+    public:
+        BitReader(const std::uint8_t* data, std::size_t size) : data(data), size(size) {}
+
+        std::uint32_t get_bits(int count) {
+            while (bit_count < count) {
+                if (position >= size) {
+                    overflow = true;
+                    return 0;
+                }
+
+                bit_buffer |= static_cast<std::uint32_t>(data[position++]) << bit_count;
+                bit_count += 8;
+            }
+
+            std::uint32_t value = bit_buffer & ((std::uint32_t{1} << count) - 1);
+            bit_buffer >>= count;
+            bit_count -= count;
+            return value;
+        }
+
+        // Drops the rest of the current byte.
+        void align() {
+            bit_buffer = 0;
+            bit_count = 0;
+        }
+
+        const std::uint8_t* get_bytes(std::size_t count) {
+            if (size - position < count) {
+                overflow = true;
+                return nullptr;
+            }
+
+            const std::uint8_t* bytes = data + position;
+            position += count;
+            return bytes;
+        }
+
+        bool has_overflown() const {
+            return overflow;
+        }
+
+    private:
+        const std::uint8_t* data;
+        std::size_t size;
+        std::size_t position = 0;
+        std::uint32_t bit_buffer = 0;
+        int bit_count = 0;
+        bool overflow = false;
+    };
+
+    // Canonical Huffman code: the number of codes of every length and the symbols ordered by code.
+    struct Huffman {
+        std::uint16_t counts[MAX_CODE_LENGTH + 1];
+        std::uint16_t symbols[288];
+    };
+
+    // False for lengths that give more codes than fit; incomplete codes are allowed (as deflate
+    // allows a single distance code), their missing codes fail decode_symbol.
+    bool build_huffman(Huffman& huffman, const std::uint8_t* lengths, int number_of_symbols) {
+        std::fill(std::begin(huffman.counts), std::end(huffman.counts), std::uint16_t{0});
+
+        for (int symbol = 0; symbol < number_of_symbols; symbol++) {
+            huffman.counts[lengths[symbol]]++;
+        }
+
+        int left = 1;
+
+        for (int length = 1; length <= MAX_CODE_LENGTH; length++) {
+            left = (left << 1) - huffman.counts[length];
+
+            if (left < 0) {
+                return false;
+            }
+        }
+
+        std::uint16_t offsets[MAX_CODE_LENGTH + 1];
+        offsets[1] = 0;
+
+        for (int length = 1; length < MAX_CODE_LENGTH; length++) {
+            offsets[length + 1] = static_cast<std::uint16_t>(offsets[length] + huffman.counts[length]);
+        }
+
+        for (int symbol = 0; symbol < number_of_symbols; symbol++) {
+            if (lengths[symbol] != 0) {
+                huffman.symbols[offsets[lengths[symbol]]++] = static_cast<std::uint16_t>(symbol);
+            }
+        }
+
+        return true;
+    }
+
+    // -1 for a code that is not in the table.
+    int decode_symbol(BitReader& reader, const Huffman& huffman) {
+        int code = 0;
+        int first = 0;
+        int index = 0;
+
+        for (int length = 1; length <= MAX_CODE_LENGTH; length++) {
+            code |= static_cast<int>(reader.get_bits(1));
+            int count = huffman.counts[length];
+
+            if (code - first < count) {
+                return huffman.symbols[index + code - first];
+            }
+
+            index += count;
+            first = (first + count) << 1;
+            code <<= 1;
+        }
+
+        return -1;
+    }
+
+    bool inflate_block(BitReader& reader, const Huffman& lengths, const Huffman& distances,
+                       std::vector<std::uint8_t>& out, std::size_t max_size) {
+        while (true) {
+            int symbol = decode_symbol(reader, lengths);
+
+            if (symbol < 0 || reader.has_overflown()) {
+                return false;
+            }
+
+            if (symbol < 256) {
+                if (out.size() >= max_size) {
+                    return false;
+                }
+
+                out.push_back(static_cast<std::uint8_t>(symbol));
+                continue;
+            }
+
+            if (symbol == 256) {
+                return true;
+            }
+
+            symbol -= 257;
+
+            if (symbol >= 29) {
+                return false;
+            }
+
+            std::size_t length = LENGTH_BASES[symbol] + reader.get_bits(LENGTH_EXTRA_BITS[symbol]);
+            int distance_symbol = decode_symbol(reader, distances);
+
+            if (distance_symbol < 0 || distance_symbol >= 30) {
+                return false;
+            }
+
+            std::size_t distance = DISTANCE_BASES[distance_symbol] + reader.get_bits(DISTANCE_EXTRA_BITS[distance_symbol]);
+
+            if (reader.has_overflown() || distance > out.size() || length > max_size - out.size()) {
+                return false;
+            }
+
+            // Byte by byte, the copy may overlap what it writes
+            std::size_t from = out.size() - distance;
+
+            for (std::size_t i = 0; i < length; i++) {
+                out.push_back(out[from + i]);
+            }
+        }
+    }
+
+    bool read_dynamic_codes(BitReader& reader, Huffman& lengths, Huffman& distances) {
+        int number_of_lengths = static_cast<int>(reader.get_bits(5)) + 257;
+        int number_of_distances = static_cast<int>(reader.get_bits(5)) + 1;
+        int number_of_code_lengths = static_cast<int>(reader.get_bits(4)) + 4;
+
+        if (number_of_lengths > 286 || number_of_distances > 30) {
+            return false;
+        }
+
+        std::uint8_t code_lengths[19] = {};
+
+        for (int i = 0; i < number_of_code_lengths; i++) {
+            code_lengths[CODE_LENGTH_ORDER[i]] = static_cast<std::uint8_t>(reader.get_bits(3));
+        }
+
+        Huffman code_length_code;
+
+        if (!build_huffman(code_length_code, code_lengths, 19)) {
+            return false;
+        }
+
+        std::uint8_t symbol_lengths[286 + 30] = {};
+        int count = 0;
+
+        while (count < number_of_lengths + number_of_distances) {
+            int symbol = decode_symbol(reader, code_length_code);
+
+            if (symbol < 0 || reader.has_overflown()) {
+                return false;
+            }
+
+            if (symbol < 16) {
+                symbol_lengths[count++] = static_cast<std::uint8_t>(symbol);
+                continue;
+            }
+
+            std::uint8_t length = 0;
+            int repeat;
+
+            if (symbol == 16) {
+                if (count == 0) {
+                    return false;
+                }
+
+                length = symbol_lengths[count - 1];
+                repeat = 3 + static_cast<int>(reader.get_bits(2));
+            }
+            else if (symbol == 17) {
+                repeat = 3 + static_cast<int>(reader.get_bits(3));
+            }
+            else {
+                repeat = 11 + static_cast<int>(reader.get_bits(7));
+            }
+
+            if (count + repeat > number_of_lengths + number_of_distances) {
+                return false;
+            }
+
+            std::fill(symbol_lengths + count, symbol_lengths + count + repeat, length);
+            count += repeat;
+        }
+
+        // Without an end of block code no block could end
+        return symbol_lengths[256] != 0 &&
+               build_huffman(lengths, symbol_lengths, number_of_lengths) &&
+               build_huffman(distances, symbol_lengths + number_of_lengths, number_of_distances);
+    }
+
+    // zlib stream (RFC 1950 around RFC 1951) of at most max_size bytes.
+    bool inflate_zlib(const std::uint8_t* data, std::size_t size, std::vector<std::uint8_t>& out, std::size_t max_size) {
+        if (size < 6 || (data[0] & 0x0F) != 8 || (data[0] >> 4) > 7 || ((data[0] << 8) | data[1]) % 31 != 0 || (data[1] & 0x20) != 0) {
+            return false;
+        }
+
+        static const std::pair<Huffman, Huffman> fixed_codes = [] {
+            std::uint8_t lengths[288 + 30];
+            std::fill(lengths, lengths + 144, std::uint8_t{8});
+            std::fill(lengths + 144, lengths + 256, std::uint8_t{9});
+            std::fill(lengths + 256, lengths + 280, std::uint8_t{7});
+            std::fill(lengths + 280, lengths + 288, std::uint8_t{8});
+            std::fill(lengths + 288, lengths + 318, std::uint8_t{5});
+
+            std::pair<Huffman, Huffman> codes;
+            build_huffman(codes.first, lengths, 288);
+            build_huffman(codes.second, lengths + 288, 30);
+            return codes;
+        }();
+
+        BitReader reader(data + 2, size - 2);
+        out.clear();
+        out.reserve(max_size);
+        bool last = false;
+
+        while (!last) {
+            last = reader.get_bits(1) != 0;
+            std::uint32_t type = reader.get_bits(2);
+
+            if (type == 0) {
+                reader.align();
+                const std::uint8_t* header = reader.get_bytes(4);
+
+                if (header == nullptr) {
+                    return false;
+                }
+
+                std::size_t length = header[0] | (header[1] << 8);
+                std::size_t complement = header[2] | (header[3] << 8);
+                const std::uint8_t* bytes = reader.get_bytes(length);
+
+                if (length != (~complement & 0xFFFF) || bytes == nullptr || length > max_size - out.size()) {
+                    return false;
+                }
+
+                out.insert(out.end(), bytes, bytes + length);
+            }
+            else if (type == 1) {
+                if (!inflate_block(reader, fixed_codes.first, fixed_codes.second, out, max_size)) {
+                    return false;
+                }
+            }
+            else if (type == 2) {
+                Huffman lengths;
+                Huffman distances;
+
+                if (!read_dynamic_codes(reader, lengths, distances) || !inflate_block(reader, lengths, distances, out, max_size)) {
+                    return false;
+                }
+            }
+            else {
+                return false;
+            }
+
+            if (reader.has_overflown()) {
+                return false;
+            }
+        }
+
+        reader.align();
+        const std::uint8_t* checksum = reader.get_bytes(4);
+        return checksum != nullptr && read_big_endian(checksum) == get_adler32(out.data(), out.size());
+    }
+
+    std::uint8_t get_paeth(std::uint8_t left, std::uint8_t up, std::uint8_t up_left) {
+        int estimate = left + up - up_left;
+        int to_left = std::abs(estimate - left);
+        int to_up = std::abs(estimate - up);
+        int to_up_left = std::abs(estimate - up_left);
+
+        if (to_left <= to_up && to_left <= to_up_left) {
+            return left;
+        }
+
+        return to_up <= to_up_left ? up : up_left;
+    }
+
+    // Undoes the filters in place; every row starts with its filter type.
+    bool unfilter(std::vector<std::uint8_t>& data, std::size_t row_bytes, std::size_t texel_bytes, std::uint32_t height) {
+        const std::uint8_t* previous = nullptr;
+
+        for (std::uint32_t y = 0; y < height; y++) {
+            std::uint8_t* row = data.data() + y * (row_bytes + 1) + 1;
+            std::uint8_t filter = row[-1];
+
+            for (std::size_t i = 0; i < row_bytes; i++) {
+                std::uint8_t left = i >= texel_bytes ? row[i - texel_bytes] : 0;
+                std::uint8_t up = previous != nullptr ? previous[i] : 0;
+                std::uint8_t up_left = previous != nullptr && i >= texel_bytes ? previous[i - texel_bytes] : 0;
+
+                switch (filter) {
+                    case 0:
+                        break;
+                    case 1:
+                        row[i] = static_cast<std::uint8_t>(row[i] + left);
+                        break;
+                    case 2:
+                        row[i] = static_cast<std::uint8_t>(row[i] + up);
+                        break;
+                    case 3:
+                        row[i] = static_cast<std::uint8_t>(row[i] + (left + up) / 2);
+                        break;
+                    case 4:
+                        row[i] = static_cast<std::uint8_t>(row[i] + get_paeth(left, up, up_left));
+                        break;
+                    default:
+                        return false;
+                }
+            }
+
+            previous = row;
+        }
+
+        return true;
+    }
+
+    struct Rgba {
+        int channels[4];
+    };
+
+    Rgba get_texel(const Image& image, std::uint32_t x, std::uint32_t y) {
+        const std::uint8_t* texel = image.pixels.data() + (static_cast<std::size_t>(std::min(y, image.height - 1)) * image.width +
+                                                           std::min(x, image.width - 1)) * 4;
+        return {{texel[0], texel[1], texel[2], texel[3]}};
+    }
+
+    std::uint16_t pack_565(const int* color) {
+        return static_cast<std::uint16_t>(((color[0] * 31 + 127) / 255) << 11 | ((color[1] * 63 + 127) / 255) << 5 | ((color[2] * 31 + 127) / 255));
+    }
+
+    Rgba unpack_565(std::uint16_t color) {
+        int r = (color >> 11) & 31;
+        int g = (color >> 5) & 63;
+        int b = color & 31;
+        return {{(r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2), 255}};
+    }
+
+    Rgba mix(const Rgba& a, const Rgba& b, int weight_a, int weight_b) {
+        Rgba result;
+
+        for (int channel = 0; channel < 4; channel++) {
+            result.channels[channel] = (a.channels[channel] * weight_a + b.channels[channel] * weight_b) / (weight_a + weight_b);
+        }
+
+        return result;
+    }
+
+    void put_le(std::uint8_t* out, std::uint64_t value, int bytes) {
+        for (int i = 0; i < bytes; i++) {
+            out[i] = static_cast<std::uint8_t>(value >> (8 * i));
+        }
+    }
+
+    std::uint64_t get_le(const std::uint8_t* data, int bytes) {
+        std::uint64_t value = 0;
+
+        for (int i = 0; i < bytes; i++) {
+            value |= static_cast<std::uint64_t>(data[i]) << (8 * i);
+        }
+
+        return value;
+    }
+
+    // Endpoints from the bounding box of the colors, inset by 1/16 of it, and the nearest
+    // of the four palette colors per texel. c0 > c1 keeps BC1 in its four color mode.
+    void encode_color_block(const Rgba (&texels)[16], std::uint8_t* out) {
+        int low[3] = {255, 255, 255};
+        int high[3] = {0, 0, 0};
+
+        for (const Rgba& texel : texels) {
+            for (int channel = 0; channel < 3; channel++) {
+                low[channel] = std::min(low[channel], texel.channels[channel]);
+                high[channel] = std::max(high[channel], texel.channels[channel]);
+            }
+        }
+
+        for (int channel = 0; channel < 3; channel++) {
+            int inset = (high[channel] - low[channel]) / 16;
+            low[channel] += inset;
+            high[channel] -= inset;
+        }
+
+        std::uint16_t color0 = pack_565(high);
+        std::uint16_t color1 = pack_565(low);
+
+        if (color0 < color1) {
+            std::swap(color0, color1);
+        }
+
+        std::uint32_t indices = 0;
+
+        if (color0 != color1) {
+            Rgba palette[4];
+            palette[0] = unpack_565(color0);
+            palette[1] = unpack_565(color1);
+            palette[2] = mix(palette[0], palette[1], 2, 1);
+            palette[3] = mix(palette[0], palette[1], 1, 2);
+
+            for (int i = 0; i < 16; i++) {
+                int best = 0;
+                int best_distance = -1;
+
+                for (int entry = 0; entry < 4; entry++) {
+                    int distance = 0;
+
+                    for (int channel = 0; channel < 3; channel++) {
+                        int difference = texels[i].channels[channel] - palette[entry].channels[channel];
+                        distance += difference * difference;
+                    }
+
+                    if (best_distance < 0 || distance < best_distance) {
+                        best = entry;
+                        best_distance = distance;
+                    }
+                }
+
+                indices |= static_cast<std::uint32_t>(best) << (2 * i);
+            }
+        }
+
+        put_le(out, color0, 2);
+        put_le(out + 2, color1, 2);
+        put_le(out + 4, indices, 4);
+    }
+
+    // Alpha from the lowest to the highest in the mode with eight interpolated values.
+    void encode_alpha_block(const Rgba (&texels)[16], std::uint8_t* out) {
+        int low = 255;
+        int high = 0;
+
+        for (const Rgba& texel : texels) {
+            low = std::min(low, texel.channels[3]);
+            high = std::max(high, texel.channels[3]);
+        }
+
+        std::uint64_t indices = 0;
+
+        if (high != low) {
+            int palette[8] = {high, low};
+
+            for (int i = 1; i < 7; i++) {
+                palette[i + 1] = ((7 - i) * high + i * low) / 7;
+            }
+
+            for (int i = 0; i < 16; i++) {
+                int best = 0;
+
+                for (int entry = 1; entry < 8; entry++) {
+                    if (std::abs(texels[i].channels[3] - palette[entry]) < std::abs(texels[i].channels[3] - palette[best])) {
+                        best = entry;
+                    }
+                }
+
+                indices |= static_cast<std::uint64_t>(best) << (3 * i);
+            }
+        }
+
+        out[0] = static_cast<std::uint8_t>(high);
+        out[1] = static_cast<std::uint8_t>(low);
+        put_le(out + 2, indices, 6);
+    }
+
+    void decode_color_block(const std::uint8_t* data, bool always_four_colors, Rgba (&texels)[16]) {
+        auto color0 = static_cast<std::uint16_t>(get_le(data, 2));
+        auto color1 = static_cast<std::uint16_t>(get_le(data + 2, 2));
+        auto indices = static_cast<std::uint32_t>(get_le(data + 4, 4));
+
+        Rgba palette[4];
+        palette[0] = unpack_565(color0);
+        palette[1] = unpack_565(color1);
+
+        if (color0 > color1 || always_four_colors) {
+            palette[2] = mix(palette[0], palette[1], 2, 1);
+            palette[3] = mix(palette[0], palette[1], 1, 2);
+        }
+        else {
+            palette[2] = mix(palette[0], palette[1], 1, 1);
+            palette[3] = {{0, 0, 0, 0}};
+        }
+
+        for (int i = 0; i < 16; i++) {
+            texels[i] = palette[(indices >> (2 * i)) & 3];
+        }
+    }
+
+    void decode_alpha_block(const std::uint8_t* data, Rgba (&texels)[16]) {
+        int palette[8] = {data[0], data[1]};
+        std::uint64_t indices = get_le(data + 2, 6);
+
+        if (palette[0] > palette[1]) {
+            for (int i = 1; i < 7; i++) {
+                palette[i + 1] = ((7 - i) * palette[0] + i * palette[1]) / 7;
+            }
+        }
+        else {
+            for (int i = 1; i < 5; i++) {
+                palette[i + 1] = ((5 - i) * palette[0] + i * palette[1]) / 5;
+            }
+
+            palette[6] = 0;
+            palette[7] = 255;
+        }
+
+        for (int i = 0; i < 16; i++) {
+            texels[i].channels[3] = palette[(indices >> (3 * i)) & 7];
+        }
+    }
+
+    std::size_t get_block_bytes(BlockFormat format) {
+        return format == BlockFormat::BC1 ? BC1_BLOCK_BYTES : BC3_BLOCK_BYTES;
+    }
+
+    std::size_t get_blocks_size(std::uint32_t width, std::uint32_t height, BlockFormat format) {
+        return static_cast<std::size_t>((width + 3) / 4) * ((height + 3) / 4) * get_block_bytes(format);
+    }
+}
+
+HRESULT decode_png(const std::uint8_t* data, std::size_t size, Image& image) {
+    if (size < sizeof(PNG_SIGNATURE) || std::memcmp(data, PNG_SIGNATURE, sizeof(PNG_SIGNATURE)) != 0) {
+        return E_FAIL;
+    }
+
+    std::uint32_t width = 0;
+    std::uint32_t height = 0;
+    int bit_depth = 0;
+    int color_type = -1;
+    std::vector<std::uint8_t> compressed;
+    std::uint8_t palette[256][4] = {};
+    std::size_t palette_size = 0;
+    bool has_color_key = false;
+    std::uint16_t color_key[3] = {};
+    bool ended = false;
+
+    std::size_t position = sizeof(PNG_SIGNATURE);
+
+    while (!ended) {
+        if (size - position < 12) {
+            return E_FAIL;
+        }
+
+        std::uint32_t length = read_big_endian(data + position);
+
+        if (length > size - position - 12) {
+            return E_FAIL;
+        }
+
+        const std::uint8_t* type = data + position + 4;
+        const std::uint8_t* chunk = type + 4;
+
+        if (read_big_endian(chunk + length) != get_crc32(type, length + 4)) {
+            return E_FAIL;
+        }
+
+        position += length + 12;
+
+        if (std::memcmp(type, "IHDR", 4) == 0) {
+            if (length != 13 || chunk[10] != 0 || chunk[11] != 0 || chunk[12] != 0) {
+                return E_FAIL;
+            }
+
+            width = read_big_endian(chunk);
+            height = read_big_endian(chunk + 4);
+            bit_depth = chunk[8];
+            color_type = chunk[9];
+        }
+        else if (std::memcmp(type, "PLTE", 4) == 0) {
+            if (length % 3 != 0 || length > 3 * 256) {
+                return E_FAIL;
+            }
+
+            palette_size = length / 3;
+
+            for (std::size_t i = 0; i < palette_size; i++) {
+                palette[i][0] = chunk[3 * i];
+                palette[i][1] = chunk[3 * i + 1];
+                palette[i][2] = chunk[3 * i + 2];
+                palette[i][3] = 255;
+            }
+        }
+        else if (std::memcmp(type, "tRNS", 4) == 0) {
+            if (color_type == 3) {
+                for (std::size_t i = 0; i < std::min<std::size_t>(length, 256); i++) {
+                    palette[i][3] = chunk[i];
+                }
+            }
+            else if ((color_type == 0 && length == 2) || (color_type == 2 && length == 6)) {
+                has_color_key = true;
+
+                for (std::uint32_t i = 0; i < length / 2; i++) {
+                    color_key[i] = static_cast<std::uint16_t>((chunk[2 * i] << 8) | chunk[2 * i + 1]);
+                }
+            }
+        }
+        else if (std::memcmp(type, "IDAT", 4) == 0) {
+            compressed.insert(compressed.end(), chunk, chunk + length);
+        }
+        else if (std::memcmp(type, "IEND", 4) == 0) {
+            ended = true;
+        }
+        else if ((type[0] & 0x20) == 0) {
+            // An unknown critical chunk
+            return E_FAIL;
+        }
+    }
+
+    int channels;
+
+    switch (color_type) {
+        case 0: channels = 1; break;
+        case 2: channels = 3; break;
+        case 3: channels = 1; break;
+        case 4: channels = 2; break;
+        case 6: channels = 4; break;
+        default: return E_FAIL;
+    }
+
+    bool supported_depth = color_type == 3 ? bit_depth == 8 && palette_size > 0 : bit_depth == 8 || bit_depth == 16;
+
+    if (!supported_depth || width == 0 || height == 0 || static_cast<std::uint64_t>(width) * height > MAX_TEXELS) {
+        return E_FAIL;
+    }
+
+    std::size_t sample_bytes = static_cast<std::size_t>(bit_depth / 8);
+    std::size_t texel_bytes = channels * sample_bytes;
+    std::size_t row_bytes = texel_bytes * width;
+    std::size_t filtered_size = (row_bytes + 1) * height;
+    std::vector<std::uint8_t> filtered;
+
+    if (!inflate_zlib(compressed.data(), compressed.size(), filtered, filtered_size) || filtered.size() != filtered_size ||
+        !unfilter(filtered, row_bytes, texel_bytes, height)) {
+        return E_FAIL;
+    }
+
+    image.width = width;
+    image.height = height;
+    image.pixels.resize(static_cast<std::size_t>(width) * height * 4);
+
+    for (std::uint32_t y = 0; y < height; y++) {
+        const std::uint8_t* row = filtered.data() + y * (row_bytes + 1) + 1;
+
+        for (std::uint32_t x = 0; x < width; x++) {
+            const std::uint8_t* texel = row + x * texel_bytes;
+            std::uint8_t* out = image.pixels.data() + (static_cast<std::size_t>(y) * width + x) * 4;
+            std::uint16_t samples[4];
+
+            for (int channel = 0; channel < channels; channel++) {
+                const std::uint8_t* sample = texel + channel * sample_bytes;
+                samples[channel] = sample_bytes == 2 ? static_cast<std::uint16_t>((sample[0] << 8) | sample[1]) : sample[0];
+            }
+
+            // The high byte of 16 bit samples
+            auto to_byte = [sample_bytes](std::uint16_t sample) {
+                return static_cast<std::uint8_t>(sample_bytes == 2 ? sample >> 8 : sample);
+            };
+
+            switch (color_type) {
+                case 0:
+                    out[0] = out[1] = out[2] = to_byte(samples[0]);
+                    out[3] = has_color_key && samples[0] == color_key[0] ? 0 : 255;
+                    break;
+                case 2:
+                    out[0] = to_byte(samples[0]);
+                    out[1] = to_byte(samples[1]);
+                    out[2] = to_byte(samples[2]);
+                    out[3] = has_color_key && samples[0] == color_key[0] && samples[1] == color_key[1] && samples[2] == color_key[2] ? 0 : 255;
+                    break;
+                case 3:
+                    if (samples[0] >= palette_size) {
+                        return E_FAIL;
+                    }
+
+                    std::memcpy(out, palette[samples[0]], 4);
+                    break;
+                case 4:
+                    out[0] = out[1] = out[2] = to_byte(samples[0]);
+                    out[3] = to_byte(samples[1]);
+                    break;
+                default:
+                    for (int channel = 0; channel < 4; channel++) {
+                        out[channel] = to_byte(samples[channel]);
+                    }
+                    break;
+            }
+        }
+    }
+
+    return S_OK;
+}
+
+std::vector<Image> generate_mips(const Image& image) {
+    std::vector<Image> mips;
+    mips.push_back(image);
+
+    while (mips.back().width > 1 || mips.back().height > 1) {
+        const Image& source = mips.back();
+        Image level;
+        level.width = std::max(source.width / 2, 1u);
+        level.height = std::max(source.height / 2, 1u);
+        level.pixels.resize(static_cast<std::size_t>(level.width) * level.height * 4);
+
+        for (std::uint32_t y = 0; y < level.height; y++) {
+            std::uint32_t first_row = static_cast<std::uint32_t>(static_cast<std::uint64_t>(y) * source.height / level.height);
+            std::uint32_t end_row = static_cast<std::uint32_t>(static_cast<std::uint64_t>(y + 1) * source.height / level.height);
+
+            for (std::uint32_t x = 0; x < level.width; x++) {
+                std::uint32_t first_column = static_cast<std::uint32_t>(static_cast<std::uint64_t>(x) * source.width / level.width);
+                std::uint32_t end_column = static_cast<std::uint32_t>(static_cast<std::uint64_t>(x + 1) * source.width / level.width);
+                std::uint32_t sums[4] = {};
+
+                for (std::uint32_t row = first_row; row < end_row; row++) {
+                    const std::uint8_t* texel = source.pixels.data() + (static_cast<std::size_t>(row) * source.width + first_column) * 4;
+
+                    for (std::uint32_t column = first_column; column < end_column; column++, texel += 4) {
+                        for (int channel = 0; channel < 4; channel++) {
+                            sums[channel] += texel[channel];
+                        }
+                    }
+                }
+
+                std::uint32_t count = (end_row - first_row) * (end_column - first_column);
+                std::uint8_t* out = level.pixels.data() + (static_cast<std::size_t>(y) * level.width + x) * 4;
+
+                for (int channel = 0; channel < 4; channel++) {
+                    out[channel] = static_cast<std::uint8_t>((sums[channel] + count / 2) / count);
+                }
+            }
+        }
+
+        mips.push_back(std::move(level));
+    }
+
+    return mips;
+}
+
+BlockFormat choose_block_format(const Image& image) {
+    for (std::size_t i = 3; i < image.pixels.size(); i += 4) {
+        if (image.pixels[i] != 255) {
+            return BlockFormat::BC3;
+        }
+    }
+
+    return BlockFormat::BC1;
+}
+
+std::vector<std::uint8_t> encode_blocks(const Image& image, BlockFormat format) {
+    std::vector<std::uint8_t> blocks(get_blocks_size(image.width, image.height, format));
+    std::uint8_t* out = blocks.data();
+
+    for (std::uint32_t y = 0; y < image.height; y += 4) {
+        for (std::uint32_t x = 0; x < image.width; x += 4) {
+            Rgba texels[16];
+
+            for (std::uint32_t i = 0; i < 16; i++) {
+                texels[i] = get_texel(image, x + i % 4, y + i / 4);
+            }
+
+            if (format == BlockFormat::BC3) {
+                encode_alpha_block(texels, out);
+                out += 8;
+            }
+
+            encode_color_block(texels, out);
+            out += 8;
+        }
+    }
+
+    return blocks;
+}
+
+HRESULT decode_blocks(const std::uint8_t* data, std::size_t size, BlockFormat format,
+                      std::uint32_t width, std::uint32_t height, Image& image) {
+    if (width == 0 || height == 0 || size < get_blocks_size(width, height, format)) {
+        return E_INVALIDARG;
+    }
+
+    image.width = width;
+    image.height = height;
+    image.pixels.assign(static_cast<std::size_t>(width) * height * 4, 0);
+
+    for (std::uint32_t y = 0; y < height; y += 4) {
+        for (std::uint32_t x = 0; x < width; x += 4) {
+            Rgba texels[16];
+
+            if (format == BlockFormat::BC3) {
+                decode_color_block(data + 8, true, texels);
+                decode_alpha_block(data, texels);
+            }
+            else {
+                decode_color_block(data, false, texels);
+            }
+
+            data += get_block_bytes(format);
+
+            for (std::uint32_t i = 0; i < 16; i++) {
+                if (x + i % 4 < width && y + i / 4 < height) {
+                    std::uint8_t* out = image.pixels.data() + (static_cast<std::size_t>(y + i / 4) * width + x + i % 4) * 4;
+
+                    for (int channel = 0; channel < 4; channel++) {
+                        out[channel] = static_cast<std::uint8_t>(texels[i].channels[channel]);
+                    }
+                }
+            }
+        }
+    }
+
+    return S_OK;
+}
+
+std::vector<std::uint8_t> write_dds(const std::vector<Image>& mips, BlockFormat format) {
+    // Magic and the 124 byte header with its 32 byte pixel format
+    constexpr std::size_t HEADER_BYTES = 4 + 124;
+
+    std::vector<std::uint8_t> dds(HEADER_BYTES, 0);
+    std::uint8_t* header = dds.data();
+    std::uint32_t width = mips.empty() ? 0 : mips[0].width;
+    std::uint32_t height = mips.empty() ? 0 : mips[0].height;
+
+    put_le(header, DDS_MAGIC, 4);
+    put_le(header + 4, 124, 4);
+    put_le(header + 8, DDS_HEADER_FLAGS, 4);
+    put_le(header + 12, height, 4);
+    put_le(header + 16, width, 4);
+    put_le(header + 20, get_blocks_size(width, height, format), 4);
+    put_le(header + 28, mips.size(), 4);
+    put_le(header + 76, 32, 4);
+    put_le(header + 80, DDPF_FOURCC, 4);
+    put_le(header + 84, format == BlockFormat::BC1 ? FOURCC_DXT1 : FOURCC_DXT5, 4);
+    put_le(header + 108, DDSCAPS_TEXTURE | (mips.size() > 1 ? DDSCAPS_COMPLEX | DDSCAPS_MIPMAP : 0), 4);
+
+    for (const Image& level : mips) {
+        std::vector<std::uint8_t> blocks = encode_blocks(level, format);
+        dds.insert(dds.end(), blocks.begin(), blocks.end());
+    }
+
+    return dds;
+}
@@ -0,0 +1,52 @@
+#ifndef PROJECT3D_TEXTURE_CODEC_H
+#define PROJECT3D_TEXTURE_CODEC_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "hresult.h"
+
+// Textures for cooked assets, without the Windows Imaging Component the
+// application decodes with: PNG files are decoded, a mip chain generated and
+// every level compressed into 4x4 blocks, BC1 (DXT1) for opaque textures and
+// BC3 (DXT5) for ones with alpha, written as a DDS file Direct3D loads as is.
+// The block encoder takes the endpoints from the bounding box of the block's
+// colors, inset a little, and picks the nearest palette entry per texel:
+// fast and good enough for photographs, worse than a real compressor on
+// gradients and sharp edges.
+struct Image {
+    std::uint32_t width = 0;
+    std::uint32_t height = 0;
+
+    // RGBA, 4 bytes per texel, rows from the top
+    std::vector<std::uint8_t> pixels;
+};
+
+enum class BlockFormat {
+    BC1,
+    BC3
+};
+
+// Gray, gray with alpha, RGB, RGBA (8 or 16 bits per sample) and palette (8 bits per index)
+// PNG files, with tRNS transparency, not interlaced. E_FAIL for anything else and for
+// damaged files (checksums are verified).
+HRESULT decode_png(const std::uint8_t* data, std::size_t size, Image& image);
+
+// The image and every next level at half the size (at least 1), down to 1x1. A texel of
+// a level is the average of the 2x2 texels below it, the last row and column of odd sizes
+// are averaged into the ones before.
+std::vector<Image> generate_mips(const Image& image);
+
+// BC1 when every texel is opaque.
+BlockFormat choose_block_format(const Image& image);
+
+// Rows of blocks from the top; blocks over the edge of the image repeat its last texels.
+std::vector<std::uint8_t> encode_blocks(const Image& image, BlockFormat format);
+HRESULT decode_blocks(const std::uint8_t* data, std::size_t size, BlockFormat format,
+                      std::uint32_t width, std::uint32_t height, Image& image);
+
+// All levels, with the legacy header (FourCC DXT1 / DXT5).
+std::vector<std::uint8_t> write_dds(const std::vector<Image>& mips, BlockFormat format);
+
+#endif //PROJECT3D_TEXTURE_CODEC_H
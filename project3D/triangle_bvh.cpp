@@ -0,0 +1,586 @@
+#include "triangle_bvh.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace {
+    constexpr int BIN_COUNT = 12;
+
+    // Relative cost of visiting a node compared to testing a triangle
+    constexpr float TRAVERSAL_COST = 1.0f;
+
+    // Leaves are never made larger than this, even when SAH would prefer it.
+    constexpr std::uint32_t MAX_FORCED_LEAF_SIZE = 16;
+
+    // Bounds the traversal stack, deeper ranges become (large) leaves.
+    constexpr std::uint32_t MAX_DEPTH = 64;
+
+    float get_surface_area(const Aabb& box) {
+        if (box.empty()) {
+            return 0.0f;
+        }
+
+        float x = box.max.x - box.min.x;
+        float y = box.max.y - box.min.y;
+        float z = box.max.z - box.min.z;
+
+        return 2.0f * (x * y + y * z + z * x);
+    }
+
+    float get_axis(const DirectX::XMFLOAT3& point, int axis) {
+        return axis == 0 ? point.x : (axis == 1 ? point.y : point.z);
+    }
+
+    struct Bin {
+        Aabb bounds;
+        std::uint32_t count = 0;
+    };
+
+    struct BuildTask {
+        std::uint32_t node;
+        std::uint32_t begin;
+        std::uint32_t end;
+        std::uint32_t depth;
+    };
+
+    struct TraversalEntry {
+        std::uint32_t node;
+        float distance;
+    };
+
+    // Finite even for axis aligned rays, so a ray lying in a box face does not produce 0 * inf.
+    DirectX::XMFLOAT3 get_inverse_direction(const Ray& ray) {
+        auto inverse = [](float x) {
+            return 1.0f / (std::fabs(x) > 1e-12f ? x : std::copysign(1e-12f, x));
+        };
+
+        return {inverse(ray.direction.x), inverse(ray.direction.y), inverse(ray.direction.z)};
+    }
+
+    // Slab test, returns the entry distance or FLT_MAX when the box is missed or starts beyond max_distance.
+    float intersect_box(const Aabb& box, const DirectX::XMFLOAT3& origin, const DirectX::XMFLOAT3& inverse_direction, float max_distance) {
+        float tx0 = (box.min.x - origin.x) * inverse_direction.x;
+        float tx1 = (box.max.x - origin.x) * inverse_direction.x;
+        float ty0 = (box.min.y - origin.y) * inverse_direction.y;
+        float ty1 = (box.max.y - origin.y) * inverse_direction.y;
+        float tz0 = (box.min.z - origin.z) * inverse_direction.z;
+        float tz1 = (box.max.z - origin.z) * inverse_direction.z;
+
+        float t_enter = std::max({std::min(tx0, tx1), std::min(ty0, ty1), std::min(tz0, tz1), 0.0f});
+        float t_exit = std::min({std::max(tx0, tx1), std::max(ty0, ty1), std::max(tz0, tz1), max_distance});
+
+        return t_enter <= t_exit ? t_enter : FLT_MAX;
+    }
+
+    // Moller-Trumbore, culls neither side.
+    bool intersect_triangle(const BvhTriangle& triangle, const DirectX::XMFLOAT3& origin, const DirectX::XMFLOAT3& direction,
+                            float& distance, float& u, float& v) {
+        constexpr float EPSILON = 1e-12f;
+
+        DirectX::XMFLOAT3 edge1 = {triangle.b.x - triangle.a.x, triangle.b.y - triangle.a.y, triangle.b.z - triangle.a.z};
+        DirectX::XMFLOAT3 edge2 = {triangle.c.x - triangle.a.x, triangle.c.y - triangle.a.y, triangle.c.z - triangle.a.z};
+        DirectX::XMFLOAT3 p = {
+                direction.y * edge2.z - direction.z * edge2.y,
+                direction.z * edge2.x - direction.x * edge2.z,
+                direction.x * edge2.y - direction.y * edge2.x
+        };
+        float determinant = edge1.x * p.x + edge1.y * p.y + edge1.z * p.z;
+
+        if (std::fabs(determinant) < EPSILON) {
+            return false;
+        }
+
+        float inverse_determinant = 1.0f / determinant;
+        DirectX::XMFLOAT3 t = {origin.x - triangle.a.x, origin.y - triangle.a.y, origin.z - triangle.a.z};
+        u = (t.x * p.x + t.y * p.y + t.z * p.z) * inverse_determinant;
+
+        if (u < 0.0f || u > 1.0f) {
+            return false;
+        }
+
+        DirectX::XMFLOAT3 q = {t.y * edge1.z - t.z * edge1.y, t.z * edge1.x - t.x * edge1.z, t.x * edge1.y - t.y * edge1.x};
+        v = (direction.x * q.x + direction.y * q.y + direction.z * q.z) * inverse_determinant;
+
+        if (v < 0.0f || u + v > 1.0f) {
+            return false;
+        }
+
+        distance = (edge2.x * q.x + edge2.y * q.y + edge2.z * q.z) * inverse_determinant;
+        return distance >= 0.0f;
+    }
+}
+
+void TriangleBvh::build(const std::vector<Vertex>& vertices, std::vector<std::uint32_t> objects) {
+    std::vector<BvhTriangle> list;
+    list.reserve(vertices.size() / 3);
+
+    for (std::size_t i = 0; i + 2 < vertices.size(); i += 3) {
+        list.push_back({vertices[i].position, vertices[i + 1].position, vertices[i + 2].position});
+    }
+
+    build(std::move(list), std::move(objects));
+}
+
+void TriangleBvh::build(std::vector<BvhTriangle> list, std::vector<std::uint32_t> objects) {
+    std::size_t count = list.size();
+    std::vector<Aabb> triangle_bounds(count);
+    std::vector<DirectX::XMFLOAT3> centroids(count);
+    std::vector<std::uint32_t> order(count);
+
+    for (std::size_t i = 0; i < count; i++) {
+        triangle_bounds[i].merge(list[i].a);
+        triangle_bounds[i].merge(list[i].b);
+        triangle_bounds[i].merge(list[i].c);
+        centroids[i] = triangle_bounds[i].get_center();
+        order[i] = static_cast<std::uint32_t>(i);
+    }
+
+    nodes.clear();
+    nodes.reserve(count > 0 ? 2 * ((count + MAX_LEAF_SIZE - 1) / MAX_LEAF_SIZE) : 1);
+    nodes.push_back({{}, 0, static_cast<std::uint32_t>(count)});
+
+    std::vector<BuildTask> stack = {{0, 0, static_cast<std::uint32_t>(count), 1}};
+
+    while (!stack.empty()) {
+        BuildTask task = stack.back();
+        stack.pop_back();
+
+        Aabb bounds;
+        Aabb centroid_bounds;
+
+        for (std::uint32_t i = task.begin; i < task.end; i++) {
+            bounds.merge(triangle_bounds[order[i]]);
+            centroid_bounds.merge(centroids[order[i]]);
+        }
+
+        nodes[task.node] = {bounds, task.begin, task.end - task.begin};
+
+        std::uint32_t size = task.end - task.begin;
+
+        if (size <= MAX_LEAF_SIZE || task.depth >= MAX_DEPTH) {
+            continue;
+        }
+
+        // Binned SAH over all three axes, the split goes between two bins.
+        float best_cost = static_cast<float>(size);
+        int best_axis = -1;
+        int best_split = 0;
+
+        for (int axis = 0; axis < 3; axis++) {
+            float axis_min = get_axis(centroid_bounds.min, axis);
+            float axis_extent = get_axis(centroid_bounds.max, axis) - axis_min;
+
+            if (axis_extent <= 0.0f) {
+                continue;
+            }
+
+            Bin bins[BIN_COUNT];
+            float scale = BIN_COUNT / axis_extent;
+
+            for (std::uint32_t i = task.begin; i < task.end; i++) {
+                int bin = std::min(static_cast<int>((get_axis(centroids[order[i]], axis) - axis_min) * scale), BIN_COUNT - 1);
+                bins[bin].bounds.merge(triangle_bounds[order[i]]);
+                bins[bin].count++;
+            }
+
+            float right_area[BIN_COUNT] = {};
+            std::uint32_t right_count[BIN_COUNT] = {};
+            Aabb right;
+            std::uint32_t right_total = 0;
+
+            for (int bin = BIN_COUNT - 1; bin > 0; bin--) {
+                right.merge(bins[bin].bounds);
+                right_total += bins[bin].count;
+                right_area[bin] = get_surface_area(right);
+                right_count[bin] = right_total;
+            }
+
+            Aabb left;
+            std::uint32_t left_total = 0;
+            float parent_area = get_surface_area(bounds);
+
+            for (int split = 1; split < BIN_COUNT; split++) {
+                left.merge(bins[split - 1].bounds);
+                left_total += bins[split - 1].count;
+
+                if (left_total == 0 || right_count[split] == 0) {
+                    continue;
+                }
+
+                float cost = TRAVERSAL_COST +
+                             (get_surface_area(left) * static_cast<float>(left_total) +
+                              right_area[split] * static_cast<float>(right_count[split])) / parent_area;
+
+                if (cost < best_cost) {
+                    best_cost = cost;
+                    best_axis = axis;
+                    best_split = split;
+                }
+            }
+        }
+
+        std::uint32_t middle = task.begin;
+
+        if (best_axis >= 0) {
+            float axis_min = get_axis(centroid_bounds.min, best_axis);
+            float scale = BIN_COUNT / (get_axis(centroid_bounds.max, best_axis) - axis_min);
+
+            middle = static_cast<std::uint32_t>(std::partition(order.begin() + task.begin, order.begin() + task.end, [&](std::uint32_t triangle) {
+                int bin = std::min(static_cast<int>((get_axis(centroids[triangle], best_axis) - axis_min) * scale), BIN_COUNT - 1);
+                return bin < best_split;
+            }) - order.begin());
+        }
+        else if (size > MAX_FORCED_LEAF_SIZE) {
+            // Splitting does not pay off (or all centroids coincide), but the leaf would be too large.
+            middle = task.begin + size / 2;
+        }
+        else {
+            continue;
+        }
+
+        std::uint32_t left_child = static_cast<std::uint32_t>(nodes.size());
+        nodes.push_back({});
+        nodes.push_back({});
+        nodes[task.node].first = left_child;
+        nodes[task.node].count = 0;
+
+        stack.push_back({left_child + 1, middle, task.end, task.depth + 1});
+        stack.push_back({left_child, task.begin, middle, task.depth + 1});
+    }
+
+    triangles.resize(count);
+    triangle_indices = std::move(order);
+
+    for (std::size_t i = 0; i < count; i++) {
+        triangles[i] = list[triangle_indices[i]];
+    }
+
+    triangle_objects.clear();
+
+    if (objects.size() == count) {
+        triangle_objects.resize(count);
+
+        for (std::size_t i = 0; i < count; i++) {
+            triangle_objects[i] = objects[triangle_indices[i]];
+        }
+    }
+}
+
+std::size_t TriangleBvh::query(const Aabb& box, std::vector<std::uint32_t>& result) const {
+    if (triangles.empty()) {
+        return 0;
+    }
+
+    std::uint32_t stack[MAX_DEPTH];
+    int stack_size = 0;
+    std::uint32_t node_index = 0;
+    std::size_t visited = 0;
+
+    while (true) {
+        const Node& node = nodes[node_index];
+        visited++;
+
+        if (node.bounds.intersects(box)) {
+            if (node.count > 0) {
+                for (std::uint32_t i = node.first; i < node.first + node.count; i++) {
+                    const BvhTriangle& triangle = triangles[i];
+                    Aabb triangle_bounds;
+                    triangle_bounds.merge(triangle.a);
+                    triangle_bounds.merge(triangle.b);
+                    triangle_bounds.merge(triangle.c);
+
+                    if (triangle_bounds.intersects(box)) {
+                        result.push_back(i);
+                    }
+                }
+            }
+            else {
+                stack[stack_size++] = node.first + 1;
+                node_index = node.first;
+                continue;
+            }
+        }
+
+        if (stack_size == 0) {
+            break;
+        }
+
+        node_index = stack[--stack_size];
+    }
+
+    return visited;
+}
+
+bool TriangleBvh::intersect(const Ray& ray, RayHit& hit, float max_distance) const {
+    if (triangles.empty()) {
+        return false;
+    }
+
+    DirectX::XMFLOAT3 inverse_direction = get_inverse_direction(ray);
+    float closest = max_distance;
+    std::uint32_t closest_triangle = UINT32_MAX;
+    float closest_u = 0.0f;
+    float closest_v = 0.0f;
+
+    TraversalEntry stack[MAX_DEPTH];
+    int stack_size = 0;
+    std::uint32_t node_index = 0;
+
+    if (intersect_box(nodes[0].bounds, ray.origin, inverse_direction, closest) == FLT_MAX) {
+        return false;
+    }
+
+    while (true) {
+        const Node& node = nodes[node_index];
+
+        if (node.count > 0) {
+            for (std::uint32_t i = node.first; i < node.first + node.count; i++) {
+                float distance;
+                float u;
+                float v;
+
+                if (intersect_triangle(triangles[i], ray.origin, ray.direction, distance, u, v) && distance < closest) {
+                    closest = distance;
+                    closest_triangle = i;
+                    closest_u = u;
+                    closest_v = v;
+                }
+            }
+        }
+        else {
+            float left = intersect_box(nodes[node.first].bounds, ray.origin, inverse_direction, closest);
+            float right = intersect_box(nodes[node.first + 1].bounds, ray.origin, inverse_direction, closest);
+
+            if (left != FLT_MAX && right != FLT_MAX) {
+                bool left_first = left <= right;
+                stack[stack_size++] = {node.first + (left_first ? 1u : 0u), left_first ? right : left};
+                node_index = node.first + (left_first ? 0u : 1u);
+                continue;
+            }
+
+            if (left != FLT_MAX || right != FLT_MAX) {
+                node_index = node.first + (left != FLT_MAX ? 0u : 1u);
+                continue;
+            }
+        }
+
+        // Entries pushed before a closer hit was found may be behind it by now.
+        while (stack_size > 0 && stack[stack_size - 1].distance > closest) {
+            stack_size--;
+        }
+
+        if (stack_size == 0) {
+            break;
+        }
+
+        node_index = stack[--stack_size].node;
+    }
+
+    if (closest_triangle == UINT32_MAX) {
+        return false;
+    }
+
+    const BvhTriangle& triangle = triangles[closest_triangle];
+    float w = 1.0f - closest_u - closest_v;
+
+    hit.triangle = triangle_indices[closest_triangle];
+    hit.object = triangle_objects.empty() ? NO_OBJECT : triangle_objects[closest_triangle];
+    hit.distance = closest;
+    hit.u = closest_u;
+    hit.v = closest_v;
+    hit.position = {
+            w * triangle.a.x + closest_u * triangle.b.x + closest_v * triangle.c.x,
+            w * triangle.a.y + closest_u * triangle.b.y + closest_v * triangle.c.y,
+            w * triangle.a.z + closest_u * triangle.b.z + closest_v * triangle.c.z
+    };
+
+    return true;
+}
+
+bool TriangleBvh::occluded(const Ray& ray, float max_distance) const {
+    if (triangles.empty()) {
+        return false;
+    }
+
+    DirectX::XMFLOAT3 inverse_direction = get_inverse_direction(ray);
+    std::uint32_t stack[MAX_DEPTH];
+    int stack_size = 0;
+    std::uint32_t node_index = 0;
+
+    while (true) {
+        const Node& node = nodes[node_index];
+
+        if (intersect_box(node.bounds, ray.origin, inverse_direction, max_distance) != FLT_MAX) {
+            if (node.count > 0) {
+                for (std::uint32_t i = node.first; i < node.first + node.count; i++) {
+                    float distance;
+                    float u;
+                    float v;
+
+                    if (intersect_triangle(triangles[i], ray.origin, ray.direction, distance, u, v) && distance < max_distance) {
+                        return true;
+                    }
+                }
+            }
+            else {
+                stack[stack_size++] = node.first + 1;
+                node_index = node.first;
+                continue;
+            }
+        }
+
+        if (stack_size == 0) {
+            return false;
+        }
+
+        node_index = stack[--stack_size];
+    }
+}
+
+std::uint32_t TriangleBvh::occluded(const DirectX::XMFLOAT3& origin, const DirectX::XMFLOAT3* directions, std::uint32_t count,
+                                    float max_distance) const {
+    count = std::min(count, MAX_PACKET_SIZE);
+
+    if (triangles.empty() || count == 0) {
+        return 0;
+    }
+
+    alignas(32) float dx[MAX_PACKET_SIZE];
+    alignas(32) float dy[MAX_PACKET_SIZE];
+    alignas(32) float dz[MAX_PACKET_SIZE];
+    alignas(32) float ix[MAX_PACKET_SIZE];
+    alignas(32) float iy[MAX_PACKET_SIZE];
+    alignas(32) float iz[MAX_PACKET_SIZE];
+    alignas(32) std::uint32_t lane_bits[MAX_PACKET_SIZE];
+
+    for (std::uint32_t i = 0; i < count; i++) {
+        const DirectX::XMFLOAT3& direction = directions[i];
+        DirectX::XMFLOAT3 inverse_direction = get_inverse_direction({origin, direction});
+        lane_bits[i] = 1u << i;
+        dx[i] = direction.x;
+        dy[i] = direction.y;
+        dz[i] = direction.z;
+        ix[i] = inverse_direction.x;
+        iy[i] = inverse_direction.y;
+        iz[i] = inverse_direction.z;
+    }
+
+    std::uint32_t all = count == MAX_PACKET_SIZE ? UINT32_MAX : (1u << count) - 1;
+    std::uint32_t result = 0;
+    std::uint32_t stack[MAX_DEPTH];
+    int stack_size = 0;
+    std::uint32_t node_index = 0;
+
+    while (true) {
+        const Node& node = nodes[node_index];
+
+        // The origin is shared: nodes beyond max_distance from it are skipped before any per ray work, and
+        // nodes around it are entered by every ray.
+        float x0 = node.bounds.min.x - origin.x;
+        float x1 = node.bounds.max.x - origin.x;
+        float y0 = node.bounds.min.y - origin.y;
+        float y1 = node.bounds.max.y - origin.y;
+        float z0 = node.bounds.min.z - origin.z;
+        float z1 = node.bounds.max.z - origin.z;
+        float gap_x = std::max({x0, -x1, 0.0f});
+        float gap_y = std::max({y0, -y1, 0.0f});
+        float gap_z = std::max({z0, -z1, 0.0f});
+        std::uint32_t entering = 0;
+
+        if (gap_x == 0.0f && gap_y == 0.0f && gap_z == 0.0f) {
+            entering = all & ~result;
+        }
+        else if (gap_x * gap_x + gap_y * gap_y + gap_z * gap_z < max_distance * max_distance) {
+            for (std::uint32_t i = 0; i < count; i++) {
+                float tx0 = x0 * ix[i];
+                float tx1 = x1 * ix[i];
+                float ty0 = y0 * iy[i];
+                float ty1 = y1 * iy[i];
+                float tz0 = z0 * iz[i];
+                float tz1 = z1 * iz[i];
+                float t_enter = std::max(std::max(std::min(tx0, tx1), std::min(ty0, ty1)), std::max(std::min(tz0, tz1), 0.0f));
+                float t_exit = std::min(std::min(std::max(tx0, tx1), std::max(ty0, ty1)), std::min(std::max(tz0, tz1), max_distance));
+                entering |= t_enter <= t_exit ? lane_bits[i] : 0u;
+            }
+
+            entering &= ~result;
+        }
+
+        if (entering != 0) {
+            if (node.count > 0) {
+                for (std::uint32_t triangle = node.first; triangle < node.first + node.count; triangle++) {
+                    // Moller-Trumbore; with a shared origin t, q and the distance numerator are the same for every lane.
+                    const BvhTriangle& t = triangles[triangle];
+                    DirectX::XMFLOAT3 edge1 = {t.b.x - t.a.x, t.b.y - t.a.y, t.b.z - t.a.z};
+                    DirectX::XMFLOAT3 edge2 = {t.c.x - t.a.x, t.c.y - t.a.y, t.c.z - t.a.z};
+                    DirectX::XMFLOAT3 to_origin = {origin.x - t.a.x, origin.y - t.a.y, origin.z - t.a.z};
+                    DirectX::XMFLOAT3 q = {
+                            to_origin.y * edge1.z - to_origin.z * edge1.y,
+                            to_origin.z * edge1.x - to_origin.x * edge1.z,
+                            to_origin.x * edge1.y - to_origin.y * edge1.x
+                    };
+                    float distance_numerator = edge2.x * q.x + edge2.y * q.y + edge2.z * q.z;
+                    std::uint32_t hits = 0;
+
+                    for (std::uint32_t i = 0; i < count; i++) {
+                        float px = dy[i] * edge2.z - dz[i] * edge2.y;
+                        float py = dz[i] * edge2.x - dx[i] * edge2.z;
+                        float pz = dx[i] * edge2.y - dy[i] * edge2.x;
+                        float determinant = edge1.x * px + edge1.y * py + edge1.z * pz;
+                        float inverse_determinant = 1.0f / determinant;
+                        float u = (to_origin.x * px + to_origin.y * py + to_origin.z * pz) * inverse_determinant;
+                        float v = (dx[i] * q.x + dy[i] * q.y + dz[i] * q.z) * inverse_determinant;
+                        float distance = distance_numerator * inverse_determinant;
+
+                        // & instead of &&, so there are no branches in the loop
+                        bool hit = (std::fabs(determinant) >= 1e-12f) & (u >= 0.0f) & (v >= 0.0f) & (u + v <= 1.0f) &
+                                   (distance >= 0.0f) & (distance < max_distance);
+                        hits |= hit ? lane_bits[i] : 0u;
+                    }
+
+                    result |= hits & entering;
+                }
+
+                if ((result & all) == all) {
+                    return result;
+                }
+            }
+            else {
+                stack[stack_size++] = node.first + 1;
+                node_index = node.first;
+                continue;
+            }
+        }
+
+        if (stack_size == 0) {
+            return result;
+        }
+
+        node_index = stack[--stack_size];
+    }
+}
+
+const BvhTriangle& TriangleBvh::get_triangle(std::uint32_t triangle) const {
+    return triangles[triangle];
+}
+
+std::uint32_t TriangleBvh::get_triangle_index(std::uint32_t triangle) const {
+    return triangle_indices[triangle];
+}
+
+std::size_t TriangleBvh::get_number_of_triangles() const {
+    return triangles.size();
+}
+
+std::size_t TriangleBvh::get_number_of_nodes() const {
+    return triangles.empty() ? 0 : nodes.size();
+}
+
+Aabb TriangleBvh::get_bounds() const {
+    return triangles.empty() ? Aabb() : nodes[0].bounds;
+}
+
+bool TriangleBvh::empty() const {
+    return triangles.empty();
+}
@@ -0,0 +1,91 @@
+#ifndef PROJECT3D_TRIANGLE_BVH_H
+#define PROJECT3D_TRIANGLE_BVH_H
+
+#include <cfloat>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <DirectXMath.h>
+
+#include "bounds.h"
+#include "common.h"
+
+struct BvhTriangle {
+    DirectX::XMFLOAT3 a;
+    DirectX::XMFLOAT3 b;
+    DirectX::XMFLOAT3 c;
+};
+
+struct RayHit {
+    // Index of the triangle in the list the hierarchy was built from
+    std::uint32_t triangle;
+    std::uint32_t object;
+    float distance;
+
+    // Barycentric weights of b and c, a gets 1 - u - v
+    float u;
+    float v;
+
+    DirectX::XMFLOAT3 position;
+};
+
+// Bounding volume hierarchy over a triangle list, built top-down with binned
+// SAH. Nodes are 32 bytes and both children of a node are stored next to each
+// other. Triangles are reordered so that every leaf is a continuous range;
+// get_triangle_index maps them back to the order they were given in.
+class TriangleBvh {
+public:
+    static constexpr std::uint32_t MAX_LEAF_SIZE = 4;
+    static constexpr std::uint32_t NO_OBJECT = UINT32_MAX;
+    static constexpr std::uint32_t MAX_PACKET_SIZE = 32;
+
+    // Every three vertices form a triangle, like in the vertex buffer. objects is either
+    // empty or holds the object id (e.g. the submesh) of every triangle.
+    void build(const std::vector<Vertex>& vertices, std::vector<std::uint32_t> objects = {});
+    void build(std::vector<BvhTriangle> triangles, std::vector<std::uint32_t> objects = {});
+
+    // Appends the triangles whose bounds overlap the box. Returns the number of nodes visited.
+    std::size_t query(const Aabb& box, std::vector<std::uint32_t>& result) const;
+
+    // Closest triangle (either side) hit by the ray nearer than max_distance.
+    // Children are visited nearest first and skipped once they are behind the closest hit.
+    bool intersect(const Ray& ray, RayHit& hit, float max_distance = FLT_MAX) const;
+
+    // Any triangle nearer than max_distance (shadow rays), stops at the first one found.
+    bool occluded(const Ray& ray, float max_distance = FLT_MAX) const;
+
+    // Packet of up to MAX_PACKET_SIZE rays from one origin (ambient occlusion), bit i of the result is set
+    // when ray i is occluded. Nodes are visited once for all rays still unoccluded that enter them; the
+    // per ray loops work on arrays so that the compiler can vectorize them.
+    std::uint32_t occluded(const DirectX::XMFLOAT3& origin, const DirectX::XMFLOAT3* directions, std::uint32_t count,
+                           float max_distance = FLT_MAX) const;
+
+    const BvhTriangle& get_triangle(std::uint32_t triangle) const;
+
+    // Index of the triangle in the list the hierarchy was built from
+    std::uint32_t get_triangle_index(std::uint32_t triangle) const;
+
+    std::size_t get_number_of_triangles() const;
+    std::size_t get_number_of_nodes() const;
+    Aabb get_bounds() const;
+    bool empty() const;
+
+private:
+    struct Node {
+        Aabb bounds;
+
+        // Inner nodes: index of the left child, the right one follows it.
+        // Leaves: index of the first triangle.
+        std::uint32_t first;
+
+        // 0 for inner nodes
+        std::uint32_t count;
+    };
+
+    std::vector<Node> nodes;
+    std::vector<BvhTriangle> triangles;
+    std::vector<std::uint32_t> triangle_indices;
+    std::vector<std::uint32_t> triangle_objects;
+};
+
+#endif //PROJECT3D_TRIANGLE_BVH_H
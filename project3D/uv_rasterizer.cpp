@@ -0,0 +1,149 @@
+#include "uv_rasterizer.h"
+
+#include <algorithm>
+#include <cmath>
+
+std::vector<UvTexel> rasterize_uvs(const std::vector<Vertex>& vertices, std::uint32_t width, std::uint32_t height) {
+    std::vector<UvTexel> texels;
+    std::vector<bool> covered(static_cast<std::size_t>(width) * height, false);
+
+    for (std::size_t first = 0; first + 2 < vertices.size(); first += 3) {
+        const Vertex* corners = &vertices[first];
+        float tile_u = std::floor(std::min({corners[0].texture_coordinates.x, corners[1].texture_coordinates.x, corners[2].texture_coordinates.x}));
+        float tile_v = std::floor(std::min({corners[0].texture_coordinates.y, corners[1].texture_coordinates.y, corners[2].texture_coordinates.y}));
+        DirectX::XMFLOAT2 p[3];
+
+        for (int i = 0; i < 3; i++) {
+            p[i] = {
+                    (corners[i].texture_coordinates.x - tile_u) * static_cast<float>(width),
+                    (corners[i].texture_coordinates.y - tile_v) * static_cast<float>(height)
+            };
+        }
+
+        float area = (p[1].x - p[0].x) * (p[2].y - p[0].y) - (p[2].x - p[0].x) * (p[1].y - p[0].y);
+
+        if (std::fabs(area) < 1e-12f) {
+            continue;
+        }
+
+        int x0 = std::max(0, static_cast<int>(std::floor(std::min({p[0].x, p[1].x, p[2].x}))));
+        int x1 = std::min(static_cast<int>(width) - 1, static_cast<int>(std::ceil(std::max({p[0].x, p[1].x, p[2].x}))));
+        int y0 = std::max(0, static_cast<int>(std::floor(std::min({p[0].y, p[1].y, p[2].y}))));
+        int y1 = std::min(static_cast<int>(height) - 1, static_cast<int>(std::ceil(std::max({p[0].y, p[1].y, p[2].y}))));
+
+        for (int y = y0; y <= y1; y++) {
+            for (int x = x0; x <= x1; x++) {
+                std::size_t pixel = static_cast<std::size_t>(y) * width + static_cast<std::size_t>(x);
+
+                if (covered[pixel]) {
+                    continue;
+                }
+
+                float cx = static_cast<float>(x) + 0.5f;
+                float cy = static_cast<float>(y) + 0.5f;
+                float w1 = ((cx - p[0].x) * (p[2].y - p[0].y) - (p[2].x - p[0].x) * (cy - p[0].y)) / area;
+                float w2 = ((p[1].x - p[0].x) * (cy - p[0].y) - (cx - p[0].x) * (p[1].y - p[0].y)) / area;
+                float w0 = 1.0f - w1 - w2;
+
+                if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f) {
+                    continue;
+                }
+
+                UvTexel texel = {};
+                texel.pixel = static_cast<std::uint32_t>(pixel);
+                DirectX::XMStoreFloat3(&texel.position, DirectX::XMVectorAdd(
+                        DirectX::XMVectorAdd(
+                                DirectX::XMVectorScale(DirectX::XMLoadFloat3(&corners[0].position), w0),
+                                DirectX::XMVectorScale(DirectX::XMLoadFloat3(&corners[1].position), w1)),
+                        DirectX::XMVectorScale(DirectX::XMLoadFloat3(&corners[2].position), w2)));
+                texel.normal = get_interpolated_normal(corners, w1, w2);
+
+                covered[pixel] = true;
+                texels.push_back(texel);
+            }
+        }
+    }
+
+    return texels;
+}
+
+void pad_uv_charts(std::vector<float>& values, std::uint32_t channels, const std::vector<UvTexel>& texels,
+                   std::uint32_t width, std::uint32_t height, std::uint32_t rings) {
+    std::vector<bool> filled(static_cast<std::size_t>(width) * height, false);
+    std::vector<std::uint32_t> ring;
+
+    for (const UvTexel& texel : texels) {
+        filled[texel.pixel] = true;
+    }
+
+    for (std::uint32_t iteration = 0; iteration < rings; iteration++) {
+        ring.clear();
+
+        for (std::uint32_t y = 0; y < height; y++) {
+            for (std::uint32_t x = 0; x < width; x++) {
+                std::size_t pixel = static_cast<std::size_t>(y) * width + x;
+
+                if (filled[pixel]) {
+                    continue;
+                }
+
+                int count = 0;
+
+                for (std::uint32_t channel = 0; channel < channels; channel++) {
+                    values[pixel * channels + channel] = 0.0f;
+                }
+
+                for (int dy = -1; dy <= 1; dy++) {
+                    for (int dx = -1; dx <= 1; dx++) {
+                        int nx = static_cast<int>(x) + dx;
+                        int ny = static_cast<int>(y) + dy;
+
+                        if (nx < 0 || ny < 0 || nx >= static_cast<int>(width) || ny >= static_cast<int>(height)) {
+                            continue;
+                        }
+
+                        std::size_t neighbour = static_cast<std::size_t>(ny) * width + static_cast<std::size_t>(nx);
+
+                        if (filled[neighbour]) {
+                            for (std::uint32_t channel = 0; channel < channels; channel++) {
+                                values[pixel * channels + channel] += values[neighbour * channels + channel];
+                            }
+
+                            count++;
+                        }
+                    }
+                }
+
+                if (count > 0) {
+                    for (std::uint32_t channel = 0; channel < channels; channel++) {
+                        values[pixel * channels + channel] /= static_cast<float>(count);
+                    }
+
+                    ring.push_back(static_cast<std::uint32_t>(pixel));
+                }
+            }
+        }
+
+        for (std::uint32_t pixel : ring) {
+            filled[pixel] = true;
+        }
+    }
+}
+
+DirectX::XMFLOAT3 get_interpolated_normal(const Vertex* corners, float u, float v) {
+    DirectX::XMVECTOR normal = DirectX::XMVectorAdd(
+            DirectX::XMVectorAdd(
+                    DirectX::XMVectorScale(DirectX::XMLoadFloat3(&corners[0].normal), 1.0f - u - v),
+                    DirectX::XMVectorScale(DirectX::XMLoadFloat3(&corners[1].normal), u)),
+            DirectX::XMVectorScale(DirectX::XMLoadFloat3(&corners[2].normal), v));
+
+    if (DirectX::XMVectorGetX(DirectX::XMVector3LengthSq(normal)) < 1e-12f) {
+        normal = DirectX::XMVector3Cross(
+                DirectX::XMVectorSubtract(DirectX::XMLoadFloat3(&corners[1].position), DirectX::XMLoadFloat3(&corners[0].position)),
+                DirectX::XMVectorSubtract(DirectX::XMLoadFloat3(&corners[2].position), DirectX::XMLoadFloat3(&corners[0].position)));
+    }
+
+    DirectX::XMFLOAT3 result = {};
+    DirectX::XMStoreFloat3(&result, DirectX::XMVector3Normalize(normal));
+    return result;
+}
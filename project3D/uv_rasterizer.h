@@ -0,0 +1,34 @@
+#ifndef PROJECT3D_UV_RASTERIZER_H
+#define PROJECT3D_UV_RASTERIZER_H
+
+#include <cstdint>
+#include <vector>
+#include <DirectXMath.h>
+
+#include "common.h"
+
+// Surface point behind one texel of a texture mapped over a mesh
+struct UvTexel {
+    // y * width + x
+    std::uint32_t pixel;
+    DirectX::XMFLOAT3 position;
+    DirectX::XMFLOAT3 normal;
+};
+
+// Texels whose centers lie inside a triangle (every three vertices) in uv
+// space. Addressing wraps like the sampler, each triangle is moved into the
+// first tile as a whole. A texel belongs to the first triangle covering it;
+// uv charts are expected not to overlap.
+std::vector<UvTexel> rasterize_uvs(const std::vector<Vertex>& vertices, std::uint32_t width, std::uint32_t height);
+
+// values holds channels floats per pixel. Each of the rings of empty pixels
+// around the texels takes the average of its filled neighbours, so bilinear
+// filtering does not bleed the background into the charts.
+void pad_uv_charts(std::vector<float>& values, std::uint32_t channels, const std::vector<UvTexel>& texels,
+                   std::uint32_t width, std::uint32_t height, std::uint32_t rings);
+
+// Vertex normals interpolated with barycentrics (w0 = 1 - u - v), the face
+// normal for meshes without normals. Normalized.
+DirectX::XMFLOAT3 get_interpolated_normal(const Vertex* corners, float u, float v);
+
+#endif //PROJECT3D_UV_RASTERIZER_H
@@ -0,0 +1,359 @@
+#include "world_streamer.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    // Seconds over which the camera velocity used for prefetching is smoothed
+    constexpr float VELOCITY_SMOOTHING_TIME = 0.25f;
+
+    // Query boxes cover the whole world vertically, distances are horizontal.
+    constexpr float QUERY_HEIGHT = 1e30f;
+
+    Aabb get_world_bounds(const std::vector<WorldStreamer::Chunk>& chunks) {
+        Aabb bounds;
+
+        for (const auto& chunk : chunks) {
+            bounds.merge(chunk.bounds);
+        }
+
+        return bounds;
+    }
+
+    float get_horizontal_distance(const Aabb& bounds, DirectX::XMFLOAT3 point) {
+        float dx = std::max({bounds.min.x - point.x, 0.0f, point.x - bounds.max.x});
+        float dz = std::max({bounds.min.z - point.z, 0.0f, point.z - bounds.max.z});
+
+        return std::sqrt(dx * dx + dz * dz);
+    }
+}
+
+ThreadedChunkLoader::ThreadedChunkLoader(std::function<HRESULT(ChunkId)> load, unsigned thread_count) : load(std::move(load)) {
+    for (unsigned i = 0; i < std::max(thread_count, 1u); i++) {
+        threads.emplace_back(&ThreadedChunkLoader::thread_main, this);
+    }
+}
+
+ThreadedChunkLoader::~ThreadedChunkLoader() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        requests.clear();
+    }
+
+    requests_available.notify_all();
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+void ThreadedChunkLoader::request(ChunkId chunk) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        requests.push_back(chunk);
+    }
+
+    requests_available.notify_one();
+}
+
+void ThreadedChunkLoader::collect(std::vector<std::pair<ChunkId, HRESULT>>& completed) {
+    std::lock_guard<std::mutex> lock(mutex);
+    completed.insert(completed.end(), finished.begin(), finished.end());
+    finished.clear();
+}
+
+void ThreadedChunkLoader::thread_main() {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (true) {
+        requests_available.wait(lock, [this] { return stopping || !requests.empty(); });
+
+        if (stopping) {
+            return;
+        }
+
+        ChunkId chunk = requests.front();
+        requests.pop_front();
+
+        lock.unlock();
+        HRESULT hr = load(chunk);
+        lock.lock();
+
+        finished.emplace_back(chunk, hr);
+    }
+}
+
+WorldStreamer::WorldStreamer(std::vector<Chunk> chunk_list, ChunkLoader& loader, Callbacks callbacks, Options options)
+        : chunk_index(get_world_bounds(chunk_list)),
+          loader(loader),
+          callbacks(std::move(callbacks)),
+          options(options) {
+    chunks.resize(chunk_list.size());
+
+    for (std::size_t i = 0; i < chunk_list.size(); i++) {
+        chunks[i].chunk = chunk_list[i];
+        chunk_index.insert(chunk_list[i].bounds, static_cast<std::uint32_t>(i));
+    }
+}
+
+WorldStreamer::WorldStreamer(std::vector<Chunk> chunk_list, ChunkLoader& loader, Callbacks callbacks)
+        : WorldStreamer(std::move(chunk_list), loader, std::move(callbacks), Options()) {
+}
+
+WorldStreamer::~WorldStreamer() {
+    while (!loaded_chunks.empty()) {
+        evict(loaded_chunks.back());
+    }
+}
+
+void WorldStreamer::update(DirectX::XMFLOAT3 camera_position, float delta_time) {
+    time += delta_time;
+
+    if (has_position && delta_time > 0.0f) {
+        float alpha = std::min(delta_time / VELOCITY_SMOOTHING_TIME, 1.0f);
+        velocity = {
+                velocity.x + ((camera_position.x - position.x) / delta_time - velocity.x) * alpha,
+                velocity.y + ((camera_position.y - position.y) / delta_time - velocity.y) * alpha,
+                velocity.z + ((camera_position.z - position.z) / delta_time - velocity.z) * alpha
+        };
+    }
+
+    has_position = true;
+    position = camera_position;
+    prefetch_position = {
+            position.x + velocity.x * options.prefetch_time,
+            position.y + velocity.y * options.prefetch_time,
+            position.z + velocity.z * options.prefetch_time
+    };
+
+    statistics.uploaded_bytes = 0;
+
+    collect_loads();
+    evict_far_chunks();
+    request_near_chunks();
+    upload_loaded_chunks();
+}
+
+WorldStreamer::ChunkState WorldStreamer::get_state(ChunkId chunk) const {
+    return chunks[chunk].state;
+}
+
+const WorldStreamer::Chunk& WorldStreamer::get_chunk(ChunkId chunk) const {
+    return chunks[chunk].chunk;
+}
+
+std::size_t WorldStreamer::get_number_of_chunks() const {
+    return chunks.size();
+}
+
+const std::vector<ChunkId>& WorldStreamer::get_loaded_chunks() const {
+    return loaded_chunks;
+}
+
+const WorldStreamer::Statistics& WorldStreamer::get_statistics() const {
+    return statistics;
+}
+
+DirectX::XMFLOAT3 WorldStreamer::get_prefetch_position() const {
+    return prefetch_position;
+}
+
+float WorldStreamer::get_distance(const Aabb& bounds) const {
+    return std::min(get_horizontal_distance(bounds, position), get_horizontal_distance(bounds, prefetch_position));
+}
+
+void WorldStreamer::collect_loads() {
+    completed.clear();
+    loader.collect(completed);
+
+    for (const auto& [chunk, hr] : completed) {
+        ChunkEntry& entry = chunks[chunk];
+        statistics.pending_loads--;
+
+        if (FAILED(hr)) {
+            entry.state = ChunkState::UNLOADED;
+            statistics.used_bytes -= entry.chunk.size_bytes;
+            statistics.failed_loads++;
+        }
+        else {
+            entry.state = ChunkState::LOADED;
+            add_to_loaded(chunk);
+        }
+    }
+}
+
+void WorldStreamer::evict_far_chunks() {
+    for (std::size_t i = loaded_chunks.size(); i-- > 0;) {
+        ChunkEntry& entry = chunks[loaded_chunks[i]];
+        entry.distance = get_distance(entry.chunk.bounds);
+
+        if (entry.distance > options.unload_radius) {
+            evict(loaded_chunks[i]);
+        }
+    }
+}
+
+void WorldStreamer::request_near_chunks() {
+    if (statistics.pending_loads >= options.max_pending_loads) {
+        return;
+    }
+
+    DirectX::XMFLOAT3 extents = {options.load_radius, QUERY_HEIGHT, options.load_radius};
+    chunk_index.query_ranges({
+            Aabb::from_center_extents(position, extents),
+            Aabb::from_center_extents(prefetch_position, extents)
+    }, query_results);
+
+    candidates.clear();
+
+    for (const auto& result : query_results) {
+        for (SpatialIndex::ObjectId object : result) {
+            ChunkId chunk = chunk_index.get_user_data(object);
+            ChunkEntry& entry = chunks[chunk];
+
+            if (entry.state == ChunkState::UNLOADED) {
+                entry.distance = get_distance(entry.chunk.bounds);
+
+                if (entry.distance <= options.load_radius) {
+                    candidates.push_back(chunk);
+                }
+            }
+        }
+    }
+
+    std::sort(candidates.begin(), candidates.end(), [this](ChunkId a, ChunkId b) {
+        return chunks[a].distance < chunks[b].distance || (chunks[a].distance == chunks[b].distance && a < b);
+    });
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+    float hysteresis = std::max(options.unload_radius - options.load_radius, 0.0f);
+
+    for (ChunkId chunk : candidates) {
+        ChunkEntry& entry = chunks[chunk];
+
+        if (statistics.pending_loads >= options.max_pending_loads) {
+            break;
+        }
+
+        if (entry.chunk.size_bytes > options.memory_budget) {
+            continue;
+        }
+
+        // Candidates are sorted, once nothing further away can make room no later one fits either.
+        bool fits = true;
+
+        while (statistics.used_bytes + entry.chunk.size_bytes > options.memory_budget) {
+            if (!evict_further_than(entry.distance + hysteresis)) {
+                fits = false;
+                break;
+            }
+
+            statistics.budget_evictions++;
+        }
+
+        if (!fits) {
+            break;
+        }
+
+        if (entry.evicted_at >= 0.0 && time - entry.evicted_at < options.reload_window) {
+            statistics.reloads++;
+        }
+
+        entry.state = ChunkState::LOADING;
+        statistics.used_bytes += entry.chunk.size_bytes;
+        statistics.peak_used_bytes = std::max(statistics.peak_used_bytes, statistics.used_bytes);
+        statistics.pending_loads++;
+        statistics.loads++;
+        loader.request(chunk);
+    }
+}
+
+void WorldStreamer::upload_loaded_chunks() {
+    candidates.clear();
+
+    for (ChunkId chunk : loaded_chunks) {
+        if (chunks[chunk].state == ChunkState::LOADED) {
+            candidates.push_back(chunk);
+        }
+    }
+
+    std::sort(candidates.begin(), candidates.end(), [this](ChunkId a, ChunkId b) {
+        return chunks[a].distance < chunks[b].distance;
+    });
+
+    for (ChunkId chunk : candidates) {
+        ChunkEntry& entry = chunks[chunk];
+
+        if (statistics.uploaded_bytes > 0 && statistics.uploaded_bytes + entry.chunk.size_bytes > options.upload_budget) {
+            break;
+        }
+
+        HRESULT hr = callbacks.upload ? callbacks.upload(chunk) : S_OK;
+
+        if (FAILED(hr)) {
+            evict(chunk);
+            statistics.failed_loads++;
+            continue;
+        }
+
+        entry.state = ChunkState::RESIDENT;
+        statistics.resident_chunks++;
+        statistics.uploads++;
+        statistics.uploaded_bytes += entry.chunk.size_bytes;
+    }
+
+    statistics.max_uploaded_bytes = std::max(statistics.max_uploaded_bytes, statistics.uploaded_bytes);
+}
+
+bool WorldStreamer::evict_further_than(float distance) {
+    ChunkId furthest = 0;
+    float furthest_distance = distance;
+    bool found = false;
+
+    for (ChunkId chunk : loaded_chunks) {
+        if (chunks[chunk].distance > furthest_distance) {
+            furthest = chunk;
+            furthest_distance = chunks[chunk].distance;
+            found = true;
+        }
+    }
+
+    if (found) {
+        evict(furthest);
+    }
+
+    return found;
+}
+
+void WorldStreamer::evict(ChunkId chunk) {
+    ChunkEntry& entry = chunks[chunk];
+
+    if (callbacks.evict) {
+        callbacks.evict(chunk);
+    }
+
+    if (entry.state == ChunkState::RESIDENT) {
+        statistics.resident_chunks--;
+    }
+
+    remove_from_loaded(chunk);
+    entry.state = ChunkState::UNLOADED;
+    entry.evicted_at = time;
+    statistics.used_bytes -= entry.chunk.size_bytes;
+    statistics.evictions++;
+}
+
+void WorldStreamer::add_to_loaded(ChunkId chunk) {
+    chunks[chunk].index_in_loaded = static_cast<std::uint32_t>(loaded_chunks.size());
+    chunks[chunk].distance = get_distance(chunks[chunk].chunk.bounds);
+    loaded_chunks.push_back(chunk);
+}
+
+void WorldStreamer::remove_from_loaded(ChunkId chunk) {
+    std::uint32_t index = chunks[chunk].index_in_loaded;
+
+    loaded_chunks[index] = loaded_chunks.back();
+    chunks[loaded_chunks[index]].index_in_loaded = index;
+    loaded_chunks.pop_back();
+}
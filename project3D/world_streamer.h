@@ -0,0 +1,184 @@
+#ifndef PROJECT3D_WORLD_STREAMER_H
+#define PROJECT3D_WORLD_STREAMER_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <DirectXMath.h>
+
+#include "bounds.h"
+#include "hresult.h"
+#include "spatial_index.h"
+
+using ChunkId = std::uint32_t;
+
+// Runs chunk loads (disk reads, decompression) away from the frame. Results
+// are picked up by WorldStreamer::update on the main thread.
+class ChunkLoader {
+public:
+    virtual ~ChunkLoader() = default;
+
+    virtual void request(ChunkId chunk) = 0;
+
+    // Appends the loads finished since the last call together with their result.
+    virtual void collect(std::vector<std::pair<ChunkId, HRESULT>>& completed) = 0;
+};
+
+// Calls load on a few dedicated background threads, in request order.
+class ThreadedChunkLoader : public ChunkLoader {
+public:
+    ThreadedChunkLoader(std::function<HRESULT(ChunkId)> load, unsigned thread_count = 2);
+    ~ThreadedChunkLoader() override;
+
+    ThreadedChunkLoader(const ThreadedChunkLoader&) = delete;
+    ThreadedChunkLoader& operator=(const ThreadedChunkLoader&) = delete;
+
+    void request(ChunkId chunk) override;
+    void collect(std::vector<std::pair<ChunkId, HRESULT>>& completed) override;
+
+private:
+    void thread_main();
+
+    std::function<HRESULT(ChunkId)> load;
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable requests_available;
+    std::deque<ChunkId> requests;
+    std::vector<std::pair<ChunkId, HRESULT>> finished;
+    bool stopping = false;
+};
+
+// Keeps the chunks around the camera in memory. Every update:
+//  - finished loads are collected,
+//  - chunks further than unload_radius from the camera and from the prefetch
+//    point (where the camera will be in prefetch_time at its current velocity)
+//    are evicted,
+//  - chunks within load_radius of either point are requested closest first,
+//    evicting the furthest chunks when the memory budget would be exceeded,
+//  - loaded chunks are uploaded closest first, at most upload_budget bytes
+//    per update (but always at least one chunk, so large chunks still arrive).
+// The gap between load_radius and unload_radius is the hysteresis: a chunk is
+// not dropped as soon as it leaves the load radius, and budget evictions only
+// take chunks that are that much further away than the one being loaded.
+// Distances are measured in the x / z plane from the chunk bounds.
+class WorldStreamer {
+public:
+    enum class ChunkState { UNLOADED, LOADING, LOADED, RESIDENT };
+
+    struct Options {
+        float load_radius = 96.0f;
+        float unload_radius = 128.0f;
+        float prefetch_time = 2.0f;
+
+        // Bytes of loading, loaded and resident chunks
+        std::size_t memory_budget = std::size_t{512} << 20;
+
+        // Bytes uploaded per update
+        std::size_t upload_budget = std::size_t{8} << 20;
+
+        std::size_t max_pending_loads = 8;
+
+        // A load of a chunk evicted less than this many seconds ago counts as a reload
+        float reload_window = 10.0f;
+    };
+
+    // Both are called from update() on the calling thread.
+    struct Callbacks {
+        // Creates the GPU resources of a loaded chunk.
+        std::function<HRESULT(ChunkId)> upload;
+        // Releases whatever load / upload created for the chunk.
+        std::function<void(ChunkId)> evict;
+    };
+
+    struct Chunk {
+        Aabb bounds;
+        std::size_t size_bytes;
+    };
+
+    struct Statistics {
+        std::size_t used_bytes = 0;
+        std::size_t peak_used_bytes = 0;
+        std::size_t pending_loads = 0;
+        std::size_t resident_chunks = 0;
+        std::size_t loads = 0;
+        std::size_t failed_loads = 0;
+        std::size_t reloads = 0;
+        std::size_t evictions = 0;
+        std::size_t budget_evictions = 0;
+        std::size_t uploads = 0;
+        std::size_t uploaded_bytes = 0;
+        std::size_t max_uploaded_bytes = 0;
+    };
+
+    WorldStreamer(std::vector<Chunk> chunks, ChunkLoader& loader, Callbacks callbacks, Options options);
+    WorldStreamer(std::vector<Chunk> chunks, ChunkLoader& loader, Callbacks callbacks);
+
+    // Evicts the loaded chunks. Loads still in flight are not waited for, so the
+    // loader has to outlive the streamer.
+    ~WorldStreamer();
+
+    WorldStreamer(const WorldStreamer&) = delete;
+    WorldStreamer& operator=(const WorldStreamer&) = delete;
+
+    void update(DirectX::XMFLOAT3 camera_position, float delta_time);
+
+    ChunkState get_state(ChunkId chunk) const;
+    const Chunk& get_chunk(ChunkId chunk) const;
+    std::size_t get_number_of_chunks() const;
+
+    // Chunks that are loaded or resident, in no particular order
+    const std::vector<ChunkId>& get_loaded_chunks() const;
+
+    // uploaded_bytes covers the last update only, the other counters the whole run.
+    const Statistics& get_statistics() const;
+
+    // Where the camera is expected to be after prefetch_time
+    DirectX::XMFLOAT3 get_prefetch_position() const;
+
+private:
+    struct ChunkEntry {
+        Chunk chunk;
+        ChunkState state = ChunkState::UNLOADED;
+        float distance = 0.0f;
+        double evicted_at = -1.0;
+        std::uint32_t index_in_loaded = 0;
+    };
+
+    float get_distance(const Aabb& bounds) const;
+    void collect_loads();
+    void evict_far_chunks();
+    void request_near_chunks();
+    void upload_loaded_chunks();
+    bool evict_further_than(float distance);
+    void evict(ChunkId chunk);
+    void add_to_loaded(ChunkId chunk);
+    void remove_from_loaded(ChunkId chunk);
+
+    std::vector<ChunkEntry> chunks;
+    SpatialIndex chunk_index;
+    ChunkLoader& loader;
+    Callbacks callbacks;
+    Options options;
+    Statistics statistics;
+
+    // Chunks in the LOADED or RESIDENT state
+    std::vector<ChunkId> loaded_chunks;
+
+    double time = 0.0;
+    bool has_position = false;
+    DirectX::XMFLOAT3 position = {};
+    DirectX::XMFLOAT3 velocity = {};
+    DirectX::XMFLOAT3 prefetch_position = {};
+
+    std::vector<std::pair<ChunkId, HRESULT>> completed;
+    std::vector<std::vector<SpatialIndex::ObjectId>> query_results;
+    std::vector<ChunkId> candidates;
+};
+
+#endif //PROJECT3D_WORLD_STREAMER_H